@@ -0,0 +1,193 @@
+#include "CaptureReplay.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "Core.h"
+#include "MessageRecording.h"
+#include "PrintVar.h"
+#include "TcpServer.h"
+#include "Utils.h"
+
+namespace {
+double GetSeconds(std::chrono::steady_clock::duration a_Duration) {
+  return std::chrono::duration<double>(a_Duration).count();
+}
+
+// Stops and deletes GTcpServer on every return of CaptureReplay::Run.
+struct TcpServerGuard {
+  ~TcpServerGuard() {
+    GTcpServer->Stop();
+    delete GTcpServer;
+    GTcpServer = nullptr;
+  }
+};
+}  // namespace
+
+//-----------------------------------------------------------------------------
+CaptureReplay::CaptureReplay(const std::string& a_RecordingPath,
+                             unsigned short a_Port, double a_Speed,
+                             bool a_Once)
+    : m_RecordingPath(a_RecordingPath),
+      m_Port(a_Port),
+      m_Speed(a_Speed),
+      m_Once(a_Once),
+      m_StartRequested(false),
+      m_StopRequested(false) {}
+
+//-----------------------------------------------------------------------------
+CaptureReplay::~CaptureReplay() {}
+
+//-----------------------------------------------------------------------------
+bool CaptureReplay::IsCaptureMessage(MessageType a_Type) {
+  switch (a_Type) {
+    case Msg_RemoteTimers:
+    case Msg_RemoteCallStack:
+    case Msg_RemoteSymbol:
+    case Msg_SamplingCallstack:
+    case Msg_SamplingCallstacks:
+    case Msg_SamplingHashedCallstacks:
+    case Msg_TimerCallstack:
+    case Msg_RemoteContextSwitches:
+      return true;
+    default:
+      return false;
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool CaptureReplay::Run() {
+  MessageRecordingReader reader;
+  if (!reader.Open(m_RecordingPath)) {
+    PRINT("Could not read recording %s\n", m_RecordingPath.c_str());
+    return false;
+  }
+
+  GTcpServer = new TcpServer();
+  TcpServerGuard serverGuard;
+  // As OrbitService does, see ConnectionManager::SetupServerCallbacks.
+  GTcpServer->AddCallback(Msg_EnableCompression, [](const Message& a_Msg) {
+    bool enabled = a_Msg.m_Header.m_GenericHeader.m_Address != 0;
+    PRINT("Capture traffic compression %s\n", enabled ? "on" : "off");
+    GTcpServer->SetCompressionEnabled(enabled);
+  });
+  GTcpServer->AddCallback(Msg_StartCapture, [this](const Message&) {
+    m_StopRequested = false;
+    m_StartRequested = true;
+  });
+  GTcpServer->AddCallback(Msg_StopCapture,
+                          [this](const Message&) { m_StopRequested = true; });
+  GTcpServer->Start(m_Port);
+  PRINT("Replaying %s on port %u at speed %g\n", m_RecordingPath.c_str(),
+        m_Port, m_Speed);
+
+  bool connected = false;
+  while (true) {
+    if (GTcpServer->HasConnection() != connected) {
+      connected = !connected;
+      if (connected && !SendPreamble()) return false;
+    }
+
+    if (connected && m_StartRequested.exchange(false)) {
+      if (!Replay()) return false;
+      if (m_Once) break;
+    }
+
+    Sleep(16);
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool CaptureReplay::SendPreamble() {
+  MessageRecordingReader reader;
+  reader.Open(m_RecordingPath);
+  RecordedMessage recorded;
+  uint32_t numMessages = 0;
+  while (reader.Read(&recorded) &&
+         !IsCaptureMessage(recorded.message.GetType())) {
+    // Msg_Unload is the client's own notice of a lost connection.
+    if (recorded.message.GetType() == Msg_Unload) continue;
+    GTcpServer->Send(recorded.message, recorded.payload.data());
+    ++numMessages;
+  }
+
+  if (reader.HasError()) {
+    PRINT("Malformed recording %s\n", m_RecordingPath.c_str());
+    return false;
+  }
+  PRINT("Client connected, sent %u messages preceding the capture\n",
+        numMessages);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool CaptureReplay::Replay() {
+  MessageRecordingReader reader;
+  reader.Open(m_RecordingPath);
+  RecordedMessage recorded;
+  bool hasRecord = reader.Read(&recorded);
+  while (hasRecord && !IsCaptureMessage(recorded.message.GetType())) {
+    hasRecord = reader.Read(&recorded);
+  }
+
+  const uint64_t firstTimeNs = recorded.time_ns;
+  const uint64_t numSentBytes = GTcpServer->GetNumSentBytes();
+  const uint64_t numBlockedSends = GTcpServer->GetNumBlockedSends();
+  uint64_t numMessages = 0;
+  uint64_t numPayloadBytes = 0;
+  uint64_t recordedNs = 0;
+  std::chrono::steady_clock::duration maxLag{0};
+  auto start = std::chrono::steady_clock::now();
+
+  for (; hasRecord && !m_StopRequested && GTcpServer->HasConnection();
+       hasRecord = reader.Read(&recorded)) {
+    if (recorded.message.GetType() == Msg_Unload) continue;
+
+    recordedNs = recorded.time_ns - firstTimeNs;
+    if (m_Speed > 0) {
+      auto due = start + std::chrono::nanoseconds(
+                             static_cast<uint64_t>(recordedNs / m_Speed));
+      auto now = std::chrono::steady_clock::now();
+      if (now < due) {
+        std::this_thread::sleep_until(due);
+      } else {
+        maxLag = std::max(maxLag, now - due);
+      }
+    }
+
+    GTcpServer->Send(recorded.message, recorded.payload.data());
+    ++numMessages;
+    numPayloadBytes += recorded.message.m_Size;
+  }
+
+  if (reader.HasError()) {
+    PRINT("Malformed recording %s\n", m_RecordingPath.c_str());
+    return false;
+  }
+
+  // The send queue is bounded, a client that can't keep up slows the replay
+  // down. Wait for the tail of the capture to be sent.
+  while (GTcpServer->GetNumQueuedBytes() != 0 && GTcpServer->HasConnection()) {
+    Sleep(1);
+  }
+  double seconds = GetSeconds(std::chrono::steady_clock::now() - start);
+  uint64_t sentBytes = GTcpServer->GetNumSentBytes() - numSentBytes;
+
+  PRINT("Replayed %llu messages, %s of payload, in %.3f s (recorded %.3f s)\n",
+        (unsigned long long)numMessages,
+        GetPrettySize(numPayloadBytes).c_str(), seconds, recordedNs / 1e9);
+  PRINT("%.0f messages/s, %s/s of payload, %s/s on the wire\n",
+        numMessages / seconds,
+        GetPrettySize(static_cast<uint64_t>(numPayloadBytes / seconds)).c_str(),
+        GetPrettySize(static_cast<uint64_t>(sentBytes / seconds)).c_str());
+  PRINT("Max lag behind schedule %.3f s, %llu sends waited for the client\n",
+        GetSeconds(maxLag),
+        (unsigned long long)(GTcpServer->GetNumBlockedSends() -
+                             numBlockedSends));
+  if (GTcpServer->IsCompressionEnabled()) {
+    PRINT("Compression ratio %.2f\n", GTcpServer->GetCompressionRatio());
+  }
+  return true;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "Message.h"
+
+// Plays a client's recording (see MessageRecording.h) back over TcpServer,
+// standing in for OrbitService to benchmark the client's capture pipeline
+// without a target. Messages recorded before the first capture message are
+// sent on connection, the capture messages when the client starts a capture,
+// with their recorded timing divided by the speed. A speed of 0 sends them
+// as fast as the connection takes them.
+class CaptureReplay {
+ public:
+  CaptureReplay(const std::string& a_RecordingPath, unsigned short a_Port,
+                double a_Speed, bool a_Once);
+  ~CaptureReplay();
+
+  // Returns false if the recording can't be read.
+  bool Run();
+
+  static bool IsCaptureMessage(MessageType a_Type);
+
+ private:
+  bool SendPreamble();
+  bool Replay();
+
+  std::string m_RecordingPath;
+  unsigned short m_Port;
+  double m_Speed;
+  bool m_Once;
+  std::atomic<bool> m_StartRequested;
+  std::atomic<bool> m_StopRequested;
+};
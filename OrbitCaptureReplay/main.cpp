@@ -0,0 +1,81 @@
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "CaptureReplay.h"
+
+namespace {
+void PrintUsage() {
+  std::cout << "Usage: OrbitCaptureReplay <recording> [--port=44766] "
+               "[--speed=1] [--once]\n"
+               "Recordings are made with Orbit's \"record:<file>\" argument. "
+               "--speed=0 replays\nas fast as possible, --once exits after "
+               "the first replayed capture."
+            << std::endl;
+}
+
+// The whole of "a_Text" must be a number, in range.
+bool ParsePort(const std::string& a_Text, unsigned short* a_Port) {
+  char* end = nullptr;
+  errno = 0;
+  long port = std::strtol(a_Text.c_str(), &end, 10);
+  if (a_Text.empty() || *end != '\0' || errno != 0 || port < 1 ||
+      port > 65535) {
+    return false;
+  }
+  *a_Port = static_cast<unsigned short>(port);
+  return true;
+}
+
+bool ParseSpeed(const std::string& a_Text, double* a_Speed) {
+  char* end = nullptr;
+  errno = 0;
+  double speed = std::strtod(a_Text.c_str(), &end);
+  if (a_Text.empty() || *end != '\0' || errno != 0 || !std::isfinite(speed) ||
+      speed < 0) {
+    return false;
+  }
+  *a_Speed = speed;
+  return true;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::string recording;
+  unsigned short port = 44766;
+  double speed = 1.0;
+  bool once = false;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.rfind("--port=", 0) == 0) {
+      if (!ParsePort(arg.substr(7), &port)) {
+        std::cout << "Invalid port " << arg.substr(7) << std::endl;
+        PrintUsage();
+        return 1;
+      }
+    } else if (arg.rfind("--speed=", 0) == 0) {
+      if (!ParseSpeed(arg.substr(8), &speed)) {
+        std::cout << "Invalid speed " << arg.substr(8) << std::endl;
+        PrintUsage();
+        return 1;
+      }
+    } else if (arg == "--once") {
+      once = true;
+    } else if (recording.empty() && arg.rfind("--", 0) != 0) {
+      recording = arg;
+    } else {
+      PrintUsage();
+      return 1;
+    }
+  }
+  if (recording.empty()) {
+    PrintUsage();
+    return 1;
+  }
+
+  CaptureReplay replay(recording, port, speed, once);
+  return replay.Run() ? 0 : 1;
+}
@@ -156,11 +156,14 @@ struct BlockChain {
 
   uint32_t size() const { return m_NumItems; }
 
+  // Last element pushed, the chain must not be empty.
+  T& back() { return m_Current->m_Data[m_Current->m_Size - 1]; }
+
   T* SlowAt(uint32_t a_Index) {
     if (a_Index < m_NumItems && a_Index >= 0) {
       uint32_t count = 1;
       Block<T, BlockSize>* block = m_Root;
-      while (count * BlockSize < a_Index && block && block->m_Next) {
+      while (count * BlockSize <= a_Index && block && block->m_Next) {
         block = block->m_Next;
         ++count;
       }
@@ -0,0 +1,106 @@
+#ifndef ORBIT_CORE_BYTE_CODING_H_
+#define ORBIT_CORE_BYTE_CODING_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Primitives of the compact binary encodings of capture data. Integers are
+// LEB128 varints, signed values are zigzag encoded and fixed size values are
+// little-endian, so the encodings don't depend on the host.
+
+// Appends to a buffer.
+class ByteWriter {
+ public:
+  explicit ByteWriter(std::string* buffer) : buffer_(buffer) {}
+
+  void PutByte(uint8_t value) { buffer_->push_back(static_cast<char>(value)); }
+  void PutVarint(uint64_t value) {
+    while (value >= 0x80) {
+      PutByte(static_cast<uint8_t>(value) | 0x80);
+      value >>= 7;
+    }
+    PutByte(static_cast<uint8_t>(value));
+  }
+  void PutZigZag(int64_t value) {
+    PutVarint((static_cast<uint64_t>(value) << 1) ^
+              static_cast<uint64_t>(value >> 63));
+  }
+  void PutFixed64(uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+      PutByte(static_cast<uint8_t>(value >> (8 * i)));
+    }
+  }
+  void PutString(const std::string& value) {
+    PutVarint(value.size());
+    buffer_->append(value);
+  }
+
+ private:
+  std::string* buffer_;
+};
+
+// Reads from a buffer in place. Reading past the end returns zeros and clears
+// ok(), so that callers only need to check once per decoded item.
+class ByteReader {
+ public:
+  ByteReader(const char* data, size_t size)
+      : pos_(reinterpret_cast<const uint8_t*>(data)), end_(pos_ + size) {}
+
+  bool ok() const { return ok_; }
+  size_t GetRemainingSize() const { return end_ - pos_; }
+
+  uint8_t GetByte() {
+    if (pos_ == end_) {
+      ok_ = false;
+      return 0;
+    }
+    return *pos_++;
+  }
+  uint64_t GetVarint() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      uint8_t byte = GetByte();
+      value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) return value;
+    }
+    ok_ = false;
+    return 0;
+  }
+  int64_t GetZigZag() {
+    uint64_t value = GetVarint();
+    return static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1));
+  }
+  uint64_t GetFixed64() {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+      value |= static_cast<uint64_t>(GetByte()) << (8 * i);
+    }
+    return value;
+  }
+  void GetString(std::string* value) {
+    uint64_t size = GetVarint();
+    if (size > GetRemainingSize()) {
+      ok_ = false;
+      return;
+    }
+    value->assign(reinterpret_cast<const char*>(pos_), size);
+    pos_ += size;
+  }
+
+  // Reads a format version byte, which must be "version", and a number of
+  // items. Every item taking at least one byte bounds the count of malformed
+  // data.
+  bool GetHeader(uint8_t version, uint64_t* num_items) {
+    if (GetByte() != version) return false;
+    *num_items = GetVarint();
+    return ok_ && *num_items <= GetRemainingSize();
+  }
+
+ private:
+  const uint8_t* pos_;
+  const uint8_t* end_;
+  bool ok_ = true;
+};
+
+#endif  // ORBIT_CORE_BYTE_CODING_H_
@@ -0,0 +1,149 @@
+#include "CallTree.h"
+
+#include <algorithm>
+
+namespace {
+void SortByDecreasingCount(std::vector<CallTree::FunctionCount>* counts) {
+  std::sort(counts->begin(), counts->end(),
+            [](const CallTree::FunctionCount& a,
+               const CallTree::FunctionCount& b) {
+              if (a.count != b.count) return a.count > b.count;
+              return a.function_address < b.function_address;
+            });
+}
+
+std::vector<CallTree::FunctionCount> ToFunctionCounts(
+    const absl::flat_hash_map<uint64_t, uint64_t>& count_map) {
+  std::vector<CallTree::FunctionCount> counts;
+  counts.reserve(count_map.size());
+  for (const auto& pair : count_map) {
+    counts.push_back({pair.first, pair.second});
+  }
+  SortByDecreasingCount(&counts);
+  return counts;
+}
+}  // namespace
+
+CallTree::CallTree(Direction direction) : direction_(direction) { Clear(); }
+
+void CallTree::Clear() {
+  nodes_.clear();
+  child_lookup_.clear();
+  function_to_nodes_.clear();
+  nodes_.emplace_back();
+}
+
+void CallTree::AddCallstack(const uint64_t* frames, uint32_t depth,
+                            uint64_t count) {
+  if (depth == 0 || count == 0) return;
+
+  uint32_t node_index = kRootIndex;
+  nodes_[kRootIndex].inclusive_count += count;
+  for (uint32_t i = 0; i < depth; ++i) {
+    uint64_t function_address = direction_ == Direction::kTopDown
+                                    ? frames[depth - 1 - i]
+                                    : frames[i];
+    node_index = GetOrCreateChild(node_index, function_address);
+    nodes_[node_index].inclusive_count += count;
+  }
+  nodes_[node_index].exclusive_count += count;
+}
+
+uint32_t CallTree::GetOrCreateChild(uint32_t parent_index,
+                                    uint64_t function_address) {
+  auto it = child_lookup_.find(std::make_pair(parent_index, function_address));
+  if (it != child_lookup_.end()) return it->second;
+
+  uint32_t child_index = static_cast<uint32_t>(nodes_.size());
+  Node child;
+  child.function_address = function_address;
+  child.parent = parent_index;
+  child.depth = nodes_[parent_index].depth + 1;
+  child.next_sibling = nodes_[parent_index].first_child;
+  nodes_.push_back(child);
+
+  Node& parent = nodes_[parent_index];
+  parent.first_child = child_index;
+  ++parent.num_children;
+
+  child_lookup_.emplace(std::make_pair(parent_index, function_address),
+                        child_index);
+  function_to_nodes_[function_address].push_back(child_index);
+  return child_index;
+}
+
+std::vector<uint32_t> CallTree::GetChildren(uint32_t node_index) const {
+  std::vector<uint32_t> children;
+  const Node& node = nodes_[node_index];
+  children.reserve(node.num_children);
+  for (uint32_t child = node.first_child; child != kInvalidIndex;
+       child = nodes_[child].next_sibling) {
+    children.push_back(child);
+  }
+
+  std::sort(children.begin(), children.end(), [this](uint32_t a, uint32_t b) {
+    if (nodes_[a].inclusive_count != nodes_[b].inclusive_count) {
+      return nodes_[a].inclusive_count > nodes_[b].inclusive_count;
+    }
+    return nodes_[a].function_address < nodes_[b].function_address;
+  });
+  return children;
+}
+
+uint32_t CallTree::FindChild(uint32_t parent_index,
+                             uint64_t function_address) const {
+  auto it = child_lookup_.find(std::make_pair(parent_index, function_address));
+  return it != child_lookup_.end() ? it->second : kInvalidIndex;
+}
+
+std::vector<uint64_t> CallTree::GetPath(uint32_t node_index) const {
+  std::vector<uint64_t> path(nodes_[node_index].depth);
+  for (uint32_t index = node_index; index != kRootIndex;
+       index = nodes_[index].parent) {
+    path[nodes_[index].depth - 1] = nodes_[index].function_address;
+  }
+  return path;
+}
+
+const std::vector<uint32_t>& CallTree::GetNodesOfFunction(
+    uint64_t function_address) const {
+  static const std::vector<uint32_t> kNoNodes;
+  auto it = function_to_nodes_.find(function_address);
+  return it != function_to_nodes_.end() ? it->second : kNoNodes;
+}
+
+std::vector<CallTree::FunctionCount> CallTree::GetParentCounts(
+    uint64_t function_address) const {
+  absl::flat_hash_map<uint64_t, uint64_t> count_map;
+  for (uint32_t node_index : GetNodesOfFunction(function_address)) {
+    const Node& node = nodes_[node_index];
+    if (node.parent == kRootIndex) continue;
+    count_map[nodes_[node.parent].function_address] += node.inclusive_count;
+  }
+  return ToFunctionCounts(count_map);
+}
+
+std::vector<CallTree::FunctionCount> CallTree::GetChildCounts(
+    uint64_t function_address) const {
+  absl::flat_hash_map<uint64_t, uint64_t> count_map;
+  for (uint32_t node_index : GetNodesOfFunction(function_address)) {
+    for (uint32_t child = nodes_[node_index].first_child;
+         child != kInvalidIndex; child = nodes_[child].next_sibling) {
+      count_map[nodes_[child].function_address] +=
+          nodes_[child].inclusive_count;
+    }
+  }
+  return ToFunctionCounts(count_map);
+}
+
+std::vector<CallTree::FunctionCount> CallTree::GetCallers(
+    uint64_t function_address) const {
+  return direction_ == Direction::kTopDown ? GetParentCounts(function_address)
+                                           : GetChildCounts(function_address);
+}
+
+std::vector<CallTree::FunctionCount> CallTree::GetCallees(
+    uint64_t function_address) const {
+  return direction_ == Direction::kTopDown ? GetChildCounts(function_address)
+                                           : GetParentCounts(function_address);
+}
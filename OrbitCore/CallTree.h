@@ -0,0 +1,92 @@
+#ifndef ORBIT_CORE_CALL_TREE_H_
+#define ORBIT_CORE_CALL_TREE_H_
+
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+
+// Prefix tree of resolved callstacks, aggregated as samples come in.
+// Nodes are stored contiguously and linked to their parent, first child and
+// next sibling by index, so that expanding a node in the UI only costs a walk
+// over its direct children and never requires re-aggregating the samples.
+//
+// A top-down tree has the outermost frames (e.g. "main") as children of the
+// root, while a bottom-up (inverted) tree has the innermost frames, i.e. the
+// functions that were actually executing when the sample was taken, as
+// children of the root. In both cases the inclusive count of a node is the
+// number of samples whose path goes through that node, and the exclusive
+// count is the number of samples whose path ends at that node.
+class CallTree {
+ public:
+  enum class Direction { kTopDown, kBottomUp };
+
+  static constexpr uint32_t kRootIndex = 0;
+  static constexpr uint32_t kInvalidIndex =
+      std::numeric_limits<uint32_t>::max();
+
+  struct Node {
+    uint64_t function_address = 0;
+    uint64_t inclusive_count = 0;
+    uint64_t exclusive_count = 0;
+    uint32_t parent = kInvalidIndex;
+    uint32_t first_child = kInvalidIndex;
+    uint32_t next_sibling = kInvalidIndex;
+    uint32_t num_children = 0;
+    uint32_t depth = 0;
+  };
+
+  struct FunctionCount {
+    uint64_t function_address = 0;
+    uint64_t count = 0;
+  };
+
+  explicit CallTree(Direction direction = Direction::kTopDown);
+
+  // Adds "count" samples of the callstack described by "frames". As in
+  // CallStack::m_Data, frames[0] is the innermost frame.
+  void AddCallstack(const uint64_t* frames, uint32_t depth, uint64_t count);
+  void AddCallstack(const std::vector<uint64_t>& frames, uint64_t count) {
+    AddCallstack(frames.data(), static_cast<uint32_t>(frames.size()), count);
+  }
+  void Clear();
+
+  Direction GetDirection() const { return direction_; }
+  size_t GetNumNodes() const { return nodes_.size(); }
+  const Node& GetNode(uint32_t node_index) const { return nodes_[node_index]; }
+  uint64_t GetTotalCount() const {
+    return nodes_[kRootIndex].inclusive_count;
+  }
+
+  // Children of "node_index", sorted by decreasing inclusive count.
+  std::vector<uint32_t> GetChildren(uint32_t node_index) const;
+  // Returns kInvalidIndex if "parent_index" has no child for that function.
+  uint32_t FindChild(uint32_t parent_index, uint64_t function_address) const;
+  // Function addresses from the first level below the root down to
+  // "node_index".
+  std::vector<uint64_t> GetPath(uint32_t node_index) const;
+  // All the nodes that represent "function_address", in creation order.
+  const std::vector<uint32_t>& GetNodesOfFunction(
+      uint64_t function_address) const;
+
+  // Caller/callee views: aggregates, over all the nodes of the tree that
+  // represent "function_address", the inclusive counts of the functions
+  // calling it or called by it. Results are sorted by decreasing count. With
+  // recursion, every occurrence of the function on a path contributes.
+  std::vector<FunctionCount> GetCallers(uint64_t function_address) const;
+  std::vector<FunctionCount> GetCallees(uint64_t function_address) const;
+
+ private:
+  uint32_t GetOrCreateChild(uint32_t parent_index, uint64_t function_address);
+  std::vector<FunctionCount> GetParentCounts(uint64_t function_address) const;
+  std::vector<FunctionCount> GetChildCounts(uint64_t function_address) const;
+
+  Direction direction_;
+  std::vector<Node> nodes_;
+  absl::flat_hash_map<std::pair<uint32_t, uint64_t>, uint32_t> child_lookup_;
+  absl::flat_hash_map<uint64_t, std::vector<uint32_t>> function_to_nodes_;
+};
+
+#endif  // ORBIT_CORE_CALL_TREE_H_
@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "CallTree.h"
+
+namespace {
+// Frames are innermost first, as in CallStack::m_Data.
+const std::vector<uint64_t> kMainFooBar = {0x30, 0x20, 0x10};
+const std::vector<uint64_t> kMainFooBaz = {0x40, 0x20, 0x10};
+const std::vector<uint64_t> kMainBar = {0x30, 0x10};
+const std::vector<uint64_t> kMainFoo = {0x20, 0x10};
+
+constexpr uint64_t kMain = 0x10;
+constexpr uint64_t kFoo = 0x20;
+constexpr uint64_t kBar = 0x30;
+constexpr uint64_t kBaz = 0x40;
+
+void AddTestCallstacks(CallTree* tree) {
+  tree->AddCallstack(kMainFooBar, 5);
+  tree->AddCallstack(kMainFooBaz, 2);
+  tree->AddCallstack(kMainBar, 3);
+  tree->AddCallstack(kMainFoo, 1);
+}
+}  // namespace
+
+TEST(CallTree, Empty) {
+  CallTree tree;
+  EXPECT_EQ(tree.GetNumNodes(), 1);
+  EXPECT_EQ(tree.GetTotalCount(), 0);
+  EXPECT_TRUE(tree.GetChildren(CallTree::kRootIndex).empty());
+
+  tree.AddCallstack(std::vector<uint64_t>{}, 3);
+  tree.AddCallstack(kMainFoo, 0);
+  EXPECT_EQ(tree.GetNumNodes(), 1);
+  EXPECT_EQ(tree.GetTotalCount(), 0);
+}
+
+TEST(CallTree, TopDown) {
+  CallTree tree(CallTree::Direction::kTopDown);
+  AddTestCallstacks(&tree);
+
+  EXPECT_EQ(tree.GetTotalCount(), 11);
+  // root, main, main/foo, main/foo/bar, main/foo/baz, main/bar
+  EXPECT_EQ(tree.GetNumNodes(), 6);
+
+  std::vector<uint32_t> roots = tree.GetChildren(CallTree::kRootIndex);
+  ASSERT_EQ(roots.size(), 1);
+  const CallTree::Node& main = tree.GetNode(roots[0]);
+  EXPECT_EQ(main.function_address, kMain);
+  EXPECT_EQ(main.inclusive_count, 11);
+  EXPECT_EQ(main.exclusive_count, 0);
+  EXPECT_EQ(main.depth, 1);
+
+  std::vector<uint32_t> main_children = tree.GetChildren(roots[0]);
+  ASSERT_EQ(main_children.size(), 2);
+  const CallTree::Node& foo = tree.GetNode(main_children[0]);
+  EXPECT_EQ(foo.function_address, kFoo);
+  EXPECT_EQ(foo.inclusive_count, 8);
+  EXPECT_EQ(foo.exclusive_count, 1);
+  const CallTree::Node& bar = tree.GetNode(main_children[1]);
+  EXPECT_EQ(bar.function_address, kBar);
+  EXPECT_EQ(bar.inclusive_count, 3);
+  EXPECT_EQ(bar.exclusive_count, 3);
+
+  uint32_t baz_index = tree.FindChild(main_children[0], kBaz);
+  ASSERT_NE(baz_index, CallTree::kInvalidIndex);
+  EXPECT_EQ(tree.GetNode(baz_index).inclusive_count, 2);
+  EXPECT_EQ(tree.GetPath(baz_index),
+            (std::vector<uint64_t>{kMain, kFoo, kBaz}));
+  EXPECT_EQ(tree.FindChild(main_children[1], kBaz), CallTree::kInvalidIndex);
+}
+
+TEST(CallTree, BottomUp) {
+  CallTree tree(CallTree::Direction::kBottomUp);
+  AddTestCallstacks(&tree);
+
+  EXPECT_EQ(tree.GetTotalCount(), 11);
+
+  std::vector<uint32_t> leaves = tree.GetChildren(CallTree::kRootIndex);
+  ASSERT_EQ(leaves.size(), 3);
+  EXPECT_EQ(tree.GetNode(leaves[0]).function_address, kBar);
+  EXPECT_EQ(tree.GetNode(leaves[0]).inclusive_count, 8);
+  EXPECT_EQ(tree.GetNode(leaves[1]).function_address, kBaz);
+  EXPECT_EQ(tree.GetNode(leaves[1]).inclusive_count, 2);
+  EXPECT_EQ(tree.GetNode(leaves[2]).function_address, kFoo);
+  EXPECT_EQ(tree.GetNode(leaves[2]).inclusive_count, 1);
+
+  std::vector<uint32_t> bar_callers = tree.GetChildren(leaves[0]);
+  ASSERT_EQ(bar_callers.size(), 2);
+  EXPECT_EQ(tree.GetNode(bar_callers[0]).function_address, kFoo);
+  EXPECT_EQ(tree.GetNode(bar_callers[0]).inclusive_count, 5);
+  EXPECT_EQ(tree.GetNode(bar_callers[1]).function_address, kMain);
+  EXPECT_EQ(tree.GetNode(bar_callers[1]).inclusive_count, 3);
+  EXPECT_EQ(tree.GetNode(bar_callers[1]).exclusive_count, 3);
+}
+
+TEST(CallTree, CallersAndCallees) {
+  CallTree top_down(CallTree::Direction::kTopDown);
+  CallTree bottom_up(CallTree::Direction::kBottomUp);
+  AddTestCallstacks(&top_down);
+  AddTestCallstacks(&bottom_up);
+
+  for (const CallTree* tree : {&top_down, &bottom_up}) {
+    std::vector<CallTree::FunctionCount> bar_callers = tree->GetCallers(kBar);
+    ASSERT_EQ(bar_callers.size(), 2);
+    EXPECT_EQ(bar_callers[0].function_address, kFoo);
+    EXPECT_EQ(bar_callers[0].count, 5);
+    EXPECT_EQ(bar_callers[1].function_address, kMain);
+    EXPECT_EQ(bar_callers[1].count, 3);
+
+    std::vector<CallTree::FunctionCount> foo_callees = tree->GetCallees(kFoo);
+    ASSERT_EQ(foo_callees.size(), 2);
+    EXPECT_EQ(foo_callees[0].function_address, kBar);
+    EXPECT_EQ(foo_callees[0].count, 5);
+    EXPECT_EQ(foo_callees[1].function_address, kBaz);
+    EXPECT_EQ(foo_callees[1].count, 2);
+
+    EXPECT_TRUE(tree->GetCallers(kMain).empty());
+    EXPECT_TRUE(tree->GetCallees(kBaz).empty());
+  }
+}
+
+TEST(CallTree, IncrementalAndClear) {
+  CallTree tree;
+  tree.AddCallstack(kMainFooBar, 1);
+  size_t num_nodes = tree.GetNumNodes();
+  tree.AddCallstack(kMainFooBar, 4);
+  EXPECT_EQ(tree.GetNumNodes(), num_nodes);
+  EXPECT_EQ(tree.GetTotalCount(), 5);
+  EXPECT_EQ(tree.GetNodesOfFunction(kBar).size(), 1);
+
+  tree.Clear();
+  EXPECT_EQ(tree.GetNumNodes(), 1);
+  EXPECT_EQ(tree.GetTotalCount(), 0);
+  EXPECT_TRUE(tree.GetNodesOfFunction(kBar).empty());
+}
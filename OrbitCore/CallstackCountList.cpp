@@ -0,0 +1,50 @@
+#include "CallstackCountList.h"
+
+#include <algorithm>
+
+namespace {
+bool ComesBefore(const CallstackCountList::Entry& lhs,
+                 const CallstackCountList::Entry& rhs) {
+  if (lhs.count != rhs.count) return lhs.count > rhs.count;
+  return lhs.callstack_id < rhs.callstack_id;
+}
+}  // namespace
+
+void CallstackCountList::Add(CallstackID callstack_id, uint32_t count) {
+  if (count == 0) return;
+  entries_.push_back({callstack_id, count});
+  total_count_ += count;
+  // A new entry can belong anywhere, including in the sorted prefix.
+  num_sorted_ = 0;
+}
+
+void CallstackCountList::Clear() {
+  entries_.clear();
+  num_sorted_ = 0;
+  total_count_ = 0;
+}
+
+void CallstackCountList::SortUpTo(size_t end) {
+  end = std::min(end, entries_.size());
+  if (end <= num_sorted_) return;
+
+  // Only the unsorted tail needs to be looked at, as it contains no entry
+  // that belongs before the sorted prefix.
+  auto first = entries_.begin() + num_sorted_;
+  auto middle = entries_.begin() + end;
+  if (end == entries_.size()) {
+    std::sort(first, middle, ComesBefore);
+  } else {
+    std::nth_element(first, middle, entries_.end(), ComesBefore);
+    std::sort(first, middle, ComesBefore);
+  }
+  num_sorted_ = end;
+}
+
+std::vector<CallstackCountList::Entry> CallstackCountList::GetPage(
+    size_t first, size_t max_count) {
+  if (first >= entries_.size()) return {};
+  size_t end = first + std::min(max_count, entries_.size() - first);
+  SortUpTo(end);
+  return std::vector<Entry>(entries_.begin() + first, entries_.begin() + end);
+}
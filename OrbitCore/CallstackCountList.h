@@ -0,0 +1,46 @@
+#ifndef ORBIT_CORE_CALLSTACK_COUNT_LIST_H_
+#define ORBIT_CORE_CALLSTACK_COUNT_LIST_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "CallstackTypes.h"
+
+// Unique callstacks and their sample counts for one function on one thread.
+//
+// The list is only sorted as far as it has been read: requesting a page
+// partially sorts the entries up to the end of that page and leaves the rest
+// unordered, so showing the most frequent callstacks of a function that
+// appears in a large number of unique callstacks does not require sorting
+// all of them.
+class CallstackCountList {
+ public:
+  struct Entry {
+    CallstackID callstack_id = 0;
+    uint32_t count = 0;
+  };
+
+  void Add(CallstackID callstack_id, uint32_t count);
+  void Clear();
+
+  size_t GetNumCallstacks() const { return entries_.size(); }
+  uint64_t GetTotalCount() const { return total_count_; }
+  size_t GetNumSortedEntries() const { return num_sorted_; }
+
+  // Returns the entries at positions [first, first + max_count) in order of
+  // decreasing count. Ties are broken by increasing callstack id so that
+  // pages are stable.
+  std::vector<Entry> GetPage(size_t first, size_t max_count);
+
+ private:
+  void SortUpTo(size_t end);
+
+  std::vector<Entry> entries_;
+  // entries_[0, num_sorted_) is sorted and no entry after it compares before
+  // any entry in it.
+  size_t num_sorted_ = 0;
+  uint64_t total_count_ = 0;
+};
+
+#endif  // ORBIT_CORE_CALLSTACK_COUNT_LIST_H_
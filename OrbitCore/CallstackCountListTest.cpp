@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "CallstackCountList.h"
+
+TEST(CallstackCountList, Empty) {
+  CallstackCountList list;
+  EXPECT_EQ(list.GetNumCallstacks(), 0);
+  EXPECT_EQ(list.GetTotalCount(), 0);
+  EXPECT_TRUE(list.GetPage(0, 10).empty());
+
+  list.Add(1, 0);
+  EXPECT_EQ(list.GetNumCallstacks(), 0);
+}
+
+TEST(CallstackCountList, SortsByCountThenId) {
+  CallstackCountList list;
+  list.Add(10, 1);
+  list.Add(20, 5);
+  list.Add(30, 3);
+  list.Add(5, 3);
+
+  EXPECT_EQ(list.GetNumCallstacks(), 4);
+  EXPECT_EQ(list.GetTotalCount(), 12);
+
+  std::vector<CallstackCountList::Entry> page = list.GetPage(0, 10);
+  ASSERT_EQ(page.size(), 4);
+  EXPECT_EQ(page[0].callstack_id, 20);
+  EXPECT_EQ(page[1].callstack_id, 5);
+  EXPECT_EQ(page[2].callstack_id, 30);
+  EXPECT_EQ(page[3].callstack_id, 10);
+  EXPECT_EQ(page[3].count, 1);
+
+  EXPECT_TRUE(list.GetPage(4, 10).empty());
+}
+
+TEST(CallstackCountList, OnlySortsRequestedPages) {
+  constexpr uint32_t kNumCallstacks = 100000;
+  constexpr size_t kPageSize = 256;
+
+  std::vector<CallstackCountList::Entry> expected;
+  std::mt19937 random(42);
+  CallstackCountList list;
+  for (uint32_t i = 0; i < kNumCallstacks; ++i) {
+    uint32_t count = 1 + random() % 1000;
+    list.Add(i, count);
+    expected.push_back({i, count});
+  }
+  std::sort(expected.begin(), expected.end(),
+            [](const CallstackCountList::Entry& lhs,
+               const CallstackCountList::Entry& rhs) {
+              if (lhs.count != rhs.count) return lhs.count > rhs.count;
+              return lhs.callstack_id < rhs.callstack_id;
+            });
+
+  std::vector<CallstackCountList::Entry> first_page =
+      list.GetPage(0, kPageSize);
+  EXPECT_EQ(list.GetNumSortedEntries(), kPageSize);
+
+  // Pages can be requested out of order, only the prefix up to the furthest
+  // page is ever sorted.
+  std::vector<CallstackCountList::Entry> third_page =
+      list.GetPage(2 * kPageSize, kPageSize);
+  EXPECT_EQ(list.GetNumSortedEntries(), 3 * kPageSize);
+  std::vector<CallstackCountList::Entry> second_page =
+      list.GetPage(kPageSize, kPageSize);
+  EXPECT_EQ(list.GetNumSortedEntries(), 3 * kPageSize);
+
+  std::vector<CallstackCountList::Entry> pages = first_page;
+  pages.insert(pages.end(), second_page.begin(), second_page.end());
+  pages.insert(pages.end(), third_page.begin(), third_page.end());
+  ASSERT_EQ(pages.size(), 3 * kPageSize);
+  for (size_t i = 0; i < pages.size(); ++i) {
+    EXPECT_EQ(pages[i].callstack_id, expected[i].callstack_id);
+    EXPECT_EQ(pages[i].count, expected[i].count);
+  }
+
+  std::vector<CallstackCountList::Entry> last_page =
+      list.GetPage(kNumCallstacks - 10, kPageSize);
+  ASSERT_EQ(last_page.size(), 10);
+  EXPECT_EQ(last_page.back().callstack_id, expected.back().callstack_id);
+}
+
+TEST(CallstackCountList, AddInvalidatesSorting) {
+  CallstackCountList list;
+  list.Add(1, 1);
+  list.Add(2, 2);
+  EXPECT_EQ(list.GetPage(0, 1)[0].callstack_id, 2);
+
+  list.Add(3, 10);
+  EXPECT_EQ(list.GetNumSortedEntries(), 0);
+  EXPECT_EQ(list.GetPage(0, 1)[0].callstack_id, 3);
+
+  list.Clear();
+  EXPECT_EQ(list.GetNumCallstacks(), 0);
+  EXPECT_EQ(list.GetTotalCount(), 0);
+}
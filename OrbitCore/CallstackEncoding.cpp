@@ -0,0 +1,144 @@
+#include "CallstackEncoding.h"
+
+#include <cstdint>
+
+#include "ByteCoding.h"
+#include "EventBuffer.h"
+#include "LinuxCallstackEvent.h"
+#include "absl/container/flat_hash_map.h"
+
+namespace {
+// Written first, to detect mismatching service and client versions.
+constexpr uint8_t kFormatVersion = 1;
+
+// Maps callstack ids to their index in order of first appearance.
+class IdEncoder {
+ public:
+  void Put(ByteWriter* writer, uint64_t id) {
+    auto result = indices_.emplace(id, indices_.size());
+    writer->PutVarint(result.first->second);
+    if (result.second) writer->PutFixed64(id);
+  }
+
+ private:
+  absl::flat_hash_map<uint64_t, uint64_t> indices_;
+};
+
+class IdDecoder {
+ public:
+  // Returns false if the index refers to an id that wasn't seen yet.
+  bool Get(ByteReader* reader, uint64_t* id) {
+    uint64_t index = reader->GetVarint();
+    if (index == ids_.size()) {
+      ids_.push_back(reader->GetFixed64());
+    } else if (index > ids_.size()) {
+      return false;
+    }
+    *id = ids_[index];
+    return true;
+  }
+
+ private:
+  std::vector<uint64_t> ids_;
+};
+}  // namespace
+
+void EncodeCallstackEvents(const std::vector<CallstackEvent>& events,
+                           std::string* buffer) {
+  buffer->clear();
+  ByteWriter writer(buffer);
+  writer.PutByte(kFormatVersion);
+  writer.PutVarint(events.size());
+
+  IdEncoder ids;
+  uint64_t previous_time = 0;
+  for (const CallstackEvent& event : events) {
+    uint64_t time = static_cast<uint64_t>(event.m_Time);
+    writer.PutZigZag(static_cast<int64_t>(time - previous_time));
+    previous_time = time;
+    writer.PutVarint(event.m_TID);
+    ids.Put(&writer, event.m_Id);
+  }
+}
+
+bool DecodeCallstackEvents(
+    const char* data, size_t size,
+    const std::function<void(CallstackEvent&)>& callback) {
+  ByteReader reader(data, size);
+  uint64_t num_events = 0;
+  if (!reader.GetHeader(kFormatVersion, &num_events)) return false;
+
+  IdDecoder ids;
+  CallstackEvent event;
+  uint64_t time = 0;
+  for (uint64_t i = 0; i < num_events; ++i) {
+    time += static_cast<uint64_t>(reader.GetZigZag());
+    event.m_Time = static_cast<long long>(time);
+    event.m_TID = static_cast<ThreadID>(reader.GetVarint());
+    if (!ids.Get(&reader, &event.m_Id) || !reader.ok()) return false;
+    callback(event);
+  }
+  return reader.GetRemainingSize() == 0;
+}
+
+void EncodeLinuxCallstackEvents(const std::vector<LinuxCallstackEvent>& events,
+                                std::string* buffer) {
+  buffer->clear();
+  ByteWriter writer(buffer);
+  writer.PutByte(kFormatVersion);
+  writer.PutVarint(events.size());
+
+  uint64_t previous_time = 0;
+  for (const LinuxCallstackEvent& event : events) {
+    writer.PutZigZag(static_cast<int64_t>(event.m_time - previous_time));
+    previous_time = event.m_time;
+    writer.PutVarint(event.m_numCallstacks);
+    writer.PutString(event.m_header);
+
+    // Callstacks are only sent once, their hashes don't repeat.
+    const CallStack& callstack = event.m_CS;
+    writer.PutVarint(callstack.m_ThreadId);
+    writer.PutFixed64(callstack.m_Hash);
+    writer.PutVarint(callstack.m_Depth);
+    writer.PutVarint(callstack.m_Data.size());
+    uint64_t previous_address = 0;
+    for (uint64_t address : callstack.m_Data) {
+      writer.PutZigZag(static_cast<int64_t>(address - previous_address));
+      previous_address = address;
+    }
+  }
+}
+
+bool DecodeLinuxCallstackEvents(
+    const char* data, size_t size,
+    const std::function<void(LinuxCallstackEvent&)>& callback) {
+  ByteReader reader(data, size);
+  uint64_t num_events = 0;
+  if (!reader.GetHeader(kFormatVersion, &num_events)) return false;
+
+  LinuxCallstackEvent event;
+  uint64_t time = 0;
+  for (uint64_t i = 0; i < num_events; ++i) {
+    time += static_cast<uint64_t>(reader.GetZigZag());
+    event.m_time = time;
+    event.m_numCallstacks = reader.GetVarint();
+    reader.GetString(&event.m_header);
+
+    CallStack& callstack = event.m_CS;
+    callstack.m_ThreadId = static_cast<ThreadID>(reader.GetVarint());
+    callstack.m_Hash = reader.GetFixed64();
+    callstack.m_Depth = static_cast<uint32_t>(reader.GetVarint());
+    uint64_t num_frames = reader.GetVarint();
+    if (!reader.ok() || num_frames > reader.GetRemainingSize()) return false;
+
+    callstack.m_Data.resize(num_frames);
+    uint64_t address = 0;
+    for (uint64_t& frame : callstack.m_Data) {
+      address += static_cast<uint64_t>(reader.GetZigZag());
+      frame = address;
+    }
+    if (!reader.ok()) return false;
+    callback(event);
+  }
+  return reader.GetRemainingSize() == 0;
+}
@@ -0,0 +1,37 @@
+#ifndef ORBIT_CORE_CALLSTACK_ENCODING_H_
+#define ORBIT_CORE_CALLSTACK_ENCODING_H_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct CallstackEvent;
+class LinuxCallstackEvent;
+
+// Compact wire encoding of the sampled callstacks streamed during a capture.
+//
+// See ByteCoding.h for the integer encodings. Timestamps are delta encoded
+// against the previous event. Callstack ids are hashes, which don't compress:
+// within a buffer each distinct id is written once, and referred to by its
+// index in order of appearance afterwards. The frame addresses of a
+// callstack are delta encoded against the previous frame, addresses in the
+// same module being close to each other.
+//
+// Decoding reads the message data in place and calls "callback" for each
+// event, reusing the same event object. It returns false if the data is
+// malformed, after the callbacks for the events decoded until then.
+
+void EncodeCallstackEvents(const std::vector<CallstackEvent>& events,
+                           std::string* buffer);
+bool DecodeCallstackEvents(
+    const char* data, size_t size,
+    const std::function<void(CallstackEvent&)>& callback);
+
+void EncodeLinuxCallstackEvents(const std::vector<LinuxCallstackEvent>& events,
+                                std::string* buffer);
+bool DecodeLinuxCallstackEvents(
+    const char* data, size_t size,
+    const std::function<void(LinuxCallstackEvent&)>& callback);
+
+#endif  // ORBIT_CORE_CALLSTACK_ENCODING_H_
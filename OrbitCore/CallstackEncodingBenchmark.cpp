@@ -0,0 +1,89 @@
+// Timing runs of the callstack encoding against cereal. Correctness is
+// checked by CallstackEncodingTest.cpp.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "CallstackEncoding.h"
+#include "CallstackEncodingTestData.h"
+#include "EventBuffer.h"
+#include "LinuxCallstackEvent.h"
+#include "Serialization.h"
+
+namespace {
+double GetMilliseconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+}  // namespace
+
+TEST(CallstackEncoding, BenchmarkAgainstCereal) {
+  std::vector<LinuxCallstackEvent> events = CreateLinuxCallstackEvents(20000);
+  std::vector<CallstackEvent> hashed_events = CreateCallstackEvents(200000);
+
+  auto start = std::chrono::steady_clock::now();
+  std::string buffer;
+  EncodeLinuxCallstackEvents(events, &buffer);
+  std::string hashed_buffer;
+  EncodeCallstackEvents(hashed_events, &hashed_buffer);
+  double encode_ms = GetMilliseconds(start);
+
+  start = std::chrono::steady_clock::now();
+  uint64_t num_frames = 0;
+  DecodeLinuxCallstackEvents(buffer.data(), buffer.size(),
+                             [&num_frames](LinuxCallstackEvent& event) {
+                               num_frames += event.m_CS.m_Data.size();
+                             });
+  uint64_t num_hashed = 0;
+  DecodeCallstackEvents(hashed_buffer.data(), hashed_buffer.size(),
+                        [&num_hashed](CallstackEvent&) { ++num_hashed; });
+  double decode_ms = GetMilliseconds(start);
+  EXPECT_EQ(num_hashed, hashed_events.size());
+
+  // The previous path, as in ConnectionManager::SetupClientCallbacks.
+  start = std::chrono::steady_clock::now();
+  std::string cereal_buffer = SerializeObjectBinary(events);
+  std::string cereal_hashed_buffer = SerializeObjectBinary(hashed_events);
+  double cereal_encode_ms = GetMilliseconds(start);
+
+  start = std::chrono::steady_clock::now();
+  uint64_t cereal_num_frames = 0;
+  {
+    std::istringstream stream(
+        std::string(cereal_buffer.data(), cereal_buffer.size()));
+    cereal::BinaryInputArchive archive(stream);
+    std::vector<LinuxCallstackEvent> decoded;
+    archive(decoded);
+    for (LinuxCallstackEvent& event : decoded) {
+      cereal_num_frames += event.m_CS.m_Data.size();
+    }
+  }
+  {
+    std::istringstream stream(
+        std::string(cereal_hashed_buffer.data(), cereal_hashed_buffer.size()));
+    cereal::BinaryInputArchive archive(stream);
+    std::vector<CallstackEvent> decoded;
+    archive(decoded);
+  }
+  double cereal_decode_ms = GetMilliseconds(start);
+  EXPECT_EQ(num_frames, cereal_num_frames);
+
+  EXPECT_LT(buffer.size(), cereal_buffer.size());
+  EXPECT_LT(hashed_buffer.size(), cereal_hashed_buffer.size());
+  std::cout << "Callstacks: " << buffer.size() << " bytes, cereal "
+            << cereal_buffer.size() << " bytes" << std::endl
+            << "Hashed callstacks: " << hashed_buffer.size()
+            << " bytes, cereal " << cereal_hashed_buffer.size() << " bytes"
+            << std::endl
+            << "Encode: " << encode_ms << " ms, cereal " << cereal_encode_ms
+            << " ms" << std::endl
+            << "Decode: " << decode_ms << " ms, cereal " << cereal_decode_ms
+            << " ms" << std::endl;
+}
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "CallstackEncoding.h"
+#include "CallstackEncodingTestData.h"
+#include "EventBuffer.h"
+#include "LinuxCallstackEvent.h"
+#include "Serialization.h"
+
+namespace {
+void ExpectEqual(const LinuxCallstackEvent& lhs,
+                 const LinuxCallstackEvent& rhs) {
+  EXPECT_EQ(lhs.m_time, rhs.m_time);
+  EXPECT_EQ(lhs.m_numCallstacks, rhs.m_numCallstacks);
+  EXPECT_EQ(lhs.m_header, rhs.m_header);
+  EXPECT_EQ(lhs.m_CS.m_Hash, rhs.m_CS.m_Hash);
+  EXPECT_EQ(lhs.m_CS.m_Depth, rhs.m_CS.m_Depth);
+  EXPECT_EQ(lhs.m_CS.m_ThreadId, rhs.m_CS.m_ThreadId);
+  EXPECT_EQ(lhs.m_CS.m_Data, rhs.m_CS.m_Data);
+}
+}  // namespace
+
+TEST(CallstackEncoding, LinuxCallstackEventsRoundTrip) {
+  std::vector<LinuxCallstackEvent> events = CreateLinuxCallstackEvents(1000);
+  events[0].m_header = "header";
+  // Timestamps and addresses going backwards.
+  events[1].m_time = 0;
+  events[2].m_CS.m_Data = {UINT64_MAX, 0, UINT64_MAX / 2};
+  events[2].m_CS.m_Depth = 3;
+
+  std::string buffer;
+  EncodeLinuxCallstackEvents(events, &buffer);
+
+  size_t index = 0;
+  EXPECT_TRUE(DecodeLinuxCallstackEvents(
+      buffer.data(), buffer.size(), [&](LinuxCallstackEvent& event) {
+        ASSERT_LT(index, events.size());
+        ExpectEqual(event, events[index++]);
+      }));
+  EXPECT_EQ(index, events.size());
+}
+
+TEST(CallstackEncoding, CallstackEventsRoundTrip) {
+  std::vector<CallstackEvent> events = CreateCallstackEvents(1000);
+  events[1].m_Time = 0;
+  events[2].m_Id = 0;
+
+  std::string buffer;
+  EncodeCallstackEvents(events, &buffer);
+  // Each of the 256 ids is written once.
+  EXPECT_LT(buffer.size(), events.size() * sizeof(CallstackEvent) / 2);
+
+  size_t index = 0;
+  EXPECT_TRUE(DecodeCallstackEvents(
+      buffer.data(), buffer.size(), [&](CallstackEvent& event) {
+        ASSERT_LT(index, events.size());
+        EXPECT_EQ(event.m_Time, events[index].m_Time);
+        EXPECT_EQ(event.m_Id, events[index].m_Id);
+        EXPECT_EQ(event.m_TID, events[index].m_TID);
+        ++index;
+      }));
+  EXPECT_EQ(index, events.size());
+}
+
+TEST(CallstackEncoding, EmptyBuffers) {
+  std::string buffer;
+  EncodeCallstackEvents({}, &buffer);
+  EXPECT_TRUE(DecodeCallstackEvents(buffer.data(), buffer.size(),
+                                    [](CallstackEvent&) { FAIL(); }));
+  EncodeLinuxCallstackEvents({}, &buffer);
+  EXPECT_TRUE(DecodeLinuxCallstackEvents(buffer.data(), buffer.size(),
+                                         [](LinuxCallstackEvent&) { FAIL(); }));
+  EXPECT_FALSE(DecodeCallstackEvents(nullptr, 0, [](CallstackEvent&) {}));
+}
+
+TEST(CallstackEncoding, MalformedDataIsRejected) {
+  std::vector<LinuxCallstackEvent> events = CreateLinuxCallstackEvents(10);
+  std::string buffer;
+  EncodeLinuxCallstackEvents(events, &buffer);
+
+  // Every truncation fails, after at most the complete events.
+  for (size_t size = 0; size < buffer.size(); ++size) {
+    size_t num_decoded = 0;
+    EXPECT_FALSE(DecodeLinuxCallstackEvents(
+        buffer.data(), size,
+        [&num_decoded](LinuxCallstackEvent&) { ++num_decoded; }));
+    EXPECT_LT(num_decoded, events.size());
+  }
+
+  std::string wrong_version = buffer;
+  wrong_version[0] = 0x7f;
+  EXPECT_FALSE(DecodeLinuxCallstackEvents(
+      wrong_version.data(), wrong_version.size(),
+      [](LinuxCallstackEvent&) { FAIL(); }));
+
+  // A reference to an id that wasn't sent.
+  std::string hashed = {1, 1, 0, 0, 5};
+  EXPECT_FALSE(DecodeCallstackEvents(hashed.data(), hashed.size(),
+                                     [](CallstackEvent&) { FAIL(); }));
+}
+
+TEST(CallstackEncoding, SmallerThanCereal) {
+  std::vector<LinuxCallstackEvent> events = CreateLinuxCallstackEvents(2000);
+  std::vector<CallstackEvent> hashed_events = CreateCallstackEvents(20000);
+
+  std::string buffer;
+  EncodeLinuxCallstackEvents(events, &buffer);
+  std::string hashed_buffer;
+  EncodeCallstackEvents(hashed_events, &hashed_buffer);
+  EXPECT_LT(buffer.size(), SerializeObjectBinary(events).size());
+  EXPECT_LT(hashed_buffer.size(), SerializeObjectBinary(hashed_events).size());
+}
@@ -0,0 +1,50 @@
+#ifndef ORBIT_CORE_CALLSTACK_ENCODING_TEST_DATA_H_
+#define ORBIT_CORE_CALLSTACK_ENCODING_TEST_DATA_H_
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "EventBuffer.h"
+#include "LinuxCallstackEvent.h"
+
+// Callstack events as sent during a capture, shared by the callstack
+// encoding tests and benchmarks.
+inline std::vector<LinuxCallstackEvent> CreateLinuxCallstackEvents(
+    size_t count) {
+  std::mt19937_64 random(42);
+  std::vector<LinuxCallstackEvent> events(count);
+  uint64_t time = 1'000'000'000'000;
+  for (LinuxCallstackEvent& event : events) {
+    time += random() % 1'000'000;
+    event.m_time = time;
+    event.m_numCallstacks = 1;
+    event.m_CS.m_ThreadId = 1000 + random() % 8;
+    // Frames in a few modules, as in real callstacks.
+    uint32_t depth = 1 + random() % 32;
+    for (uint32_t i = 0; i < depth; ++i) {
+      uint64_t module_base = 0x7f0000000000 + (random() % 4) * 0x10000000;
+      event.m_CS.m_Data.push_back(module_base + random() % 0x100000);
+    }
+    event.m_CS.m_Depth = depth;
+    event.m_CS.Hash();
+  }
+  return events;
+}
+
+inline std::vector<CallstackEvent> CreateCallstackEvents(size_t count) {
+  std::mt19937_64 random(42);
+  std::vector<uint64_t> ids(256);
+  for (uint64_t& id : ids) id = random();
+
+  std::vector<CallstackEvent> events;
+  long long time = 1'000'000'000'000;
+  for (size_t i = 0; i < count; ++i) {
+    time += random() % 1'000'000;
+    events.emplace_back(time, ids[random() % ids.size()],
+                        1000 + random() % 8);
+  }
+  return events;
+}
+
+#endif  // ORBIT_CORE_CALLSTACK_ENCODING_TEST_DATA_H_
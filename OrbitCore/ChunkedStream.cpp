@@ -0,0 +1,53 @@
+#include "ChunkedStream.h"
+
+void ChunkStreamer::Start() {
+  if (IsRunning()) return;
+  exit_requested_ = false;
+  notified_ = false;
+  thread_ = std::thread(&ChunkStreamer::Run, this);
+}
+
+void ChunkStreamer::Stop() {
+  if (!IsRunning()) return;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    exit_requested_ = true;
+  }
+  condition_.notify_one();
+  thread_.join();
+}
+
+void ChunkStreamer::Notify() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    notified_ = true;
+  }
+  condition_.notify_one();
+}
+
+void ChunkStreamer::Run() {
+  using Clock = ChunkedStreamBase::Clock;
+  Clock::time_point due_time = Clock::time_point::max();
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    auto woken_up = [this] { return notified_ || exit_requested_; };
+    if (due_time == Clock::time_point::max()) {
+      condition_.wait(lock, woken_up);
+    } else {
+      condition_.wait_until(lock, due_time, woken_up);
+    }
+    bool exit = exit_requested_;
+    notified_ = false;
+    lock.unlock();
+
+    // On exit, a last forced flush sends what is left.
+    due_time = Clock::time_point::max();
+    Clock::time_point now = Clock::now();
+    for (ChunkedStreamBase* stream : streams_) {
+      due_time = std::min(due_time, stream->Flush(now, exit));
+    }
+
+    lock.lock();
+    if (exit) break;
+  }
+}
@@ -0,0 +1,198 @@
+#ifndef ORBIT_CORE_CHUNKED_STREAM_H_
+#define ORBIT_CORE_CHUNKED_STREAM_H_
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Streams items appended by producer threads (e.g. capture event handlers)
+// to a consumer (e.g. a TcpEntity) in chunks.
+//
+// Items are appended to the current chunk of a ChunkedStream. A chunk is
+// handed off as soon as it reaches its maximum size, or once its first item
+// is older than the maximum latency, so that the chunk rate follows the data
+// rate. Chunks are sent by the thread of a ChunkStreamer, which sleeps until
+// a chunk is full or a latency deadline is reached, and which can serve
+// several streams. Sent chunks are recycled to avoid reallocating them.
+//
+// Full chunks that pile up while the consumer is busy are counted in the
+// stream statistics: a growing max_pending_chunks means the consumer doesn't
+// keep up with the producers.
+
+class ChunkedStreamBase {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  virtual ~ChunkedStreamBase() = default;
+
+  // Sends the full chunks, and the current chunk if it is due or if "force"
+  // is set. Returns when the current chunk is due, Clock::time_point::max()
+  // if it is empty.
+  virtual Clock::time_point Flush(Clock::time_point now, bool force) = 0;
+};
+
+class ChunkStreamer {
+ public:
+  ChunkStreamer() = default;
+  ChunkStreamer(const ChunkStreamer&) = delete;
+  ChunkStreamer& operator=(const ChunkStreamer&) = delete;
+  ~ChunkStreamer() { Stop(); }
+
+  // Streams must be added before Start() and outlive the streamer thread.
+  void AddStream(ChunkedStreamBase* stream) { streams_.push_back(stream); }
+
+  void Start();
+  // Sends everything left in the streams, then stops the thread.
+  void Stop();
+  bool IsRunning() const { return thread_.joinable(); }
+
+  // Wakes up the streamer thread, called by the streams.
+  void Notify();
+
+ private:
+  void Run();
+
+  std::vector<ChunkedStreamBase*> streams_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool notified_ = false;
+  bool exit_requested_ = false;
+  std::thread thread_;
+};
+
+template <typename T>
+class ChunkedStream : public ChunkedStreamBase {
+ public:
+  using Chunk = std::vector<T>;
+  using SendFunc = std::function<void(const Chunk& chunk)>;
+
+  struct Stats {
+    uint64_t num_items = 0;
+    // Chunks sent because they were full, and because they were due.
+    uint64_t num_full_chunks = 0;
+    uint64_t num_partial_chunks = 0;
+    // Maximum number of full chunks waiting to be sent.
+    uint64_t max_pending_chunks = 0;
+  };
+
+  ChunkedStream(ChunkStreamer* streamer, size_t max_chunk_size,
+                std::chrono::microseconds max_latency, SendFunc send)
+      : streamer_(streamer),
+        max_chunk_size_(std::max<size_t>(max_chunk_size, 1)),
+        max_latency_(max_latency),
+        send_(std::move(send)) {
+    current_.reserve(max_chunk_size_);
+    streamer_->AddStream(this);
+  }
+  ChunkedStream(const ChunkedStream&) = delete;
+  ChunkedStream& operator=(const ChunkedStream&) = delete;
+
+  void Append(const T& item) {
+    bool notify = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      // The streamer needs to know when a new chunk is due.
+      if (current_.empty()) {
+        first_item_time_ = Clock::now();
+        notify = true;
+      }
+      current_.push_back(item);
+      ++stats_.num_items;
+
+      if (current_.size() >= max_chunk_size_) {
+        full_chunks_.push_back(std::move(current_));
+        current_ = GetFreeChunk();
+        stats_.max_pending_chunks = std::max<uint64_t>(
+            stats_.max_pending_chunks, full_chunks_.size());
+        notify = true;
+      }
+    }
+
+    if (notify) streamer_->Notify();
+  }
+
+  Clock::time_point Flush(Clock::time_point now, bool force) override {
+    Clock::time_point due_time = Clock::time_point::max();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      sending_.swap(full_chunks_);
+      stats_.num_full_chunks += sending_.size();
+      if (!current_.empty()) {
+        if (force || now >= first_item_time_ + max_latency_) {
+          sending_.push_back(std::move(current_));
+          current_ = GetFreeChunk();
+          ++stats_.num_partial_chunks;
+        } else {
+          due_time = first_item_time_ + max_latency_;
+        }
+      }
+    }
+
+    // Send without holding the lock, producers keep appending meanwhile.
+    for (const Chunk& chunk : sending_) {
+      send_(chunk);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (Chunk& chunk : sending_) {
+      if (free_chunks_.size() < kMaxFreeChunks) {
+        chunk.clear();
+        free_chunks_.push_back(std::move(chunk));
+      }
+    }
+    sending_.clear();
+    return due_time;
+  }
+
+  // Drops the items that haven't been sent.
+  void Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    current_.clear();
+    full_chunks_.clear();
+  }
+
+  Stats GetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+  }
+  void ResetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_ = Stats();
+  }
+
+  static constexpr size_t kMaxFreeChunks = 8;
+
+ private:
+  Chunk GetFreeChunk() {
+    if (free_chunks_.empty()) {
+      Chunk chunk;
+      chunk.reserve(max_chunk_size_);
+      return chunk;
+    }
+    Chunk chunk = std::move(free_chunks_.back());
+    free_chunks_.pop_back();
+    return chunk;
+  }
+
+  ChunkStreamer* streamer_;
+  const size_t max_chunk_size_;
+  const std::chrono::microseconds max_latency_;
+  SendFunc send_;
+
+  std::mutex mutex_;
+  Chunk current_;
+  Clock::time_point first_item_time_;
+  std::vector<Chunk> full_chunks_;
+  std::vector<Chunk> free_chunks_;
+  Stats stats_;
+  // Only used by the streamer thread.
+  std::vector<Chunk> sending_;
+};
+
+#endif  // ORBIT_CORE_CHUNKED_STREAM_H_
@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "ChunkedStream.h"
+
+namespace {
+using std::chrono::milliseconds;
+
+// Collects the chunks sent by a stream.
+class Receiver {
+ public:
+  ChunkedStream<int>::SendFunc GetSendFunc() {
+    return [this](const std::vector<int>& chunk) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      chunks_.push_back(chunk);
+      condition_.notify_all();
+    };
+  }
+
+  // Returns false if fewer than "num_chunks" chunks were received in time.
+  bool WaitForChunks(size_t num_chunks, milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return condition_.wait_for(lock, timeout, [this, num_chunks] {
+      return chunks_.size() >= num_chunks;
+    });
+  }
+
+  std::vector<std::vector<int>> GetChunks() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return chunks_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::vector<std::vector<int>> chunks_;
+};
+}  // namespace
+
+TEST(ChunkedStream, FullChunksAreSentRightAway) {
+  Receiver receiver;
+  ChunkStreamer streamer;
+  // Long enough a latency that partial chunks are only sent on Stop().
+  ChunkedStream<int> stream(&streamer, 4, std::chrono::hours(1),
+                            receiver.GetSendFunc());
+  streamer.Start();
+
+  for (int i = 0; i < 10; ++i) {
+    stream.Append(i);
+  }
+  ASSERT_TRUE(receiver.WaitForChunks(2, milliseconds(5000)));
+  EXPECT_EQ(receiver.GetChunks().size(), 2);
+
+  streamer.Stop();
+  std::vector<std::vector<int>> chunks = receiver.GetChunks();
+  ASSERT_EQ(chunks.size(), 3);
+  EXPECT_EQ(chunks[0], std::vector<int>({0, 1, 2, 3}));
+  EXPECT_EQ(chunks[1], std::vector<int>({4, 5, 6, 7}));
+  EXPECT_EQ(chunks[2], std::vector<int>({8, 9}));
+
+  ChunkedStream<int>::Stats stats = stream.GetStats();
+  EXPECT_EQ(stats.num_items, 10);
+  EXPECT_EQ(stats.num_full_chunks, 2);
+  EXPECT_EQ(stats.num_partial_chunks, 1);
+  EXPECT_GE(stats.max_pending_chunks, 1);
+}
+
+TEST(ChunkedStream, PartialChunkIsSentAfterLatency) {
+  Receiver receiver;
+  ChunkStreamer streamer;
+  ChunkedStream<int> stream(&streamer, 1000, milliseconds(10),
+                            receiver.GetSendFunc());
+  streamer.Start();
+
+  auto start = ChunkedStreamBase::Clock::now();
+  stream.Append(1);
+  stream.Append(2);
+  ASSERT_TRUE(receiver.WaitForChunks(1, milliseconds(5000)));
+  EXPECT_GE(ChunkedStreamBase::Clock::now() - start, milliseconds(10));
+  EXPECT_EQ(receiver.GetChunks()[0], std::vector<int>({1, 2}));
+
+  // The streamer keeps going once the stream is empty again.
+  stream.Append(3);
+  ASSERT_TRUE(receiver.WaitForChunks(2, milliseconds(5000)));
+  EXPECT_EQ(receiver.GetChunks()[1], std::vector<int>({3}));
+  streamer.Stop();
+  EXPECT_EQ(stream.GetStats().num_partial_chunks, 2);
+}
+
+TEST(ChunkedStream, StreamsShareAStreamer) {
+  Receiver receiver_a;
+  Receiver receiver_b;
+  ChunkStreamer streamer;
+  ChunkedStream<int> stream_a(&streamer, 2, std::chrono::hours(1),
+                              receiver_a.GetSendFunc());
+  ChunkedStream<int> stream_b(&streamer, 100, std::chrono::hours(1),
+                              receiver_b.GetSendFunc());
+  streamer.Start();
+
+  stream_a.Append(1);
+  stream_b.Append(2);
+  stream_a.Append(3);
+  ASSERT_TRUE(receiver_a.WaitForChunks(1, milliseconds(5000)));
+  EXPECT_TRUE(receiver_b.GetChunks().empty());
+
+  stream_a.Append(4);
+  streamer.Stop();
+  EXPECT_EQ(receiver_a.GetChunks().size(), 2);
+  ASSERT_EQ(receiver_b.GetChunks().size(), 1);
+  EXPECT_EQ(receiver_b.GetChunks()[0], std::vector<int>({2}));
+}
+
+TEST(ChunkedStream, ClearDropsPendingItems) {
+  Receiver receiver;
+  ChunkStreamer streamer;
+  ChunkedStream<int> stream(&streamer, 100, std::chrono::hours(1),
+                            receiver.GetSendFunc());
+  stream.Append(1);
+  stream.Clear();
+  streamer.Start();
+  stream.Append(2);
+  streamer.Stop();
+
+  std::vector<std::vector<int>> chunks = receiver.GetChunks();
+  ASSERT_EQ(chunks.size(), 1);
+  EXPECT_EQ(chunks[0], std::vector<int>({2}));
+}
@@ -4,8 +4,10 @@
 
 #include "ConnectionManager.h"
 
+#include "CallstackEncoding.h"
 #include "Capture.h"
 #include "ContextSwitch.h"
+#include "ContextSwitchEncoding.h"
 #include "CoreApp.h"
 #include "EventBuffer.h"
 #include "LinuxCallstackEvent.h"
@@ -13,6 +15,7 @@
 #include "OrbitFunction.h"
 #include "OrbitModule.h"
 #include "Params.h"
+#include "ProcessEncoding.h"
 #include "ProcessUtils.h"
 #include "SamplingProfiler.h"
 #include "Serialization.h"
@@ -119,6 +122,17 @@ void ConnectionManager::StartCaptureAsRemote(uint32_t pid) {
     return;
   }
   Capture::SetTargetProcess(process);
+
+  // What happens to capture data while the client can't keep up.
+  int policy = GParams.m_SendQueuePolicy;
+  if (policy < TcpEntity::BlockSender || policy > TcpEntity::ReduceSampling) {
+    PRINT("Invalid send queue policy %d\n", policy);
+    policy = TcpEntity::DropOldestSamples;
+  }
+  GTcpServer->SetSendQueuePolicy(
+      static_cast<TcpEntity::SendQueuePolicy>(policy));
+  GTcpServer->SetMaxQueuedBytes(GParams.m_MaxSendQueueBytes);
+
   Capture::StartCapture();
   GCoreApp->StartRemoteCaptureBufferingThread();
 }
@@ -128,6 +142,11 @@ void ConnectionManager::StopCaptureAsRemote() {
   PRINT_FUNC;
   Capture::StopCapture();
   GCoreApp->StopRemoteCaptureBufferingThread();
+  PRINT("Send queue so far: %llu packets (%llu bytes) dropped, %llu blocked "
+        "sends\n",
+        (unsigned long long)GTcpServer->GetNumDroppedPackets(),
+        (unsigned long long)GTcpServer->GetNumDroppedBytes(),
+        (unsigned long long)GTcpServer->GetNumBlockedSends());
 }
 
 //-----------------------------------------------------------------------------
@@ -135,6 +154,13 @@ void ConnectionManager::Stop() { m_ExitRequested = true; }
 
 //-----------------------------------------------------------------------------
 void ConnectionManager::SetupServerCallbacks() {
+  // Sent by each client on connection, before capture traffic starts.
+  GTcpServer->AddCallback(Msg_EnableCompression, [](const Message& a_Msg) {
+    bool enabled = a_Msg.m_Header.m_GenericHeader.m_Address != 0;
+    PRINT("Capture traffic compression %s\n", enabled ? "on" : "off");
+    GTcpServer->SetCompressionEnabled(enabled);
+  });
+
   GTcpServer->AddMainThreadCallback(
       Msg_RemoteSelectedFunctionsMap,
       [this](const Message& a_Msg) { SetSelectedFunctionsOnRemote(a_Msg); });
@@ -220,10 +246,8 @@ void ConnectionManager::SetupClientCallbacks() {
 
   GTcpClient->AddCallback(Msg_RemoteTimers, [=](const Message& a_Msg) {
     uint32_t numTimers = (uint32_t)a_Msg.m_Size / sizeof(Timer);
-    Timer* timers = (Timer*)a_Msg.GetData();
-    for (uint32_t i = 0; i < numTimers; ++i) {
-      GTimerManager->Add(timers[i]);
-    }
+    const Timer* timers = (const Timer*)a_Msg.GetData();
+    GTimerManager->Add(timers, numTimers);
   });
 
   GTcpClient->AddCallback(Msg_RemoteCallStack, [=](const Message& a_Msg) {
@@ -245,38 +269,33 @@ void ConnectionManager::SetupClientCallbacks() {
   });
 
   GTcpClient->AddCallback(Msg_RemoteContextSwitches, [=](const Message& a_Msg) {
-    uint32_t num_context_switches =
-        (uint32_t)a_Msg.m_Size / sizeof(ContextSwitch);
-    ContextSwitch* context_switches = (ContextSwitch*)a_Msg.GetData();
-    for (uint32_t i = 0; i < num_context_switches; i++) {
-      GCoreApp->ProcessContextSwitch(context_switches[i]);
+    if (!DecodeContextSwitches(a_Msg.GetData(), a_Msg.m_Size,
+                               [](ContextSwitch& a_ContextSwitch) {
+                                 GCoreApp->ProcessContextSwitch(
+                                     a_ContextSwitch);
+                               })) {
+      PRINT("Malformed Msg_RemoteContextSwitches message\n");
     }
   });
 
   GTcpClient->AddCallback(Msg_SamplingCallstacks, [=](const Message& a_Msg) {
-    const char* a_Data = a_Msg.GetData();
-    size_t a_Size = a_Msg.m_Size;
-    std::istringstream buffer(std::string(a_Data, a_Size));
-    cereal::BinaryInputArchive inputAr(buffer);
-    std::vector<LinuxCallstackEvent> call_stacks;
-    inputAr(call_stacks);
-
-    for (auto& cs : call_stacks) {
-      GCoreApp->ProcessSamplingCallStack(cs);
+    if (!DecodeLinuxCallstackEvents(a_Msg.GetData(), a_Msg.m_Size,
+                                    [](LinuxCallstackEvent& a_CallStack) {
+                                      GCoreApp->ProcessSamplingCallStack(
+                                          a_CallStack);
+                                    })) {
+      PRINT("Malformed Msg_SamplingCallstacks message\n");
     }
   });
 
   GTcpClient->AddCallback(
       Msg_SamplingHashedCallstacks, [=](const Message& a_Msg) {
-        const char* a_Data = a_Msg.GetData();
-        size_t a_Size = a_Msg.m_Size;
-        std::istringstream buffer(std::string(a_Data, a_Size));
-        cereal::BinaryInputArchive inputAr(buffer);
-        std::vector<CallstackEvent> call_stacks;
-        inputAr(call_stacks);
-
-        for (auto& cs : call_stacks) {
-          GCoreApp->ProcessHashedSamplingCallStack(cs);
+        if (!DecodeCallstackEvents(a_Msg.GetData(), a_Msg.m_Size,
+                                   [](CallstackEvent& a_CallStack) {
+                                     GCoreApp->ProcessHashedSamplingCallStack(
+                                         a_CallStack);
+                                   })) {
+          PRINT("Malformed Msg_SamplingHashedCallstacks message\n");
         }
       });
 }
@@ -285,7 +304,8 @@ void ConnectionManager::SetupClientCallbacks() {
 void ConnectionManager::SendProcesses(TcpEntity* tcp_entity) {
   process_list_.Refresh();
   process_list_.UpdateCpuTimes();
-  std::string process_data = SerializeObjectHumanReadable(process_list_);
+  std::string process_data;
+  EncodeProcessList(process_list_, &process_data);
   tcp_entity->Send(Msg_RemoteProcessList, process_data.data(),
                    process_data.size());
 }
@@ -297,7 +317,8 @@ void ConnectionManager::SendRemoteProcess(TcpEntity* tcp_entity, uint32_t pid) {
   Capture::SetTargetProcess(process);
   process->ListModules();
   if (process) {
-    std::string process_data = SerializeObjectHumanReadable(*process);
+    std::string process_data;
+    EncodeProcess(*process, &process_data);
     tcp_entity->Send(Msg_RemoteProcess, process_data.data(),
                      process_data.size());
   }
@@ -309,6 +330,13 @@ void ConnectionManager::ConnectionThread() {
     if (!GTcpClient->IsValid()) {
       GTcpClient->Connect(m_RemoteAddress);
       GTcpClient->Start();
+      if (GTcpClient->IsValid()) {
+        // The service sends the capture data, compressed if we ask for it.
+        Message msg(Msg_EnableCompression);
+        msg.m_Header.m_GenericHeader.m_Address =
+            GParams.m_CompressCaptureTraffic;
+        GTcpClient->Send(msg);
+      }
     } else {
       // std::string msg("Hello from dev machine");
       // GTcpClient->Send(msg);
@@ -0,0 +1,206 @@
+#include "ContextSwitchEncoding.h"
+
+#include <algorithm>
+
+#include "ByteCoding.h"
+
+namespace {
+// Written first, to detect mismatching service and client versions.
+constexpr uint8_t kFormatVersion = 1;
+// The switch type takes the low two bits of the thread index varint. The
+// value of the unused type, with index 0, announces a new processor number.
+constexpr uint64_t kTypeBits = 2;
+constexpr uint64_t kTypeMask = (1 << kTypeBits) - 1;
+constexpr uint64_t kProcessorNumberChange = kTypeMask;
+constexpr uint8_t kInitialProcessorNumber = 0xFF;
+
+// Encoding state of a core, the same on both sides.
+struct CoreState {
+  uint64_t time = 0;
+  uint8_t processor_number = kInitialProcessorNumber;
+};
+
+void PutContextSwitch(const ContextSwitch& context_switch,
+                      uint64_t thread_index, CoreState* core,
+                      ByteWriter* writer) {
+  if (context_switch.m_ProcessorNumber != core->processor_number) {
+    core->processor_number = context_switch.m_ProcessorNumber;
+    writer->PutVarint(kProcessorNumberChange);
+    writer->PutByte(core->processor_number);
+  }
+  writer->PutVarint((thread_index << kTypeBits) | context_switch.m_Type);
+  writer->PutZigZag(static_cast<int64_t>(context_switch.m_Time - core->time));
+  core->time = context_switch.m_Time;
+}
+
+// Reads all but the thread id, which is resolved from "thread_index" by the
+// caller. Returns false if the data is malformed.
+bool GetContextSwitch(ByteReader* reader, CoreState* core,
+                      ContextSwitch* context_switch, uint64_t* thread_index) {
+  uint64_t value = reader->GetVarint();
+  if (value == kProcessorNumberChange) {
+    core->processor_number = reader->GetByte();
+    value = reader->GetVarint();
+  }
+  uint64_t type = value & kTypeMask;
+  if (type > ContextSwitch::Invalid) return false;
+
+  *thread_index = value >> kTypeBits;
+  core->time += static_cast<uint64_t>(reader->GetZigZag());
+  context_switch->m_Type = static_cast<ContextSwitch::SwitchType>(type);
+  context_switch->m_Time = core->time;
+  context_switch->m_ProcessorNumber = core->processor_number;
+  return reader->ok();
+}
+}  // namespace
+
+void EncodeContextSwitches(const std::vector<ContextSwitch>& context_switches,
+                           std::string* buffer) {
+  buffer->clear();
+  ByteWriter writer(buffer);
+  writer.PutByte(kFormatVersion);
+  writer.PutVarint(context_switches.size());
+
+  // Group per core, keeping the order of the switches of each core.
+  std::vector<const ContextSwitch*> sorted;
+  sorted.reserve(context_switches.size());
+  for (const ContextSwitch& context_switch : context_switches) {
+    sorted.push_back(&context_switch);
+  }
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [](const ContextSwitch* lhs, const ContextSwitch* rhs) {
+                     return lhs->m_ProcessorIndex < rhs->m_ProcessorIndex;
+                   });
+
+  uint64_t num_cores = 0;
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    if (i == 0 ||
+        sorted[i]->m_ProcessorIndex != sorted[i - 1]->m_ProcessorIndex) {
+      ++num_cores;
+    }
+  }
+  writer.PutVarint(num_cores);
+
+  absl::flat_hash_map<uint32_t, uint64_t> thread_indices;
+  size_t begin = 0;
+  while (begin < sorted.size()) {
+    uint16_t processor_index = sorted[begin]->m_ProcessorIndex;
+    size_t end = begin;
+    while (end < sorted.size() &&
+           sorted[end]->m_ProcessorIndex == processor_index) {
+      ++end;
+    }
+    writer.PutVarint(processor_index);
+    writer.PutVarint(end - begin);
+
+    CoreState core;
+    for (size_t i = begin; i < end; ++i) {
+      uint32_t thread_id = sorted[i]->m_ThreadId;
+      auto result = thread_indices.emplace(thread_id, thread_indices.size());
+      PutContextSwitch(*sorted[i], result.first->second, &core, &writer);
+      if (result.second) writer.PutVarint(thread_id);
+    }
+    begin = end;
+  }
+}
+
+bool DecodeContextSwitches(
+    const char* data, size_t size,
+    const std::function<void(ContextSwitch&)>& callback) {
+  ByteReader reader(data, size);
+  uint64_t num_context_switches = 0;
+  if (!reader.GetHeader(kFormatVersion, &num_context_switches)) return false;
+  uint64_t num_cores = reader.GetVarint();
+  if (!reader.ok() || num_cores > reader.GetRemainingSize()) return false;
+
+  std::vector<uint32_t> thread_ids;
+  ContextSwitch context_switch;
+  uint64_t num_decoded = 0;
+  for (uint64_t i = 0; i < num_cores; ++i) {
+    uint64_t processor_index = reader.GetVarint();
+    uint64_t num_core_switches = reader.GetVarint();
+    if (!reader.ok() || processor_index > UINT16_MAX ||
+        num_core_switches > num_context_switches - num_decoded) {
+      return false;
+    }
+    context_switch.m_ProcessorIndex = static_cast<uint16_t>(processor_index);
+
+    CoreState core;
+    for (uint64_t j = 0; j < num_core_switches; ++j) {
+      uint64_t thread_index = 0;
+      if (!GetContextSwitch(&reader, &core, &context_switch, &thread_index)) {
+        return false;
+      }
+      if (thread_index == thread_ids.size()) {
+        thread_ids.push_back(static_cast<uint32_t>(reader.GetVarint()));
+        if (!reader.ok()) return false;
+      } else if (thread_index > thread_ids.size()) {
+        return false;
+      }
+      context_switch.m_ThreadId = thread_ids[thread_index];
+      callback(context_switch);
+    }
+    num_decoded += num_core_switches;
+  }
+  return num_decoded == num_context_switches &&
+         reader.GetRemainingSize() == 0;
+}
+
+void PackedContextSwitches::Add(const ContextSwitch& context_switch) {
+  // Copies, the fields of the packed struct can't be bound to references.
+  uint32_t thread_id = context_switch.m_ThreadId;
+  uint16_t processor_index = context_switch.m_ProcessorIndex;
+  auto result = thread_indices_.emplace(thread_id, thread_ids_.size());
+  if (result.second) thread_ids_.push_back(thread_id);
+
+  Core& core = cores_[processor_index];
+  CoreState state{core.time, core.processor_number};
+  ByteWriter writer(&core.data);
+  PutContextSwitch(context_switch, result.first->second, &state, &writer);
+  core.time = state.time;
+  core.processor_number = state.processor_number;
+  ++num_context_switches_;
+}
+
+void PackedContextSwitches::Clear() {
+  cores_.clear();
+  thread_indices_.clear();
+  thread_ids_.clear();
+  num_context_switches_ = 0;
+}
+
+void PackedContextSwitches::ForEach(
+    uint16_t processor_index,
+    const std::function<void(const ContextSwitch&)>& callback) const {
+  auto it = cores_.find(processor_index);
+  if (it == cores_.end()) return;
+
+  const std::string& data = it->second.data;
+  ByteReader reader(data.data(), data.size());
+  CoreState state;
+  ContextSwitch context_switch;
+  context_switch.m_ProcessorIndex = processor_index;
+  while (reader.GetRemainingSize() > 0) {
+    uint64_t thread_index = 0;
+    // The data was written by Add(), it can't be malformed.
+    GetContextSwitch(&reader, &state, &context_switch, &thread_index);
+    context_switch.m_ThreadId = thread_ids_[thread_index];
+    callback(context_switch);
+  }
+}
+
+std::vector<uint16_t> PackedContextSwitches::GetProcessorIndices() const {
+  std::vector<uint16_t> processor_indices;
+  for (const auto& pair : cores_) {
+    processor_indices.push_back(pair.first);
+  }
+  return processor_indices;
+}
+
+size_t PackedContextSwitches::GetNumBytes() const {
+  size_t num_bytes = thread_ids_.size() * sizeof(uint32_t);
+  for (const auto& pair : cores_) {
+    num_bytes += pair.second.data.size();
+  }
+  return num_bytes;
+}
@@ -0,0 +1,65 @@
+#ifndef ORBIT_CORE_CONTEXT_SWITCH_ENCODING_H_
+#define ORBIT_CORE_CONTEXT_SWITCH_ENCODING_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ContextSwitch.h"
+#include "absl/container/flat_hash_map.h"
+
+// Compact encoding of context switches, used on the wire and in the client.
+//
+// Context switches are packed per core: the timestamps of a core only grow,
+// so they are delta encoded against the previous switch of the same core.
+// Thread ids are replaced by small indices in order of first appearance,
+// which share a varint with the switch type. The processor number is only
+// written when it changes on a core. See ByteCoding.h for the integer
+// encodings.
+//
+// Encoding groups the context switches per core. Decoding calls "callback"
+// for each context switch, reusing the same object, core after core and in
+// their original order within a core. It returns false if the data is
+// malformed, after the callbacks for the switches decoded until then.
+
+void EncodeContextSwitches(const std::vector<ContextSwitch>& context_switches,
+                           std::string* buffer);
+bool DecodeContextSwitches(
+    const char* data, size_t size,
+    const std::function<void(ContextSwitch&)>& callback);
+
+// Context switches of a capture, stored with the encoding above in a growing
+// buffer per core. This takes a few bytes per context switch, where
+// ContextSwitch objects take 19.
+class PackedContextSwitches {
+ public:
+  void Add(const ContextSwitch& context_switch);
+  void Clear();
+
+  // Calls "callback" for the context switches of a core, in the order they
+  // were added.
+  void ForEach(uint16_t processor_index,
+               const std::function<void(const ContextSwitch&)>& callback) const;
+  std::vector<uint16_t> GetProcessorIndices() const;
+  size_t GetNumProcessors() const { return cores_.size(); }
+  uint64_t GetNumContextSwitches() const { return num_context_switches_; }
+  // Encoded size of the context switches.
+  size_t GetNumBytes() const;
+
+ private:
+  struct Core {
+    std::string data;
+    uint64_t time = 0;
+    uint8_t processor_number = 0xFF;
+  };
+
+  std::map<uint16_t, Core> cores_;
+  absl::flat_hash_map<uint32_t, uint64_t> thread_indices_;
+  std::vector<uint32_t> thread_ids_;
+  uint64_t num_context_switches_ = 0;
+};
+
+#endif  // ORBIT_CORE_CONTEXT_SWITCH_ENCODING_H_
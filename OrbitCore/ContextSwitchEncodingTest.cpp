@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ContextSwitch.h"
+#include "ContextSwitchEncoding.h"
+
+namespace {
+// A busy machine: threads of a few processes switching in and out of 32
+// cores, every few microseconds on each core, in timestamp order.
+std::vector<ContextSwitch> CreateSchedulerTrace(size_t count) {
+  constexpr uint16_t kNumCores = 32;
+  std::mt19937_64 random(42);
+  std::vector<uint64_t> core_times(kNumCores, 1'000'000'000'000);
+  std::vector<uint32_t> running(kNumCores, 0);
+
+  std::vector<ContextSwitch> trace;
+  while (trace.size() < count) {
+    uint16_t core = static_cast<uint16_t>(random() % kNumCores);
+    core_times[core] += 1000 + random() % 20000;
+    if (running[core] != 0) {
+      ContextSwitch out(ContextSwitch::Out);
+      out.m_ThreadId = running[core];
+      out.m_Time = core_times[core];
+      out.m_ProcessorIndex = core;
+      out.m_ProcessorNumber = static_cast<uint8_t>(core);
+      trace.push_back(out);
+    }
+
+    ContextSwitch in(ContextSwitch::In);
+    in.m_ThreadId = 1000 + static_cast<uint32_t>(random() % 500);
+    in.m_Time = core_times[core] + random() % 100;
+    in.m_ProcessorIndex = core;
+    in.m_ProcessorNumber = static_cast<uint8_t>(core);
+    trace.push_back(in);
+    running[core] = in.m_ThreadId;
+  }
+
+  std::stable_sort(trace.begin(), trace.end(),
+                   [](const ContextSwitch& lhs, const ContextSwitch& rhs) {
+                     return lhs.m_Time < rhs.m_Time;
+                   });
+  trace.resize(count);
+  return trace;
+}
+
+// Decoding yields the context switches core after core.
+std::vector<ContextSwitch> SortByCore(std::vector<ContextSwitch> trace) {
+  std::stable_sort(trace.begin(), trace.end(),
+                   [](const ContextSwitch& lhs, const ContextSwitch& rhs) {
+                     return lhs.m_ProcessorIndex < rhs.m_ProcessorIndex;
+                   });
+  return trace;
+}
+
+// Compares copies, the fields of the packed struct can't be bound to the
+// references EXPECT_EQ takes.
+void ExpectEqual(const ContextSwitch& lhs, const ContextSwitch& rhs) {
+  EXPECT_EQ(uint32_t{lhs.m_ThreadId}, uint32_t{rhs.m_ThreadId});
+  EXPECT_EQ(int{lhs.m_Type}, int{rhs.m_Type});
+  EXPECT_EQ(uint64_t{lhs.m_Time}, uint64_t{rhs.m_Time});
+  EXPECT_EQ(uint16_t{lhs.m_ProcessorIndex}, uint16_t{rhs.m_ProcessorIndex});
+  EXPECT_EQ(uint8_t{lhs.m_ProcessorNumber}, uint8_t{rhs.m_ProcessorNumber});
+}
+
+void ExpectRoundTrip(const std::vector<ContextSwitch>& trace) {
+  std::string buffer;
+  EncodeContextSwitches(trace, &buffer);
+
+  std::vector<ContextSwitch> expected = SortByCore(trace);
+  size_t index = 0;
+  EXPECT_TRUE(DecodeContextSwitches(
+      buffer.data(), buffer.size(), [&](ContextSwitch& context_switch) {
+        ASSERT_LT(index, expected.size());
+        ExpectEqual(context_switch, expected[index++]);
+      }));
+  EXPECT_EQ(index, expected.size());
+}
+}  // namespace
+
+TEST(ContextSwitchEncoding, SchedulerTraceRoundTrip) {
+  std::vector<ContextSwitch> trace = CreateSchedulerTrace(200'000);
+  std::string buffer;
+  EncodeContextSwitches(trace, &buffer);
+  EXPECT_LT(buffer.size(), trace.size() * sizeof(ContextSwitch) / 4);
+
+  ExpectRoundTrip(trace);
+  // Chunks as streamed during a capture.
+  for (size_t begin = 0; begin < trace.size(); begin += 4096) {
+    size_t end = std::min(begin + 4096, trace.size());
+    ExpectRoundTrip(std::vector<ContextSwitch>(trace.begin() + begin,
+                                               trace.begin() + end));
+  }
+}
+
+TEST(ContextSwitchEncoding, UnusualValuesRoundTrip) {
+  std::vector<ContextSwitch> trace = CreateSchedulerTrace(100);
+  // Time going backwards, a processor number changing on a core, invalid
+  // switches and extreme values.
+  trace[10].m_Time = 0;
+  trace[20].m_ProcessorNumber = 200;
+  trace[30].m_Type = ContextSwitch::Invalid;
+  trace[40].m_ThreadId = UINT32_MAX;
+  trace[50].m_Time = UINT64_MAX;
+  trace[60].m_ProcessorIndex = UINT16_MAX;
+  trace.push_back(ContextSwitch());
+  ExpectRoundTrip(trace);
+  ExpectRoundTrip({});
+}
+
+TEST(ContextSwitchEncoding, MalformedDataIsRejected) {
+  std::vector<ContextSwitch> trace = CreateSchedulerTrace(50);
+  std::string buffer;
+  EncodeContextSwitches(trace, &buffer);
+
+  for (size_t size = 0; size < buffer.size(); ++size) {
+    size_t num_decoded = 0;
+    EXPECT_FALSE(DecodeContextSwitches(
+        buffer.data(), size,
+        [&num_decoded](ContextSwitch&) { ++num_decoded; }));
+    EXPECT_LT(num_decoded, trace.size());
+  }
+
+  // One switch on core 0 of an unknown type, then of an unknown thread.
+  std::string bad_type = {1, 1, 1, 0, 1, 0x07, 0, 5};
+  EXPECT_FALSE(DecodeContextSwitches(bad_type.data(), bad_type.size(),
+                                     [](ContextSwitch&) { FAIL(); }));
+  std::string bad_thread = {1, 1, 1, 0, 1, 0x04, 0};
+  EXPECT_FALSE(DecodeContextSwitches(bad_thread.data(), bad_thread.size(),
+                                     [](ContextSwitch&) { FAIL(); }));
+  // More switches on a core than in the buffer.
+  std::string bad_count = {1, 1, 1, 0, 2, 0x00, 0, 5};
+  EXPECT_FALSE(DecodeContextSwitches(bad_count.data(), bad_count.size(),
+                                     [](ContextSwitch&) {}));
+}
+
+TEST(PackedContextSwitches, StoresContextSwitchesPerCore) {
+  std::vector<ContextSwitch> trace = CreateSchedulerTrace(100'000);
+  trace[20].m_ProcessorNumber = 200;
+
+  PackedContextSwitches packed;
+  for (const ContextSwitch& context_switch : trace) {
+    packed.Add(context_switch);
+  }
+  EXPECT_EQ(packed.GetNumContextSwitches(), trace.size());
+  EXPECT_EQ(packed.GetNumProcessors(), 32);
+  EXPECT_LT(packed.GetNumBytes(), trace.size() * sizeof(ContextSwitch) / 4);
+
+  std::vector<ContextSwitch> expected = SortByCore(trace);
+  size_t index = 0;
+  for (uint16_t processor_index : packed.GetProcessorIndices()) {
+    packed.ForEach(processor_index, [&](const ContextSwitch& context_switch) {
+      ASSERT_LT(index, expected.size());
+      ExpectEqual(context_switch, expected[index++]);
+    });
+  }
+  EXPECT_EQ(index, expected.size());
+
+  packed.Clear();
+  EXPECT_EQ(packed.GetNumContextSwitches(), 0);
+  EXPECT_EQ(packed.GetNumBytes(), 0);
+  packed.ForEach(0, [](const ContextSwitch&) { FAIL(); });
+}
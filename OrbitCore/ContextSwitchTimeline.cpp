@@ -0,0 +1,141 @@
+#include "ContextSwitchTimeline.h"
+
+#include <algorithm>
+
+namespace {
+bool IsBefore(const ContextSwitchTimeline::Switch& lhs, uint64_t time) {
+  return lhs.time < time;
+}
+}  // namespace
+
+const ContextSwitchTimeline::RunningInterval* ContextSwitchTimeline::Add(
+    const ContextSwitch& context_switch) {
+  // Copies, the fields of the packed struct can't be bound to references.
+  uint64_t time = context_switch.m_Time;
+  uint32_t thread_id = context_switch.m_ThreadId;
+  uint16_t processor_index = context_switch.m_ProcessorIndex;
+  ContextSwitch::SwitchType type = context_switch.m_Type;
+  ++num_context_switches_;
+
+  Insert({time, processor_index, type}, &threads_[thread_id]);
+  Core& core = cores_[processor_index];
+  size_t index = Insert({time, thread_id, type}, &core.switches);
+  UpdateIntervals(index, &core);
+
+  bool is_late = index + 1 != core.switches.size();
+  if (is_late) ++num_late_context_switches_;
+  if (is_late || type != ContextSwitch::Out || index == 0 ||
+      core.switches[index - 1].type != ContextSwitch::In) {
+    return nullptr;
+  }
+  return &core.intervals.back();
+}
+
+void ContextSwitchTimeline::Clear() {
+  cores_.clear();
+  threads_.clear();
+  num_context_switches_ = 0;
+  num_late_context_switches_ = 0;
+}
+
+size_t ContextSwitchTimeline::Insert(const Switch& new_switch,
+                                     std::vector<Switch>* switches) {
+  if (switches->empty() || switches->back().time <= new_switch.time) {
+    switches->push_back(new_switch);
+    return switches->size() - 1;
+  }
+  // After the switches of the same time, which arrived before.
+  auto it = std::upper_bound(
+      switches->begin(), switches->end(), new_switch.time,
+      [](uint64_t time, const Switch& rhs) { return time < rhs.time; });
+  it = switches->insert(it, new_switch);
+  return it - switches->begin();
+}
+
+void ContextSwitchTimeline::UpdateIntervals(size_t index, Core* core) {
+  const std::vector<Switch>& switches = core->switches;
+  std::vector<RunningInterval>& intervals = core->intervals;
+
+  // The switches from the one before "index" on can pair differently. Those
+  // of the same time are paired again too, as the intervals are only known
+  // by time.
+  size_t begin = 0;
+  if (index > 0) {
+    begin = std::lower_bound(switches.begin(), switches.end(),
+                             switches[index - 1].time, IsBefore) -
+            switches.begin();
+  }
+  uint64_t begin_time = switches[begin].time;
+  while (!intervals.empty() && intervals.back().start >= begin_time) {
+    intervals.pop_back();
+  }
+
+  for (size_t i = begin; i + 1 < switches.size(); ++i) {
+    if (switches[i].type == ContextSwitch::In &&
+        switches[i + 1].type == ContextSwitch::Out) {
+      intervals.push_back(
+          {switches[i].time, switches[i + 1].time, switches[i + 1].id});
+    }
+  }
+}
+
+void ContextSwitchTimeline::ForEachSwitch(
+    const std::vector<Switch>& switches, uint64_t min_time, uint64_t max_time,
+    const std::function<void(const Switch&)>& callback) {
+  auto it = std::lower_bound(switches.begin(), switches.end(), min_time,
+                             IsBefore);
+  for (; it != switches.end() && it->time <= max_time; ++it) {
+    callback(*it);
+  }
+}
+
+void ContextSwitchTimeline::ForEachCoreSwitch(
+    uint16_t processor_index, uint64_t min_time, uint64_t max_time,
+    const std::function<void(const Switch&)>& callback) const {
+  auto it = cores_.find(processor_index);
+  if (it == cores_.end()) return;
+  ForEachSwitch(it->second.switches, min_time, max_time, callback);
+}
+
+void ContextSwitchTimeline::ForEachThreadSwitch(
+    uint32_t thread_id, uint64_t min_time, uint64_t max_time,
+    const std::function<void(const Switch&)>& callback) const {
+  auto it = threads_.find(thread_id);
+  if (it == threads_.end()) return;
+  ForEachSwitch(it->second, min_time, max_time, callback);
+}
+
+void ContextSwitchTimeline::ForEachRunningInterval(
+    uint16_t processor_index, uint64_t min_time, uint64_t max_time,
+    const std::function<void(const RunningInterval&)>& callback) const {
+  auto core = cores_.find(processor_index);
+  if (core == cores_.end()) return;
+
+  const std::vector<RunningInterval>& intervals = core->second.intervals;
+  auto it = std::lower_bound(
+      intervals.begin(), intervals.end(), min_time,
+      [](const RunningInterval& lhs, uint64_t time) { return lhs.end < time; });
+  for (; it != intervals.end() && it->start <= max_time; ++it) {
+    callback(*it);
+  }
+}
+
+std::vector<uint16_t> ContextSwitchTimeline::GetProcessorIndices() const {
+  std::vector<uint16_t> processor_indices;
+  for (const auto& pair : cores_) {
+    processor_indices.push_back(pair.first);
+  }
+  return processor_indices;
+}
+
+size_t ContextSwitchTimeline::GetMemoryUsage() const {
+  size_t memory_usage = 0;
+  for (const auto& pair : cores_) {
+    memory_usage += pair.second.switches.capacity() * sizeof(Switch) +
+                    pair.second.intervals.capacity() * sizeof(RunningInterval);
+  }
+  for (const auto& pair : threads_) {
+    memory_usage += pair.second.capacity() * sizeof(Switch);
+  }
+  return memory_usage;
+}
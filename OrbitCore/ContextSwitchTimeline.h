@@ -0,0 +1,88 @@
+#ifndef ORBIT_CORE_CONTEXT_SWITCH_TIMELINE_H_
+#define ORBIT_CORE_CONTEXT_SWITCH_TIMELINE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <vector>
+
+#include "ContextSwitch.h"
+#include "absl/container/flat_hash_map.h"
+
+// Context switches of a capture indexed by time, per core and per thread,
+// for drawing the switches of a time range without walking all of them.
+//
+// Switches are kept in arrays sorted by time, where they are appended as
+// they mostly arrive in order; late ones are inserted at their place. Time
+// ranges are found by binary search.
+//
+// The intervals during which a thread ran on each core, from a switch in to
+// the next switch out, are paired as switches arrive, so drawing a core
+// doesn't pair them again.
+class ContextSwitchTimeline {
+ public:
+  // A switch of a core or of a thread. "id" is the thread for the switches
+  // of a core, and the core for the switches of a thread.
+  struct Switch {
+    uint64_t time;
+    uint32_t id;
+    ContextSwitch::SwitchType type;
+  };
+
+  struct RunningInterval {
+    uint64_t start;
+    uint64_t end;
+    uint32_t thread_id;
+  };
+
+  // Returns the running interval ended by "context_switch", or nullptr if
+  // it doesn't end one. Late switches update the intervals but return
+  // nullptr. The interval is valid until the next call.
+  const RunningInterval* Add(const ContextSwitch& context_switch);
+  void Clear();
+
+  // Call "callback" in time order for what lies in [min_time, max_time].
+  void ForEachCoreSwitch(
+      uint16_t processor_index, uint64_t min_time, uint64_t max_time,
+      const std::function<void(const Switch&)>& callback) const;
+  void ForEachThreadSwitch(
+      uint32_t thread_id, uint64_t min_time, uint64_t max_time,
+      const std::function<void(const Switch&)>& callback) const;
+  // Intervals overlapping [min_time, max_time].
+  void ForEachRunningInterval(
+      uint16_t processor_index, uint64_t min_time, uint64_t max_time,
+      const std::function<void(const RunningInterval&)>& callback) const;
+
+  std::vector<uint16_t> GetProcessorIndices() const;
+  size_t GetNumProcessors() const { return cores_.size(); }
+  uint64_t GetNumContextSwitches() const { return num_context_switches_; }
+  // Switches older than the latest one of their core when added.
+  uint64_t GetNumLateContextSwitches() const {
+    return num_late_context_switches_;
+  }
+  // Bytes held by the arrays, including unused capacity.
+  size_t GetMemoryUsage() const;
+
+ private:
+  struct Core {
+    std::vector<Switch> switches;
+    // Sorted by start, and by end as they don't overlap.
+    std::vector<RunningInterval> intervals;
+  };
+
+  // Inserts "new_switch" in time order, returns its index.
+  static size_t Insert(const Switch& new_switch, std::vector<Switch>* switches);
+  static void ForEachSwitch(
+      const std::vector<Switch>& switches, uint64_t min_time,
+      uint64_t max_time, const std::function<void(const Switch&)>& callback);
+  // Pairs the switches of "core" again from the one before "index".
+  static void UpdateIntervals(size_t index, Core* core);
+
+  std::map<uint16_t, Core> cores_;
+  absl::flat_hash_map<uint32_t, std::vector<Switch>> threads_;
+  uint64_t num_context_switches_ = 0;
+  uint64_t num_late_context_switches_ = 0;
+};
+
+#endif  // ORBIT_CORE_CONTEXT_SWITCH_TIMELINE_H_
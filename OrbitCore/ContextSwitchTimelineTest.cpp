@@ -0,0 +1,224 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "ContextSwitch.h"
+#include "ContextSwitchTimeline.h"
+
+using Switch = ContextSwitchTimeline::Switch;
+using RunningInterval = ContextSwitchTimeline::RunningInterval;
+
+// Found by the comparisons of std::vector, in the namespace of the structs.
+bool operator==(const Switch& lhs, const Switch& rhs) {
+  return lhs.time == rhs.time && lhs.id == rhs.id && lhs.type == rhs.type;
+}
+
+bool operator==(const RunningInterval& lhs, const RunningInterval& rhs) {
+  return lhs.start == rhs.start && lhs.end == rhs.end &&
+         lhs.thread_id == rhs.thread_id;
+}
+
+namespace {
+
+ContextSwitch MakeSwitch(ContextSwitch::SwitchType type, uint64_t time,
+                         uint32_t thread_id, uint16_t core) {
+  ContextSwitch context_switch(type);
+  context_switch.m_Time = time;
+  context_switch.m_ThreadId = thread_id;
+  context_switch.m_ProcessorIndex = core;
+  context_switch.m_ProcessorNumber = static_cast<uint8_t>(core);
+  return context_switch;
+}
+
+// Threads switching in and out of 8 cores, in timestamp order per core.
+// Some switches out are missing, as when a capture starts.
+std::vector<ContextSwitch> CreateSchedulerTrace(size_t count) {
+  constexpr uint16_t kNumCores = 8;
+  std::mt19937_64 random(42);
+  std::vector<uint64_t> core_times(kNumCores, 1'000'000);
+  std::vector<uint32_t> running(kNumCores, 0);
+
+  std::vector<ContextSwitch> trace;
+  while (trace.size() < count) {
+    uint16_t core = static_cast<uint16_t>(random() % kNumCores);
+    core_times[core] += random() % 3 == 0 ? 0 : 1 + random() % 2000;
+    if (running[core] != 0 && random() % 10 != 0) {
+      trace.push_back(MakeSwitch(ContextSwitch::Out, core_times[core],
+                                 running[core], core));
+    }
+    running[core] = 1000 + static_cast<uint32_t>(random() % 50);
+    trace.push_back(
+        MakeSwitch(ContextSwitch::In, core_times[core], running[core], core));
+  }
+  return trace;
+}
+
+// What the timeline holds, computed by sorting all switches.
+struct Expected {
+  explicit Expected(const std::vector<ContextSwitch>& trace) {
+    for (const ContextSwitch& context_switch : trace) {
+      cores[context_switch.m_ProcessorIndex].push_back(
+          {context_switch.m_Time, context_switch.m_ThreadId,
+           context_switch.m_Type});
+      threads[context_switch.m_ThreadId].push_back(
+          {context_switch.m_Time, context_switch.m_ProcessorIndex,
+           context_switch.m_Type});
+    }
+    auto by_time = [](const Switch& lhs, const Switch& rhs) {
+      return lhs.time < rhs.time;
+    };
+    for (auto& pair : cores) {
+      std::vector<Switch>& switches = pair.second;
+      std::stable_sort(switches.begin(), switches.end(), by_time);
+      for (size_t i = 0; i + 1 < switches.size(); ++i) {
+        if (switches[i].type == ContextSwitch::In &&
+            switches[i + 1].type == ContextSwitch::Out) {
+          intervals[pair.first].push_back(
+              {switches[i].time, switches[i + 1].time, switches[i + 1].id});
+        }
+      }
+    }
+    for (auto& pair : threads) {
+      std::stable_sort(pair.second.begin(), pair.second.end(), by_time);
+    }
+  }
+
+  std::map<uint16_t, std::vector<Switch>> cores;
+  std::map<uint32_t, std::vector<Switch>> threads;
+  std::map<uint16_t, std::vector<RunningInterval>> intervals;
+};
+
+template <class T>
+std::vector<T> InRange(const std::vector<T>& values, uint64_t min_time,
+                       uint64_t max_time) {
+  std::vector<T> result;
+  for (const T& value : values) {
+    if (value.time >= min_time && value.time <= max_time) {
+      result.push_back(value);
+    }
+  }
+  return result;
+}
+
+std::vector<RunningInterval> Overlapping(
+    const std::vector<RunningInterval>& intervals, uint64_t min_time,
+    uint64_t max_time) {
+  std::vector<RunningInterval> result;
+  for (const RunningInterval& interval : intervals) {
+    if (interval.end >= min_time && interval.start <= max_time) {
+      result.push_back(interval);
+    }
+  }
+  return result;
+}
+
+void ExpectSameAsSorted(const ContextSwitchTimeline& timeline,
+                        const std::vector<ContextSwitch>& trace) {
+  Expected expected(trace);
+  EXPECT_EQ(timeline.GetNumContextSwitches(), trace.size());
+  ASSERT_EQ(timeline.GetNumProcessors(), expected.cores.size());
+
+  std::mt19937_64 random(7);
+  for (int i = 0; i < 100; ++i) {
+    uint64_t min_time = 1'000'000 + random() % 1'000'000;
+    uint64_t max_time = min_time + random() % 100'000;
+
+    for (const auto& pair : expected.cores) {
+      std::vector<Switch> switches;
+      timeline.ForEachCoreSwitch(
+          pair.first, min_time, max_time,
+          [&switches](const Switch& value) { switches.push_back(value); });
+      EXPECT_EQ(switches, InRange(pair.second, min_time, max_time));
+
+      std::vector<RunningInterval> intervals;
+      timeline.ForEachRunningInterval(
+          pair.first, min_time, max_time,
+          [&intervals](const RunningInterval& value) {
+            intervals.push_back(value);
+          });
+      EXPECT_EQ(intervals,
+                Overlapping(expected.intervals[pair.first], min_time,
+                            max_time));
+    }
+
+    for (const auto& pair : expected.threads) {
+      std::vector<Switch> switches;
+      timeline.ForEachThreadSwitch(
+          pair.first, min_time, max_time,
+          [&switches](const Switch& value) { switches.push_back(value); });
+      EXPECT_EQ(switches, InRange(pair.second, min_time, max_time));
+    }
+  }
+}
+
+}  // namespace
+
+TEST(ContextSwitchTimeline, RangeQueriesMatchSortedSwitches) {
+  std::vector<ContextSwitch> trace = CreateSchedulerTrace(20000);
+  ContextSwitchTimeline timeline;
+  for (const ContextSwitch& context_switch : trace) {
+    timeline.Add(context_switch);
+  }
+  ExpectSameAsSorted(timeline, trace);
+}
+
+TEST(ContextSwitchTimeline, LateSwitchesAreInsertedInOrder) {
+  std::vector<ContextSwitch> trace = CreateSchedulerTrace(20000);
+  // Switches arriving up to 30 positions late.
+  std::mt19937_64 random(3);
+  for (size_t i = 0; i + 30 < trace.size(); i += 1 + random() % 60) {
+    std::swap(trace[i], trace[i + random() % 30]);
+  }
+
+  ContextSwitchTimeline timeline;
+  for (const ContextSwitch& context_switch : trace) {
+    timeline.Add(context_switch);
+  }
+  ExpectSameAsSorted(timeline, trace);
+}
+
+TEST(ContextSwitchTimeline, AddReturnsTheEndedInterval) {
+  ContextSwitchTimeline timeline;
+  EXPECT_EQ(timeline.Add(MakeSwitch(ContextSwitch::Out, 100, 1, 0)), nullptr);
+  EXPECT_EQ(timeline.Add(MakeSwitch(ContextSwitch::In, 200, 2, 0)), nullptr);
+  // Another core doesn't end the interval.
+  EXPECT_EQ(timeline.Add(MakeSwitch(ContextSwitch::Out, 250, 2, 1)), nullptr);
+
+  const RunningInterval* interval =
+      timeline.Add(MakeSwitch(ContextSwitch::Out, 300, 2, 0));
+  ASSERT_NE(interval, nullptr);
+  EXPECT_EQ(interval->start, 200);
+  EXPECT_EQ(interval->end, 300);
+  EXPECT_EQ(interval->thread_id, 2);
+
+  // A late switch in splits the interval it falls into.
+  EXPECT_EQ(timeline.Add(MakeSwitch(ContextSwitch::In, 280, 3, 0)), nullptr);
+  std::vector<RunningInterval> intervals;
+  timeline.ForEachRunningInterval(0, 0, 1000,
+                                  [&intervals](const RunningInterval& value) {
+                                    intervals.push_back(value);
+                                  });
+  ASSERT_EQ(intervals.size(), 1);
+  EXPECT_EQ(intervals[0].start, 280);
+  EXPECT_EQ(intervals[0].end, 300);
+  EXPECT_EQ(timeline.GetNumLateContextSwitches(), 1);
+}
+
+TEST(ContextSwitchTimeline, Clear) {
+  ContextSwitchTimeline timeline;
+  for (const ContextSwitch& context_switch : CreateSchedulerTrace(100)) {
+    timeline.Add(context_switch);
+  }
+  EXPECT_GT(timeline.GetMemoryUsage(), 0);
+  timeline.Clear();
+  EXPECT_EQ(timeline.GetNumProcessors(), 0);
+  EXPECT_EQ(timeline.GetNumContextSwitches(), 0);
+  EXPECT_EQ(timeline.GetNumLateContextSwitches(), 0);
+  EXPECT_TRUE(timeline.GetProcessorIndices().empty());
+  timeline.ForEachCoreSwitch(0, 0, UINT64_MAX,
+                             [](const Switch&) { FAIL(); });
+}
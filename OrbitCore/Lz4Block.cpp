@@ -0,0 +1,164 @@
+#include "Lz4Block.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+constexpr size_t kMinMatch = 4;
+// The last match must start at least kMatchSafeDistance bytes before the
+// end of the block, and the last kLastLiterals bytes are always literals.
+constexpr size_t kMatchSafeDistance = 12;
+constexpr size_t kLastLiterals = 5;
+constexpr size_t kMaxOffset = 65535;
+constexpr int kHashLog = 14;
+
+uint32_t Read32(const uint8_t* data) {
+  uint32_t value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+uint32_t Hash(uint32_t sequence) {
+  return (sequence * 2654435761u) >> (32 - kHashLog);
+}
+
+// Lengths of 15 and more continue in extra bytes of up to 255 each.
+uint8_t* WriteLength(uint8_t* out, size_t length) {
+  length -= 15;
+  while (length >= 255) {
+    *out++ = 255;
+    length -= 255;
+  }
+  *out++ = static_cast<uint8_t>(length);
+  return out;
+}
+
+uint8_t* WriteSequence(uint8_t* out, const uint8_t* literals,
+                       size_t num_literals, size_t offset,
+                       size_t match_length) {
+  uint8_t* token = out++;
+  *token = static_cast<uint8_t>(std::min<size_t>(num_literals, 15) << 4);
+  if (num_literals >= 15) out = WriteLength(out, num_literals);
+  memcpy(out, literals, num_literals);
+  out += num_literals;
+
+  // The last sequence only has literals.
+  if (match_length == 0) return out;
+
+  *out++ = static_cast<uint8_t>(offset);
+  *out++ = static_cast<uint8_t>(offset >> 8);
+  size_t length = match_length - kMinMatch;
+  *token |= static_cast<uint8_t>(std::min<size_t>(length, 15));
+  if (length >= 15) out = WriteLength(out, length);
+  return out;
+}
+
+// Reads the extra bytes of a length of 15 or more. Returns false at the end
+// of the input.
+bool ReadLength(const uint8_t** in, const uint8_t* end, size_t* length) {
+  uint8_t byte;
+  do {
+    if (*in == end) return false;
+    byte = *(*in)++;
+    *length += byte;
+  } while (byte == 255);
+  return true;
+}
+}  // namespace
+
+size_t Lz4GetMaxCompressedSize(size_t size) { return size + size / 255 + 16; }
+
+size_t Lz4Compress(const char* source, size_t size, char* destination) {
+  const uint8_t* in = reinterpret_cast<const uint8_t*>(source);
+  uint8_t* out = reinterpret_cast<uint8_t*>(destination);
+  uint8_t* out_begin = out;
+
+  const uint8_t* anchor = in;
+  if (size > kMatchSafeDistance) {
+    // Positions of the last occurrence of each hashed 4-byte sequence.
+    std::vector<uint32_t> table(size_t{1} << kHashLog, 0);
+    const uint8_t* match_start_limit = in + size - kMatchSafeDistance;
+    const uint8_t* match_end_limit = in + size - kLastLiterals;
+
+    const uint8_t* ip = in + 1;
+    while (ip < match_start_limit) {
+      uint32_t sequence = Read32(ip);
+      uint32_t& entry = table[Hash(sequence)];
+      const uint8_t* ref = in + entry;
+      entry = static_cast<uint32_t>(ip - in);
+
+      if (ip - ref > static_cast<ptrdiff_t>(kMaxOffset) ||
+          Read32(ref) != sequence) {
+        ++ip;
+        continue;
+      }
+
+      // Extend the match backwards over pending literals, then forwards.
+      while (ip > anchor && ref > in && ip[-1] == ref[-1]) {
+        --ip;
+        --ref;
+      }
+      size_t length = kMinMatch;
+      while (ip + length < match_end_limit && ip[length] == ref[length]) {
+        ++length;
+      }
+
+      out = WriteSequence(out, anchor, ip - anchor, ip - ref, length);
+      ip += length;
+      anchor = ip;
+    }
+  }
+
+  out = WriteSequence(out, anchor, in + size - anchor, 0, 0);
+  return out - out_begin;
+}
+
+bool Lz4Decompress(const char* source, size_t size, char* destination,
+                   size_t decompressed_size) {
+  const uint8_t* in = reinterpret_cast<const uint8_t*>(source);
+  const uint8_t* in_end = in + size;
+  uint8_t* out = reinterpret_cast<uint8_t*>(destination);
+  uint8_t* out_begin = out;
+  uint8_t* out_end = out + decompressed_size;
+
+  while (in < in_end) {
+    uint8_t token = *in++;
+    size_t num_literals = token >> 4;
+    if (num_literals == 15 && !ReadLength(&in, in_end, &num_literals)) {
+      return false;
+    }
+    if (num_literals > static_cast<size_t>(in_end - in) ||
+        num_literals > static_cast<size_t>(out_end - out)) {
+      return false;
+    }
+    memcpy(out, in, num_literals);
+    in += num_literals;
+    out += num_literals;
+
+    // The last sequence ends after its literals.
+    if (in == in_end) break;
+
+    if (in_end - in < 2) return false;
+    size_t offset = in[0] | (in[1] << 8);
+    in += 2;
+    if (offset == 0 || offset > static_cast<size_t>(out - out_begin)) {
+      return false;
+    }
+
+    size_t length = token & 15;
+    if (length == 15 && !ReadLength(&in, in_end, &length)) return false;
+    length += kMinMatch;
+    if (length > static_cast<size_t>(out_end - out)) return false;
+
+    // The match can overlap the bytes it produces, copy bytewise.
+    const uint8_t* match = out - offset;
+    for (size_t i = 0; i < length; ++i) {
+      out[i] = match[i];
+    }
+    out += length;
+  }
+
+  return out == out_end;
+}
@@ -0,0 +1,25 @@
+#ifndef ORBIT_CORE_LZ4_BLOCK_H_
+#define ORBIT_CORE_LZ4_BLOCK_H_
+
+#include <cstddef>
+
+// Compression in the LZ4 block format
+// (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md), used to
+// compress capture traffic. The compressor is a plain greedy single-pass
+// one: it trades some ratio for speed, as LZ4's default mode does, and its
+// output can be read by any LZ4 block decoder.
+
+// Size of the buffer Lz4Compress() needs for "size" bytes of input.
+size_t Lz4GetMaxCompressedSize(size_t size);
+
+// Compresses "size" bytes from "source" into "destination", which must hold
+// at least Lz4GetMaxCompressedSize(size) bytes. Returns the compressed size.
+size_t Lz4Compress(const char* source, size_t size, char* destination);
+
+// Decompresses "size" bytes from "source" into "destination". Returns false
+// if the data is malformed or doesn't decompress to exactly
+// "decompressed_size" bytes. Never reads or writes out of bounds.
+bool Lz4Decompress(const char* source, size_t size, char* destination,
+                   size_t decompressed_size);
+
+#endif  // ORBIT_CORE_LZ4_BLOCK_H_
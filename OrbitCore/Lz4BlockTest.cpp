@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Lz4Block.h"
+
+namespace {
+std::string Compress(const std::string& data) {
+  std::string compressed(Lz4GetMaxCompressedSize(data.size()), '\0');
+  compressed.resize(Lz4Compress(data.data(), data.size(), &compressed[0]));
+  return compressed;
+}
+
+void ExpectRoundTrip(const std::string& data) {
+  std::string compressed = Compress(data);
+  EXPECT_LE(compressed.size(), Lz4GetMaxCompressedSize(data.size()));
+  std::string decompressed(data.size(), '\0');
+  EXPECT_TRUE(Lz4Decompress(compressed.data(), compressed.size(),
+                            &decompressed[0], decompressed.size()));
+  EXPECT_EQ(decompressed, data);
+}
+
+std::string CreateRandomData(size_t size) {
+  std::mt19937 random(42);
+  std::string data(size, '\0');
+  for (char& c : data) c = static_cast<char>(random());
+  return data;
+}
+
+// Fixed size records with a few changing fields, as in capture messages.
+std::string CreateRedundantData(size_t num_records) {
+  std::mt19937 random(42);
+  std::string data;
+  uint64_t time = 1'000'000'000;
+  for (size_t i = 0; i < num_records; ++i) {
+    time += random() % 1000;
+    uint64_t record[4] = {time, 0x7f0000001000 + random() % 16, 1234, 0};
+    data.append(reinterpret_cast<const char*>(record), sizeof(record));
+  }
+  return data;
+}
+}  // namespace
+
+TEST(Lz4Block, RoundTrip) {
+  ExpectRoundTrip(CreateRandomData(100'000));
+  ExpectRoundTrip(CreateRedundantData(10'000));
+  ExpectRoundTrip(std::string(100'000, 'a'));
+}
+
+TEST(Lz4Block, EdgeSizes) {
+  std::string data = CreateRedundantData(100);
+  for (size_t size = 0; size < 64; ++size) {
+    ExpectRoundTrip(data.substr(0, size));
+    ExpectRoundTrip(std::string(size, 'a'));
+  }
+  // Literal and match lengths needing several extra length bytes.
+  ExpectRoundTrip(CreateRandomData(1000) + std::string(1000, 'b') +
+                  CreateRandomData(300));
+}
+
+TEST(Lz4Block, RedundantDataCompresses) {
+  std::string data = CreateRedundantData(10'000);
+  EXPECT_LT(Compress(data).size(), data.size() / 2);
+  EXPECT_LT(Compress(std::string(100'000, 'a')).size(), 1000);
+}
+
+TEST(Lz4Block, MalformedDataIsRejected) {
+  std::string data = CreateRedundantData(100);
+  std::string compressed = Compress(data);
+  std::string decompressed(data.size(), '\0');
+
+  for (size_t size = 0; size < compressed.size(); ++size) {
+    EXPECT_FALSE(Lz4Decompress(compressed.data(), size, &decompressed[0],
+                               decompressed.size()));
+  }
+  EXPECT_FALSE(Lz4Decompress(compressed.data(), compressed.size(),
+                             &decompressed[0], decompressed.size() - 1));
+
+  // A match referring to before the start of the output.
+  std::string bad_offset = {0x10, 'a', 0x02, 0x00};
+  EXPECT_FALSE(Lz4Decompress(bad_offset.data(), bad_offset.size(),
+                             &decompressed[0], decompressed.size()));
+
+  // Corrupted data never writes past the output.
+  std::mt19937 random(42);
+  for (int i = 0; i < 1000; ++i) {
+    std::string corrupted = compressed;
+    corrupted[random() % corrupted.size()] = static_cast<char>(random());
+    std::vector<char> output(data.size());
+    Lz4Decompress(corrupted.data(), corrupted.size(), output.data(),
+                  output.size());
+  }
+}
@@ -68,6 +68,10 @@ enum MessageType : int16_t {
   Msg_RemoteContextSwitches,
   Msg_SamplingCallstacks,
   Msg_SamplingHashedCallstacks,
+  Msg_EnableCompression,
+  Msg_CompressedBlock,
+  // Number of message types, new types go before it.
+  Msg_NumMessageTypes,
 };
 
 //-----------------------------------------------------------------------------
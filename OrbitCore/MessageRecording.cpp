@@ -0,0 +1,100 @@
+#include "MessageRecording.h"
+
+#include <cstring>
+
+namespace {
+
+constexpr char kMagic[8] = {'O', 'R', 'B', 'I', 'T', 'R', 'E', 'C'};
+constexpr uint32_t kVersion = 1;
+
+struct FileHeader {
+  char magic[sizeof(kMagic)];
+  uint32_t version;
+  // Recordings made with a different Message layout are rejected.
+  uint32_t message_size;
+};
+
+}  // namespace
+
+bool MessageRecorder::Open(const std::string& path) {
+  Close();
+  file_.open(path, std::ios::binary | std::ios::trunc);
+  if (!file_.is_open()) return false;
+
+  FileHeader header;
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.message_size = sizeof(Message);
+  file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  num_messages_ = 0;
+  num_bytes_ = sizeof(header);
+  return file_.good();
+}
+
+void MessageRecorder::Record(const Message& message) {
+  if (!file_.is_open()) return;
+
+  auto now = std::chrono::steady_clock::now();
+  if (num_messages_ == 0) start_ = now;
+  uint64_t time_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(now - start_)
+          .count();
+
+  Message header = message;
+  header.m_Data = nullptr;
+  file_.write(reinterpret_cast<const char*>(&time_ns), sizeof(time_ns));
+  file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  if (message.m_Size != 0) file_.write(message.GetData(), message.m_Size);
+
+  ++num_messages_;
+  num_bytes_ += sizeof(time_ns) + sizeof(header) + message.m_Size;
+}
+
+void MessageRecorder::Close() {
+  if (file_.is_open()) file_.close();
+}
+
+bool MessageRecordingReader::Open(const std::string& path) {
+  has_error_ = false;
+  file_.open(path, std::ios::binary);
+  if (!file_.is_open()) return false;
+
+  FileHeader header;
+  if (!file_.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion || header.message_size != sizeof(Message)) {
+    file_.close();
+    return false;
+  }
+  return true;
+}
+
+bool MessageRecordingReader::Read(RecordedMessage* message) {
+  if (!file_.is_open() || has_error_) return false;
+
+  uint64_t time_ns = 0;
+  if (!file_.read(reinterpret_cast<char*>(&time_ns), sizeof(time_ns))) {
+    // A record cut in its time stamp is malformed.
+    has_error_ = file_.gcount() != 0;
+    return false;
+  }
+
+  Message header;
+  if (!file_.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      header.m_Size > kMaxPayloadSize) {
+    has_error_ = true;
+    return false;
+  }
+  message->payload.resize(header.m_Size);
+  if (header.m_Size != 0 &&
+      !file_.read(message->payload.data(), header.m_Size)) {
+    has_error_ = true;
+    return false;
+  }
+
+  message->time_ns = time_ns;
+  message->message = header;
+  message->message.m_Data =
+      header.m_Size != 0 ? message->payload.data() : nullptr;
+  return true;
+}
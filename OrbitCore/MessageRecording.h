@@ -0,0 +1,70 @@
+#ifndef ORBIT_CORE_MESSAGE_RECORDING_H_
+#define ORBIT_CORE_MESSAGE_RECORDING_H_
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Message.h"
+
+// Recordings of the messages a client receives, to replay a capture over the
+// network without the target (see OrbitCaptureReplay). Compressed blocks are
+// recorded as the messages they hold, a recording doesn't depend on whether
+// the connection was compressed.
+//
+// A recording is a header followed by records: the time in nanoseconds since
+// the first record, the Message header and the payload. Recordings use the
+// byte order and Message layout of the machine, they aren't portable.
+
+struct RecordedMessage {
+  uint64_t time_ns = 0;
+  // m_Data points into "payload".
+  Message message;
+  std::vector<char> payload;
+};
+
+class MessageRecorder {
+ public:
+  MessageRecorder() = default;
+  MessageRecorder(const MessageRecorder&) = delete;
+  MessageRecorder& operator=(const MessageRecorder&) = delete;
+  ~MessageRecorder() { Close(); }
+
+  // Truncates "path". Returns false if it can't be written.
+  bool Open(const std::string& path);
+  bool IsOpen() const { return file_.is_open(); }
+  // Not thread safe, a client records from its receiving thread.
+  void Record(const Message& message);
+  void Close();
+
+  uint64_t GetNumMessages() const { return num_messages_; }
+  uint64_t GetNumBytes() const { return num_bytes_; }
+
+ private:
+  std::ofstream file_;
+  std::chrono::steady_clock::time_point start_;
+  uint64_t num_messages_ = 0;
+  uint64_t num_bytes_ = 0;
+};
+
+class MessageRecordingReader {
+ public:
+  // Returns false if "path" can't be read or isn't a recording.
+  bool Open(const std::string& path);
+  // Reads the next record into "message", reusing its payload buffer.
+  // Returns false at the end of the recording or if it is malformed, which
+  // HasError() tells apart.
+  bool Read(RecordedMessage* message);
+  bool HasError() const { return has_error_; }
+
+  // Payloads larger than this are taken for corrupted data.
+  static constexpr uint32_t kMaxPayloadSize = 1024 * 1024 * 1024;
+
+ private:
+  std::ifstream file_;
+  bool has_error_ = false;
+};
+
+#endif  // ORBIT_CORE_MESSAGE_RECORDING_H_
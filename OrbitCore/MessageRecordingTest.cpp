@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "MessageRecording.h"
+
+namespace {
+
+std::string GetRecordingPath(const std::string& name) {
+  return ::testing::TempDir() + "MessageRecordingTest_" + name + ".orbitrec";
+}
+
+Message CreateMessage(MessageType type, std::vector<char>* payload) {
+  Message message(type, static_cast<uint32_t>(payload->size()),
+                  payload->empty() ? nullptr : payload->data());
+  message.m_Header.m_GenericHeader.m_Address = payload->size() * 3;
+  message.m_ThreadId = 42;
+  return message;
+}
+
+std::vector<std::vector<char>> CreatePayloads() {
+  std::vector<std::vector<char>> payloads;
+  for (size_t size : {0, 1, 100, 70000}) {
+    std::vector<char> payload(size);
+    for (size_t i = 0; i < size; ++i) payload[i] = static_cast<char>(i * 7);
+    payloads.push_back(payload);
+  }
+  return payloads;
+}
+
+void Truncate(const std::string& path, size_t size) {
+  std::string data;
+  {
+    std::ifstream file(path, std::ios::binary);
+    data.assign(std::istreambuf_iterator<char>(file),
+                std::istreambuf_iterator<char>());
+  }
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(data.data(), std::min(size, data.size()));
+}
+
+}  // namespace
+
+TEST(MessageRecording, RoundTrip) {
+  std::string path = GetRecordingPath("RoundTrip");
+  std::vector<std::vector<char>> payloads = CreatePayloads();
+  const MessageType kTypes[] = {Msg_RemoteTimers, Msg_StartCapture,
+                                Msg_RemoteContextSwitches, Msg_RemoteSymbol};
+  {
+    MessageRecorder recorder;
+    ASSERT_TRUE(recorder.Open(path));
+    for (size_t i = 0; i < payloads.size(); ++i) {
+      recorder.Record(CreateMessage(kTypes[i], &payloads[i]));
+    }
+    EXPECT_EQ(recorder.GetNumMessages(), payloads.size());
+  }
+
+  MessageRecordingReader reader;
+  ASSERT_TRUE(reader.Open(path));
+  RecordedMessage recorded;
+  uint64_t last_time_ns = 0;
+  for (size_t i = 0; i < payloads.size(); ++i) {
+    ASSERT_TRUE(reader.Read(&recorded));
+    const Message& message = recorded.message;
+    EXPECT_EQ(message.GetType(), kTypes[i]);
+    EXPECT_EQ(message.m_Header.m_GenericHeader.m_Address,
+              payloads[i].size() * 3);
+    EXPECT_EQ(message.m_ThreadId, 42);
+    ASSERT_EQ(message.m_Size, payloads[i].size());
+    EXPECT_EQ(std::vector<char>(message.GetData(),
+                                message.GetData() + message.m_Size),
+              payloads[i]);
+    EXPECT_GE(recorded.time_ns, last_time_ns);
+    last_time_ns = recorded.time_ns;
+  }
+  EXPECT_FALSE(reader.Read(&recorded));
+  EXPECT_FALSE(reader.HasError());
+  std::remove(path.c_str());
+}
+
+TEST(MessageRecording, MalformedRecordingIsRejected) {
+  std::string path = GetRecordingPath("Malformed");
+  std::vector<char> payload(100, 'x');
+  uint64_t file_size = 0;
+  {
+    MessageRecorder recorder;
+    ASSERT_TRUE(recorder.Open(path));
+    recorder.Record(CreateMessage(Msg_RemoteTimers, &payload));
+    file_size = recorder.GetNumBytes();
+  }
+
+  // A record cut anywhere is an error, a header cut anywhere fails to open.
+  size_t header_size = file_size - 8 - sizeof(Message) - payload.size();
+  for (size_t size = file_size - 1; size > 0; --size) {
+    Truncate(path, size);
+    MessageRecordingReader reader;
+    if (size < header_size) {
+      EXPECT_FALSE(reader.Open(path));
+      continue;
+    }
+    ASSERT_TRUE(reader.Open(path));
+    RecordedMessage recorded;
+    EXPECT_FALSE(reader.Read(&recorded));
+    EXPECT_EQ(reader.HasError(), size != header_size);
+  }
+
+  std::ofstream(path, std::ios::binary | std::ios::trunc) << "not a recording";
+  MessageRecordingReader reader;
+  EXPECT_FALSE(reader.Open(path));
+  EXPECT_FALSE(reader.Open(GetRecordingPath("Missing")));
+  std::remove(path.c_str());
+}
@@ -50,6 +50,7 @@ struct Module {
   bool m_Loaded = false;
 
   friend class TestRemoteMessages;
+  friend class ProcessEncoding;
 };
 
 //-----------------------------------------------------------------------------
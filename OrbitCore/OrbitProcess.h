@@ -169,4 +169,6 @@ class Process {
   std::unordered_set<uint64_t> m_UniqueTypeHash;
 
   friend class TestRemoteMessages;
+  friend class ProcessEncoding;
+  friend class ProcessEncodingTest;
 };
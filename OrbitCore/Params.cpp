@@ -11,6 +11,7 @@
 #include "CoreApp.h"
 #include "ScopeTimer.h"
 #include "Serialization.h"
+#include "TcpEntity.h"
 #include "absl/strings/str_format.h"
 
 Params GParams;
@@ -30,13 +31,17 @@ Params::Params()
       m_AutoReleasePdb(false),
       m_BpftraceCallstacks(false),
       m_SystemWideScheduling(true),
+      m_CompressCaptureTraffic(false),
+      m_SendQueuePolicy(TcpEntity::DropOldestSamples),
+      m_MaxSendQueueBytes(TcpEntity::kDefaultMaxQueuedBytes),
       m_MaxNumTimers(1000000),
       m_FontSize(14.f),
+      m_SamplingWindowSeconds(0.f),
       m_Port(44766),
       m_NumBytesAssembly(1024),
       m_DiffArgs("%1 %2") {}
 
-ORBIT_SERIALIZE(Params, 16) {
+ORBIT_SERIALIZE(Params, 19) {
   ORBIT_NVP_VAL(0, m_LoadTypeInfo);
   ORBIT_NVP_VAL(0, m_SendCallStacks);
   ORBIT_NVP_VAL(0, m_MaxNumTimers);
@@ -61,6 +66,10 @@ ORBIT_SERIALIZE(Params, 16) {
   ORBIT_NVP_VAL(13, m_ProcessFilter);
   ORBIT_NVP_VAL(14, m_BpftraceCallstacks);
   ORBIT_NVP_VAL(15, m_SystemWideScheduling);
+  ORBIT_NVP_VAL(17, m_SamplingWindowSeconds);
+  ORBIT_NVP_VAL(18, m_CompressCaptureTraffic);
+  ORBIT_NVP_VAL(19, m_SendQueuePolicy);
+  ORBIT_NVP_VAL(19, m_MaxSendQueueBytes);
 }
 
 //-----------------------------------------------------------------------------
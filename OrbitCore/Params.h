@@ -32,8 +32,13 @@ struct Params {
   bool m_BpftraceCallstacks;
   bool m_SystemWideScheduling;
   bool m_UseBpftrace;
+  bool m_CompressCaptureTraffic;
+  // TcpEntity::SendQueuePolicy of the service, and its send queue bound.
+  int m_SendQueuePolicy;
+  uint64_t m_MaxSendQueueBytes;
   int m_MaxNumTimers;
   float m_FontSize;
+  float m_SamplingWindowSeconds;
   int m_Port;
   uint64_t m_NumBytesAssembly;
   std::string m_DiffExe;
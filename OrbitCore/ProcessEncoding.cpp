@@ -0,0 +1,361 @@
+#include "ProcessEncoding.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "ByteCoding.h"
+#include "OrbitModule.h"
+#include "absl/container/flat_hash_map.h"
+
+namespace {
+// Written first, to detect mismatching service and client versions.
+constexpr uint8_t kFormatVersion = 1;
+
+enum ModuleFlags : uint8_t {
+  kFoundPdb = 1 << 0,
+  kSelected = 1 << 1,
+  kLoaded = 1 << 2,
+};
+enum ProcessFlags : uint8_t {
+  kIsElevated = 1 << 0,
+  kIs64Bit = 1 << 1,
+  kDebugInfoLoaded = 1 << 2,
+  kIsRemote = 1 << 3,
+};
+
+// Writes a string as its index in the strings written so far, followed by
+// the string itself the first time.
+class StringWriter {
+ public:
+  explicit StringWriter(ByteWriter* writer) : writer_(writer) {}
+
+  void Put(const std::string& value) {
+    auto result = indices_.emplace(value, indices_.size());
+    writer_->PutVarint(result.first->second);
+    if (result.second) writer_->PutString(value);
+  }
+
+ private:
+  ByteWriter* writer_;
+  // Views of the strings of the encoded objects, which outlive the writer.
+  absl::flat_hash_map<std::string_view, uint64_t> indices_;
+};
+
+class StringReader {
+ public:
+  explicit StringReader(ByteReader* reader) : reader_(reader) {}
+
+  // Returns false if the data is malformed.
+  bool Get(std::string* value) {
+    uint64_t index = reader_->GetVarint();
+    if (index == strings_.size()) {
+      reader_->GetString(value);
+      strings_.push_back(*value);
+    } else if (index < strings_.size()) {
+      *value = strings_[index];
+    } else {
+      return false;
+    }
+    return reader_->ok();
+  }
+
+ private:
+  ByteReader* reader_;
+  std::vector<std::string> strings_;
+};
+
+// Objects that containers refer to, each written once. A reference is the
+// index of the object plus one, 0 stands for nullptr.
+template <class T>
+class ObjectTable {
+ public:
+  void Add(const std::shared_ptr<T>& object) {
+    if (object && indices_.emplace(object.get(), objects_.size()).second) {
+      objects_.push_back(object.get());
+    }
+  }
+  const std::vector<const T*>& GetObjects() const { return objects_; }
+  uint64_t GetReference(const std::shared_ptr<T>& object) const {
+    return object ? indices_.at(object.get()) + 1 : 0;
+  }
+
+ private:
+  std::vector<const T*> objects_;
+  absl::flat_hash_map<const T*, uint64_t> indices_;
+};
+
+// Returns false if "reference" isn't one of "objects".
+template <class T>
+bool GetObject(uint64_t reference,
+               const std::vector<std::shared_ptr<T>>& objects,
+               std::shared_ptr<T>* object) {
+  if (reference > objects.size()) return false;
+  *object = reference == 0 ? nullptr : objects[reference - 1];
+  return true;
+}
+
+// Reads a number of items taking at least a byte each, which bounds the
+// count of malformed data.
+bool GetCount(ByteReader* reader, uint64_t* count) {
+  *count = reader->GetVarint();
+  return reader->ok() && *count <= reader->GetRemainingSize();
+}
+
+uint64_t DoubleToBits(double value) {
+  uint64_t bits = 0;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+double BitsToDouble(uint64_t bits) {
+  double value = 0;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+}  // namespace
+
+// Friend of Process and Module, reads and writes their private fields.
+class ProcessEncoding {
+ public:
+  static void PutProcess(const Process& process, StringWriter* strings,
+                         ByteWriter* writer);
+  static bool GetProcess(ByteReader* reader, StringReader* strings,
+                         Process* process);
+
+ private:
+  static void PutModule(const Module& module, uint64_t* address,
+                        StringWriter* strings, ByteWriter* writer);
+  static bool GetModule(ByteReader* reader, uint64_t* address,
+                        StringReader* strings, Module* module);
+};
+
+void ProcessEncoding::PutModule(const Module& module, uint64_t* address,
+                                StringWriter* strings, ByteWriter* writer) {
+  strings->Put(module.m_Name);
+  strings->Put(module.m_FullName);
+  strings->Put(module.m_PdbName);
+  strings->Put(module.m_Directory);
+  strings->Put(module.m_PrettyName);
+  strings->Put(module.m_AddressRange);
+  strings->Put(module.m_DebugSignature);
+  // Modules are sorted by address, start addresses are close.
+  writer->PutZigZag(static_cast<int64_t>(module.m_AddressStart - *address));
+  *address = module.m_AddressStart;
+  writer->PutZigZag(
+      static_cast<int64_t>(module.m_AddressEnd - module.m_AddressStart));
+  writer->PutZigZag(
+      static_cast<int64_t>(module.m_EntryPoint - module.m_AddressStart));
+  writer->PutByte((module.m_FoundPdb ? kFoundPdb : 0) |
+                  (module.m_Selected ? kSelected : 0) |
+                  (module.m_Loaded ? kLoaded : 0));
+  writer->PutVarint(module.m_PdbSize);
+}
+
+bool ProcessEncoding::GetModule(ByteReader* reader, uint64_t* address,
+                                StringReader* strings, Module* module) {
+  if (!strings->Get(&module->m_Name) || !strings->Get(&module->m_FullName) ||
+      !strings->Get(&module->m_PdbName) ||
+      !strings->Get(&module->m_Directory) ||
+      !strings->Get(&module->m_PrettyName) ||
+      !strings->Get(&module->m_AddressRange) ||
+      !strings->Get(&module->m_DebugSignature)) {
+    return false;
+  }
+  *address += static_cast<uint64_t>(reader->GetZigZag());
+  module->m_AddressStart = *address;
+  module->m_AddressEnd = *address + static_cast<uint64_t>(reader->GetZigZag());
+  module->m_EntryPoint = *address + static_cast<uint64_t>(reader->GetZigZag());
+  uint8_t flags = reader->GetByte();
+  module->m_FoundPdb = (flags & kFoundPdb) != 0;
+  module->m_Selected = (flags & kSelected) != 0;
+  module->m_Loaded = (flags & kLoaded) != 0;
+  module->m_PdbSize = reader->GetVarint();
+  return reader->ok();
+}
+
+void ProcessEncoding::PutProcess(const Process& process, StringWriter* strings,
+                                 ByteWriter* writer) {
+  strings->Put(process.m_Name);
+  strings->Put(process.m_FullName);
+  writer->PutVarint(process.m_ID);
+  writer->PutByte((process.m_IsElevated ? kIsElevated : 0) |
+                  (process.m_Is64Bit ? kIs64Bit : 0) |
+                  (process.m_DebugInfoLoaded ? kDebugInfoLoaded : 0) |
+                  (process.m_IsRemote ? kIsRemote : 0));
+  writer->PutFixed64(DoubleToBits(process.m_CpuUsage));
+
+  std::vector<uint32_t> thread_ids(process.m_ThreadIds.begin(),
+                                   process.m_ThreadIds.end());
+  std::sort(thread_ids.begin(), thread_ids.end());
+  writer->PutVarint(thread_ids.size());
+  uint32_t thread_id = 0;
+  for (uint32_t id : thread_ids) {
+    writer->PutVarint(id - thread_id);
+    thread_id = id;
+  }
+
+  // The name map refers to the same modules as the address map.
+  ObjectTable<Module> modules;
+  for (const auto& pair : process.m_Modules) modules.Add(pair.second);
+  for (const auto& pair : process.m_NameToModuleMap) modules.Add(pair.second);
+  writer->PutVarint(modules.GetObjects().size());
+  uint64_t address = 0;
+  for (const Module* module : modules.GetObjects()) {
+    PutModule(*module, &address, strings, writer);
+  }
+
+  writer->PutVarint(process.m_Modules.size());
+  uint64_t key = 0;
+  for (const auto& pair : process.m_Modules) {
+    writer->PutVarint(pair.first - key);
+    key = pair.first;
+    writer->PutVarint(modules.GetReference(pair.second));
+  }
+  writer->PutVarint(process.m_NameToModuleMap.size());
+  for (const auto& pair : process.m_NameToModuleMap) {
+    strings->Put(pair.first);
+    writer->PutVarint(modules.GetReference(pair.second));
+  }
+}
+
+bool ProcessEncoding::GetProcess(ByteReader* reader, StringReader* strings,
+                                 Process* process) {
+  if (!strings->Get(&process->m_Name) ||
+      !strings->Get(&process->m_FullName)) {
+    return false;
+  }
+  process->m_ID = static_cast<DWORD>(reader->GetVarint());
+  uint8_t flags = reader->GetByte();
+  process->m_IsElevated = (flags & kIsElevated) != 0;
+  process->m_Is64Bit = (flags & kIs64Bit) != 0;
+  process->m_DebugInfoLoaded = (flags & kDebugInfoLoaded) != 0;
+  process->m_IsRemote = (flags & kIsRemote) != 0;
+  process->m_CpuUsage = BitsToDouble(reader->GetFixed64());
+
+  uint64_t num_threads = 0;
+  if (!GetCount(reader, &num_threads)) return false;
+  uint32_t thread_id = 0;
+  for (uint64_t i = 0; i < num_threads; ++i) {
+    thread_id += static_cast<uint32_t>(reader->GetVarint());
+    process->m_ThreadIds.insert(thread_id);
+  }
+
+  uint64_t num_modules = 0;
+  if (!GetCount(reader, &num_modules)) return false;
+  std::vector<std::shared_ptr<Module>> modules;
+  modules.reserve(num_modules);
+  uint64_t address = 0;
+  for (uint64_t i = 0; i < num_modules; ++i) {
+    modules.push_back(std::make_shared<Module>());
+    if (!GetModule(reader, &address, strings, modules.back().get())) {
+      return false;
+    }
+  }
+
+  uint64_t num_entries = 0;
+  if (!GetCount(reader, &num_entries)) return false;
+  uint64_t key = 0;
+  for (uint64_t i = 0; i < num_entries; ++i) {
+    key += reader->GetVarint();
+    std::shared_ptr<Module> module;
+    if (!GetObject(reader->GetVarint(), modules, &module)) return false;
+    process->m_Modules[key] = module;
+  }
+  if (!GetCount(reader, &num_entries)) return false;
+  std::string name;
+  for (uint64_t i = 0; i < num_entries; ++i) {
+    if (!strings->Get(&name)) return false;
+    std::shared_ptr<Module> module;
+    if (!GetObject(reader->GetVarint(), modules, &module)) return false;
+    process->m_NameToModuleMap[name] = module;
+  }
+  return reader->ok();
+}
+
+void EncodeProcess(const Process& process, std::string* buffer) {
+  buffer->clear();
+  ByteWriter writer(buffer);
+  StringWriter strings(&writer);
+  writer.PutByte(kFormatVersion);
+  ProcessEncoding::PutProcess(process, &strings, &writer);
+}
+
+bool DecodeProcess(const char* data, size_t size, Process* process) {
+  ByteReader reader(data, size);
+  StringReader strings(&reader);
+  if (reader.GetByte() != kFormatVersion) return false;
+  return ProcessEncoding::GetProcess(&reader, &strings, process) &&
+         reader.GetRemainingSize() == 0;
+}
+
+void EncodeProcessList(const ProcessList& process_list, std::string* buffer) {
+  buffer->clear();
+  ByteWriter writer(buffer);
+  StringWriter strings(&writer);
+
+  ObjectTable<Process> processes;
+  for (const auto& process : process_list.m_Processes) processes.Add(process);
+  for (const auto& pair : process_list.m_ProcessesMap) {
+    processes.Add(pair.second);
+  }
+  writer.PutByte(kFormatVersion);
+  writer.PutVarint(processes.GetObjects().size());
+  for (const Process* process : processes.GetObjects()) {
+    ProcessEncoding::PutProcess(*process, &strings, &writer);
+  }
+
+  writer.PutVarint(process_list.m_Processes.size());
+  for (const auto& process : process_list.m_Processes) {
+    writer.PutVarint(processes.GetReference(process));
+  }
+  std::vector<std::pair<uint32_t, uint64_t>> entries;
+  for (const auto& pair : process_list.m_ProcessesMap) {
+    entries.emplace_back(pair.first, processes.GetReference(pair.second));
+  }
+  std::sort(entries.begin(), entries.end());
+  writer.PutVarint(entries.size());
+  uint32_t pid = 0;
+  for (const auto& entry : entries) {
+    writer.PutVarint(entry.first - pid);
+    pid = entry.first;
+    writer.PutVarint(entry.second);
+  }
+}
+
+bool DecodeProcessList(const char* data, size_t size,
+                       ProcessList* process_list) {
+  ByteReader reader(data, size);
+  StringReader strings(&reader);
+  uint64_t num_processes = 0;
+  if (!reader.GetHeader(kFormatVersion, &num_processes)) return false;
+  std::vector<std::shared_ptr<Process>> processes;
+  processes.reserve(num_processes);
+  for (uint64_t i = 0; i < num_processes; ++i) {
+    processes.push_back(std::make_shared<Process>());
+    if (!ProcessEncoding::GetProcess(&reader, &strings,
+                                     processes.back().get())) {
+      return false;
+    }
+  }
+
+  uint64_t num_entries = 0;
+  if (!GetCount(&reader, &num_entries)) return false;
+  for (uint64_t i = 0; i < num_entries; ++i) {
+    std::shared_ptr<Process> process;
+    if (!GetObject(reader.GetVarint(), processes, &process)) return false;
+    process_list->m_Processes.push_back(process);
+  }
+  if (!GetCount(&reader, &num_entries)) return false;
+  uint32_t pid = 0;
+  for (uint64_t i = 0; i < num_entries; ++i) {
+    pid += static_cast<uint32_t>(reader.GetVarint());
+    std::shared_ptr<Process> process;
+    if (!GetObject(reader.GetVarint(), processes, &process)) return false;
+    process_list->m_ProcessesMap[pid] = process;
+  }
+  return reader.ok() && reader.GetRemainingSize() == 0;
+}
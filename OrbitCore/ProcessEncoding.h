@@ -0,0 +1,28 @@
+#ifndef ORBIT_CORE_PROCESS_ENCODING_H_
+#define ORBIT_CORE_PROCESS_ENCODING_H_
+
+#include <cstddef>
+#include <string>
+
+#include "OrbitProcess.h"
+#include "ProcessUtils.h"
+
+// Compact encoding of processes with their modules and threads, used for the
+// Msg_RemoteProcess and Msg_RemoteProcessList messages.
+//
+// Strings are interned: a string is written the first time it appears and
+// then referred to by its index, as module names, directories and process
+// names repeat a lot across processes. Sorted integers are delta encoded.
+// See ByteCoding.h for the integer encodings.
+//
+// Decoding fills a default constructed object and returns false if the data
+// is malformed, the object is then partially decoded.
+
+void EncodeProcess(const Process& process, std::string* buffer);
+bool DecodeProcess(const char* data, size_t size, Process* process);
+
+void EncodeProcessList(const ProcessList& process_list, std::string* buffer);
+bool DecodeProcessList(const char* data, size_t size,
+                       ProcessList* process_list);
+
+#endif  // ORBIT_CORE_PROCESS_ENCODING_H_
@@ -0,0 +1,63 @@
+// Timing runs of the process encoding against JSON. Correctness is checked
+// by ProcessEncodingTest.cpp.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "OrbitProcess.h"
+#include "ProcessEncoding.h"
+#include "ProcessEncodingTestFixture.h"
+#include "ProcessUtils.h"
+#include "Serialization.h"
+
+namespace {
+double GetMilliseconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+}  // namespace
+
+TEST_F(ProcessEncodingTest, BenchmarkAgainstJson) {
+  ProcessList process_list = CreateProcessList(5000);
+
+  auto start = std::chrono::steady_clock::now();
+  std::string buffer;
+  EncodeProcessList(process_list, &buffer);
+  double encode_ms = GetMilliseconds(start);
+
+  start = std::chrono::steady_clock::now();
+  ProcessList decoded;
+  ASSERT_TRUE(DecodeProcessList(buffer.data(), buffer.size(), &decoded));
+  double decode_ms = GetMilliseconds(start);
+  ExpectEqual(process_list, decoded);
+
+  // The previous path, as in ConnectionManager::SendProcesses and
+  // OrbitApp::OnRemoteProcessList.
+  start = std::chrono::steady_clock::now();
+  std::string json = SerializeObjectHumanReadable(process_list);
+  double json_encode_ms = GetMilliseconds(start);
+
+  start = std::chrono::steady_clock::now();
+  {
+    std::istringstream stream(json);
+    cereal::JSONInputArchive archive(stream);
+    ProcessList json_decoded;
+    archive(json_decoded);
+    EXPECT_EQ(json_decoded.m_Processes.size(), process_list.m_Processes.size());
+  }
+  double json_decode_ms = GetMilliseconds(start);
+
+  EXPECT_LT(buffer.size(), json.size() / 4);
+  std::cout << process_list.m_Processes.size()
+            << " processes: " << buffer.size() << " bytes, JSON "
+            << json.size() << " bytes" << std::endl
+            << "Encode: " << encode_ms << " ms, JSON " << json_encode_ms
+            << " ms" << std::endl
+            << "Decode: " << decode_ms << " ms, JSON " << json_decode_ms
+            << " ms" << std::endl;
+}
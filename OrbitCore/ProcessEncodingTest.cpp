@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "OrbitModule.h"
+#include "OrbitProcess.h"
+#include "ProcessEncoding.h"
+#include "ProcessEncodingTestFixture.h"
+#include "ProcessUtils.h"
+#include "Serialization.h"
+
+TEST_F(ProcessEncodingTest, ProcessWithModulesRoundTrip) {
+  std::mt19937_64 random(42);
+  std::shared_ptr<Process> process = CreateProcess(1234, &random);
+  AddModules(process.get(), 300);
+  process->SetIsRemote(true);
+
+  std::string buffer;
+  EncodeProcess(*process, &buffer);
+  Process decoded;
+  ASSERT_TRUE(DecodeProcess(buffer.data(), buffer.size(), &decoded));
+  ExpectEqual(*process, decoded);
+
+  std::string json = SerializeObjectHumanReadable(*process);
+  EXPECT_LT(buffer.size(), json.size() / 4);
+}
+
+TEST_F(ProcessEncodingTest, MalformedDataIsRejected) {
+  ProcessList process_list = CreateProcessList(10);
+  AddModules(process_list.m_Processes[0].get(), 10);
+  std::string buffer;
+  EncodeProcessList(process_list, &buffer);
+
+  for (size_t size = 0; size < buffer.size(); ++size) {
+    ProcessList decoded;
+    EXPECT_FALSE(DecodeProcessList(buffer.data(), size, &decoded));
+  }
+  // Trailing data, then a reference to a process that doesn't exist.
+  ProcessList decoded;
+  std::string trailing = buffer + '\0';
+  EXPECT_FALSE(DecodeProcessList(trailing.data(), trailing.size(), &decoded));
+  std::string bad_reference = {1, 0, 1, 1, 0};
+  EXPECT_FALSE(DecodeProcessList(bad_reference.data(), bad_reference.size(),
+                                 &decoded));
+
+  EncodeProcess(*process_list.m_Processes[0], &buffer);
+  for (size_t size = 0; size < buffer.size(); ++size) {
+    Process process;
+    EXPECT_FALSE(DecodeProcess(buffer.data(), size, &process));
+  }
+}
+
+TEST_F(ProcessEncodingTest, ProcessListSmallerThanJson) {
+  ProcessList process_list = CreateProcessList(500);
+  std::string buffer;
+  EncodeProcessList(process_list, &buffer);
+  ProcessList decoded;
+  ASSERT_TRUE(DecodeProcessList(buffer.data(), buffer.size(), &decoded));
+  ExpectEqual(process_list, decoded);
+
+  std::string json = SerializeObjectHumanReadable(process_list);
+  EXPECT_LT(buffer.size(), json.size() / 4);
+}
@@ -0,0 +1,130 @@
+#ifndef ORBIT_CORE_PROCESS_ENCODING_TEST_FIXTURE_H_
+#define ORBIT_CORE_PROCESS_ENCODING_TEST_FIXTURE_H_
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+
+#include "OrbitModule.h"
+#include "OrbitProcess.h"
+#include "ProcessUtils.h"
+
+// Friend of Process, to create processes without looking them up on the
+// host and to compare their private fields. Shared by the process encoding
+// tests and benchmarks.
+class ProcessEncodingTest : public ::testing::Test {
+ protected:
+  static std::shared_ptr<Process> CreateProcess(uint32_t pid,
+                                                std::mt19937_64* random) {
+    static const char* kNames[] = {"bash", "sshd", "python3", "chrome",
+                                   "systemd", "java"};
+    auto process = std::make_shared<Process>();
+    process->m_ID = pid;
+    process->m_Name = kNames[(*random)() % 6];
+    process->m_FullName = "/usr/bin/" + process->m_Name;
+    process->m_Is64Bit = (*random)() % 8 != 0;
+    process->m_IsElevated = (*random)() % 4 == 0;
+    process->m_CpuUsage = static_cast<double>((*random)() % 10000) / 100;
+    uint32_t num_threads = 1 + (*random)() % 16;
+    for (uint32_t i = 0; i < num_threads; ++i) {
+      process->AddThreadId(pid + i);
+    }
+    return process;
+  }
+
+  // Shared libraries mapped as in a Linux process.
+  static void AddModules(Process* process, size_t count) {
+    uint64_t address = 0x7f0000000000;
+    for (size_t i = 0; i < count; ++i) {
+      auto module = std::make_shared<Module>();
+      module->m_Name = "lib" + std::to_string(i) + ".so";
+      module->m_Directory = "/usr/lib/x86_64-linux-gnu/";
+      module->m_FullName = module->m_Directory + module->m_Name;
+      module->m_DebugSignature = std::to_string(i * 7919);
+      module->m_AddressStart = address;
+      module->m_AddressEnd = address + 0x1000 * (1 + i % 64);
+      module->m_EntryPoint = address + 0x40;
+      module->m_PdbSize = i * 1000;
+      module->m_FoundPdb = i % 3 == 0;
+      module->SetLoaded(i % 2 == 0);
+      address = module->m_AddressEnd + 0x1000;
+      process->AddModule(module);
+      process->GetNameToModulesMap()[module->m_Name] = module;
+    }
+  }
+
+  // Processes as listed on a busy host: many instances of a few programs.
+  static ProcessList CreateProcessList(size_t count) {
+    std::mt19937_64 random(42);
+    ProcessList process_list;
+    uint32_t pid = 1;
+    for (size_t i = 0; i < count; ++i) {
+      pid += 1 + random() % 100;
+      std::shared_ptr<Process> process = CreateProcess(pid, &random);
+      process_list.m_Processes.push_back(process);
+      process_list.m_ProcessesMap[pid] = process;
+    }
+    return process_list;
+  }
+
+  // Modules aren't const, GetLoaded() isn't.
+  static void ExpectEqual(Module& lhs, Module& rhs) {
+    EXPECT_EQ(lhs.m_Name, rhs.m_Name);
+    EXPECT_EQ(lhs.m_FullName, rhs.m_FullName);
+    EXPECT_EQ(lhs.m_PdbName, rhs.m_PdbName);
+    EXPECT_EQ(lhs.m_Directory, rhs.m_Directory);
+    EXPECT_EQ(lhs.m_PrettyName, rhs.m_PrettyName);
+    EXPECT_EQ(lhs.m_AddressRange, rhs.m_AddressRange);
+    EXPECT_EQ(lhs.m_DebugSignature, rhs.m_DebugSignature);
+    EXPECT_EQ(lhs.m_AddressStart, rhs.m_AddressStart);
+    EXPECT_EQ(lhs.m_AddressEnd, rhs.m_AddressEnd);
+    EXPECT_EQ(lhs.m_EntryPoint, rhs.m_EntryPoint);
+    EXPECT_EQ(lhs.m_FoundPdb, rhs.m_FoundPdb);
+    EXPECT_EQ(lhs.m_Selected, rhs.m_Selected);
+    EXPECT_EQ(lhs.GetLoaded(), rhs.GetLoaded());
+    EXPECT_EQ(lhs.m_PdbSize, rhs.m_PdbSize);
+  }
+
+  static void ExpectEqual(const Process& lhs, const Process& rhs) {
+    EXPECT_EQ(lhs.m_Name, rhs.m_Name);
+    EXPECT_EQ(lhs.m_FullName, rhs.m_FullName);
+    EXPECT_EQ(lhs.m_ID, rhs.m_ID);
+    EXPECT_EQ(lhs.m_IsElevated, rhs.m_IsElevated);
+    EXPECT_EQ(lhs.m_Is64Bit, rhs.m_Is64Bit);
+    EXPECT_EQ(lhs.m_DebugInfoLoaded, rhs.m_DebugInfoLoaded);
+    EXPECT_EQ(lhs.m_IsRemote, rhs.m_IsRemote);
+    EXPECT_EQ(lhs.m_CpuUsage, rhs.m_CpuUsage);
+    EXPECT_EQ(lhs.m_ThreadIds, rhs.m_ThreadIds);
+
+    ASSERT_EQ(lhs.m_Modules.size(), rhs.m_Modules.size());
+    for (auto it = lhs.m_Modules.begin(), other = rhs.m_Modules.begin();
+         it != lhs.m_Modules.end(); ++it, ++other) {
+      EXPECT_EQ(it->first, other->first);
+      ExpectEqual(*it->second, *other->second);
+    }
+    ASSERT_EQ(lhs.m_NameToModuleMap.size(), rhs.m_NameToModuleMap.size());
+    for (const auto& pair : rhs.m_NameToModuleMap) {
+      EXPECT_EQ(lhs.m_NameToModuleMap.count(pair.first), 1);
+      // Both maps share the modules.
+      EXPECT_EQ(pair.second, rhs.m_Modules.at(pair.second->m_AddressStart));
+    }
+  }
+
+  static void ExpectEqual(const ProcessList& lhs, const ProcessList& rhs) {
+    ASSERT_EQ(lhs.m_Processes.size(), rhs.m_Processes.size());
+    for (size_t i = 0; i < lhs.m_Processes.size(); ++i) {
+      ExpectEqual(*lhs.m_Processes[i], *rhs.m_Processes[i]);
+    }
+    ASSERT_EQ(lhs.m_ProcessesMap.size(), rhs.m_ProcessesMap.size());
+    for (const auto& pair : rhs.m_ProcessesMap) {
+      ASSERT_NE(pair.second, nullptr);
+      EXPECT_EQ(pair.first, pair.second->GetID());
+    }
+  }
+
+};
+
+#endif  // ORBIT_CORE_PROCESS_ENCODING_TEST_FIXTURE_H_
@@ -0,0 +1,302 @@
+#include "ProfileDiff.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "SamplingProfiler.h"
+#include "Utils.h"
+#include "absl/container/flat_hash_map.h"
+
+ProfileDiff::Profile::Profile(const CallTree& tree,
+                              const FunctionIdFunc& function_id)
+    : tree(tree) {
+  // Computing an id can require a symbol lookup, do it once per address.
+  absl::flat_hash_map<uint64_t, uint64_t> address_to_id;
+  node_ids.resize(tree.GetNumNodes());
+  for (uint32_t i = 0; i < tree.GetNumNodes(); ++i) {
+    uint64_t address = tree.GetNode(i).function_address;
+    if (!function_id) {
+      node_ids[i] = address;
+      continue;
+    }
+    auto it = address_to_id.find(address);
+    if (it == address_to_id.end()) {
+      it = address_to_id.emplace(address, function_id(address)).first;
+    }
+    node_ids[i] = it->second;
+  }
+}
+
+ProfileDiff::ProfileDiff(const CallTree& base, const CallTree& current,
+                         const FunctionIdFunc& base_function_id,
+                         const FunctionIdFunc& current_function_id) {
+  Compute(base, base_function_id, current, current_function_id);
+}
+
+ProfileDiff::ProfileDiff(SamplingProfiler* base, SamplingProfiler* current,
+                         ThreadID tid) {
+  // Copies, the trees of a profile still sampling grow under its lock.
+  auto get_tree = [tid](SamplingProfiler* profiler) {
+    std::shared_ptr<CallTree> tree =
+        profiler ? profiler->CopyCallTree(tid, CallTree::Direction::kTopDown)
+                 : nullptr;
+    return tree ? tree : std::make_shared<CallTree>();
+  };
+  auto symbol_hash = [](SamplingProfiler* profiler) {
+    return [profiler](uint64_t address) -> uint64_t {
+      std::wstring symbol = profiler->GetSymbolFromAddress(address);
+      // Unresolved symbols can't be matched by name.
+      if (symbol.empty() || symbol == L"???") return address;
+      return StringHash(symbol);
+    };
+  };
+
+  Compute(*get_tree(base), symbol_hash(base), *get_tree(current),
+          symbol_hash(current));
+}
+
+void ProfileDiff::Compute(const CallTree& base,
+                          const FunctionIdFunc& base_function_id,
+                          const CallTree& current,
+                          const FunctionIdFunc& current_function_id) {
+  Profile base_profile(base, base_function_id);
+  Profile current_profile(current, current_function_id);
+  base_total_ = base.GetTotalCount();
+  current_total_ = current.GetTotalCount();
+
+  DiffFunctions(GetSortedFunctionCounts(base_profile),
+                GetSortedFunctionCounts(current_profile));
+  DiffNodes(base_profile, current_profile);
+}
+
+std::vector<ProfileDiff::FunctionCount> ProfileDiff::GetSortedFunctionCounts(
+    const Profile& profile) {
+  const CallTree& tree = profile.tree;
+  absl::flat_hash_map<uint64_t, FunctionCount> counts;
+  // Number of times each function id is on the path from the root to the
+  // current node. The inclusive count of a recursive function is only added
+  // for its outermost node, or samples would be counted more than once.
+  absl::flat_hash_map<uint64_t, uint32_t> num_on_path;
+
+  // Depth-first traversal, each node is pushed a second time to be popped
+  // once its whole subtree has been visited.
+  std::vector<std::pair<uint32_t, bool>> stack;
+  for (uint32_t child = tree.GetNode(CallTree::kRootIndex).first_child;
+       child != CallTree::kInvalidIndex;
+       child = tree.GetNode(child).next_sibling) {
+    stack.emplace_back(child, false);
+  }
+
+  while (!stack.empty()) {
+    uint32_t node_index = stack.back().first;
+    bool subtree_done = stack.back().second;
+    stack.pop_back();
+
+    uint64_t id = profile.node_ids[node_index];
+    if (subtree_done) {
+      --num_on_path[id];
+      continue;
+    }
+
+    const CallTree::Node& node = tree.GetNode(node_index);
+    auto it = counts.find(id);
+    if (it == counts.end()) {
+      it = counts.emplace(id, FunctionCount{id, node.function_address, 0, 0})
+               .first;
+    }
+    it->second.exclusive += node.exclusive_count;
+    if (num_on_path[id]++ == 0) {
+      it->second.inclusive += node.inclusive_count;
+    }
+
+    stack.emplace_back(node_index, true);
+    for (uint32_t child = node.first_child; child != CallTree::kInvalidIndex;
+         child = tree.GetNode(child).next_sibling) {
+      stack.emplace_back(child, false);
+    }
+  }
+
+  std::vector<FunctionCount> sorted_counts;
+  sorted_counts.reserve(counts.size());
+  for (const auto& id_count : counts) {
+    sorted_counts.push_back(id_count.second);
+  }
+  std::sort(sorted_counts.begin(), sorted_counts.end(),
+            [](const FunctionCount& lhs, const FunctionCount& rhs) {
+              return lhs.function_id < rhs.function_id;
+            });
+  return sorted_counts;
+}
+
+void ProfileDiff::DiffFunctions(const std::vector<FunctionCount>& base,
+                                const std::vector<FunctionCount>& current) {
+  function_deltas_.clear();
+  function_deltas_.reserve(std::max(base.size(), current.size()));
+
+  auto base_it = base.begin();
+  auto current_it = current.begin();
+  while (base_it != base.end() || current_it != current.end()) {
+    bool take_base =
+        base_it != base.end() && (current_it == current.end() ||
+                                  base_it->function_id <=
+                                      current_it->function_id);
+    bool take_current =
+        current_it != current.end() && (base_it == base.end() ||
+                                        current_it->function_id <=
+                                            base_it->function_id);
+
+    FunctionDelta delta;
+    if (take_base) {
+      delta.function_id = base_it->function_id;
+      delta.base_address = base_it->function_address;
+      delta.base_inclusive = base_it->inclusive;
+      delta.base_exclusive = base_it->exclusive;
+      ++base_it;
+    }
+    if (take_current) {
+      delta.function_id = current_it->function_id;
+      delta.current_address = current_it->function_address;
+      delta.current_inclusive = current_it->inclusive;
+      delta.current_exclusive = current_it->exclusive;
+      ++current_it;
+    }
+    function_deltas_.push_back(delta);
+  }
+}
+
+std::vector<ProfileDiff::NodeGroup> ProfileDiff::GetChildGroups(
+    const Profile& profile, const NodeGroup& parents) {
+  std::vector<uint32_t> children;
+  for (uint32_t parent : parents) {
+    for (uint32_t child = profile.tree.GetNode(parent).first_child;
+         child != CallTree::kInvalidIndex;
+         child = profile.tree.GetNode(child).next_sibling) {
+      children.push_back(child);
+    }
+  }
+  std::sort(children.begin(), children.end(),
+            [&profile](uint32_t lhs, uint32_t rhs) {
+              uint64_t lhs_id = profile.node_ids[lhs];
+              uint64_t rhs_id = profile.node_ids[rhs];
+              return lhs_id != rhs_id ? lhs_id < rhs_id : lhs < rhs;
+            });
+
+  std::vector<NodeGroup> groups;
+  for (size_t i = 0; i < children.size(); ++i) {
+    if (i == 0 || profile.node_ids[children[i]] !=
+                      profile.node_ids[children[i - 1]]) {
+      groups.emplace_back();
+    }
+    groups.back().push_back(children[i]);
+  }
+  return groups;
+}
+
+void ProfileDiff::DiffNodes(const Profile& base, const Profile& current) {
+  struct PendingNode {
+    NodeGroup base_nodes;
+    NodeGroup current_nodes;
+    uint32_t delta_index;
+  };
+
+  node_deltas_.clear();
+  NodeDelta root;
+  root.function.base_inclusive = base_total_;
+  root.function.current_inclusive = current_total_;
+  node_deltas_.push_back(root);
+
+  // Breadth-first, so that the children of a node are added contiguously.
+  std::vector<PendingNode> pending;
+  pending.push_back({{CallTree::kRootIndex}, {CallTree::kRootIndex},
+                     kRootIndex});
+  for (size_t next = 0; next < pending.size(); ++next) {
+    std::vector<NodeGroup> base_groups =
+        GetChildGroups(base, pending[next].base_nodes);
+    std::vector<NodeGroup> current_groups =
+        GetChildGroups(current, pending[next].current_nodes);
+    uint32_t parent_index = pending[next].delta_index;
+    uint32_t first_child = static_cast<uint32_t>(node_deltas_.size());
+    uint32_t depth = node_deltas_[parent_index].depth + 1;
+
+    size_t base_i = 0;
+    size_t current_i = 0;
+    while (base_i < base_groups.size() || current_i < current_groups.size()) {
+      uint64_t base_id = base_i < base_groups.size()
+                             ? base.node_ids[base_groups[base_i][0]]
+                             : UINT64_MAX;
+      uint64_t current_id = current_i < current_groups.size()
+                                ? current.node_ids[current_groups[current_i][0]]
+                                : UINT64_MAX;
+      bool take_base =
+          base_i < base_groups.size() &&
+          (current_i == current_groups.size() || base_id <= current_id);
+      bool take_current =
+          current_i < current_groups.size() &&
+          (base_i == base_groups.size() || current_id <= base_id);
+
+      NodeDelta delta;
+      delta.parent = parent_index;
+      delta.depth = depth;
+      PendingNode child;
+      child.delta_index = static_cast<uint32_t>(node_deltas_.size());
+      if (take_base) {
+        child.base_nodes = std::move(base_groups[base_i++]);
+        delta.function.function_id = base_id;
+        delta.function.base_address =
+            base.tree.GetNode(child.base_nodes[0]).function_address;
+        for (uint32_t node_index : child.base_nodes) {
+          const CallTree::Node& node = base.tree.GetNode(node_index);
+          delta.function.base_inclusive += node.inclusive_count;
+          delta.function.base_exclusive += node.exclusive_count;
+        }
+      }
+      if (take_current) {
+        child.current_nodes = std::move(current_groups[current_i++]);
+        delta.function.function_id = current_id;
+        delta.function.current_address =
+            current.tree.GetNode(child.current_nodes[0]).function_address;
+        for (uint32_t node_index : child.current_nodes) {
+          const CallTree::Node& node = current.tree.GetNode(node_index);
+          delta.function.current_inclusive += node.inclusive_count;
+          delta.function.current_exclusive += node.exclusive_count;
+        }
+      }
+      node_deltas_.push_back(delta);
+      pending.push_back(std::move(child));
+    }
+
+    NodeDelta& parent = node_deltas_[parent_index];
+    parent.num_children =
+        static_cast<uint32_t>(node_deltas_.size()) - first_child;
+    if (parent.num_children > 0) parent.first_child = first_child;
+  }
+}
+
+std::vector<ProfileDiff::FunctionDelta> ProfileDiff::GetSortedByInclusiveDelta()
+    const {
+  std::vector<FunctionDelta> sorted = function_deltas_;
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [this](const FunctionDelta& lhs, const FunctionDelta& rhs) {
+                     return GetInclusiveDelta(lhs) > GetInclusiveDelta(rhs);
+                   });
+  return sorted;
+}
+
+double ProfileDiff::GetPercentDelta(uint64_t base_count,
+                                    uint64_t current_count) const {
+  double base_percent =
+      base_total_ > 0 ? 100.0 * base_count / base_total_ : 0.0;
+  double current_percent =
+      current_total_ > 0 ? 100.0 * current_count / current_total_ : 0.0;
+  return current_percent - base_percent;
+}
+
+double ProfileDiff::GetInclusiveDelta(const FunctionDelta& delta) const {
+  return GetPercentDelta(delta.base_inclusive, delta.current_inclusive);
+}
+
+double ProfileDiff::GetExclusiveDelta(const FunctionDelta& delta) const {
+  return GetPercentDelta(delta.base_exclusive, delta.current_exclusive);
+}
@@ -0,0 +1,117 @@
+#ifndef ORBIT_CORE_PROFILE_DIFF_H_
+#define ORBIT_CORE_PROFILE_DIFF_H_
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "CallTree.h"
+#include "CallstackTypes.h"
+
+class SamplingProfiler;
+
+// Differences between two sampling profiles, e.g. two captures of different
+// builds or two time ranges of the same capture.
+//
+// Functions are matched by id rather than by address, since addresses differ
+// between builds. The id of a function is given by a FunctionIdFunc for each
+// profile: the identity for profiles of the same binary, a hash of the symbol
+// name for profiles of different builds. Per-function totals of both profiles
+// are sorted by id and merged in a single pass. Call tree nodes are matched
+// the same way, child list by child list, starting from the roots. Sibling
+// nodes with the same id, e.g. two addresses resolved to the same symbol, are
+// merged into one.
+//
+// Counts are absolute. Use the Get*Delta functions, which compare fractions
+// of the total number of samples, to compare profiles of different lengths.
+class ProfileDiff {
+ public:
+  using FunctionIdFunc = std::function<uint64_t(uint64_t function_address)>;
+
+  struct FunctionDelta {
+    uint64_t function_id = 0;
+    // Address of the function in each profile, 0 if it wasn't sampled.
+    uint64_t base_address = 0;
+    uint64_t current_address = 0;
+    uint64_t base_inclusive = 0;
+    uint64_t base_exclusive = 0;
+    uint64_t current_inclusive = 0;
+    uint64_t current_exclusive = 0;
+  };
+
+  // Node of the merged top-down call tree. The children of a node are
+  // stored contiguously, at [first_child, first_child + num_children).
+  struct NodeDelta {
+    FunctionDelta function;
+    uint32_t parent = CallTree::kInvalidIndex;
+    uint32_t first_child = CallTree::kInvalidIndex;
+    uint32_t num_children = 0;
+    uint32_t depth = 0;
+  };
+
+  static constexpr uint32_t kRootIndex = 0;
+
+  // A null FunctionIdFunc identifies functions by address.
+  ProfileDiff(const CallTree& base, const CallTree& current,
+              const FunctionIdFunc& base_function_id = nullptr,
+              const FunctionIdFunc& current_function_id = nullptr);
+  // Diffs the top-down call trees of thread "tid" of both profilers, thread 0
+  // being the summary of all threads. Functions are identified by a hash of
+  // their symbol name.
+  ProfileDiff(SamplingProfiler* base, SamplingProfiler* current,
+              ThreadID tid = 0);
+
+  uint64_t GetBaseTotalCount() const { return base_total_; }
+  uint64_t GetCurrentTotalCount() const { return current_total_; }
+
+  // Sorted by function id.
+  const std::vector<FunctionDelta>& GetFunctionDeltas() const {
+    return function_deltas_;
+  }
+  // Function deltas sorted by decreasing inclusive delta, i.e. the biggest
+  // regressions first.
+  std::vector<FunctionDelta> GetSortedByInclusiveDelta() const;
+
+  const std::vector<NodeDelta>& GetNodeDeltas() const { return node_deltas_; }
+
+  // Differences of the fractions of samples, in percentage points.
+  double GetInclusiveDelta(const FunctionDelta& delta) const;
+  double GetExclusiveDelta(const FunctionDelta& delta) const;
+
+ private:
+  struct FunctionCount {
+    uint64_t function_id;
+    uint64_t function_address;
+    uint64_t inclusive;
+    uint64_t exclusive;
+  };
+
+  // A call tree along with the function id of each of its nodes.
+  struct Profile {
+    Profile(const CallTree& tree, const FunctionIdFunc& function_id);
+    const CallTree& tree;
+    std::vector<uint64_t> node_ids;
+  };
+
+  // Call tree nodes of one profile that map to the same diff node.
+  using NodeGroup = std::vector<uint32_t>;
+
+  void Compute(const CallTree& base, const FunctionIdFunc& base_function_id,
+               const CallTree& current,
+               const FunctionIdFunc& current_function_id);
+  static std::vector<FunctionCount> GetSortedFunctionCounts(
+      const Profile& profile);
+  void DiffFunctions(const std::vector<FunctionCount>& base,
+                     const std::vector<FunctionCount>& current);
+  static std::vector<NodeGroup> GetChildGroups(const Profile& profile,
+                                               const NodeGroup& parents);
+  void DiffNodes(const Profile& base, const Profile& current);
+  double GetPercentDelta(uint64_t base_count, uint64_t current_count) const;
+
+  uint64_t base_total_ = 0;
+  uint64_t current_total_ = 0;
+  std::vector<FunctionDelta> function_deltas_;
+  std::vector<NodeDelta> node_deltas_;
+};
+
+#endif  // ORBIT_CORE_PROFILE_DIFF_H_
@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "CallTree.h"
+#include "ProfileDiff.h"
+
+namespace {
+constexpr uint64_t kMain = 0x10;
+constexpr uint64_t kFoo = 0x20;
+constexpr uint64_t kBar = 0x30;
+constexpr uint64_t kBaz = 0x40;
+
+// Frames are innermost first, as in CallStack::m_Data.
+const std::vector<uint64_t> kMainFoo = {kFoo, kMain};
+const std::vector<uint64_t> kMainBar = {kBar, kMain};
+const std::vector<uint64_t> kMainFooBaz = {kBaz, kFoo, kMain};
+
+const ProfileDiff::FunctionDelta* FindFunction(const ProfileDiff& diff,
+                                               uint64_t function_id) {
+  for (const ProfileDiff::FunctionDelta& delta : diff.GetFunctionDeltas()) {
+    if (delta.function_id == function_id) return &delta;
+  }
+  return nullptr;
+}
+}  // namespace
+
+TEST(ProfileDiff, IdenticalProfiles) {
+  CallTree base;
+  base.AddCallstack(kMainFoo, 5);
+  base.AddCallstack(kMainBar, 5);
+
+  ProfileDiff diff(base, base);
+  EXPECT_EQ(diff.GetBaseTotalCount(), 10);
+  EXPECT_EQ(diff.GetCurrentTotalCount(), 10);
+  ASSERT_EQ(diff.GetFunctionDeltas().size(), 3);
+  for (const ProfileDiff::FunctionDelta& delta : diff.GetFunctionDeltas()) {
+    EXPECT_EQ(delta.base_inclusive, delta.current_inclusive);
+    EXPECT_EQ(delta.base_exclusive, delta.current_exclusive);
+    EXPECT_DOUBLE_EQ(diff.GetInclusiveDelta(delta), 0.0);
+  }
+
+  // root, main, main/foo, main/bar
+  EXPECT_EQ(diff.GetNodeDeltas().size(), 4);
+}
+
+TEST(ProfileDiff, FunctionDeltas) {
+  CallTree base;
+  base.AddCallstack(kMainFoo, 5);
+  base.AddCallstack(kMainBar, 5);
+  CallTree current;
+  current.AddCallstack(kMainFoo, 10);
+  current.AddCallstack(kMainBar, 2);
+  current.AddCallstack(kMainFooBaz, 8);
+
+  ProfileDiff diff(base, current);
+  const std::vector<ProfileDiff::FunctionDelta>& deltas =
+      diff.GetFunctionDeltas();
+  ASSERT_EQ(deltas.size(), 4);
+  for (size_t i = 1; i < deltas.size(); ++i) {
+    EXPECT_LT(deltas[i - 1].function_id, deltas[i].function_id);
+  }
+
+  const ProfileDiff::FunctionDelta* foo = FindFunction(diff, kFoo);
+  ASSERT_NE(foo, nullptr);
+  EXPECT_EQ(foo->base_inclusive, 5);
+  EXPECT_EQ(foo->current_inclusive, 18);
+  EXPECT_EQ(foo->current_exclusive, 10);
+  // 50% of the samples before, 90% after.
+  EXPECT_DOUBLE_EQ(diff.GetInclusiveDelta(*foo), 40.0);
+  EXPECT_DOUBLE_EQ(diff.GetExclusiveDelta(*foo), 0.0);
+
+  const ProfileDiff::FunctionDelta* baz = FindFunction(diff, kBaz);
+  ASSERT_NE(baz, nullptr);
+  EXPECT_EQ(baz->base_address, 0);
+  EXPECT_EQ(baz->current_address, kBaz);
+  EXPECT_EQ(baz->base_inclusive, 0);
+  EXPECT_EQ(baz->current_inclusive, 8);
+
+  std::vector<ProfileDiff::FunctionDelta> sorted =
+      diff.GetSortedByInclusiveDelta();
+  ASSERT_EQ(sorted.size(), 4);
+  EXPECT_EQ(sorted[0].function_id, kFoo);
+  EXPECT_EQ(sorted[1].function_id, kBaz);
+  EXPECT_EQ(sorted[3].function_id, kBar);
+}
+
+TEST(ProfileDiff, NodeDeltas) {
+  CallTree base;
+  base.AddCallstack(kMainFoo, 4);
+  base.AddCallstack(kMainBar, 4);
+  CallTree current;
+  current.AddCallstack(kMainFoo, 1);
+  current.AddCallstack(kMainFooBaz, 3);
+
+  ProfileDiff diff(base, current);
+  const std::vector<ProfileDiff::NodeDelta>& nodes = diff.GetNodeDeltas();
+  // root, main, main/foo, main/bar, main/foo/baz
+  ASSERT_EQ(nodes.size(), 5);
+
+  const ProfileDiff::NodeDelta& root = nodes[ProfileDiff::kRootIndex];
+  EXPECT_EQ(root.function.base_inclusive, 8);
+  EXPECT_EQ(root.function.current_inclusive, 4);
+  ASSERT_EQ(root.num_children, 1);
+
+  const ProfileDiff::NodeDelta& main = nodes[root.first_child];
+  EXPECT_EQ(main.function.function_id, kMain);
+  EXPECT_EQ(main.depth, 1);
+  ASSERT_EQ(main.num_children, 2);
+
+  // Children are sorted by id.
+  const ProfileDiff::NodeDelta& foo = nodes[main.first_child];
+  const ProfileDiff::NodeDelta& bar = nodes[main.first_child + 1];
+  EXPECT_EQ(foo.function.function_id, kFoo);
+  EXPECT_EQ(foo.function.base_inclusive, 4);
+  EXPECT_EQ(foo.function.current_inclusive, 4);
+  EXPECT_EQ(foo.function.base_exclusive, 4);
+  EXPECT_EQ(foo.function.current_exclusive, 1);
+  EXPECT_EQ(foo.parent, root.first_child);
+  EXPECT_EQ(bar.function.function_id, kBar);
+  EXPECT_EQ(bar.function.current_inclusive, 0);
+  EXPECT_EQ(bar.num_children, 0);
+
+  ASSERT_EQ(foo.num_children, 1);
+  const ProfileDiff::NodeDelta& baz = nodes[foo.first_child];
+  EXPECT_EQ(baz.function.function_id, kBaz);
+  EXPECT_EQ(baz.depth, 3);
+  EXPECT_EQ(baz.function.base_inclusive, 0);
+  EXPECT_EQ(baz.function.current_inclusive, 3);
+}
+
+TEST(ProfileDiff, RecursionIsCountedOnce) {
+  CallTree tree;
+  tree.AddCallstack(std::vector<uint64_t>{kFoo, kFoo, kFoo, kMain}, 3);
+
+  ProfileDiff diff(tree, tree);
+  const ProfileDiff::FunctionDelta* foo = FindFunction(diff, kFoo);
+  ASSERT_NE(foo, nullptr);
+  EXPECT_EQ(foo->base_inclusive, 3);
+  EXPECT_EQ(foo->base_exclusive, 3);
+}
+
+TEST(ProfileDiff, MatchesFunctionsById) {
+  // The same functions at different addresses, as in two builds.
+  constexpr uint64_t kOffset = 0x1000;
+  CallTree base;
+  base.AddCallstack(kMainFoo, 2);
+  CallTree current;
+  current.AddCallstack(std::vector<uint64_t>{kFoo + kOffset, kMain + kOffset},
+                       6);
+  // A second address that resolves to "foo".
+  current.AddCallstack(
+      std::vector<uint64_t>{kFoo + kOffset + 4, kMain + kOffset}, 2);
+
+  ProfileDiff::FunctionIdFunc current_id = [](uint64_t address) {
+    return address >= kFoo + kOffset ? kFoo : address - kOffset;
+  };
+  ProfileDiff diff(base, current, nullptr, current_id);
+
+  ASSERT_EQ(diff.GetFunctionDeltas().size(), 2);
+  const ProfileDiff::FunctionDelta* foo = FindFunction(diff, kFoo);
+  ASSERT_NE(foo, nullptr);
+  EXPECT_EQ(foo->base_address, kFoo);
+  EXPECT_EQ(foo->current_inclusive, 8);
+
+  // Both "foo" nodes of the current profile map to a single node.
+  ASSERT_EQ(diff.GetNodeDeltas().size(), 3);
+  const ProfileDiff::NodeDelta& foo_node = diff.GetNodeDeltas()[2];
+  EXPECT_EQ(foo_node.function.function_id, kFoo);
+  EXPECT_EQ(foo_node.function.base_inclusive, 2);
+  EXPECT_EQ(foo_node.function.current_inclusive, 8);
+}
@@ -4,9 +4,11 @@
 
 #include "SamplingProfiler.h"
 
+#include <algorithm>
 #include <map>
 #include <memory>
 #include <set>
+#include <utility>
 #include <vector>
 
 #include "Capture.h"
@@ -48,6 +50,9 @@ void SamplingProfiler::StartCapture() {
   Capture::GIsSampling = true;
   m_Process->EnumerateThreads();
 
+  SetSlidingWindow(TicksFromMicroseconds(GParams.m_SamplingWindowSeconds *
+                                         1000000.0));
+
   m_SamplingTimer.Start();
   m_ThreadUsageTimer.Start();
 
@@ -127,19 +132,13 @@ void SamplingProfiler::FireDoneProcessingCallbacks() {
 }
 
 //-----------------------------------------------------------------------------
-std::multimap<int, CallstackID> SamplingProfiler::GetCallStacksFromAddress(
-    uint64_t a_Addr, ThreadID a_TID, int& o_NumCallstacks) {
-  std::set<CallstackID>& callstacks = m_FunctionToCallstacks[a_Addr];
-  return m_ThreadSampleData[a_TID].SortCallstacks(callstacks, o_NumCallstacks);
-}
-
-//-----------------------------------------------------------------------------
-void SamplingProfiler::AddCallStack(CallStack& a_CallStack) {
+void SamplingProfiler::AddCallStack(CallStack& a_CallStack, TickType a_Time) {
   CallstackID hash = a_CallStack.Hash();
   if (!HasCallStack(hash)) {
     AddUniqueCallStack(a_CallStack);
   }
   CallstackEvent hashedCS;
+  hashedCS.m_Time = a_Time != 0 ? a_Time : OrbitTicks();
   hashedCS.m_Id = hash;
   hashedCS.m_TID = a_CallStack.m_ThreadId;
   AddHashedCallStack(hashedCS);
@@ -154,6 +153,13 @@ void SamplingProfiler::AddHashedCallStack(CallstackEvent& a_CallStack) {
   }
   ScopeLock lock(m_Mutex);
   m_Callstacks.push_back(a_CallStack);
+  if (m_SlidingWindow) {
+    m_SlidingWindow->Add(a_CallStack.m_Time, a_CallStack.m_Id);
+    if (a_CallStack.m_Time >= m_LatestSampleTime) {
+      m_LatestSampleTime = a_CallStack.m_Time;
+      m_LatestSampleLocalTime = OrbitTicks();
+    }
+  }
 }
 
 //-----------------------------------------------------------------------------
@@ -166,19 +172,25 @@ void SamplingProfiler::AddUniqueCallStack(CallStack& a_CallStack) {
 //-----------------------------------------------------------------------------
 std::shared_ptr<SortedCallstackReport>
 SamplingProfiler::GetSortedCallstacksFromAddress(uint64_t a_Addr,
-                                                 ThreadID a_TID) {
+                                                 ThreadID a_TID,
+                                                 int a_FirstIndex,
+                                                 int a_MaxCount) {
+  ScopeLock lock(m_Mutex);
   std::shared_ptr<SortedCallstackReport> report =
       std::make_shared<SortedCallstackReport>();
-  std::multimap<int, CallstackID> multiMap =
-      GetCallStacksFromAddress(a_Addr, a_TID, report->m_NumCallStacksTotal);
-  int numUniqueCallstacks = (int)multiMap.size();
-  report->m_CallStacks.resize(numUniqueCallstacks);
-  int index = numUniqueCallstacks;
-
-  for (auto& pair : multiMap) {
-    CallstackCount& callstack = report->m_CallStacks[--index];
-    callstack.m_Count = pair.first;
-    callstack.m_CallstackId = pair.second;
+  CallstackCountList& callstacks =
+      m_ThreadSampleData[a_TID].GetFunctionCallstacks(
+          a_Addr, m_FunctionToCallstacks[a_Addr]);
+  report->m_NumCallStacksTotal = (int)callstacks.GetTotalCount();
+  report->m_NumUniqueCallStacks = (int)callstacks.GetNumCallstacks();
+  report->m_FirstIndex = std::max(a_FirstIndex, 0);
+
+  std::vector<CallstackCountList::Entry> page =
+      callstacks.GetPage(report->m_FirstIndex, std::max(a_MaxCount, 0));
+  report->m_CallStacks.resize(page.size());
+  for (size_t i = 0; i < page.size(); ++i) {
+    report->m_CallStacks[i].m_Count = (int)page[i].count;
+    report->m_CallStacks[i].m_CallstackId = page[i].callstack_id;
   }
 
   return report;
@@ -260,6 +272,11 @@ void SamplingProfiler::ProcessSamples() {
 
   m_State = Processing;
 
+  // Callstacks counted since the last call, used to grow the call trees
+  // incrementally instead of rebuilding them.
+  std::unordered_map<ThreadID, std::unordered_map<CallstackID, unsigned int>>
+      newCallstackCounts;
+
   // Unique call stacks and per thread data
   for (const CallstackEvent& callstack : m_Callstacks) {
     if (!HasCallStack(callstack.m_Id)) {
@@ -269,20 +286,31 @@ void SamplingProfiler::ProcessSamples() {
     ThreadSampleData& threadSampleData = m_ThreadSampleData[callstack.m_TID];
     threadSampleData.m_NumSamples++;
     threadSampleData.m_CallstackCount[callstack.m_Id]++;
+    newCallstackCounts[callstack.m_TID][callstack.m_Id]++;
 
     if (m_GenerateSummary) {
       ThreadSampleData& threadSampleDataAll = m_ThreadSampleData[0];
       threadSampleDataAll.m_NumSamples++;
       threadSampleDataAll.m_CallstackCount[callstack.m_Id]++;
+      newCallstackCounts[0][callstack.m_Id]++;
     }
   }
 
   ProcessAddresses();
 
+  for (auto& threadIt : newCallstackCounts) {
+    ThreadSampleData& threadSampleData = m_ThreadSampleData[threadIt.first];
+    for (auto& stackCountIt : threadIt.second) {
+      AddToCallTrees(threadSampleData, stackCountIt.first,
+                     stackCountIt.second);
+    }
+  }
+
   for (auto& dataIt : m_ThreadSampleData) {
     ThreadSampleData& threadSampleData = dataIt.second;
 
     threadSampleData.ComputeAverageThreadUsage();
+    threadSampleData.m_FunctionCallstacks.clear();
 
     // Address count per sample per thread
     for (auto& stackCountIt : threadSampleData.m_CallstackCount) {
@@ -324,6 +352,61 @@ void SamplingProfiler::ProcessSamples() {
   m_State = DoneProcessing;
 }
 
+//-----------------------------------------------------------------------------
+void SamplingProfiler::AddToCallTrees(ThreadSampleData& a_ThreadSampleData,
+                                      CallstackID a_CallstackID,
+                                      unsigned int a_Count) {
+  auto resolvedIt = m_RawToResolvedMap.find(a_CallstackID);
+  if (resolvedIt == m_RawToResolvedMap.end()) return;
+  auto callstackIt = m_UniqueResolvedCallstacks.find(resolvedIt->second);
+  if (callstackIt == m_UniqueResolvedCallstacks.end()) return;
+
+  const CallStack& callstack = *callstackIt->second;
+  a_ThreadSampleData.m_CallTree.AddCallstack(callstack.m_Data.data(),
+                                             callstack.m_Depth, a_Count);
+  a_ThreadSampleData.m_InvertedCallTree.AddCallstack(
+      callstack.m_Data.data(), callstack.m_Depth, a_Count);
+}
+
+//-----------------------------------------------------------------------------
+void SamplingProfiler::BuildCallTrees() {
+  ScopeLock lock(m_Mutex);
+  for (auto& dataIt : m_ThreadSampleData) {
+    ThreadSampleData& threadSampleData = dataIt.second;
+    threadSampleData.m_CallTree.Clear();
+    threadSampleData.m_InvertedCallTree.Clear();
+    for (auto& stackCountIt : threadSampleData.m_CallstackCount) {
+      AddToCallTrees(threadSampleData, stackCountIt.first,
+                     stackCountIt.second);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+const CallTree* SamplingProfiler::GetCallTree(
+    ThreadID a_TID, CallTree::Direction a_Direction) const {
+  auto it = m_ThreadSampleData.find(a_TID);
+  if (it == m_ThreadSampleData.end()) return nullptr;
+  return a_Direction == CallTree::Direction::kTopDown
+             ? &it->second.m_CallTree
+             : &it->second.m_InvertedCallTree;
+}
+
+//-----------------------------------------------------------------------------
+std::shared_ptr<CallTree> SamplingProfiler::CopyCallTree(
+    ThreadID a_TID, CallTree::Direction a_Direction) {
+  ScopeLock lock(m_Mutex);
+  const CallTree* callTree = GetCallTree(a_TID, a_Direction);
+  return callTree ? std::make_shared<CallTree>(*callTree) : nullptr;
+}
+
+//-----------------------------------------------------------------------------
+ThreadID SamplingProfiler::GetBusiestThreadID() {
+  ScopeLock lock(m_Mutex);
+  return m_SortedThreadSampleData.empty() ? 0
+                                          : m_SortedThreadSampleData[0]->m_TID;
+}
+
 //-----------------------------------------------------------------------------
 void ThreadSampleData::ComputeAverageThreadUsage() {
   m_AverageThreadUsage = 0.f;
@@ -338,60 +421,87 @@ void ThreadSampleData::ComputeAverageThreadUsage() {
 }
 
 //-----------------------------------------------------------------------------
-std::multimap<int, CallstackID> ThreadSampleData::SortCallstacks(
-    const std::set<CallstackID>& a_CallStacks, int& o_TotalCallStacks) {
-  std::multimap<int, CallstackID> sortedCallstacks;
-  int numCallstacks = 0;
-  for (CallstackID id : a_CallStacks) {
-    auto it = m_CallstackCount.find(id);
-    if (it != m_CallstackCount.end()) {
-      int count = it->second;
-      sortedCallstacks.insert(std::make_pair(count, id));
-      numCallstacks += count;
+CallstackCountList& ThreadSampleData::GetFunctionCallstacks(
+    uint64_t a_FunctionAddress,
+    const std::set<CallstackID>& a_FunctionCallstacks) {
+  auto it = m_FunctionCallstacks.find(a_FunctionAddress);
+  if (it != m_FunctionCallstacks.end()) {
+    return it->second;
+  }
+
+  CallstackCountList& callstacks = m_FunctionCallstacks[a_FunctionAddress];
+  for (CallstackID id : a_FunctionCallstacks) {
+    auto countIt = m_CallstackCount.find(id);
+    if (countIt != m_CallstackCount.end()) {
+      callstacks.Add(id, countIt->second);
     }
   }
 
-  o_TotalCallStacks = numCallstacks;
-  return sortedCallstacks;
+  return callstacks;
 }
 
 //-----------------------------------------------------------------------------
 void SamplingProfiler::ProcessAddresses() {
   ScopeLock lock(m_Mutex);
   for (const auto& it : m_UniqueCallstacks) {
-    CallstackID rawCallstackId = it.first;
-    const std::shared_ptr<CallStack> callstack = it.second;
-    CallStack ResolvedCallstack = *callstack;
+    ResolveCallstack(it.first, *it.second);
+  }
+}
 
-    for (uint32_t i = 0; i < callstack->m_Depth; ++i) {
-      uint64_t addr = callstack->m_Data[i];
+//-----------------------------------------------------------------------------
+void SamplingProfiler::ResolveCallstack(CallstackID a_RawCallstackId,
+                                        const CallStack& a_Callstack) {
+  CallStack ResolvedCallstack = a_Callstack;
 
-      if (m_ExactAddresses.find(addr) == m_ExactAddresses.end()) {
-        AddAddress(addr);
-      }
+  for (uint32_t i = 0; i < a_Callstack.m_Depth; ++i) {
+    uint64_t addr = a_Callstack.m_Data[i];
 
-      auto addrIt = m_ExactAddresses.find(addr);
-      if (addrIt != m_ExactAddresses.end()) {
-        const uint64_t& functionAddr = addrIt->second;
-        ResolvedCallstack.m_Data[i] = functionAddr;
-        m_FunctionToCallstacks[functionAddr].insert(rawCallstackId);
-      }
+    if (m_ExactAddresses.find(addr) == m_ExactAddresses.end()) {
+      AddAddress(addr);
     }
 
-    CallstackID resolvedCallstackId = ResolvedCallstack.Hash();
-    if (m_UniqueResolvedCallstacks.find(resolvedCallstackId) ==
-        m_UniqueResolvedCallstacks.end()) {
-      m_UniqueResolvedCallstacks[resolvedCallstackId] =
-          std::make_shared<CallStack>(ResolvedCallstack);
+    auto addrIt = m_ExactAddresses.find(addr);
+    if (addrIt != m_ExactAddresses.end()) {
+      const uint64_t& functionAddr = addrIt->second;
+      ResolvedCallstack.m_Data[i] = functionAddr;
+      m_FunctionToCallstacks[functionAddr].insert(a_RawCallstackId);
     }
+  }
 
-    m_RawToResolvedMap[rawCallstackId] = resolvedCallstackId;
+  CallstackID resolvedCallstackId = ResolvedCallstack.Hash();
+  if (m_UniqueResolvedCallstacks.find(resolvedCallstackId) ==
+      m_UniqueResolvedCallstacks.end()) {
+    m_UniqueResolvedCallstacks[resolvedCallstackId] =
+        std::make_shared<CallStack>(ResolvedCallstack);
   }
+
+  m_RawToResolvedMap[a_RawCallstackId] = resolvedCallstackId;
+}
+
+//-----------------------------------------------------------------------------
+std::shared_ptr<CallStack> SamplingProfiler::FindResolvedCallstack(
+    CallstackID a_RawCallstackId) const {
+  auto resolvedIt = m_RawToResolvedMap.find(a_RawCallstackId);
+  if (resolvedIt == m_RawToResolvedMap.end()) return nullptr;
+  auto callstackIt = m_UniqueResolvedCallstacks.find(resolvedIt->second);
+  if (callstackIt == m_UniqueResolvedCallstacks.end()) return nullptr;
+  return callstackIt->second;
 }
 
 //-----------------------------------------------------------------------------
 void SamplingProfiler::AddAddress(uint64_t a_Address) {
+  AddressInfo info = LookUpAddress(a_Address);
   ScopeLock lock(m_Mutex);
+  StoreAddress(info);
+}
+
+//-----------------------------------------------------------------------------
+SamplingProfiler::AddressInfo SamplingProfiler::LookUpAddress(
+    uint64_t a_Address) {
+  ScopeLock lock(m_SymbolMutex);
+  AddressInfo info;
+  info.m_Address = a_Address;
+  info.m_FunctionAddress = a_Address;
 #ifdef _WIN32
 
   if (!m_IsLinuxPerf) {
@@ -424,25 +534,13 @@ void SamplingProfiler::AddAddress(uint64_t a_Address) {
       }
     }
 
-    m_ExactAddresses[a_Address] =
-        symbol_info->Address ? symbol_info->Address : a_Address;
-    m_AddressToSymbol[(uint64_t)a_Address] = symName;
-    m_AddressToSymbol[symbol_info->Address] = symName;
-
-    LineInfo lineInfo;
-    if (SymUtils::GetLineInfo(a_Address, lineInfo)) {
-      uint64_t hash = StringHash(lineInfo.m_File);
-      lineInfo.m_FileNameHash = hash;
-      m_FileNames[hash] = lineInfo.m_File;
-      lineInfo.m_File = L"";
-      m_AddressToLineInfo[a_Address] = lineInfo;
-    }
+    if (symbol_info->Address) info.m_FunctionAddress = symbol_info->Address;
+    info.m_Symbol = symName;
+    info.m_HasLineInfo = SymUtils::GetLineInfo(a_Address, info.m_LineInfo);
   } else
 #endif
   {
     // TODO: find function start address
-    m_ExactAddresses[a_Address] =
-        /*symbol_info->Address ? symbol_info->Address :*/ a_Address;
     std::shared_ptr<LinuxSymbol> symbol =
         m_Process->LinuxSymbolFromAddress(a_Address);
     std::string symbolName = "???";
@@ -458,7 +556,24 @@ void SamplingProfiler::AddAddress(uint64_t a_Address) {
     } else {
       symbolName = symbol->m_Name;
     }
-    m_AddressToSymbol[(uint64_t)a_Address] = s2ws(symbolName);
+    info.m_Symbol = s2ws(symbolName);
+  }
+  return info;
+}
+
+//-----------------------------------------------------------------------------
+void SamplingProfiler::StoreAddress(const AddressInfo& a_Info) {
+  m_ExactAddresses[a_Info.m_Address] = a_Info.m_FunctionAddress;
+  m_AddressToSymbol[a_Info.m_Address] = a_Info.m_Symbol;
+  m_AddressToSymbol[a_Info.m_FunctionAddress] = a_Info.m_Symbol;
+
+  if (a_Info.m_HasLineInfo) {
+    LineInfo lineInfo = a_Info.m_LineInfo;
+    uint64_t hash = StringHash(lineInfo.m_File);
+    lineInfo.m_FileNameHash = hash;
+    m_FileNames[hash] = lineInfo.m_File;
+    lineInfo.m_File = L"";
+    m_AddressToLineInfo[a_Info.m_Address] = lineInfo;
   }
 }
 
@@ -476,31 +591,169 @@ void SamplingProfiler::OutputStats() {
     for (std::multimap<unsigned int, uint64_t>::reverse_iterator sortedIt =
              threadSampleData.m_AddressCountSorted.rbegin();
          sortedIt != threadSampleData.m_AddressCountSorted.rend(); ++sortedIt) {
-      int numOccurences = sortedIt->first;
+      unsigned int numOccurences = sortedIt->first;
       uint64_t address = sortedIt->second;
-      float prct =
-          100.f * ((float)numOccurences) / (float)threadSampleData.m_NumSamples;
-
-      SampledFunction function;
-      function.m_Name = m_AddressToSymbol[address].c_str();
-      function.m_Inclusive = prct;
-      function.m_Exclusive = 0.f;
+      unsigned int numExclusive = 0;
       auto it = threadSampleData.m_ExclusiveCount.find(address);
       if (it != threadSampleData.m_ExclusiveCount.end()) {
-        function.m_Exclusive =
-            100.f * (float)it->second / (float)threadSampleData.m_NumSamples;
+        numExclusive = it->second;
       }
-      function.m_Address = address;
 
-      std::shared_ptr<Module> module = m_Process->GetModuleFromAddress(address);
-      function.m_Module = module ? s2ws(module->m_Name) : L"unknown module";
+      sampleReport.push_back(CreateSampledFunction(
+          address, numOccurences, numExclusive, threadSampleData.m_NumSamples));
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+SampledFunction SamplingProfiler::CreateSampledFunction(
+    uint64_t a_Address, unsigned int a_InclusiveCount,
+    unsigned int a_ExclusiveCount, unsigned int a_NumSamples) {
+  SampledFunction function;
+  function.m_Name = m_AddressToSymbol[a_Address].c_str();
+  function.m_Inclusive = 100.f * (float)a_InclusiveCount / (float)a_NumSamples;
+  function.m_Exclusive = 100.f * (float)a_ExclusiveCount / (float)a_NumSamples;
+  function.m_Address = a_Address;
+
+  std::shared_ptr<Module> module = m_Process->GetModuleFromAddress(a_Address);
+  function.m_Module = module ? s2ws(module->m_Name) : L"unknown module";
+
+  const LineInfo& lineInfo = m_AddressToLineInfo[a_Address];
+  function.m_Line = lineInfo.m_Line;
+  function.m_File = lineInfo.m_File;
+  return function;
+}
 
-      const LineInfo& lineInfo = m_AddressToLineInfo[address];
-      function.m_Line = lineInfo.m_Line;
-      function.m_File = lineInfo.m_File;
-      sampleReport.push_back(function);
+//-----------------------------------------------------------------------------
+void SamplingProfiler::SetSlidingWindow(TickType a_Duration,
+                                        uint32_t a_NumIntervals) {
+  ScopeLock lock(m_Mutex);
+  m_SlidingWindow =
+      a_Duration > 0
+          ? std::make_unique<SlidingWindowHistogram>(a_Duration, a_NumIntervals)
+          : nullptr;
+  m_SlidingWindowReport.clear();
+  m_SlidingWindowNumSamples = 0;
+  m_LatestSampleTime = 0;
+  m_LatestSampleLocalTime = 0;
+}
+
+//-----------------------------------------------------------------------------
+TickType SamplingProfiler::GetSlidingWindowDuration() const {
+  return m_SlidingWindow ? m_SlidingWindow->GetWindowDuration() : 0;
+}
+
+//-----------------------------------------------------------------------------
+void SamplingProfiler::UpdateSlidingWindowReport() {
+  // Called from the UI thread while samples keep coming in: the lock is only
+  // held to copy state in and out, symbols are looked up and the report is
+  // built without it.
+  std::vector<std::pair<std::shared_ptr<CallStack>, uint64_t>> callstacks;
+  std::vector<std::pair<CallstackID, uint64_t>> unresolved;
+  std::set<uint64_t> newAddresses;
+  unsigned int numSamples = 0;
+  {
+    ScopeLock lock(m_Mutex);
+    if (!m_SlidingWindow) return;
+    // Samples older than the window expire when none come in.
+    if (m_State == Sampling && m_LatestSampleLocalTime != 0) {
+      m_SlidingWindow->AdvanceTo(m_LatestSampleTime + OrbitTicks() -
+                                 m_LatestSampleLocalTime);
+    }
+    numSamples = (unsigned int)m_SlidingWindow->GetTotalCount();
+
+    // Only the unique callstacks of the window are visited, so the cost does
+    // not depend on how long the capture has been running.
+    for (const auto& callstackCount : m_SlidingWindow->GetCounts()) {
+      std::shared_ptr<CallStack> callstack =
+          FindResolvedCallstack(callstackCount.first);
+      if (callstack != nullptr) {
+        callstacks.emplace_back(callstack, callstackCount.second);
+        continue;
+      }
+      auto rawIt = m_UniqueCallstacks.find(callstackCount.first);
+      if (rawIt == m_UniqueCallstacks.end()) continue;
+      unresolved.push_back(callstackCount);
+      const CallStack& rawCallstack = *rawIt->second;
+      for (uint32_t i = 0; i < rawCallstack.m_Depth; ++i) {
+        if (m_ExactAddresses.count(rawCallstack.m_Data[i]) == 0) {
+          newAddresses.insert(rawCallstack.m_Data[i]);
+        }
+      }
     }
   }
+
+  std::vector<AddressInfo> addressInfos;
+  addressInfos.reserve(newAddresses.size());
+  for (uint64_t address : newAddresses) {
+    addressInfos.push_back(LookUpAddress(address));
+  }
+
+  if (!unresolved.empty()) {
+    ScopeLock lock(m_Mutex);
+    for (const AddressInfo& info : addressInfos) {
+      if (m_ExactAddresses.count(info.m_Address) == 0) StoreAddress(info);
+    }
+    for (const auto& callstackCount : unresolved) {
+      // The capture can have been cleared since.
+      auto rawIt = m_UniqueCallstacks.find(callstackCount.first);
+      if (rawIt == m_UniqueCallstacks.end()) continue;
+      ResolveCallstack(callstackCount.first, *rawIt->second);
+      callstacks.emplace_back(FindResolvedCallstack(callstackCount.first),
+                              callstackCount.second);
+    }
+  }
+
+  // Resolved callstacks are never modified, they are read without the lock.
+  std::unordered_map<uint64_t, unsigned int> inclusiveCounts;
+  std::unordered_map<uint64_t, unsigned int> exclusiveCounts;
+  std::set<uint64_t> uniqueAddresses;
+  for (const auto& callstackCount : callstacks) {
+    const CallStack* callstack = callstackCount.first.get();
+    if (callstack == nullptr || callstack->m_Depth == 0) continue;
+    unsigned int count = (unsigned int)callstackCount.second;
+
+    exclusiveCounts[callstack->m_Data[0]] += count;
+    uniqueAddresses.clear();
+    for (uint32_t i = 0; i < callstack->m_Depth; ++i) {
+      uniqueAddresses.insert(callstack->m_Data[i]);
+    }
+    for (uint64_t address : uniqueAddresses) {
+      inclusiveCounts[address] += count;
+    }
+  }
+
+  std::vector<SampledFunction> report;
+  report.reserve(inclusiveCounts.size());
+  {
+    ScopeLock lock(m_Mutex);
+    for (const auto& addressCount : inclusiveCounts) {
+      report.push_back(CreateSampledFunction(
+          addressCount.first, addressCount.second,
+          exclusiveCounts[addressCount.first], numSamples));
+    }
+  }
+
+  std::sort(report.begin(), report.end(),
+            [](const SampledFunction& a, const SampledFunction& b) {
+              return a.m_Inclusive > b.m_Inclusive;
+            });
+
+  ScopeLock lock(m_Mutex);
+  m_SlidingWindowReport = std::move(report);
+  m_SlidingWindowNumSamples = (int)numSamples;
+}
+
+//-----------------------------------------------------------------------------
+std::vector<SampledFunction> SamplingProfiler::GetSlidingWindowReport() {
+  ScopeLock lock(m_Mutex);
+  return m_SlidingWindowReport;
+}
+
+//-----------------------------------------------------------------------------
+int SamplingProfiler::GetSlidingWindowNumSamples() {
+  ScopeLock lock(m_Mutex);
+  return m_SlidingWindowNumSamples;
 }
 
 //-----------------------------------------------------------------------------
@@ -595,9 +848,11 @@ ORBIT_SERIALIZE_WSTRING(SamplingProfiler, 1) {
 }
 
 //-----------------------------------------------------------------------------
-ORBIT_SERIALIZE_WSTRING(SortedCallstackReport, 0) {
+ORBIT_SERIALIZE_WSTRING(SortedCallstackReport, 1) {
   ORBIT_NVP_VAL(0, m_NumCallStacksTotal);
   ORBIT_NVP_VAL(0, m_CallStacks);
+  ORBIT_NVP_VAL(1, m_NumUniqueCallStacks);
+  ORBIT_NVP_VAL(1, m_FirstIndex);
 }
 
 //-----------------------------------------------------------------------------
@@ -4,11 +4,15 @@
 #pragma once
 
 #include "BlockChain.h"
+#include "CallTree.h"
 #include "Callstack.h"
+#include "CallstackCountList.h"
 #include "Core.h"
 #include "EventBuffer.h"
 #include "Pdb.h"
+#include "Profiling.h"
 #include "SerializationMacros.h"
+#include "SlidingWindowHistogram.h"
 
 class Process;
 class Thread;
@@ -46,8 +50,9 @@ struct LineInfo {
 struct ThreadSampleData {
   ThreadSampleData() { m_ThreadUsage.push_back(0); }
   void ComputeAverageThreadUsage();
-  std::multimap<int, CallstackID> SortCallstacks(
-      const std::set<CallstackID>& a_CallStacks, int& o_TotalCallStacks);
+  CallstackCountList& GetFunctionCallstacks(
+      uint64_t a_FunctionAddress,
+      const std::set<CallstackID>& a_FunctionCallstacks);
   std::unordered_map<CallstackID, unsigned int> m_CallstackCount;
   std::unordered_map<uint64_t, unsigned int> m_AddressCount;
   std::unordered_map<uint64_t, unsigned int> m_ExclusiveCount;
@@ -58,6 +63,15 @@ struct ThreadSampleData {
   float m_AverageThreadUsage = 0;
   ThreadID m_TID = 0;
 
+  // Not serialized, rebuilt from m_CallstackCount by
+  // SamplingProfiler::BuildCallTrees.
+  CallTree m_CallTree{CallTree::Direction::kTopDown};
+  CallTree m_InvertedCallTree{CallTree::Direction::kBottomUp};
+
+  // Not serialized, built on first use for each function and invalidated by
+  // SamplingProfiler::ProcessSamples.
+  std::unordered_map<uint64_t, CallstackCountList> m_FunctionCallstacks;
+
   ORBIT_SERIALIZABLE;
 };
 
@@ -70,9 +84,13 @@ struct CallstackCount {
 };
 
 //-----------------------------------------------------------------------------
+// One page of the unique callstacks of a function, most frequent first.
 struct SortedCallstackReport {
   SortedCallstackReport() {}
+  static const int kPageSize = 256;
   int m_NumCallStacksTotal = 0;
+  int m_NumUniqueCallStacks = 0;
+  int m_FirstIndex = 0;
   std::vector<CallstackCount> m_CallStacks;
   ORBIT_SERIALIZABLE;
 };
@@ -93,7 +111,7 @@ class SamplingProfiler {
   bool ShouldStop();
   void FireDoneProcessingCallbacks();
 
-  void AddCallStack(CallStack& a_CallStack);
+  void AddCallStack(CallStack& a_CallStack, TickType a_Time = 0);
   void AddHashedCallStack(CallstackEvent& a_CallStack);
   void AddUniqueCallStack(CallStack& a_CallStack);
 
@@ -108,10 +126,17 @@ class SamplingProfiler {
     return it != m_UniqueCallstacks.end();
   }
 
-  std::multimap<int, CallstackID> GetCallStacksFromAddress(
-      uint64_t a_Addr, ThreadID a_TID, int& o_NumCallstacks);
   std::shared_ptr<SortedCallstackReport> GetSortedCallstacksFromAddress(
-      uint64_t a_Addr, ThreadID a_TID);
+      uint64_t a_Addr, ThreadID a_TID, int a_FirstIndex = 0,
+      int a_MaxCount = SortedCallstackReport::kPageSize);
+  const CallTree* GetCallTree(ThreadID a_TID,
+                              CallTree::Direction a_Direction) const;
+  // Copy of a call tree made under the lock, for readers on other threads
+  // while samples keep growing the tree. Returns nullptr if there is none.
+  std::shared_ptr<CallTree> CopyCallTree(ThreadID a_TID,
+                                         CallTree::Direction a_Direction);
+  // Thread with the highest average usage, 0 if there are no samples.
+  ThreadID GetBusiestThreadID();
 
   enum SamplingState {
     Idle,
@@ -134,6 +159,19 @@ class SamplingProfiler {
   }
   void SetSelectedFunctions(
       std::unordered_map<uint64_t, SampledFunction>& a_SelectedFunctions);
+  // Keeps counts of the samples of the last "a_Duration" ticks, across all
+  // threads, next to the full capture. The window advances by
+  // a_Duration / a_NumIntervals at a time. A duration of 0 disables it.
+  void SetSlidingWindow(TickType a_Duration, uint32_t a_NumIntervals = 10);
+  bool HasSlidingWindow() const { return m_SlidingWindow != nullptr; }
+  TickType GetSlidingWindowDuration() const;
+  // Rebuilds the report of the functions sampled in the sliding window,
+  // sorted by decreasing inclusive percentage. While sampling, the window
+  // first advances to the current time, even if no samples came in since.
+  void UpdateSlidingWindowReport();
+  std::vector<SampledFunction> GetSlidingWindowReport();
+  int GetSlidingWindowNumSamples();
+
   void SetGenerateSummary(bool a_Value) { m_GenerateSummary = a_Value; }
   bool GetGenerateSummary() const { return m_GenerateSummary; }
   void SortByThreadUsage();
@@ -143,6 +181,7 @@ class SamplingProfiler {
   void Print();
   void ProcessSamples();
   void ProcessSamplesAsync();
+  void BuildCallTrees();
   void AddAddress(uint64_t a_Address);
 
   std::wstring GetSymbolFromAddress(uint64_t a_Address);
@@ -156,6 +195,29 @@ class SamplingProfiler {
   void GetThreadCallstack(Thread* a_Thread);
   void GetThreadsUsage();
   void ProcessAddresses();
+  void ResolveCallstack(CallstackID a_RawCallstackId,
+                        const CallStack& a_Callstack);
+  // Returns nullptr if the callstack isn't resolved yet. Needs the lock.
+  std::shared_ptr<CallStack> FindResolvedCallstack(
+      CallstackID a_RawCallstackId) const;
+
+  // What AddAddress() finds out about an address. Looking it up doesn't
+  // need m_Mutex, storing it does.
+  struct AddressInfo {
+    uint64_t m_Address = 0;
+    uint64_t m_FunctionAddress = 0;
+    std::wstring m_Symbol;
+    bool m_HasLineInfo = false;
+    LineInfo m_LineInfo;
+  };
+  AddressInfo LookUpAddress(uint64_t a_Address);
+  void StoreAddress(const AddressInfo& a_Info);
+  SampledFunction CreateSampledFunction(uint64_t a_Address,
+                                        unsigned int a_InclusiveCount,
+                                        unsigned int a_ExclusiveCount,
+                                        unsigned int a_NumSamples);
+  void AddToCallTrees(ThreadSampleData& a_ThreadSampleData,
+                      CallstackID a_CallstackID, unsigned int a_Count);
   void OutputStats();
 
  protected:
@@ -169,6 +231,8 @@ class SamplingProfiler {
   float m_SampleTimeSeconds = FLT_MAX;
   bool m_GenerateSummary = true;
   Mutex m_Mutex;
+  // Serializes symbol lookups, which can happen without m_Mutex.
+  Mutex m_SymbolMutex;
   int m_NumSamples = 0;
   bool m_LoadedFromFile = false;
   bool m_IsLinuxPerf = false;
@@ -186,4 +250,12 @@ class SamplingProfiler {
   std::unordered_map<uint64_t, std::wstring> m_FileNames;
   std::vector<ProcessingDoneCallback> m_Callbacks;
   std::vector<ThreadSampleData*> m_SortedThreadSampleData;
+
+  std::unique_ptr<SlidingWindowHistogram> m_SlidingWindow;
+  // Time of the latest sample, and local time it was added at. Samples can
+  // come from another clock, the current time is estimated from these.
+  TickType m_LatestSampleTime = 0;
+  TickType m_LatestSampleLocalTime = 0;
+  std::vector<SampledFunction> m_SlidingWindowReport;
+  int m_SlidingWindowNumSamples = 0;
 };
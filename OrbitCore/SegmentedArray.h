@@ -0,0 +1,94 @@
+#ifndef ORBIT_CORE_SEGMENTED_ARRAY_H_
+#define ORBIT_CORE_SEGMENTED_ARRAY_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Append-only array whose elements never move, stored in segments of
+// doubling size: segment k holds kFirstSegmentSize << k elements. Indexing is
+// constant time and the memory held is less than twice the size, so small
+// arrays stay small.
+//
+// One thread appends while others read: size() is published after the
+// element is written, readers can access any index below the size they read.
+template <class T, size_t kFirstSegmentSize = 256>
+class SegmentedArray {
+  static_assert((kFirstSegmentSize & (kFirstSegmentSize - 1)) == 0,
+                "The first segment size must be a power of two");
+
+ public:
+  SegmentedArray() {
+    for (std::atomic<T*>& segment : segments_) segment = nullptr;
+  }
+  SegmentedArray(const SegmentedArray&) = delete;
+  SegmentedArray& operator=(const SegmentedArray&) = delete;
+  ~SegmentedArray() {
+    for (std::atomic<T*>& segment : segments_) delete[] segment.load();
+  }
+
+  void push_back(const T& value) {
+    size_t index = size_.load(std::memory_order_relaxed);
+    size_t segment = GetSegment(index);
+    T* data = segments_[segment].load(std::memory_order_relaxed);
+    if (data == nullptr) {
+      data = new T[GetSegmentSize(segment)];
+      segments_[segment].store(data, std::memory_order_release);
+      capacity_.store(capacity_.load(std::memory_order_relaxed) +
+                          GetSegmentSize(segment),
+                      std::memory_order_relaxed);
+    }
+    data[index - GetSegmentStart(segment)] = value;
+    size_.store(index + 1, std::memory_order_release);
+  }
+
+  size_t size() const { return size_.load(std::memory_order_acquire); }
+  bool empty() const { return size() == 0; }
+  size_t capacity() const { return capacity_.load(std::memory_order_relaxed); }
+  // Bytes of the allocated segments.
+  size_t GetMemoryUsage() const { return capacity() * sizeof(T); }
+
+  const T& operator[](size_t index) const {
+    size_t segment = GetSegment(index);
+    return segments_[segment].load(std::memory_order_acquire)
+        [index - GetSegmentStart(segment)];
+  }
+  T& operator[](size_t index) {
+    size_t segment = GetSegment(index);
+    return segments_[segment].load(std::memory_order_acquire)
+        [index - GetSegmentStart(segment)];
+  }
+  const T& back() const { return (*this)[size() - 1]; }
+
+ private:
+  static size_t GetSegment(size_t index) {
+    return FloorLog2(index / kFirstSegmentSize + 1);
+  }
+  static size_t GetSegmentStart(size_t segment) {
+    return kFirstSegmentSize * ((size_t{1} << segment) - 1);
+  }
+  static size_t GetSegmentSize(size_t segment) {
+    return kFirstSegmentSize << segment;
+  }
+  static size_t FloorLog2(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return index;
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+  }
+
+  // Segments for more than 2^47 * kFirstSegmentSize elements.
+  static const size_t kMaxSegments = 48;
+  std::atomic<T*> segments_[kMaxSegments];
+  std::atomic<size_t> size_{0};
+  std::atomic<size_t> capacity_{0};
+};
+
+#endif  // ORBIT_CORE_SEGMENTED_ARRAY_H_
@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "SegmentedArray.h"
+
+TEST(SegmentedArray, ElementsDontMove) {
+  SegmentedArray<uint64_t, 4> array;
+  std::vector<const uint64_t*> addresses;
+  for (uint64_t i = 0; i < 10000; ++i) {
+    array.push_back(i * 3);
+    addresses.push_back(&array.back());
+  }
+
+  ASSERT_EQ(array.size(), 10000);
+  for (size_t i = 0; i < array.size(); ++i) {
+    EXPECT_EQ(array[i], i * 3);
+    EXPECT_EQ(&array[i], addresses[i]);
+  }
+}
+
+TEST(SegmentedArray, CapacityIsLessThanTwiceTheSize) {
+  SegmentedArray<uint32_t> array;
+  EXPECT_EQ(array.capacity(), 0);
+  for (uint32_t i = 0; i < 100000; ++i) {
+    array.push_back(i);
+    EXPECT_LT(array.capacity(), 2 * array.size() + 256);
+  }
+  EXPECT_EQ(array.GetMemoryUsage(), array.capacity() * sizeof(uint32_t));
+}
+
+TEST(SegmentedArray, ReadWhileAppending) {
+  SegmentedArray<uint64_t, 16> array;
+  const uint64_t kNumElements = 1000000;
+  std::thread writer([&array, kNumElements]() {
+    for (uint64_t i = 0; i < kNumElements; ++i) array.push_back(i);
+  });
+
+  size_t size = 0;
+  while (size < kNumElements) {
+    size = array.size();
+    // Elements below the size read are written.
+    if (size > 0) {
+      ASSERT_EQ(array[size - 1], size - 1);
+    }
+  }
+  writer.join();
+}
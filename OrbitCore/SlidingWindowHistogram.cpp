@@ -0,0 +1,66 @@
+#include "SlidingWindowHistogram.h"
+
+#include <algorithm>
+
+SlidingWindowHistogram::SlidingWindowHistogram(uint64_t window_duration,
+                                               uint32_t num_intervals) {
+  num_intervals = std::max(num_intervals, 1u);
+  interval_duration_ = std::max<uint64_t>(window_duration / num_intervals, 1);
+  intervals_.resize(num_intervals);
+}
+
+void SlidingWindowHistogram::Add(uint64_t time, uint64_t key, uint32_t count) {
+  AdvanceTo(time);
+
+  uint64_t index = time / interval_duration_;
+  if (index + intervals_.size() <= latest_index_) return;
+
+  Interval& interval = intervals_[index % intervals_.size()];
+  interval.counts[key] += count;
+  interval.total_count += count;
+  counts_[key] += count;
+  total_count_ += count;
+}
+
+void SlidingWindowHistogram::AdvanceTo(uint64_t time) {
+  uint64_t index = time / interval_duration_;
+  if (index <= latest_index_) return;
+
+  // The intervals between the previous and the new latest index reuse the
+  // slots of the intervals that just fell out of the window. Don't visit
+  // more slots than there are if time jumped ahead by more than a window.
+  uint64_t num_intervals = intervals_.size();
+  uint64_t first = std::max(latest_index_ + 1,
+                            index >= num_intervals ? index - num_intervals + 1
+                                                   : 0);
+  for (uint64_t i = first; i <= index; ++i) {
+    Expire(&intervals_[i % num_intervals]);
+  }
+  latest_index_ = index;
+}
+
+void SlidingWindowHistogram::Clear() {
+  for (Interval& interval : intervals_) {
+    interval = Interval();
+  }
+  latest_index_ = 0;
+  total_count_ = 0;
+  counts_.clear();
+}
+
+uint64_t SlidingWindowHistogram::GetCount(uint64_t key) const {
+  auto it = counts_.find(key);
+  return it != counts_.end() ? it->second : 0;
+}
+
+void SlidingWindowHistogram::Expire(Interval* interval) {
+  for (const auto& key_count : interval->counts) {
+    auto it = counts_.find(key_count.first);
+    if (it == counts_.end()) continue;
+    it->second -= key_count.second;
+    if (it->second == 0) counts_.erase(it);
+  }
+  total_count_ -= interval->total_count;
+  interval->total_count = 0;
+  interval->counts.clear();
+}
@@ -0,0 +1,58 @@
+#ifndef ORBIT_CORE_SLIDING_WINDOW_HISTOGRAM_H_
+#define ORBIT_CORE_SLIDING_WINDOW_HISTOGRAM_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+
+// Counts of keys (e.g. callstack ids) over a sliding time window.
+//
+// The window is split into a fixed number of intervals, each holding the
+// counts of the keys added during that interval. The intervals are stored in
+// a ring: when time moves past the end of the window, the oldest intervals are
+// subtracted from the running totals and reused. Memory is therefore bounded
+// by the number of intervals and the number of distinct keys per interval,
+// regardless of how long samples keep coming in.
+//
+// The window ends at the interval of the most recent time passed to Add() or
+// AdvanceTo(), and times only ever move forward: samples older than the
+// window are dropped.
+class SlidingWindowHistogram {
+ public:
+  SlidingWindowHistogram(uint64_t window_duration, uint32_t num_intervals);
+
+  void Add(uint64_t time, uint64_t key, uint32_t count = 1);
+  void AdvanceTo(uint64_t time);
+  void Clear();
+
+  uint64_t GetWindowDuration() const {
+    return interval_duration_ * intervals_.size();
+  }
+  uint32_t GetNumIntervals() const {
+    return static_cast<uint32_t>(intervals_.size());
+  }
+  uint64_t GetTotalCount() const { return total_count_; }
+  uint64_t GetCount(uint64_t key) const;
+  // Keys with a non-zero count in the window.
+  const absl::flat_hash_map<uint64_t, uint64_t>& GetCounts() const {
+    return counts_;
+  }
+
+ private:
+  struct Interval {
+    uint64_t total_count = 0;
+    absl::flat_hash_map<uint64_t, uint32_t> counts;
+  };
+
+  void Expire(Interval* interval);
+
+  uint64_t interval_duration_;
+  std::vector<Interval> intervals_;
+  // Index of the most recent interval, i.e. time / interval_duration_.
+  uint64_t latest_index_ = 0;
+  uint64_t total_count_ = 0;
+  absl::flat_hash_map<uint64_t, uint64_t> counts_;
+};
+
+#endif  // ORBIT_CORE_SLIDING_WINDOW_HISTOGRAM_H_
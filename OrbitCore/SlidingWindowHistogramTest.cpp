@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include "SlidingWindowHistogram.h"
+
+TEST(SlidingWindowHistogram, CountsWithinWindow) {
+  // 10 intervals of 100 time units.
+  SlidingWindowHistogram histogram(1000, 10);
+  EXPECT_EQ(histogram.GetWindowDuration(), 1000);
+  EXPECT_EQ(histogram.GetNumIntervals(), 10);
+
+  histogram.Add(5000, 1);
+  histogram.Add(5050, 1);
+  histogram.Add(5100, 2, 3);
+  histogram.Add(5999, 3);
+
+  EXPECT_EQ(histogram.GetTotalCount(), 6);
+  EXPECT_EQ(histogram.GetCount(1), 2);
+  EXPECT_EQ(histogram.GetCount(2), 3);
+  EXPECT_EQ(histogram.GetCount(3), 1);
+  EXPECT_EQ(histogram.GetCount(4), 0);
+  EXPECT_EQ(histogram.GetCounts().size(), 3);
+}
+
+TEST(SlidingWindowHistogram, ExpiresOldIntervals) {
+  SlidingWindowHistogram histogram(1000, 10);
+  histogram.Add(5000, 1);
+  histogram.Add(5100, 2);
+  histogram.Add(5900, 3);
+
+  // The window now covers [5100, 6100).
+  histogram.AdvanceTo(6000);
+  EXPECT_EQ(histogram.GetCount(1), 0);
+  EXPECT_EQ(histogram.GetCount(2), 1);
+  EXPECT_EQ(histogram.GetTotalCount(), 2);
+  EXPECT_EQ(histogram.GetCounts().count(1), 0);
+
+  histogram.Add(6150, 3);
+  EXPECT_EQ(histogram.GetCount(2), 0);
+  EXPECT_EQ(histogram.GetCount(3), 2);
+
+  // Jumping ahead by more than a window expires everything.
+  histogram.AdvanceTo(100000);
+  EXPECT_EQ(histogram.GetTotalCount(), 0);
+  EXPECT_TRUE(histogram.GetCounts().empty());
+}
+
+TEST(SlidingWindowHistogram, ExpiresWithoutNewSamples) {
+  SlidingWindowHistogram histogram(1000, 10);
+  histogram.Add(5000, 1);
+  histogram.Add(5500, 2);
+
+  // Time passes, nothing is added.
+  histogram.AdvanceTo(5999);
+  EXPECT_EQ(histogram.GetTotalCount(), 2);
+  histogram.AdvanceTo(6200);
+  EXPECT_EQ(histogram.GetCount(1), 0);
+  EXPECT_EQ(histogram.GetCount(2), 1);
+  histogram.AdvanceTo(6600);
+  EXPECT_EQ(histogram.GetTotalCount(), 0);
+  EXPECT_TRUE(histogram.GetCounts().empty());
+
+  // Going back in time doesn't bring samples back, nor move the window.
+  histogram.AdvanceTo(5500);
+  EXPECT_EQ(histogram.GetTotalCount(), 0);
+  histogram.Add(5500, 2);
+  EXPECT_EQ(histogram.GetCount(2), 0);
+  histogram.Add(6600, 3);
+  EXPECT_EQ(histogram.GetCount(3), 1);
+}
+
+TEST(SlidingWindowHistogram, DropsSamplesOlderThanWindow) {
+  SlidingWindowHistogram histogram(1000, 10);
+  histogram.Add(10000, 1);
+  histogram.Add(8000, 2);
+  EXPECT_EQ(histogram.GetCount(2), 0);
+
+  // Late samples that still fall within the window are counted.
+  histogram.Add(9500, 2);
+  EXPECT_EQ(histogram.GetCount(2), 1);
+  EXPECT_EQ(histogram.GetTotalCount(), 2);
+}
+
+TEST(SlidingWindowHistogram, BoundedByWindow) {
+  SlidingWindowHistogram histogram(1000, 10);
+  for (uint64_t time = 0; time < 1000000; time += 10) {
+    histogram.Add(time, time % 7);
+  }
+  // 100 samples per window, spread over 7 keys.
+  EXPECT_EQ(histogram.GetTotalCount(), 100);
+  EXPECT_EQ(histogram.GetCounts().size(), 7);
+
+  histogram.Clear();
+  EXPECT_EQ(histogram.GetTotalCount(), 0);
+  histogram.Add(5, 1);
+  EXPECT_EQ(histogram.GetCount(1), 1);
+}
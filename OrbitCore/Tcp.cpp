@@ -171,12 +171,13 @@ void TcpConnection::ReadFooter() {
   asio::read(socket_, asio::buffer(&footer, 4));
   assert(footer == MAGIC_FOOT_MSG);
   num_bytes_received_ += 4;
-  DecodeMessage(message_);
+  DecodeMessage(message_, &payload_);
   ReadMessage();
 }
 
-void TcpConnection::DecodeMessage(Message& a_Message) {
+void TcpConnection::DecodeMessage(Message& a_Message,
+                                  std::vector<char>* a_Payload) {
   GTcpServer->GetServer()->RegisterConnection(
       this->shared_from_this());  // TODO:
-  GTcpServer->Receive(a_Message);
+  GTcpServer->Receive(a_Message, a_Payload);
 }
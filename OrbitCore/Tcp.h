@@ -37,7 +37,8 @@ class TcpConnection : public std::enable_shared_from_this<TcpConnection> {
   void ReadMessage();
   void ReadPayload();
   void ReadFooter();
-  void DecodeMessage(Message& message);
+  void DecodeMessage(Message& message,
+                     std::vector<char>* payload = nullptr);
 
   bool IsWebsocket() { return !web_socket_key_.empty(); }
   void ReadWebsocketHandshake();
@@ -121,11 +122,6 @@ class SharedConstBuffer {
     buffer_ = asio::buffer(*data_);
   }
 
-  explicit SharedConstBuffer(TcpPacket& packet) {
-    data_ = packet.Data();
-    buffer_ = asio::buffer(*data_);
-  }
-
   // Implement the ConstBufferSequence requirements.
   typedef asio::const_buffer value_type;
   typedef const asio::const_buffer* const_iterator;
@@ -70,6 +70,17 @@ void TcpClient::Connect(const std::string& a_Host) {
   m_IsValid = true;
 }
 
+//-----------------------------------------------------------------------------
+bool TcpClient::StartRecording(const std::string& a_Path) {
+  auto recorder = std::make_unique<MessageRecorder>();
+  if (!recorder->Open(a_Path)) {
+    PRINT("Could not open recording %s\n", a_Path.c_str());
+    return false;
+  }
+  m_Recorder = std::move(recorder);
+  return true;
+}
+
 //-----------------------------------------------------------------------------
 void TcpClient::Start() {
   TcpEntity::Start();
@@ -134,7 +145,7 @@ void TcpClient::ReadFooter() {
   unsigned int footer = 0;
   asio::read(*m_TcpSocket->m_Socket, asio::buffer(&footer, 4));
   assert(footer == MAGIC_FOOT_MSG);
-  DecodeMessage(m_Message);
+  DecodeMessage(m_Message, &m_Payload);
   ReadMessage();
 }
 
@@ -152,8 +163,18 @@ void TcpClient::OnError(const std::error_code& ec) {
 }
 
 //-----------------------------------------------------------------------------
-void TcpClient::DecodeMessage(Message& a_Message) {
-  Callback(a_Message);
+void TcpClient::DecodeMessage(Message& a_Message,
+                              std::vector<char>* a_Payload) {
+  if (DecompressBlock(a_Message,
+                      [this](Message& a_Packed) { DecodeMessage(a_Packed); })) {
+    return;
+  }
+
+  if (m_Recorder) {
+    m_Recorder->Record(a_Message);
+  }
+
+  Callback(a_Message, a_Payload);
 
 #ifdef _WIN32
   Message::Header MessageHeader = a_Message.GetHeader();
@@ -3,8 +3,11 @@
 //-----------------------------------
 #pragma once
 
+#include <memory>
+#include <string>
 #include <vector>
 
+#include "MessageRecording.h"
 #include "TcpEntity.h"
 
 class TcpClient : public TcpEntity {
@@ -16,18 +19,24 @@ class TcpClient : public TcpEntity {
   void Connect(const std::string& a_Host);
   void Start() override;
 
+  // Records the received messages to "a_Path", see MessageRecording.h. Call
+  // before Start(), the recording is closed with the client.
+  bool StartRecording(const std::string& a_Path);
+
  protected:
   void ClientThread();
   void ReadMessage();
   void ReadPayload();
   void ReadFooter();
-  void DecodeMessage(Message& a_Message);
+  void DecodeMessage(Message& a_Message,
+                     std::vector<char>* a_Payload = nullptr);
   void OnError(const std::error_code& ec);
   virtual TcpSocket* GetSocket() override final { return m_TcpSocket; }
 
  private:
   Message m_Message;
   std::vector<char> m_Payload;
+  std::unique_ptr<MessageRecorder> m_Recorder;
 };
 
 extern std::unique_ptr<TcpClient> GTcpClient;
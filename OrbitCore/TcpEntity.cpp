@@ -8,16 +8,83 @@
 
 #include "TcpEntity.h"
 
+#include <algorithm>
+#include <chrono>
+
 #include "Core.h"
 #include "Log.h"
+#include "Lz4Block.h"
 #include "Tcp.h"
 
+//-----------------------------------------------------------------------------
+TcpPacketPool::~TcpPacketPool() {
+  std::vector<char>* buffer = nullptr;
+  while (m_FreeBuffers.try_dequeue(buffer)) {
+    delete buffer;
+  }
+}
+
+//-----------------------------------------------------------------------------
+TcpPacketPool::Buffer TcpPacketPool::Get(size_t a_Size) {
+  std::vector<char>* buffer = nullptr;
+  if (m_FreeBuffers.try_dequeue(buffer)) {
+    --m_NumFreeBuffers;
+  } else {
+    buffer = new std::vector<char>();
+    ++m_NumAllocations;
+  }
+
+  buffer->resize(a_Size);
+  return Buffer(buffer, Releaser{this});
+}
+
+//-----------------------------------------------------------------------------
+void TcpPacketPool::Release(std::vector<char>* a_Buffer) {
+  if (a_Buffer->capacity() > kMaxPooledBufferSize ||
+      m_NumFreeBuffers >= kMaxNumFreeBuffers) {
+    delete a_Buffer;
+    return;
+  }
+
+  ++m_NumFreeBuffers;
+  m_FreeBuffers.enqueue(a_Buffer);
+}
+
+//-----------------------------------------------------------------------------
+void TcpPacketPool::Releaser::operator()(std::vector<char>* a_Buffer) const {
+  if (m_Pool) {
+    m_Pool->Release(a_Buffer);
+  } else {
+    delete a_Buffer;
+  }
+}
+
 //-----------------------------------------------------------------------------
 TcpEntity::TcpEntity()
     : m_NumQueuedEntries(0),
       m_ExitRequested(false),
       m_FlushRequested(false),
-      m_NumFlushedItems(0) {
+      m_NumFlushedItems(0),
+      m_MaxSendBatchBytes(kDefaultMaxSendBatchBytes),
+      m_NumSentPackets(0),
+      m_NumSentBytes(0),
+      m_NumWrites(0),
+      m_NumAdoptedPayloads(0),
+      m_NumCopiedPayloads(0),
+      m_CompressionEnabled(false),
+      m_NumCompressionInputBytes(0),
+      m_NumCompressionOutputBytes(0),
+      m_NumCompressedBlocks(0),
+      m_NumDecompressedBlocks(0),
+      m_CompressionNanoseconds(0),
+      m_SendQueuePolicy(DropOldestSamples),
+      m_MaxQueuedBytes(kDefaultMaxQueuedBytes),
+      m_NumQueuedBytes(0),
+      m_NumDroppedPackets(0),
+      m_NumDroppedBytes(0),
+      m_NumBlockedSends(0),
+      m_NumSampleMessages(0),
+      m_NumRecycledPayloads(0) {
   PRINT_FUNC;
   m_IsValid = false;
   m_TcpSocket = new TcpSocket();
@@ -40,6 +107,7 @@ void TcpEntity::Stop() {
   m_ExitRequested = true;
 
   m_ConditionVariable.signal();
+  ReleaseQueueSpace(0);
   if (m_SenderThread != nullptr) {
     m_SenderThread->join();
   }
@@ -56,12 +124,109 @@ void TcpEntity::Stop() {
 
 //-----------------------------------------------------------------------------
 void TcpEntity::SendMsg(Message& a_Message, const void* a_Payload) {
-  TcpPacket buffer(a_Message, a_Payload);
-  m_SendQueue.enqueue(buffer);
+  bool isSample = IsSampleMessage(a_Message.GetType());
+  size_t numBytes = sizeof(Message) + a_Message.m_Size + 4;
+  if (!ReserveQueueSpace(numBytes, isSample)) {
+    ++m_NumDroppedPackets;
+    m_NumDroppedBytes += numBytes;
+    return;
+  }
+
+  LockFreeQueue<TcpPacket>& queue = isSample ? m_SampleQueue : m_SendQueue;
+  queue.enqueue(TcpPacket(a_Message, a_Payload, &m_PacketPool));
   ++m_NumQueuedEntries;
   m_ConditionVariable.signal();
 }
 
+//-----------------------------------------------------------------------------
+bool TcpEntity::IsSampleMessage(MessageType a_Type) {
+  return a_Type == Msg_SamplingCallstack || a_Type == Msg_SamplingCallstacks ||
+         a_Type == Msg_SamplingHashedCallstacks;
+}
+
+//-----------------------------------------------------------------------------
+uint32_t TcpEntity::GetSampleDivisor() const {
+  if (m_SendQueuePolicy != ReduceSampling) return 1;
+
+  // Halve the sampling rate for each eighth of the limit above the half.
+  uint64_t queuedBytes = m_NumQueuedBytes;
+  uint64_t maxBytes = m_MaxQueuedBytes;
+  if (queuedBytes * 2 < maxBytes) return 1;
+  uint64_t eighths = (queuedBytes * 8 - maxBytes * 4) / maxBytes;
+  return static_cast<uint32_t>(std::min<uint64_t>(
+      uint64_t{2} << std::min<uint64_t>(eighths, 16), kMaxSampleDivisor));
+}
+
+//-----------------------------------------------------------------------------
+bool TcpEntity::FitsInQueue(size_t a_NumBytes) const {
+  uint64_t queuedBytes = m_NumQueuedBytes;
+  return queuedBytes == 0 || queuedBytes + a_NumBytes <= m_MaxQueuedBytes;
+}
+
+//-----------------------------------------------------------------------------
+bool TcpEntity::ReserveQueueSpace(size_t a_NumBytes, bool a_IsSample) {
+  SendQueuePolicy policy = m_SendQueuePolicy;
+  if (a_IsSample && policy == ReduceSampling &&
+      m_NumSampleMessages++ % GetSampleDivisor() != 0) {
+    return false;
+  }
+
+  if (!FitsInQueue(a_NumBytes) && policy == DropOldestSamples) {
+    DropQueuedSamples(a_NumBytes);
+  }
+  if (!FitsInQueue(a_NumBytes)) {
+    if (a_IsSample && policy != BlockSender) return false;
+    if (!WaitForQueueSpace(a_NumBytes)) return false;
+  }
+
+  m_NumQueuedBytes += a_NumBytes;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void TcpEntity::DropQueuedSamples(size_t a_NumBytes) {
+  TcpPacket packet;
+  while (!FitsInQueue(a_NumBytes) && m_SampleQueue.try_dequeue(packet)) {
+    size_t numBytes = packet.Size();
+    packet = TcpPacket();
+    --m_NumQueuedEntries;
+    m_NumQueuedBytes -= numBytes;
+    ++m_NumDroppedPackets;
+    m_NumDroppedBytes += numBytes;
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool TcpEntity::WaitForQueueSpace(size_t a_NumBytes) {
+  ++m_NumBlockedSends;
+  std::unique_lock<std::mutex> lock(m_QueueSpaceMutex);
+  while (!FitsInQueue(a_NumBytes)) {
+    // Nothing is sent while disconnected, which isn't notified.
+    if (!m_IsValid || m_ExitRequested) return false;
+    m_QueueSpaceCondition.wait_for(lock, std::chrono::milliseconds(100));
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void TcpEntity::ReleaseQueueSpace(size_t a_NumBytes) {
+  m_NumQueuedBytes -= a_NumBytes;
+  // Taking the lock orders this with the check of waiting senders.
+  { std::lock_guard<std::mutex> lock(m_QueueSpaceMutex); }
+  m_QueueSpaceCondition.notify_all();
+}
+
+//-----------------------------------------------------------------------------
+// Gives the buffers of the packets back to the pool, returns their size.
+static size_t ReleasePackets(TcpPacket* a_Packets, size_t a_NumPackets) {
+  size_t numBytes = 0;
+  for (size_t i = 0; i < a_NumPackets; ++i) {
+    numBytes += a_Packets[i].Size();
+    a_Packets[i] = TcpPacket();
+  }
+  return numBytes;
+}
+
 //-----------------------------------------------------------------------------
 void TcpEntity::FlushSendQueue() {
   m_FlushRequested = true;
@@ -70,23 +235,124 @@ void TcpEntity::FlushSendQueue() {
   TcpPacket Timers[numItems];
   m_NumFlushedItems = 0;
 
-  while (!m_ExitRequested) {
-    size_t numDequeued = m_SendQueue.try_dequeue_bulk(Timers, numItems);
+  for (LockFreeQueue<TcpPacket>* queue : {&m_SendQueue, &m_SampleQueue}) {
+    while (!m_ExitRequested) {
+      size_t numDequeued = queue->try_dequeue_bulk(Timers, numItems);
 
-    if (numDequeued == 0) break;
+      if (numDequeued == 0) break;
 
-    m_NumQueuedEntries -= (int)numDequeued;
-    m_NumFlushedItems += (int)numDequeued;
+      m_NumQueuedEntries -= (int)numDequeued;
+      m_NumFlushedItems += (int)numDequeued;
+      ReleaseQueueSpace(ReleasePackets(Timers, numDequeued));
+    }
   }
 
   m_FlushRequested = false;
   m_ConditionVariable.signal();
 }
 
+//-----------------------------------------------------------------------------
+struct SendStats {
+  uint64_t m_NumBytes = 0;
+  uint64_t m_NumWrites = 0;
+  uint64_t m_NumCompressionInputBytes = 0;
+  uint64_t m_NumCompressionOutputBytes = 0;
+  uint64_t m_NumCompressedBlocks = 0;
+  uint64_t m_CompressionNanoseconds = 0;
+};
+
+//-----------------------------------------------------------------------------
+// Scratch buffers of the sender thread, reused from batch to batch.
+struct SendBuffers {
+  std::vector<asio::const_buffer> m_Buffers;
+  std::vector<char> m_Block;
+  std::vector<char> m_CompressedPacket;
+};
+
+//-----------------------------------------------------------------------------
+// Compresses "a_NumBytes" bytes of packets into a Msg_CompressedBlock packet.
+// Returns false if that packet wouldn't be smaller than the packets.
+static bool CompressPackets(const TcpPacket* a_Packets, size_t a_NumPackets,
+                            size_t a_NumBytes, SendBuffers& a_Buffers) {
+  std::vector<char>& block = a_Buffers.m_Block;
+  block.resize(a_NumBytes);
+  size_t offset = 0;
+  for (size_t i = 0; i < a_NumPackets; ++i) {
+    const std::vector<char>& data = *a_Packets[i].Data();
+    memcpy(block.data() + offset, data.data(), data.size());
+    offset += data.size();
+  }
+
+  std::vector<char>& packet = a_Buffers.m_CompressedPacket;
+  packet.resize(sizeof(Message) + Lz4GetMaxCompressedSize(a_NumBytes) + 4);
+  size_t compressedSize =
+      Lz4Compress(block.data(), a_NumBytes, packet.data() + sizeof(Message));
+  size_t packetSize = sizeof(Message) + compressedSize + 4;
+  if (packetSize >= a_NumBytes) return false;
+
+  Message message(Msg_CompressedBlock, (uint32_t)compressedSize);
+  message.m_Header.m_GenericHeader.m_Address = a_NumBytes;
+  memcpy(packet.data(), &message, sizeof(Message));
+  const unsigned int footer = MAGIC_FOOT_MSG;
+  memcpy(packet.data() + sizeof(Message) + compressedSize, &footer, 4);
+  packet.resize(packetSize);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+static SendStats SendPackets(tcp::socket& a_Socket, const TcpPacket* a_Packets,
+                             size_t a_NumPackets, size_t a_MaxBatchBytes,
+                             bool a_Compress, SendBuffers& a_Buffers) {
+  SendStats stats;
+  size_t index = 0;
+  while (index < a_NumPackets) {
+    // Gather as many packets as the byte budget allows, but at least one.
+    std::vector<asio::const_buffer>& buffers = a_Buffers.m_Buffers;
+    buffers.clear();
+    size_t first = index;
+    size_t numBytes = 0;
+    do {
+      const std::vector<char>& data = *a_Packets[index].Data();
+      buffers.push_back(asio::buffer(data));
+      numBytes += data.size();
+      ++index;
+    } while (index < a_NumPackets &&
+             numBytes + a_Packets[index].Size() <= a_MaxBatchBytes);
+
+    if (a_Compress && numBytes <= TcpEntity::kMaxCompressedBlockBytes) {
+      auto start = std::chrono::steady_clock::now();
+      bool compressed = CompressPackets(a_Packets + first, index - first,
+                                        numBytes, a_Buffers);
+      stats.m_CompressionNanoseconds +=
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - start)
+              .count();
+      stats.m_NumCompressionInputBytes += numBytes;
+
+      if (compressed) {
+        buffers.clear();
+        buffers.push_back(asio::buffer(a_Buffers.m_CompressedPacket));
+        numBytes = a_Buffers.m_CompressedPacket.size();
+        ++stats.m_NumCompressedBlocks;
+      }
+      stats.m_NumCompressionOutputBytes += numBytes;
+    }
+
+    asio::write(a_Socket, buffers);
+    stats.m_NumBytes += numBytes;
+    ++stats.m_NumWrites;
+  }
+  return stats;
+}
+
 //-----------------------------------------------------------------------------
 void TcpEntity::SendData() {
   SetCurrentThreadName(L"TcpSender");
 
+  std::vector<TcpPacket> packets(kMaxSendBatchPackets);
+  SendBuffers buffers;
+  buffers.m_Buffers.reserve(kMaxSendBatchPackets);
+
   while (!m_ExitRequested) {
     // Wait for non-empty queue
     while ((!m_IsValid || m_NumQueuedEntries <= 0) && !m_ExitRequested) {
@@ -94,49 +360,160 @@ void TcpEntity::SendData() {
     }
 
     // Send messages
-    TcpPacket buffer;
-    while (m_IsValid && !m_ExitRequested && !m_FlushRequested &&
-           m_SendQueue.try_dequeue(buffer)) {
-      --m_NumQueuedEntries;
+    while (m_IsValid && !m_ExitRequested && !m_FlushRequested) {
+      // Sampling messages take up to half of a batch first, so that other
+      // messages don't starve them.
+      size_t numDequeued =
+          m_SampleQueue.try_dequeue_bulk(packets.begin(), packets.size() / 2);
+      numDequeued += m_SendQueue.try_dequeue_bulk(
+          packets.begin() + numDequeued, packets.size() - numDequeued);
+      numDequeued += m_SampleQueue.try_dequeue_bulk(
+          packets.begin() + numDequeued, packets.size() - numDequeued);
+      if (numDequeued == 0) break;
+      m_NumQueuedEntries -= (uint32_t)numDequeued;
+
       TcpSocket* socket = GetSocket();
       if (socket && socket->m_Socket && socket->m_Socket->is_open()) {
-        asio::write(*socket->m_Socket, SharedConstBuffer(buffer));
+        SendStats stats = SendPackets(*socket->m_Socket, packets.data(),
+                                      numDequeued, m_MaxSendBatchBytes,
+                                      m_CompressionEnabled, buffers);
+        m_NumSentPackets += numDequeued;
+        m_NumSentBytes += stats.m_NumBytes;
+        m_NumWrites += stats.m_NumWrites;
+        m_NumCompressionInputBytes += stats.m_NumCompressionInputBytes;
+        m_NumCompressionOutputBytes += stats.m_NumCompressionOutputBytes;
+        m_NumCompressedBlocks += stats.m_NumCompressedBlocks;
+        m_CompressionNanoseconds += stats.m_CompressionNanoseconds;
       } else {
         ORBIT_ERROR;
       }
+
+      ReleaseQueueSpace(ReleasePackets(packets.data(), numDequeued));
     }
   }
 }
 
 //-----------------------------------------------------------------------------
-void TcpEntity::Callback(const Message& a_Message) {
+double TcpEntity::GetCompressionRatio() const {
+  uint64_t outputBytes = m_NumCompressionOutputBytes;
+  return outputBytes > 0
+             ? static_cast<double>(m_NumCompressionInputBytes) / outputBytes
+             : 1.0;
+}
+
+//-----------------------------------------------------------------------------
+double TcpEntity::GetCompressionThroughput() const {
+  uint64_t nanoseconds = m_CompressionNanoseconds;
+  return nanoseconds > 0
+             ? m_NumCompressionInputBytes * 1000000000.0 / nanoseconds
+             : 0.0;
+}
+
+//-----------------------------------------------------------------------------
+bool TcpEntity::DecompressBlock(
+    const Message& a_Message, const std::function<void(Message&)>& a_Callback) {
+  if (a_Message.GetType() != Msg_CompressedBlock) return false;
+
+  uint64_t blockSize = a_Message.GetHeader().m_GenericHeader.m_Address;
+  if (blockSize > kMaxCompressedBlockBytes) {
+    PRINT("Dropping compressed block of %llu bytes\n",
+          (unsigned long long)blockSize);
+    return true;
+  }
+  m_DecompressedBlock.resize(blockSize);
+  char* block = m_DecompressedBlock.data();
+  if (!Lz4Decompress(a_Message.GetData(), a_Message.m_Size, block,
+                     blockSize)) {
+    PRINT("Dropping malformed compressed block\n");
+    return true;
+  }
+  ++m_NumDecompressedBlocks;
+
+  // Same layout as on the socket: header, payload and footer of each packet.
+  size_t offset = 0;
+  while (offset < blockSize) {
+    Message message;
+    if (blockSize - offset < sizeof(Message) + 4) break;
+    memcpy(&message, block + offset, sizeof(Message));
+    offset += sizeof(Message);
+    if (message.m_Size > blockSize - offset - 4 ||
+        message.GetType() == Msg_CompressedBlock) {
+      break;
+    }
+    message.m_Data = message.m_Size > 0 ? block + offset : nullptr;
+    offset += message.m_Size;
+
+    unsigned int footer = 0;
+    memcpy(&footer, block + offset, 4);
+    if (footer != MAGIC_FOOT_MSG) break;
+    offset += 4;
+
+    a_Callback(message);
+  }
+
+  if (offset != blockSize) {
+    PRINT("Malformed packet in compressed block\n");
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void TcpEntity::Callback(const Message& a_Message,
+                         std::vector<char>* a_Payload) {
   MessageType type = a_Message.GetType();
+  if (!IsValidType(type)) return;
+
   // Non main thread
-  std::vector<MsgCallback>& callbacks = m_Callbacks[type];
-  for (MsgCallback& callback : callbacks) {
+  for (MsgCallback& callback : m_Callbacks[type]) {
     callback(a_Message);
   }
 
   // Main thread callbacks
-  ScopeLock lock(m_Mutex);
-  const auto& pair = m_MainThreadCallbacks.find(type);
-  if (pair != m_MainThreadCallbacks.end()) {
-    std::shared_ptr<MessageOwner> messageOwner =
-        std::make_shared<MessageOwner>(a_Message);
-    m_MainThreadMessages.push_back(messageOwner);
+  if (m_MainThreadCallbacks[type].empty()) return;
+  MainThreadMessage message;
+  message.m_Message = a_Message;
+  if (m_RecycledPayloads.try_dequeue(message.m_Payload)) {
+    --m_NumRecycledPayloads;
+  }
+
+  if (a_Payload != nullptr && a_Message.m_Size > 0 &&
+      a_Message.GetData() == a_Payload->data()) {
+    message.m_Payload.swap(*a_Payload);
+    ++m_NumAdoptedPayloads;
+  } else {
+    message.m_Payload.assign(a_Message.GetData(),
+                             a_Message.GetData() + a_Message.m_Size);
+    if (a_Message.m_Size > 0) ++m_NumCopiedPayloads;
   }
+  m_MainThreadMessages.enqueue(std::move(message));
 }
 
 //-----------------------------------------------------------------------------
 void TcpEntity::ProcessMainThreadCallbacks() {
-  ScopeLock lock(m_Mutex);
-  for (auto& message : m_MainThreadMessages) {
-    std::vector<MsgCallback>& callbacks =
-        m_MainThreadCallbacks[message->GetType()];
-    for (MsgCallback& callback : callbacks) {
-      callback(*message);
+  // Messages received meanwhile wait for the next call, so that a busy
+  // receiving thread can't keep the main thread here.
+  size_t numMessages = m_MainThreadMessages.size_approx();
+  while (numMessages > 0) {
+    m_DispatchedMessages.resize(std::min(numMessages, kMaxMainThreadBatch));
+    size_t numDequeued = m_MainThreadMessages.try_dequeue_bulk(
+        m_DispatchedMessages.begin(), m_DispatchedMessages.size());
+    if (numDequeued == 0) break;
+    numMessages -= std::min(numMessages, numDequeued);
+
+    for (size_t i = 0; i < numDequeued; ++i) {
+      MainThreadMessage& message = m_DispatchedMessages[i];
+      message.m_Message.m_Data = message.m_Payload.data();
+      for (MsgCallback& callback :
+           m_MainThreadCallbacks[message.m_Message.GetType()]) {
+        callback(message.m_Message);
+      }
+
+      if (message.m_Payload.capacity() > 0 &&
+          m_NumRecycledPayloads < kMaxRecycledPayloads) {
+        ++m_NumRecycledPayloads;
+        m_RecycledPayloads.enqueue(std::move(message.m_Payload));
+      }
+      message.m_Payload = std::vector<char>();
     }
   }
-
-  m_MainThreadMessages.clear();
 }
@@ -3,7 +3,11 @@
 //-----------------------------------
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <type_traits>
 #include <unordered_map>
 #include <vector>
@@ -15,12 +19,47 @@
 #include "Utils.h"
 
 //-----------------------------------------------------------------------------
+// Recycles packet buffers so that queuing a message doesn't allocate once the
+// pool is warm. Buffers are returned to the pool when their packet is
+// destroyed. Oversized buffers and buffers in excess of kMaxNumFreeBuffers
+// are freed instead, which bounds the memory held by the pool.
+class TcpPacketPool {
+ public:
+  TcpPacketPool() : m_NumFreeBuffers(0), m_NumAllocations(0) {}
+  ~TcpPacketPool();
+
+  struct Releaser {
+    TcpPacketPool* m_Pool = nullptr;
+    void operator()(std::vector<char>* a_Buffer) const;
+  };
+  typedef std::unique_ptr<std::vector<char>, Releaser> Buffer;
+
+  Buffer Get(size_t a_Size);
+  uint32_t GetNumFreeBuffers() const { return m_NumFreeBuffers; }
+  uint64_t GetNumAllocations() const { return m_NumAllocations; }
+
+  static const uint32_t kMaxNumFreeBuffers = 4096;
+  static const size_t kMaxPooledBufferSize = 64 * 1024;
+
+ private:
+  void Release(std::vector<char>* a_Buffer);
+
+  LockFreeQueue<std::vector<char>*> m_FreeBuffers;
+  std::atomic<uint32_t> m_NumFreeBuffers;
+  std::atomic<uint64_t> m_NumAllocations;
+};
+
+//-----------------------------------------------------------------------------
+// Header, payload and footer of a message, ready to be written to a socket.
+// Packets are move-only, their buffer goes back to its pool on destruction.
 class TcpPacket {
  public:
   TcpPacket() {}
-  explicit TcpPacket(const Message& a_Message, const void* a_Payload)
-      : m_Data(new std::vector<char>()) {
-    m_Data->resize(sizeof(Message) + a_Message.m_Size + 4);
+  explicit TcpPacket(const Message& a_Message, const void* a_Payload,
+                     TcpPacketPool* a_Pool = nullptr) {
+    size_t size = sizeof(Message) + a_Message.m_Size + 4;
+    m_Data = a_Pool ? a_Pool->Get(size)
+                    : TcpPacketPool::Buffer(new std::vector<char>(size));
     memcpy(m_Data->data(), &a_Message, sizeof(Message));
 
     if (a_Payload) {
@@ -38,10 +77,11 @@ class TcpPacket {
     PrintBuffer(m_Data->data(), (uint32_t)m_Data->size());
   }
 
-  std::shared_ptr<std::vector<char>> Data() { return m_Data; };
+  const std::vector<char>* Data() const { return m_Data.get(); }
+  size_t Size() const { return m_Data ? m_Data->size() : 0; }
 
  private:
-  std::shared_ptr<std::vector<char>> m_Data;
+  TcpPacketPool::Buffer m_Data;
 };
 
 //-----------------------------------------------------------------------------
@@ -76,38 +116,175 @@ class TcpEntity {
   void Send(MessageType a_Type, const T& a_Item);
   inline void Send(MessageType a_Type, const std::string& a_Item);
 
+  // Callbacks are registered before messages are received, registering
+  // isn't synchronized with dispatching.
   typedef std::function<void(const Message&)> MsgCallback;
   void AddCallback(MessageType a_MsgType, MsgCallback a_Callback) {
-    m_Callbacks[a_MsgType].push_back(a_Callback);
+    if (IsValidType(a_MsgType)) m_Callbacks[a_MsgType].push_back(a_Callback);
   }
   void AddMainThreadCallback(MessageType a_MsgType, MsgCallback a_Callback) {
-    m_MainThreadCallbacks[a_MsgType].push_back(a_Callback);
+    if (IsValidType(a_MsgType)) {
+      m_MainThreadCallbacks[a_MsgType].push_back(a_Callback);
+    }
   }
-  void Callback(const Message& a_Message);
+  // Callbacks get a view of the message data. "a_Payload", if not null, is
+  // the receive buffer holding that data: a message queued for main thread
+  // callbacks then takes the buffer over instead of copying it, and the
+  // caller gets a recycled buffer in exchange. Messages are handed to the
+  // main thread through a lock-free queue, the receiving thread never waits
+  // for main thread callbacks.
+  void Callback(const Message& a_Message,
+                std::vector<char>* a_Payload = nullptr);
+  // Runs the main thread callbacks of the messages queued so far.
   void ProcessMainThreadCallbacks();
+  static bool IsValidType(MessageType a_Type) {
+    return a_Type >= 0 && a_Type < Msg_NumMessageTypes;
+  }
   bool IsValid() const { return m_IsValid; }
 
+  // Queued packets are coalesced into a single vectored write of up to
+  // "a_NumBytes" bytes. A packet larger than that is written on its own.
+  void SetMaxSendBatchBytes(size_t a_NumBytes) {
+    m_MaxSendBatchBytes = a_NumBytes;
+  }
+  uint64_t GetNumSentPackets() const { return m_NumSentPackets; }
+  uint64_t GetNumSentBytes() const { return m_NumSentBytes; }
+  uint64_t GetNumWrites() const { return m_NumWrites; }
+  const TcpPacketPool& GetPacketPool() const { return m_PacketPool; }
+  uint64_t GetNumAdoptedPayloads() const { return m_NumAdoptedPayloads; }
+  uint64_t GetNumCopiedPayloads() const { return m_NumCopiedPayloads; }
+
+  // What Send() does when a message doesn't fit in the send queue, whose
+  // size is bounded by SetMaxQueuedBytes(). Sampling messages, see
+  // IsSampleMessage(), are queued separately from other messages.
+  enum SendQueuePolicy {
+    // Wait until enough queued data was sent.
+    BlockSender,
+    // Drop queued sampling messages, oldest first, to make room. Sampling
+    // messages are dropped if that isn't enough, other messages wait.
+    DropOldestSamples,
+    // Past half the limit, only queue one in GetSampleDivisor() sampling
+    // messages. Over the limit, drop sampling messages and wait with others.
+    ReduceSampling,
+  };
+  void SetSendQueuePolicy(SendQueuePolicy a_Policy) {
+    m_SendQueuePolicy = a_Policy;
+  }
+  // The bound is approximate, concurrent senders can exceed it by a message
+  // each. A message larger than the bound is queued once the queue is empty.
+  // Senders don't wait while disconnected, their messages are dropped. A
+  // bound of 0 is taken as 1 byte, one message is queued at a time.
+  void SetMaxQueuedBytes(size_t a_NumBytes) {
+    m_MaxQueuedBytes = std::max<size_t>(a_NumBytes, 1);
+  }
+  uint64_t GetNumQueuedBytes() const { return m_NumQueuedBytes; }
+  uint64_t GetNumDroppedPackets() const { return m_NumDroppedPackets; }
+  uint64_t GetNumDroppedBytes() const { return m_NumDroppedBytes; }
+  uint64_t GetNumBlockedSends() const { return m_NumBlockedSends; }
+  // 1 unless the ReduceSampling policy thins sampling messages. The service
+  // also only keeps one in that many samples, see OrbitApp.
+  uint32_t GetSampleDivisor() const;
+  static bool IsSampleMessage(MessageType a_Type);
+
+  // Each batch of queued packets is then LZ4 compressed into a single
+  // Msg_CompressedBlock message, unless that doesn't make it smaller. The
+  // block's generic header holds the uncompressed size. Compression is
+  // negotiated per connection, receivers always accept compressed blocks.
+  void SetCompressionEnabled(bool a_Enabled) {
+    m_CompressionEnabled = a_Enabled;
+  }
+  bool IsCompressionEnabled() const { return m_CompressionEnabled; }
+  // Bytes of the batches given to the compressor, and bytes written for them.
+  uint64_t GetNumCompressionInputBytes() const {
+    return m_NumCompressionInputBytes;
+  }
+  uint64_t GetNumCompressionOutputBytes() const {
+    return m_NumCompressionOutputBytes;
+  }
+  uint64_t GetNumCompressedBlocks() const { return m_NumCompressedBlocks; }
+  uint64_t GetNumDecompressedBlocks() const { return m_NumDecompressedBlocks; }
+  double GetCompressionRatio() const;
+  // Input bytes per second spent compressing.
+  double GetCompressionThroughput() const;
+
+  // Calls "a_Callback" for each message packed in "a_Message", if it is a
+  // Msg_CompressedBlock message, and returns false otherwise. Malformed
+  // blocks are dropped. Only called from the receiving thread.
+  bool DecompressBlock(const Message& a_Message,
+                       const std::function<void(Message&)>& a_Callback);
+
+  static const size_t kDefaultMaxSendBatchBytes = 1024 * 1024;
+  static const size_t kMaxSendBatchPackets = 1024;
+  static const uint32_t kMaxRecycledPayloads = 16;
+  static const size_t kMaxMainThreadBatch = 256;
+  static const size_t kMaxCompressedBlockBytes = 64 * 1024 * 1024;
+  static const size_t kDefaultMaxQueuedBytes = 256 * 1024 * 1024;
+  static const uint32_t kMaxSampleDivisor = 16;
+
  protected:
   void SendMsg(Message& a_Message, const void* a_Payload);
   virtual TcpSocket* GetSocket() = 0;
   void SendData();
+  bool ReserveQueueSpace(size_t a_NumBytes, bool a_IsSample);
+  bool FitsInQueue(size_t a_NumBytes) const;
+  void DropQueuedSamples(size_t a_NumBytes);
+  bool WaitForQueueSpace(size_t a_NumBytes);
+  void ReleaseQueueSpace(size_t a_NumBytes);
 
  protected:
   TcpService* m_TcpService;
   TcpSocket* m_TcpSocket;
   std::thread* m_SenderThread = nullptr;
   AutoResetEvent m_ConditionVariable;
+  // Declared before the queue, the pool must outlive the queued packets.
+  TcpPacketPool m_PacketPool;
   LockFreeQueue<TcpPacket> m_SendQueue;
+  LockFreeQueue<TcpPacket> m_SampleQueue;
   std::atomic<uint32_t> m_NumQueuedEntries;
   std::atomic<bool> m_ExitRequested;
   std::atomic<bool> m_FlushRequested;
   std::atomic<uint32_t> m_NumFlushedItems;
-  Mutex m_Mutex;
   std::atomic<bool> m_IsValid;
-
-  std::unordered_map<int, std::vector<MsgCallback>> m_Callbacks;
-  std::unordered_map<int, std::vector<MsgCallback>> m_MainThreadCallbacks;
-  std::vector<std::shared_ptr<MessageOwner>> m_MainThreadMessages;
+  std::atomic<size_t> m_MaxSendBatchBytes;
+  std::atomic<uint64_t> m_NumSentPackets;
+  std::atomic<uint64_t> m_NumSentBytes;
+  std::atomic<uint64_t> m_NumWrites;
+  std::atomic<uint64_t> m_NumAdoptedPayloads;
+  std::atomic<uint64_t> m_NumCopiedPayloads;
+  std::atomic<bool> m_CompressionEnabled;
+  std::atomic<uint64_t> m_NumCompressionInputBytes;
+  std::atomic<uint64_t> m_NumCompressionOutputBytes;
+  std::atomic<uint64_t> m_NumCompressedBlocks;
+  std::atomic<uint64_t> m_NumDecompressedBlocks;
+  std::atomic<uint64_t> m_CompressionNanoseconds;
+  std::atomic<SendQueuePolicy> m_SendQueuePolicy;
+  std::atomic<size_t> m_MaxQueuedBytes;
+  std::atomic<uint64_t> m_NumQueuedBytes;
+  std::atomic<uint64_t> m_NumDroppedPackets;
+  std::atomic<uint64_t> m_NumDroppedBytes;
+  std::atomic<uint64_t> m_NumBlockedSends;
+  std::atomic<uint64_t> m_NumSampleMessages;
+  // Senders waiting for queue space are notified after each sent batch.
+  std::mutex m_QueueSpaceMutex;
+  ConditionVariable m_QueueSpaceCondition;
+
+  // Dispatch tables, indexed by message type.
+  std::vector<MsgCallback> m_Callbacks[Msg_NumMessageTypes];
+  std::vector<MsgCallback> m_MainThreadCallbacks[Msg_NumMessageTypes];
+
+  // A message waiting for main thread callbacks, which owns its data.
+  struct MainThreadMessage {
+    Message m_Message;
+    std::vector<char> m_Payload;
+  };
+  LockFreeQueue<MainThreadMessage> m_MainThreadMessages;
+  // Messages taken from the queue by ProcessMainThreadCallbacks().
+  std::vector<MainThreadMessage> m_DispatchedMessages;
+  // Payload buffers of processed main thread messages, handed back to the
+  // receiving thread for reuse.
+  LockFreeQueue<std::vector<char>> m_RecycledPayloads;
+  std::atomic<uint32_t> m_NumRecycledPayloads;
+  std::vector<char> m_DecompressedBlock;
 };
 
 //-----------------------------------------------------------------------------
@@ -0,0 +1,103 @@
+// Timing runs of the TcpEntity send path over a loopback connection. They
+// are in OrbitCoreBenchmarks, which ctest doesn't run; correctness is
+// checked by TcpEntityTest.cpp.
+
+// clang-format off
+#include "OrbitAsio.h"
+// clang-format on
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "Message.h"
+#include "TcpEntity.h"
+#include "TcpEntityTestFixture.h"
+
+TEST_F(TcpEntityTest, LoopbackThroughput) {
+  constexpr uint32_t kNumMessages = 200000;
+  constexpr uint32_t kPayloadSize = 64;
+  const size_t num_bytes = kNumMessages * GetPacketSize(kPayloadSize);
+
+  LoopbackSender sender(&client_);
+  StartReceiving(num_bytes);
+  sender.Start();
+
+  auto start = std::chrono::steady_clock::now();
+  char payload[kPayloadSize] = {};
+  for (uint32_t i = 0; i < kNumMessages; ++i) {
+    sender.Send(Msg_String, payload, kPayloadSize);
+  }
+  WaitForReceiver();
+  std::chrono::duration<double> seconds =
+      std::chrono::steady_clock::now() - start;
+  sender.Stop();
+
+  EXPECT_EQ(sender.GetNumSentPackets(), kNumMessages);
+  EXPECT_EQ(sender.GetNumSentBytes(), num_bytes);
+  EXPECT_LE(sender.GetNumWrites(), kNumMessages);
+
+  std::cout << kNumMessages / seconds.count() << " messages/s, "
+            << num_bytes / seconds.count() / (1024 * 1024) << " MB/s, "
+            << static_cast<double>(kNumMessages) / sender.GetNumWrites()
+            << " messages per write, "
+            << sender.GetPacketPool().GetNumAllocations()
+            << " buffer allocations" << std::endl;
+}
+
+TEST_F(TcpEntityTest, CompressedLoopbackThroughput) {
+  constexpr uint32_t kNumMessages = 200000;
+  std::vector<std::vector<char>> payloads;
+  std::vector<char> expected;
+  for (uint32_t i = 0; i < kNumMessages; ++i) {
+    payloads.push_back(CreateCapturePayload(i));
+    expected.insert(expected.end(), payloads[i].begin(), payloads[i].end());
+  }
+  const size_t num_bytes =
+      kNumMessages * GetPacketSize(static_cast<uint32_t>(payloads[0].size()));
+
+  LoopbackSender sender(&client_);
+  sender.Start();
+
+  // The same messages, uncompressed then compressed, after a first run that
+  // warms up the packet pool and the receiver.
+  double seconds[2];
+  uint64_t num_sent_bytes[2];
+  for (int run = -1; run < 2; ++run) {
+    int compress = std::max(run, 0);
+    sender.SetCompressionEnabled(compress != 0);
+    uint64_t num_previously_sent_bytes = sender.GetNumSentBytes();
+    StartReceivingMessages(kNumMessages);
+
+    auto start = std::chrono::steady_clock::now();
+    for (const std::vector<char>& payload : payloads) {
+      sender.Send(Msg_String, payload.data(), payload.size());
+    }
+    WaitForReceiver();
+    seconds[compress] = std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+    num_sent_bytes[compress] =
+        sender.GetNumSentBytes() - num_previously_sent_bytes;
+    EXPECT_EQ(received_, expected);
+  }
+  sender.Stop();
+
+  EXPECT_EQ(num_sent_bytes[0], num_bytes);
+  EXPECT_LT(num_sent_bytes[1], num_bytes / 2);
+
+  for (int compress = 0; compress < 2; ++compress) {
+    std::cout << (compress ? "Compressed: " : "Uncompressed: ")
+              << kNumMessages / seconds[compress] << " messages/s, "
+              << num_bytes / seconds[compress] / (1024 * 1024)
+              << " MB/s, " << num_sent_bytes[compress] << " bytes sent"
+              << std::endl;
+  }
+  std::cout << "Compression ratio " << sender.GetCompressionRatio() << ", "
+            << sender.GetCompressionThroughput() / (1024 * 1024)
+            << " MB/s compressed" << std::endl;
+}
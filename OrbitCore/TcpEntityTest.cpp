@@ -0,0 +1,327 @@
+// clang-format off
+#include "OrbitAsio.h"
+// clang-format on
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Message.h"
+#include "TcpEntity.h"
+#include "TcpEntityTestFixture.h"
+
+TEST_F(TcpEntityTest, BatchedSendsAreIntact) {
+  // Small enough a budget that batches are split, with some packets larger
+  // than the budget.
+  constexpr size_t kMaxBatchBytes = 4 * 1024;
+  std::vector<uint32_t> payload_sizes;
+  size_t num_bytes = 0;
+  for (uint32_t i = 0; i < 2000; ++i) {
+    uint32_t payload_size = i % 100 == 0 ? 3 * kMaxBatchBytes : i % 300;
+    payload_sizes.push_back(payload_size);
+    num_bytes += GetPacketSize(payload_size);
+  }
+
+  LoopbackSender sender(&client_);
+  sender.SetMaxSendBatchBytes(kMaxBatchBytes);
+  StartReceiving(num_bytes);
+  sender.Start();
+
+  std::vector<char> payload;
+  for (size_t i = 0; i < payload_sizes.size(); ++i) {
+    payload.assign(payload_sizes[i], static_cast<char>(i));
+    sender.Send(Msg_String, payload.data(), payload.size());
+  }
+  WaitForReceiver();
+  sender.Stop();
+
+  ExpectMessages(payload_sizes);
+  EXPECT_EQ(sender.GetNumSentPackets(), payload_sizes.size());
+  EXPECT_EQ(sender.GetNumSentBytes(), num_bytes);
+  EXPECT_LE(sender.GetNumWrites(), sender.GetNumSentPackets());
+}
+
+TEST_F(TcpEntityTest, CompressedSendsAreIntact) {
+  std::mt19937 random(42);
+  std::vector<std::vector<char>> payloads;
+  for (uint32_t i = 0; i < 20000; ++i) {
+    if (i % 500 == 0) {
+      // Incompressible payloads, larger than a batch.
+      std::vector<char> payload(20000);
+      for (char& c : payload) c = static_cast<char>(random());
+      payloads.push_back(payload);
+    } else if (i % 50 == 0) {
+      payloads.push_back({});
+    } else {
+      payloads.push_back(CreateCapturePayload(i));
+    }
+  }
+
+  LoopbackSender sender(&client_);
+  sender.SetMaxSendBatchBytes(16 * 1024);
+  sender.SetCompressionEnabled(true);
+  StartReceivingMessages(payloads.size());
+  sender.Start();
+
+  std::vector<char> expected;
+  size_t num_bytes = 0;
+  for (const std::vector<char>& payload : payloads) {
+    sender.Send(Msg_String, payload.data(), payload.size());
+    expected.insert(expected.end(), payload.begin(), payload.end());
+    num_bytes += GetPacketSize(static_cast<uint32_t>(payload.size()));
+  }
+  WaitForReceiver();
+  sender.Stop();
+
+  EXPECT_EQ(received_, expected);
+  EXPECT_GT(sender.GetNumCompressedBlocks(), 0);
+  EXPECT_EQ(sender.GetNumCompressionInputBytes(), num_bytes);
+  EXPECT_EQ(sender.GetNumCompressionOutputBytes(), sender.GetNumSentBytes());
+  EXPECT_LT(sender.GetNumSentBytes(), num_bytes);
+  EXPECT_GT(sender.GetCompressionRatio(), 1.0);
+}
+
+TEST_F(TcpEntityTest, BlockSenderWaitsForStalledReceiver) {
+  constexpr uint32_t kNumMessages = 8000;
+  LoopbackSender sender(&client_);
+  sender.SetSendQueuePolicy(TcpEntity::BlockSender);
+  sender.SetMaxQueuedBytes(kMaxQueuedBytes);
+  ShrinkSendBuffer();
+  sender.Start();
+
+  std::thread producer([&sender]() {
+    for (uint32_t i = 0; i < kNumMessages; ++i) {
+      SendWithId(&sender, Msg_Timer, i);
+    }
+  });
+
+  // Nothing is received, the producer blocks with a full queue.
+  EXPECT_TRUE(WaitFor([&sender]() { return sender.GetNumBlockedSends() > 0; }));
+  EXPECT_LE(sender.GetNumQueuedBytes(), kMaxQueuedBytes);
+
+  StartReceivingMessages(kNumMessages);
+  producer.join();
+  WaitForReceiver();
+  sender.Stop();
+
+  std::vector<uint32_t> ids = GetReceivedIds(Msg_Timer);
+  ASSERT_EQ(ids.size(), kNumMessages);
+  for (uint32_t i = 0; i < kNumMessages; ++i) {
+    EXPECT_EQ(ids[i], i);
+  }
+  EXPECT_EQ(sender.GetNumDroppedPackets(), 0);
+  EXPECT_EQ(sender.GetNumQueuedBytes(), 0);
+}
+
+TEST_F(TcpEntityTest, DropOldestSamplesKeepsTimers) {
+  constexpr uint32_t kNumMessages = 8000;
+  LoopbackSender sender(&client_);
+  sender.SetSendQueuePolicy(TcpEntity::DropOldestSamples);
+  sender.SetMaxQueuedBytes(kMaxQueuedBytes);
+  ShrinkSendBuffer();
+  sender.Start();
+
+  std::thread producer([&sender]() {
+    for (uint32_t i = 0; i < kNumMessages; ++i) {
+      SendWithId(&sender, Msg_Timer, i);
+      SendWithId(&sender, Msg_SamplingCallstacks, i);
+    }
+  });
+
+  // Samples are dropped first, then the producer blocks on timers.
+  EXPECT_TRUE(WaitFor([&sender]() { return sender.GetNumBlockedSends() > 0; }));
+  EXPECT_GT(sender.GetNumDroppedPackets(), 0);
+  EXPECT_LE(sender.GetNumQueuedBytes(), kMaxQueuedBytes);
+
+  StartReceivingMessages(SIZE_MAX, Msg_String);
+  producer.join();
+  EXPECT_TRUE(WaitFor([&sender]() { return sender.GetNumQueuedBytes() == 0; }));
+  sender.Send(std::string("end"));
+  WaitForReceiver();
+  sender.Stop();
+
+  std::vector<uint32_t> timer_ids = GetReceivedIds(Msg_Timer);
+  ASSERT_EQ(timer_ids.size(), kNumMessages);
+  for (uint32_t i = 0; i < kNumMessages; ++i) {
+    EXPECT_EQ(timer_ids[i], i);
+  }
+
+  std::vector<uint32_t> sample_ids = GetReceivedIds(Msg_SamplingCallstacks);
+  EXPECT_TRUE(std::is_sorted(sample_ids.begin(), sample_ids.end()));
+  EXPECT_EQ(sample_ids.size() + sender.GetNumDroppedPackets(), kNumMessages);
+  EXPECT_EQ(sender.GetNumDroppedBytes(),
+            sender.GetNumDroppedPackets() *
+                GetPacketSize(kIdMessagePayloadSize));
+  // Samples got through once the receiver caught up.
+  EXPECT_FALSE(sample_ids.empty());
+}
+
+TEST_F(TcpEntityTest, ReduceSamplingThinsSamples) {
+  constexpr uint32_t kNumMessages = 8000;
+  LoopbackSender sender(&client_);
+  sender.SetSendQueuePolicy(TcpEntity::ReduceSampling);
+  sender.SetMaxQueuedBytes(kMaxQueuedBytes);
+  ShrinkSendBuffer();
+  sender.Start();
+  EXPECT_EQ(sender.GetSampleDivisor(), 1);
+
+  // Samples never block, they are thinned and then dropped.
+  for (uint32_t i = 0; i < kNumMessages; ++i) {
+    SendWithId(&sender, Msg_SamplingCallstacks, i);
+  }
+  EXPECT_EQ(sender.GetNumBlockedSends(), 0);
+  EXPECT_GT(sender.GetNumDroppedPackets(), 0);
+  EXPECT_GT(sender.GetSampleDivisor(), 1);
+  EXPECT_LE(sender.GetSampleDivisor(), uint32_t{TcpEntity::kMaxSampleDivisor});
+  EXPECT_LE(sender.GetNumQueuedBytes(), kMaxQueuedBytes);
+
+  StartReceivingMessages(SIZE_MAX, Msg_String);
+  EXPECT_TRUE(WaitFor([&sender]() { return sender.GetNumQueuedBytes() == 0; }));
+  EXPECT_EQ(sender.GetSampleDivisor(), 1);
+  sender.Send(std::string("end"));
+  WaitForReceiver();
+  sender.Stop();
+
+  std::vector<uint32_t> sample_ids = GetReceivedIds(Msg_SamplingCallstacks);
+  EXPECT_TRUE(std::is_sorted(sample_ids.begin(), sample_ids.end()));
+  EXPECT_EQ(sample_ids.size() + sender.GetNumDroppedPackets(), kNumMessages);
+}
+
+TEST(TcpEntity, ZeroQueueBoundHoldsOneMessage) {
+  LoopbackSender entity(nullptr);
+  entity.SetSendQueuePolicy(TcpEntity::ReduceSampling);
+  entity.SetMaxQueuedBytes(0);
+  EXPECT_EQ(entity.GetSampleDivisor(), 1);
+
+  // Nothing is sent, the first sample stays queued.
+  char data[4] = {};
+  entity.Send(Msg_SamplingCallstacks, data, sizeof(data));
+  EXPECT_GT(entity.GetNumQueuedBytes(), 0);
+  EXPECT_EQ(entity.GetSampleDivisor(),
+            uint32_t{TcpEntity::kMaxSampleDivisor});
+  entity.Send(Msg_SamplingCallstacks, data, sizeof(data));
+  EXPECT_EQ(entity.GetNumDroppedPackets(), 1);
+}
+
+TEST(TcpEntity, MainThreadMessagesTakeOverReceiveBuffers) {
+  LoopbackSender entity(nullptr);
+  std::vector<char> received;
+  entity.AddMainThreadCallback(Msg_String, [&](const Message& message) {
+    received.assign(message.GetData(), message.GetData() + message.m_Size);
+  });
+
+  std::vector<char> payload(1000, 'a');
+  const char* payload_data = payload.data();
+  Message message(Msg_String, static_cast<uint32_t>(payload.size()),
+                  payload.data());
+  entity.Callback(message, &payload);
+  EXPECT_EQ(entity.GetNumAdoptedPayloads(), 1);
+  EXPECT_EQ(entity.GetNumCopiedPayloads(), 0);
+  // Nothing to recycle yet, the receiver continues with an empty buffer.
+  EXPECT_TRUE(payload.empty());
+
+  entity.ProcessMainThreadCallbacks();
+  EXPECT_EQ(received, std::vector<char>(1000, 'a'));
+
+  // The buffer of the processed message is reused for the next one.
+  payload.assign(10, 'b');
+  message = Message(Msg_String, static_cast<uint32_t>(payload.size()),
+                    payload.data());
+  entity.Callback(message, &payload);
+  EXPECT_EQ(payload.data(), payload_data);
+  entity.ProcessMainThreadCallbacks();
+  EXPECT_EQ(received, std::vector<char>(10, 'b'));
+
+  // Data that isn't in the receive buffer is copied.
+  char data[4] = {'c', 'c', 'c', 'c'};
+  entity.Callback(Message(Msg_String, 4, data), &payload);
+  EXPECT_EQ(entity.GetNumAdoptedPayloads(), 2);
+  EXPECT_EQ(entity.GetNumCopiedPayloads(), 1);
+  entity.ProcessMainThreadCallbacks();
+  EXPECT_EQ(received, std::vector<char>(4, 'c'));
+}
+
+TEST(TcpEntity, ReceivingDoesntWaitForMainThreadCallbacks) {
+  constexpr uint32_t kNumMessages = 100'000;
+  LoopbackSender entity(nullptr);
+  std::atomic<bool> first_received(false);
+  std::atomic<bool> all_received(false);
+  bool received_during_callback = false;
+  std::vector<uint32_t> ids;
+  entity.AddMainThreadCallback(Msg_Timer, [&](const Message& message) {
+    // A slow first callback, lasting until all messages were received.
+    if (ids.empty()) {
+      auto deadline =
+          std::chrono::steady_clock::now() + std::chrono::seconds(10);
+      while (!all_received && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      received_during_callback = all_received;
+    }
+    uint32_t id = 0;
+    memcpy(&id, message.GetData(), sizeof(id));
+    ids.push_back(id);
+  });
+
+  std::thread receiver([&]() {
+    for (uint32_t i = 0; i < kNumMessages; ++i) {
+      entity.Callback(
+          Message(Msg_Timer, sizeof(i), reinterpret_cast<char*>(&i)));
+      first_received = true;
+    }
+    all_received = true;
+  });
+
+  while (!first_received) std::this_thread::yield();
+  entity.ProcessMainThreadCallbacks();
+  receiver.join();
+  EXPECT_TRUE(received_during_callback);
+
+  for (int i = 0; i < 1000 && ids.size() < kNumMessages; ++i) {
+    entity.ProcessMainThreadCallbacks();
+  }
+  ASSERT_EQ(ids.size(), kNumMessages);
+  for (uint32_t i = 0; i < kNumMessages; ++i) {
+    EXPECT_EQ(ids[i], i);
+  }
+}
+
+TEST(TcpEntity, CallbacksAreDispatchedByType) {
+  LoopbackSender entity(nullptr);
+  std::vector<MessageType> received;
+  std::vector<MessageType> main_thread_received;
+  for (MessageType type : {Msg_Timer, Msg_String}) {
+    entity.AddCallback(type, [&received](const Message& message) {
+      received.push_back(message.GetType());
+    });
+  }
+  entity.AddMainThreadCallback(
+      Msg_String, [&main_thread_received](const Message& message) {
+        main_thread_received.push_back(message.GetType());
+      });
+
+  char data[4] = {'a', 'b', 'c', 'd'};
+  for (MessageType type :
+       {Msg_Timer, Msg_String, Msg_Invalid, Msg_NumMessageTypes,
+        static_cast<MessageType>(-1), Msg_String}) {
+    entity.Callback(Message(type, sizeof(data), data));
+  }
+  EXPECT_EQ(received,
+            std::vector<MessageType>({Msg_Timer, Msg_String, Msg_String}));
+  // Only messages with main thread callbacks are queued.
+  EXPECT_EQ(entity.GetNumCopiedPayloads(), 2);
+  EXPECT_TRUE(main_thread_received.empty());
+
+  entity.ProcessMainThreadCallbacks();
+  EXPECT_EQ(main_thread_received,
+            std::vector<MessageType>({Msg_String, Msg_String}));
+}
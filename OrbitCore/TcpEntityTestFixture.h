@@ -0,0 +1,179 @@
+#ifndef ORBIT_CORE_TCP_ENTITY_TEST_FIXTURE_H_
+#define ORBIT_CORE_TCP_ENTITY_TEST_FIXTURE_H_
+
+// clang-format off
+#include "OrbitAsio.h"
+// clang-format on
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Message.h"
+#include "TcpEntity.h"
+
+// A TcpEntity sending over a loopback connection, shared by the TcpEntity
+// tests and benchmarks.
+// Sends through one end of a loopback connection.
+class LoopbackSender : public TcpEntity {
+ public:
+  explicit LoopbackSender(tcp::socket* socket) {
+    m_TcpSocket->m_Socket = socket;
+    m_IsValid = true;
+  }
+
+ protected:
+  TcpSocket* GetSocket() override { return m_TcpSocket; }
+};
+
+class TcpEntityTest : public ::testing::Test {
+ protected:
+  TcpEntityTest() : client_(io_context_), server_(io_context_) {
+    tcp::acceptor acceptor(io_context_,
+                           tcp::endpoint(asio::ip::address_v4::loopback(), 0));
+    client_.connect(acceptor.local_endpoint());
+    acceptor.accept(server_);
+  }
+
+  // Receives "num_bytes" bytes on a separate thread, the sender blocks once
+  // the socket buffers are full.
+  void StartReceiving(size_t num_bytes) {
+    received_.resize(num_bytes);
+    receiver_ = std::thread(
+        [this]() { asio::read(server_, asio::buffer(received_)); });
+  }
+  void WaitForReceiver() { receiver_.join(); }
+
+  // Receives "num_messages" messages on a separate thread, or until a
+  // message of type "end_type", unpacking compressed blocks. Appends their
+  // payloads to received_, and their type and id to received_ids_.
+  void StartReceivingMessages(size_t num_messages,
+                              MessageType end_type = Msg_Invalid) {
+    received_.clear();
+    received_ids_.clear();
+    receiver_ = std::thread([this, num_messages, end_type]() {
+      LoopbackSender decoder(nullptr);
+      size_t num_received = 0;
+      bool end_received = false;
+      auto on_message = [&](const Message& message) {
+        received_.insert(received_.end(), message.GetData(),
+                         message.GetData() + message.m_Size);
+        received_ids_.emplace_back(message.GetType(), GetId(message));
+        end_received |= message.GetType() == end_type;
+        ++num_received;
+      };
+
+      std::vector<char> payload;
+      while (num_received < num_messages && !end_received) {
+        Message message;
+        asio::read(server_, asio::buffer(&message, sizeof(Message)));
+        payload.resize(message.m_Size);
+        asio::read(server_, asio::buffer(payload));
+        uint32_t footer = 0;
+        asio::read(server_, asio::buffer(&footer, 4));
+        message.m_Data = payload.data();
+        if (!decoder.DecompressBlock(message, on_message)) {
+          on_message(message);
+        }
+      }
+    });
+  }
+
+  // Checks that the received stream is "payload_sizes.size()" consecutive
+  // messages whose payload bytes are their index.
+  void ExpectMessages(const std::vector<uint32_t>& payload_sizes) const {
+    size_t offset = 0;
+    for (size_t i = 0; i < payload_sizes.size(); ++i) {
+      ASSERT_LE(offset + sizeof(Message), received_.size());
+      Message message;
+      memcpy(&message, received_.data() + offset, sizeof(Message));
+      ASSERT_EQ(message.GetType(), Msg_String);
+      ASSERT_EQ(message.m_Size, payload_sizes[i]);
+      offset += sizeof(Message);
+
+      ASSERT_LE(offset + message.m_Size + 4, received_.size());
+      for (uint32_t j = 0; j < message.m_Size; ++j) {
+        ASSERT_EQ(received_[offset + j], static_cast<char>(i));
+      }
+      offset += message.m_Size;
+
+      uint32_t footer = 0;
+      memcpy(&footer, received_.data() + offset, 4);
+      ASSERT_EQ(footer, MAGIC_FOOT_MSG);
+      offset += 4;
+    }
+    EXPECT_EQ(offset, received_.size());
+  }
+
+  static size_t GetPacketSize(uint32_t payload_size) {
+    return sizeof(Message) + payload_size + 4;
+  }
+
+  // Messages of the backpressure tests have an id in their first bytes.
+  static void SendWithId(TcpEntity* sender, MessageType type, uint32_t id) {
+    std::vector<char> payload(kIdMessagePayloadSize);
+    memcpy(payload.data(), &id, sizeof(id));
+    sender->Send(type, payload.data(), payload.size());
+  }
+  static uint32_t GetId(const Message& message) {
+    uint32_t id = 0;
+    if (message.m_Size >= sizeof(id)) {
+      memcpy(&id, message.GetData(), sizeof(id));
+    }
+    return id;
+  }
+  std::vector<uint32_t> GetReceivedIds(MessageType type) const {
+    std::vector<uint32_t> ids;
+    for (const auto& pair : received_ids_) {
+      if (pair.first == type) ids.push_back(pair.second);
+    }
+    return ids;
+  }
+
+  // A small send buffer, so that the sender soon stalls when nothing is
+  // received. Shrinking the receive buffer of the connected socket instead
+  // would slow TCP down to a crawl.
+  void ShrinkSendBuffer() {
+    client_.set_option(asio::socket_base::send_buffer_size(4096));
+  }
+
+  // Waits until "condition" holds, for at most a few seconds.
+  static bool WaitFor(const std::function<bool()>& condition) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!condition()) {
+      if (std::chrono::steady_clock::now() > deadline) return false;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+  }
+
+  static constexpr uint32_t kIdMessagePayloadSize = 1000;
+  static constexpr size_t kMaxQueuedBytes = 64 * 1024;
+
+  asio::io_context io_context_;
+  tcp::socket client_;
+  tcp::socket server_;
+  std::vector<char> received_;
+  std::vector<std::pair<MessageType, uint32_t>> received_ids_;
+  std::thread receiver_;
+};
+
+// Timer-like records, as streamed during a capture.
+inline std::vector<char> CreateCapturePayload(uint32_t index) {
+  uint64_t start = 1'000'000'000'000 + index * 1000ull;
+  uint64_t record[8] = {start,
+                        start + 500 + index % 7,
+                        1000 + index % 4,
+                        0x7f0000001000ull + (index % 16) * 64,
+                        index % 8};
+  const char* data = reinterpret_cast<const char*>(record);
+  return std::vector<char>(data, data + sizeof(record));
+}
+
+#endif  // ORBIT_CORE_TCP_ENTITY_TEST_FIXTURE_H_
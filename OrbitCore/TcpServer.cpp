@@ -93,7 +93,13 @@ TcpSocket* TcpServer::GetSocket() {
 }
 
 //-----------------------------------------------------------------------------
-void TcpServer::Receive(const Message& a_Message) {
+void TcpServer::Receive(const Message& a_Message,
+                        std::vector<char>* a_Payload) {
+  if (DecompressBlock(a_Message,
+                      [this](Message& a_Packed) { Receive(a_Packed); })) {
+    return;
+  }
+
   const Message::Header& MessageHeader = a_Message.GetHeader();
   ++m_NumReceivedMessages;
 
@@ -168,7 +174,7 @@ void TcpServer::Receive(const Message& a_Message) {
       break;
     }
     default: {
-      Callback(a_Message);
+      Callback(a_Message, a_Payload);
       break;
     }
   }
@@ -18,7 +18,9 @@ class TcpServer : public TcpEntity {
   using TcpEntity::Start;
   void Start(unsigned short a_Port);
 
-  void Receive(const Message& a_Message);
+  // See TcpEntity::Callback for "a_Payload".
+  void Receive(const Message& a_Message,
+               std::vector<char>* a_Payload = nullptr);
 
   void SendToUiAsync(const std::wstring& a_Message);
   void SendToUiNow(const std::wstring& a_Message);
@@ -8,6 +8,7 @@
 #include "OrbitFunction.h"
 #include "OrbitModule.h"
 #include "OrbitProcess.h"
+#include "ProcessEncoding.h"
 #include "Serialization.h"
 #include "TcpClient.h"
 #include "TcpServer.h"
@@ -49,8 +50,9 @@ void TestRemoteMessages::Run() {
   process.m_ThreadIds.insert(1);
   process.m_ThreadIds.insert(2);
 
-  std::string processData = SerializeObjectHumanReadable(process);
-  PRINT_VAR(processData);
+  std::string processData;
+  EncodeProcess(process, &processData);
+  PRINT_VAR(processData.size());
   GTcpClient->Send(Msg_RemoteProcess, (void*)processData.data(),
                    processData.size());
 
@@ -100,11 +102,10 @@ void TestRemoteMessages::Run() {
 void TestRemoteMessages::SetupMessageHandlers() {
   GTcpServer->AddCallback(Msg_RemoteProcess, [=](const Message& a_Msg) {
     PRINT_VAR(a_Msg.m_Size);
-    std::istringstream buffer(std::string(a_Msg.m_Data, a_Msg.m_Size));
-    cereal::JSONInputArchive inputAr(buffer);
     Process process;
-    inputAr(process);
-    PRINT_VAR(process.GetName());
+    if (DecodeProcess(a_Msg.GetData(), a_Msg.m_Size, &process)) {
+      PRINT_VAR(process.GetName());
+    }
   });
 
   GTcpServer->AddCallback(Msg_RemoteModule, [=](const Message& a_Msg) {
@@ -0,0 +1,46 @@
+#include "TextArena.h"
+
+#include <algorithm>
+#include <cstring>
+
+const char* TextArena::Join(std::initializer_list<std::string_view> parts) {
+  size_t size = 1;
+  for (std::string_view part : parts) size += part.size();
+
+  char* text = Allocate(size);
+  char* end = text;
+  for (std::string_view part : parts) {
+    memcpy(end, part.data(), part.size());
+    end += part.size();
+  }
+  *end = '\0';
+  return text;
+}
+
+void TextArena::Reset() {
+  current_block_ = 0;
+  current_block_used_ = 0;
+}
+
+size_t TextArena::GetMemoryUsage() const {
+  size_t memory_usage = 0;
+  for (const Block& block : blocks_) memory_usage += block.size;
+  return memory_usage;
+}
+
+char* TextArena::Allocate(size_t size) {
+  // Strings don't span blocks, the end of a block is left unused.
+  while (current_block_ < blocks_.size() &&
+         blocks_[current_block_].size - current_block_used_ < size) {
+    ++current_block_;
+    current_block_used_ = 0;
+  }
+  if (current_block_ == blocks_.size()) {
+    size_t block_size = std::max(kBlockSize, size);
+    blocks_.push_back({std::make_unique<char[]>(block_size), block_size});
+  }
+
+  char* data = blocks_[current_block_].data.get() + current_block_used_;
+  current_block_used_ += size;
+  return data;
+}
@@ -0,0 +1,43 @@
+#ifndef ORBIT_CORE_TEXT_ARENA_H_
+#define ORBIT_CORE_TEXT_ARENA_H_
+
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Null-terminated strings allocated from large blocks and freed all at once,
+// for text made in bulk such as the labels of the visible timers. Blocks
+// are kept by Reset() for the next strings.
+class TextArena {
+ public:
+  TextArena() = default;
+  TextArena(const TextArena&) = delete;
+  TextArena& operator=(const TextArena&) = delete;
+
+  // Copies "text". The copy is valid until Reset() or the destruction.
+  const char* Add(std::string_view text) { return Join({text}); }
+  // Copies the concatenation of "parts".
+  const char* Join(std::initializer_list<std::string_view> parts);
+
+  void Reset();
+
+  // Bytes of the allocated blocks.
+  size_t GetMemoryUsage() const;
+
+ private:
+  static const size_t kBlockSize = 64 * 1024;
+
+  struct Block {
+    std::unique_ptr<char[]> data;
+    size_t size;
+  };
+  char* Allocate(size_t size);
+
+  std::vector<Block> blocks_;
+  size_t current_block_ = 0;
+  size_t current_block_used_ = 0;
+};
+
+#endif  // ORBIT_CORE_TEXT_ARENA_H_
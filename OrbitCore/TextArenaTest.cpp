@@ -0,0 +1,37 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "TextArena.h"
+
+TEST(TextArena, TextsDontMove) {
+  TextArena arena;
+  std::vector<const char*> texts;
+  for (int i = 0; i < 100000; ++i) {
+    texts.push_back(arena.Add(std::to_string(i)));
+  }
+  for (int i = 0; i < 100000; ++i) {
+    EXPECT_EQ(texts[i], std::to_string(i));
+  }
+}
+
+TEST(TextArena, Joins) {
+  TextArena arena;
+  EXPECT_STREQ(arena.Join({"Foo", " ", "", "1.000 ms"}), "Foo 1.000 ms");
+  EXPECT_STREQ(arena.Add(""), "");
+
+  std::string long_text(200000, 'x');
+  EXPECT_EQ(arena.Add(long_text), long_text);
+}
+
+TEST(TextArena, ResetKeepsBlocks) {
+  TextArena arena;
+  for (int i = 0; i < 100000; ++i) arena.Add("SomeFunction 1.000 ms");
+  size_t memory_usage = arena.GetMemoryUsage();
+  EXPECT_GT(memory_usage, 0);
+
+  arena.Reset();
+  for (int i = 0; i < 100000; ++i) arena.Add("SomeFunction 1.000 ms");
+  EXPECT_EQ(arena.GetMemoryUsage(), memory_usage);
+}
@@ -0,0 +1,48 @@
+#include "TimerBatch.h"
+
+void TimerBatch::Add(const Timer& timer, ThreadID thread_id) {
+  auto thread = thread_indices_.try_emplace(
+      thread_id, static_cast<uint32_t>(threads_.size()));
+  if (thread.second) threads_.push_back({thread_id, 0, 0});
+  ++threads_[thread.first->second].end;
+
+  auto function = function_indices_.try_emplace(
+      timer.m_FunctionAddress, static_cast<uint32_t>(functions_.size()));
+  if (function.second) functions_.push_back({timer.m_FunctionAddress, 0});
+  ++functions_[function.first->second].num_timers;
+
+  timers_.push_back(&timer);
+  thread_indices_of_timers_.push_back(thread.first->second);
+  function_indices_of_timers_.push_back(function.first->second);
+}
+
+void TimerBatch::Group() {
+  // Counting sort: the ends count the timers of each thread until here.
+  uint32_t begin = 0;
+  for (Thread& thread : threads_) {
+    uint32_t num_timers = thread.end;
+    thread.begin = begin;
+    thread.end = begin;
+    begin += num_timers;
+  }
+
+  grouped_timers_.resize(timers_.size());
+  grouped_function_indices_.resize(timers_.size());
+  for (size_t i = 0; i < timers_.size(); ++i) {
+    uint32_t index = threads_[thread_indices_of_timers_[i]].end++;
+    grouped_timers_[index] = timers_[i];
+    grouped_function_indices_[index] = function_indices_of_timers_[i];
+  }
+}
+
+void TimerBatch::Clear() {
+  thread_indices_.clear();
+  function_indices_.clear();
+  threads_.clear();
+  functions_.clear();
+  timers_.clear();
+  thread_indices_of_timers_.clear();
+  function_indices_of_timers_.clear();
+  grouped_timers_.clear();
+  grouped_function_indices_.clear();
+}
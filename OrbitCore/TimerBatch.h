@@ -0,0 +1,67 @@
+#ifndef ORBIT_CORE_TIMER_BATCH_H_
+#define ORBIT_CORE_TIMER_BATCH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "CallstackTypes.h"
+#include "ScopeTimer.h"
+#include "absl/container/flat_hash_map.h"
+
+// Timers received together, grouped by thread and by function address so
+// that work done per thread or per function, such as finding a track or
+// resolving a function, is done once per batch instead of once per timer.
+//
+// Timers are added, then Group() sorts them by thread, keeping the order of
+// the timers of a thread. The batch only points to the timers, which must
+// outlive it until Clear(). Clear() keeps the allocations for the next batch.
+class TimerBatch {
+ public:
+  // Adds "timer" to the timers of "thread_id", which can differ from the
+  // thread of the timer.
+  void Add(const Timer& timer, ThreadID thread_id);
+  void Group();
+  void Clear();
+
+  size_t size() const { return timers_.size(); }
+
+  struct Thread {
+    ThreadID thread_id;
+    // Range of the grouped timers of the thread.
+    uint32_t begin;
+    uint32_t end;
+  };
+  // In order of first appearance.
+  const std::vector<Thread>& GetThreads() const { return threads_; }
+
+  struct Function {
+    uint64_t address;
+    uint32_t num_timers;
+  };
+  // Distinct function addresses, in order of first appearance.
+  const std::vector<Function>& GetFunctions() const { return functions_; }
+
+  // Timers sorted by thread, valid after Group().
+  const Timer* const* GetTimers() const { return grouped_timers_.data(); }
+  // Index in GetFunctions() of the grouped timer at "index".
+  uint32_t GetFunctionIndex(size_t index) const {
+    return grouped_function_indices_[index];
+  }
+
+ private:
+  absl::flat_hash_map<ThreadID, uint32_t> thread_indices_;
+  absl::flat_hash_map<uint64_t, uint32_t> function_indices_;
+  std::vector<Thread> threads_;
+  std::vector<Function> functions_;
+
+  // In order of addition.
+  std::vector<const Timer*> timers_;
+  std::vector<uint32_t> thread_indices_of_timers_;
+  std::vector<uint32_t> function_indices_of_timers_;
+
+  std::vector<const Timer*> grouped_timers_;
+  std::vector<uint32_t> grouped_function_indices_;
+};
+
+#endif  // ORBIT_CORE_TIMER_BATCH_H_
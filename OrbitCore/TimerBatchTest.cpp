@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "TimerBatch.h"
+
+namespace {
+
+// Timers of a few threads interleaved, as received during a capture.
+std::vector<Timer> CreateTimers(size_t num_timers, size_t num_threads) {
+  std::mt19937_64 random(17);
+  std::vector<Timer> timers(num_timers);
+  for (size_t i = 0; i < num_timers; ++i) {
+    Timer& timer = timers[i];
+    timer.m_TID = 1000 + static_cast<uint32_t>(random() % num_threads);
+    timer.m_Depth = static_cast<uint8_t>(random() % 8);
+    timer.m_Start = 1000000 + i * 100;
+    timer.m_End = timer.m_Start + 1 + random() % 99;
+    timer.m_FunctionAddress = 0x400000 + (random() % 500) * 0x40;
+    timer.m_CallstackHash = random() % 1000;
+  }
+  return timers;
+}
+
+}  // namespace
+
+TEST(TimerBatch, GroupsTimersByThreadInOrder) {
+  std::vector<Timer> timers = CreateTimers(1000, 5);
+  TimerBatch batch;
+  for (const Timer& timer : timers) batch.Add(timer, timer.m_TID);
+  batch.Group();
+  ASSERT_EQ(batch.size(), timers.size());
+
+  const std::vector<TimerBatch::Thread>& threads = batch.GetThreads();
+  ASSERT_EQ(threads.size(), 5);
+  EXPECT_EQ(threads[0].thread_id, timers[0].m_TID);
+  uint32_t begin = 0;
+  for (const TimerBatch::Thread& thread : threads) {
+    EXPECT_EQ(thread.begin, begin);
+    begin = thread.end;
+
+    std::vector<const Timer*> expected;
+    for (const Timer& timer : timers) {
+      if (timer.m_TID == thread.thread_id) expected.push_back(&timer);
+    }
+    std::vector<const Timer*> grouped(batch.GetTimers() + thread.begin,
+                                      batch.GetTimers() + thread.end);
+    EXPECT_EQ(grouped, expected);
+  }
+  EXPECT_EQ(begin, timers.size());
+}
+
+TEST(TimerBatch, CountsTimersByFunction) {
+  std::vector<Timer> timers = CreateTimers(1000, 5);
+  TimerBatch batch;
+  for (const Timer& timer : timers) batch.Add(timer, timer.m_TID);
+  batch.Group();
+
+  std::map<uint64_t, uint32_t> expected_counts;
+  for (const Timer& timer : timers) ++expected_counts[timer.m_FunctionAddress];
+  std::map<uint64_t, uint32_t> counts;
+  for (const TimerBatch::Function& function : batch.GetFunctions()) {
+    EXPECT_EQ(counts.count(function.address), 0);
+    counts[function.address] = function.num_timers;
+  }
+  EXPECT_EQ(counts, expected_counts);
+
+  for (size_t i = 0; i < batch.size(); ++i) {
+    const TimerBatch::Function& function =
+        batch.GetFunctions()[batch.GetFunctionIndex(i)];
+    EXPECT_EQ(function.address, batch.GetTimers()[i]->m_FunctionAddress);
+  }
+}
+
+TEST(TimerBatch, ThreadCanDifferFromTimer) {
+  std::vector<Timer> timers = CreateTimers(100, 5);
+  TimerBatch batch;
+  for (const Timer& timer : timers) batch.Add(timer, 0);
+  batch.Group();
+  ASSERT_EQ(batch.GetThreads().size(), 1);
+  EXPECT_EQ(batch.GetThreads()[0].thread_id, 0);
+  EXPECT_EQ(batch.GetThreads()[0].end, timers.size());
+}
+
+TEST(TimerBatch, ClearStartsNewBatch) {
+  std::vector<Timer> timers = CreateTimers(100, 5);
+  TimerBatch batch;
+  for (const Timer& timer : timers) batch.Add(timer, timer.m_TID);
+  batch.Group();
+  batch.Clear();
+  EXPECT_EQ(batch.size(), 0);
+  EXPECT_TRUE(batch.GetThreads().empty());
+  EXPECT_TRUE(batch.GetFunctions().empty());
+
+  batch.Add(timers[3], 7);
+  batch.Group();
+  ASSERT_EQ(batch.GetThreads().size(), 1);
+  EXPECT_EQ(batch.GetThreads()[0].end, 1);
+  ASSERT_EQ(batch.GetFunctions().size(), 1);
+  EXPECT_EQ(batch.GetFunctions()[0].num_timers, 1);
+  EXPECT_EQ(batch.GetTimers()[0], &timers[3]);
+}
@@ -0,0 +1,206 @@
+#include "TimerColumns.h"
+
+#include <algorithm>
+#include <utility>
+
+TimerColumns::TimerColumns(uint8_t depth) : depth_(depth) {
+  for (std::atomic<SummaryLevel*>& level : summary_levels_) level = nullptr;
+}
+
+TimerColumns::~TimerColumns() {
+  for (std::atomic<SummaryLevel*>& level : summary_levels_) delete level.load();
+}
+
+uint32_t TimerColumns::IdTable::GetId(uint64_t value) {
+  auto result = ids_.try_emplace(value, static_cast<uint32_t>(ids_.size()));
+  if (result.second) {
+    values_.push_back(value);
+    ids_capacity_.store(ids_.capacity(), std::memory_order_relaxed);
+  }
+  return result.first->second;
+}
+
+size_t TimerColumns::IdTable::GetMemoryUsage() const {
+  return values_.GetMemoryUsage() +
+         ids_capacity_.load(std::memory_order_relaxed) *
+             (sizeof(std::pair<uint64_t, uint32_t>) + 1);
+}
+
+void TimerColumns::Add(const Timer& timer) {
+  size_t index = size();
+  starts_.push_back(timer.m_Start);
+  ends_.push_back(timer.m_End);
+  function_ids_.push_back(functions_.GetId(timer.m_FunctionAddress));
+  callstack_ids_.push_back(callstacks_.GetId(timer.m_CallstackHash));
+  thread_ids_.push_back(timer.m_TID);
+  types_.push_back(timer.m_Type);
+  processors_.push_back(timer.m_Processor);
+  session_ids_.push_back(timer.m_SessionID);
+  if (timer.m_UserData[0] != 0 || timer.m_UserData[1] != 0) {
+    user_data_.push_back(
+        {static_cast<uint32_t>(index),
+         {timer.m_UserData[0], timer.m_UserData[1]}});
+  }
+
+  if (index != 0 && timer.m_Start < max_start_) {
+    start_disorder_.store(
+        std::max(start_disorder_.load(std::memory_order_relaxed),
+                 max_start_ - timer.m_Start),
+        std::memory_order_relaxed);
+  }
+  max_start_ = std::max(max_start_, timer.m_Start);
+  max_end_ = std::max(max_end_, timer.m_End);
+  if ((index + 1) % kBlockSize == 0) block_max_ends_.push_back(max_end_);
+  if ((index + 1) % kSummaryRunSize == 0) AddSummary(index + 1);
+
+  num_timers_.store(index + 1, std::memory_order_release);
+}
+
+size_t TimerColumns::FindFirstEndingAtOrAfter(TickType tick) const {
+  // The block index can be one block ahead of the size.
+  size_t low = 0;
+  size_t high = std::min(block_max_ends_.size(), size() / kBlockSize);
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (block_max_ends_[mid] < tick) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low * kBlockSize;
+}
+
+const TimerColumns::UserData* TimerColumns::FindUserData(size_t index) const {
+  size_t low = 0;
+  size_t high = user_data_.size();
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (user_data_[mid].index < index) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  if (low < user_data_.size() && user_data_[low].index == index) {
+    return &user_data_[low];
+  }
+  return nullptr;
+}
+
+void TimerColumns::AddSummary(size_t end_index) {
+  size_t begin_index = end_index - kSummaryRunSize;
+  SummaryNode node{starts_[begin_index], ends_[begin_index], kMixedRun, 0};
+  for (size_t i = begin_index; i < end_index; ++i) {
+    node.start = std::min(node.start, starts_[i]);
+    node.end = std::max(node.end, ends_[i]);
+  }
+
+  bool plain_functions = true;
+  for (size_t i = begin_index; i < end_index; ++i) {
+    plain_functions = plain_functions && types_[i] == Timer::NONE;
+  }
+  if (plain_functions) {
+    for (size_t i = begin_index; i < end_index; ++i) {
+      uint32_t count = 0;
+      for (size_t j = begin_index; j < end_index; ++j) {
+        count += function_ids_[j] == function_ids_[i];
+      }
+      if (count > node.function_count) {
+        node.function_id = function_ids_[i];
+        node.function_count = count;
+      }
+    }
+  }
+
+  // Completing a run of a level can complete one of the level above.
+  size_t node_index = end_index / kSummaryRunSize - 1;
+  for (size_t level = 0; level < kMaxSummaryLevels; ++level) {
+    SummaryLevel* nodes =
+        summary_levels_[level].load(std::memory_order_relaxed);
+    if (nodes == nullptr) {
+      nodes = new SummaryLevel();
+      summary_levels_[level].store(nodes, std::memory_order_release);
+    }
+    nodes->push_back(node);
+    if (node_index % 2 == 0) break;
+    node = Merge((*nodes)[node_index - 1], node);
+    node_index /= 2;
+  }
+}
+
+TimerColumns::SummaryNode TimerColumns::Merge(const SummaryNode& lhs,
+                                              const SummaryNode& rhs) {
+  SummaryNode node{std::min(lhs.start, rhs.start), std::max(lhs.end, rhs.end),
+                   lhs.function_id, lhs.function_count};
+  if (lhs.function_id == kMixedRun || rhs.function_id == kMixedRun) {
+    node.function_id = kMixedRun;
+    node.function_count = 0;
+  } else if (lhs.function_id == rhs.function_id) {
+    node.function_count += rhs.function_count;
+  } else if (rhs.function_count > lhs.function_count) {
+    node.function_id = rhs.function_id;
+    node.function_count = rhs.function_count;
+  }
+  return node;
+}
+
+size_t TimerColumns::Summarize(size_t index, TickType max_duration,
+                               size_t end_index, Summary* summary) const {
+  size_t num_timers = 0;
+  for (size_t level = 0; level < kMaxSummaryLevels; ++level) {
+    size_t run_size = kSummaryRunSize << level;
+    if (index % run_size != 0 || index + run_size > end_index) break;
+    // Runs below the size are complete, and so are their nodes.
+    const SummaryLevel* nodes =
+        summary_levels_[level].load(std::memory_order_acquire);
+    const SummaryNode& node = (*nodes)[index / run_size];
+    if (node.function_id == kMixedRun || node.end - node.start > max_duration) {
+      break;
+    }
+    summary->start = node.start;
+    summary->end = node.end;
+    summary->function_address = functions_.GetValue(node.function_id);
+    summary->function_count = node.function_count;
+    num_timers = run_size;
+  }
+  return num_timers;
+}
+
+Timer TimerColumns::GetTimer(size_t index) const {
+  Timer timer;
+  timer.m_TID = thread_ids_[index];
+  timer.m_Depth = depth_;
+  timer.m_SessionID = session_ids_[index];
+  timer.m_Type = types_[index];
+  timer.m_Processor = processors_[index];
+  timer.m_CallstackHash = callstacks_.GetValue(callstack_ids_[index]);
+  timer.m_FunctionAddress = functions_.GetValue(function_ids_[index]);
+  if (const UserData* user_data = FindUserData(index)) {
+    timer.m_UserData[0] = user_data->data[0];
+    timer.m_UserData[1] = user_data->data[1];
+  }
+  timer.m_Start = starts_[index];
+  timer.m_End = ends_[index];
+  return timer;
+}
+
+size_t TimerColumns::GetMemoryUsage() const {
+  return sizeof(*this) + starts_.GetMemoryUsage() + ends_.GetMemoryUsage() +
+         function_ids_.GetMemoryUsage() + callstack_ids_.GetMemoryUsage() +
+         thread_ids_.GetMemoryUsage() + types_.GetMemoryUsage() +
+         processors_.GetMemoryUsage() + session_ids_.GetMemoryUsage() +
+         functions_.GetMemoryUsage() + callstacks_.GetMemoryUsage() +
+         user_data_.GetMemoryUsage() + block_max_ends_.GetMemoryUsage() +
+         GetSummaryMemoryUsage();
+}
+
+size_t TimerColumns::GetSummaryMemoryUsage() const {
+  size_t memory_usage = 0;
+  for (const std::atomic<SummaryLevel*>& level : summary_levels_) {
+    const SummaryLevel* nodes = level.load(std::memory_order_acquire);
+    if (nodes == nullptr) break;
+    memory_usage += sizeof(SummaryLevel) + nodes->GetMemoryUsage();
+  }
+  return memory_usage;
+}
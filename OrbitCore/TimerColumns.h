@@ -0,0 +1,171 @@
+#ifndef ORBIT_CORE_TIMER_COLUMNS_H_
+#define ORBIT_CORE_TIMER_COLUMNS_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "ScopeTimer.h"
+#include "SegmentedArray.h"
+#include "absl/container/flat_hash_map.h"
+
+// Timers of one depth of a thread track, stored as columns: 31 bytes per
+// timer, about 34 with the block index and the summaries, instead of a full
+// Timer and its text box. Function addresses and callstack hashes are
+// interned per depth, as few distinct ones repeat a lot, and user data,
+// which only some timer types have, is stored aside. The depth is implied.
+// Screen positions and labels are computed when drawing.
+//
+// Timers of a depth don't overlap and arrive nearly sorted. An index of the
+// latest end of each block of timers finds the first that can be visible in
+// a time range in O(log n), and the largest amount by which a start went
+// back in time bounds where the range ends.
+//
+// Runs of timers are summarized as they arrive, mipmap-like: level k holds
+// the earliest start, latest end and most frequent function of each aligned
+// run of kSummaryRunSize << k timers. Zoomed out, a run lasting less than a
+// pixel is drawn once instead of per timer.
+//
+// One thread adds timers while others read them, see SegmentedArray.
+class TimerColumns {
+ public:
+  explicit TimerColumns(uint8_t depth);
+  ~TimerColumns();
+  TimerColumns(const TimerColumns&) = delete;
+  TimerColumns& operator=(const TimerColumns&) = delete;
+
+  void Add(const Timer& timer);
+
+  size_t size() const { return num_timers_.load(std::memory_order_acquire); }
+  uint8_t GetDepth() const { return depth_; }
+
+  TickType GetStart(size_t index) const { return starts_[index]; }
+  TickType GetEnd(size_t index) const { return ends_[index]; }
+  uint64_t GetFunctionAddress(size_t index) const {
+    return functions_.GetValue(function_ids_[index]);
+  }
+  Timer GetTimer(size_t index) const;
+
+  // Index of the first timer that can end at or after "tick": all timers
+  // before it end before.
+  size_t FindFirstEndingAtOrAfter(TickType tick) const;
+  // Whether all timers from "index" on start after "tick". Timers between
+  // FindFirstEndingAtOrAfter(min_tick) and the first index for which this is
+  // true for max_tick contain all timers overlapping [min_tick, max_tick].
+  bool StartsAllAfter(size_t index, TickType tick) const {
+    TickType disorder = start_disorder_.load(std::memory_order_relaxed);
+    return starts_[index] > tick && starts_[index] - tick > disorder;
+  }
+
+  // Consecutive timers seen as one.
+  struct Summary {
+    TickType start;
+    TickType end;
+    uint64_t function_address;
+    // Timers of "function_address" in the run, an estimate for long runs.
+    uint32_t function_count;
+  };
+  // Number of timers of the longest run from "index" to at most "end_index"
+  // lasting at most "max_duration", or 0 if there is none. Only runs of
+  // plain function timers are summarized.
+  size_t Summarize(size_t index, TickType max_duration, size_t end_index,
+                   Summary* summary) const;
+
+  // Calls "callback(index, summary)" in order for what to draw of the timers
+  // from "begin_index" to "end_index" overlapping [min_tick, max_tick]: the
+  // timer at "index" with a null "summary", or the run starting there if it
+  // lasts at most "ticks_per_pixel". Returns the number of timers and runs
+  // looked at. This is the culling loop of TimeGraph::UpdatePrimitives.
+  template <class Callback>
+  size_t ForEachPrimitive(size_t begin_index, size_t end_index,
+                          TickType min_tick, TickType max_tick,
+                          TickType ticks_per_pixel, Callback callback) const {
+    size_t num_visited = 0;
+    size_t num_summarized = 0;
+    for (size_t i = std::max(begin_index, FindFirstEndingAtOrAfter(min_tick));
+         i < end_index && !StartsAllAfter(i, max_tick);
+         i += std::max<size_t>(num_summarized, 1)) {
+      ++num_visited;
+      Summary summary;
+      num_summarized = ticks_per_pixel != 0
+                           ? Summarize(i, ticks_per_pixel, end_index, &summary)
+                           : 0;
+      TickType start = num_summarized != 0 ? summary.start : GetStart(i);
+      TickType end = num_summarized != 0 ? summary.end : GetEnd(i);
+      if (!(min_tick > end || max_tick < start)) {
+        callback(i, num_summarized != 0 ? &summary : nullptr);
+      }
+    }
+    return num_visited;
+  }
+
+  // Bytes held by the columns and tables, including unused capacity.
+  size_t GetMemoryUsage() const;
+
+ private:
+  // Ids of 64-bit values, in order of first appearance. Only the adding
+  // thread assigns ids.
+  class IdTable {
+   public:
+    uint32_t GetId(uint64_t value);
+    uint64_t GetValue(uint32_t id) const { return values_[id]; }
+    size_t GetMemoryUsage() const;
+
+   private:
+    absl::flat_hash_map<uint64_t, uint32_t> ids_;
+    SegmentedArray<uint64_t, 16> values_;
+    // Capacity of "ids_", which other threads can't query.
+    std::atomic<size_t> ids_capacity_{0};
+  };
+
+  struct UserData {
+    uint32_t index;
+    uint64_t data[2];
+  };
+  const UserData* FindUserData(size_t index) const;
+
+  static const size_t kBlockSize = 64;
+
+  // Run of timers summarized by a level, see Summary.
+  struct SummaryNode {
+    TickType start;
+    TickType end;
+    uint32_t function_id;
+    uint32_t function_count;
+  };
+  // Function id of the runs with other than plain function timers.
+  static const uint32_t kMixedRun = UINT32_MAX;
+  static const size_t kSummaryRunSize = 16;
+  static const size_t kMaxSummaryLevels = 48;
+  using SummaryLevel = SegmentedArray<SummaryNode, 16>;
+  void AddSummary(size_t end_index);
+  static SummaryNode Merge(const SummaryNode& lhs, const SummaryNode& rhs);
+  size_t GetSummaryMemoryUsage() const;
+
+  uint8_t depth_;
+  SegmentedArray<TickType> starts_;
+  SegmentedArray<TickType> ends_;
+  SegmentedArray<uint32_t> function_ids_;
+  SegmentedArray<uint32_t> callstack_ids_;
+  SegmentedArray<uint32_t> thread_ids_;
+  SegmentedArray<Timer::Type> types_;
+  SegmentedArray<uint8_t> processors_;
+  SegmentedArray<uint8_t> session_ids_;
+  IdTable functions_;
+  IdTable callstacks_;
+  // Sorted by index.
+  SegmentedArray<UserData, 16> user_data_;
+  // Latest end of the timers up to each complete block.
+  SegmentedArray<TickType, 16> block_max_ends_;
+  // Largest amount by which a start preceded an earlier start.
+  std::atomic<TickType> start_disorder_{0};
+  // Allocated as runs get long enough.
+  std::atomic<SummaryLevel*> summary_levels_[kMaxSummaryLevels];
+  // Only used by the adding thread.
+  TickType max_start_ = 0;
+  TickType max_end_ = 0;
+  std::atomic<size_t> num_timers_{0};
+};
+
+#endif  // ORBIT_CORE_TIMER_COLUMNS_H_
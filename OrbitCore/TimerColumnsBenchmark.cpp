@@ -0,0 +1,146 @@
+// Timing runs of TimerColumns on captures of tens of millions of timers.
+// Correctness is checked by TimerColumnsTest.cpp.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "TimerColumns.h"
+#include "TimerColumnsTestData.h"
+
+// A capture of 50M timers on 16 threads of 8 levels of calls.
+TEST(TimerColumns, FiftyMillionTimers) {
+  const uint64_t kNumTimers = 50000000;
+  const uint8_t kNumThreads = 16;
+  const uint8_t kNumDepths = 8;
+  std::vector<std::unique_ptr<TimerColumns>> tracks;
+  for (uint8_t i = 0; i < kNumThreads * kNumDepths; ++i) {
+    tracks.push_back(std::make_unique<TimerColumns>(i % kNumDepths));
+  }
+
+  // Timers arrive in batches per thread, the tracks are filled in turn.
+  auto start = std::chrono::steady_clock::now();
+  for (size_t track = 0; track < tracks.size(); ++track) {
+    std::mt19937_64 random(track);
+    TimerColumns& columns = *tracks[track];
+    for (uint64_t i = 0; i < kNumTimers / tracks.size(); ++i) {
+      columns.Add(CreateTimer(i, columns.GetDepth(), &random));
+    }
+  }
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  size_t num_timers = 0;
+  size_t memory_usage = 0;
+  for (const std::unique_ptr<TimerColumns>& columns : tracks) {
+    num_timers += columns->size();
+    memory_usage += columns->GetMemoryUsage();
+  }
+  ASSERT_EQ(num_timers, kNumTimers);
+  double bytes_per_timer = static_cast<double>(memory_usage) / num_timers;
+  std::cout << num_timers << " timers: " << memory_usage / (1024 * 1024)
+            << " MB, " << bytes_per_timer << " bytes per timer, added in "
+            << seconds << " s" << std::endl;
+
+  // Columns hold 31 bytes per timer, about 34 with the block index and the
+  // summaries. Segments hold up to twice that.
+  EXPECT_LT(bytes_per_timer, 2 * 34);
+  std::mt19937_64 random(5);
+  Timer timer;
+  for (uint64_t i = 0; i <= 1000; ++i) {
+    timer = CreateTimer(i, tracks[5]->GetDepth(), &random);
+  }
+  EXPECT_EQ(tracks[5]->GetStart(1000), timer.m_Start);
+  EXPECT_EQ(tracks[5]->GetEnd(1000), timer.m_End);
+}
+
+// Culling cost at zoom levels from the whole capture to a thousandth of a
+// percent of it.
+TEST(TimerColumns, CullingCostFollowsZoom) {
+  const uint64_t kNumTimers = 10000000;
+  std::mt19937_64 random(42);
+  TimerColumns columns(0);
+  for (uint64_t i = 0; i < kNumTimers; ++i) {
+    columns.Add(CreateTimer(i, 0, &random));
+  }
+
+  const TickType kMinTick = columns.GetStart(0);
+  const TickType kDuration = columns.GetEnd(kNumTimers - 1) - kMinTick;
+  const int kNumQueries = 10;
+  std::vector<size_t> visible;
+  for (uint64_t zoom = 1; zoom <= 100000; zoom *= 10) {
+    TickType window = kDuration / zoom;
+    size_t num_visited = 0;
+    size_t num_visible = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int query = 0; query < kNumQueries; ++query) {
+      TickType min_tick = kMinTick + random() % (kDuration - window + 1);
+      visible.clear();
+      size_t visited = columns.ForEachPrimitive(
+          0, columns.size(), min_tick, min_tick + window, 0,
+          [&visible](size_t index, const TimerColumns::Summary*) {
+            visible.push_back(index);
+          });
+      EXPECT_LE(visited, visible.size() + 64);
+      num_visited += visited;
+      num_visible += visible.size();
+    }
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    std::cout << "Zoom " << zoom << ": " << num_visible / kNumQueries
+              << " visible timers, " << num_visited / kNumQueries
+              << " looked at, " << seconds / kNumQueries * 1e6
+              << " us per update" << std::endl;
+  }
+}
+
+// Zoomed out, primitives follow the pixels rather than the timers. Zoomed
+// in, timers are drawn one by one.
+TEST(TimerColumns, PrimitivesPerZoom) {
+  const uint64_t kNumTimers = 10000000;
+  const TickType kNumPixels = 2000;
+  std::mt19937_64 random(42);
+  TimerColumns columns(0);
+  for (uint64_t i = 0; i < kNumTimers; ++i) {
+    Timer timer = CreateTimer(i, 0, &random);
+    timer.SetType(Timer::NONE);
+    columns.Add(timer);
+  }
+
+  const TickType kMinTick = columns.GetStart(0);
+  const TickType kDuration = columns.GetEnd(kNumTimers - 1) - kMinTick;
+  for (uint64_t zoom = 1; zoom <= 100000; zoom *= 10) {
+    TickType window = kDuration / zoom;
+    TickType min_tick = kMinTick + random() % (kDuration - window + 1);
+    TickType max_tick = min_tick + window;
+    std::vector<size_t> visible;
+    columns.ForEachPrimitive(
+        0, columns.size(), min_tick, max_tick, 0,
+        [&visible](size_t index, const TimerColumns::Summary*) {
+          visible.push_back(index);
+        });
+    size_t num_primitives = 0;
+    columns.ForEachPrimitive(
+        0, columns.size(), min_tick, max_tick, window / kNumPixels,
+        [&num_primitives](size_t, const TimerColumns::Summary*) {
+          ++num_primitives;
+        });
+    std::cout << "Zoom " << zoom << ": " << visible.size()
+              << " visible timers, " << num_primitives << " primitives"
+              << std::endl;
+
+    // Pixels with more timers than a run hold a run, and part of two others.
+    EXPECT_LE(num_primitives, 3 * 16 * kNumPixels);
+    // Runs of 16 timers last more than 1500 ticks.
+    if (window / kNumPixels < 1500) {
+      EXPECT_EQ(num_primitives, visible.size());
+    }
+  }
+}
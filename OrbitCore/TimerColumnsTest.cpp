@@ -0,0 +1,310 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "TimerColumns.h"
+#include "TimerColumnsTestData.h"
+
+namespace {
+
+void ExpectEqual(const Timer& lhs, const Timer& rhs) {
+  EXPECT_EQ(lhs.m_TID, rhs.m_TID);
+  EXPECT_EQ(lhs.m_Depth, rhs.m_Depth);
+  EXPECT_EQ(lhs.m_SessionID, rhs.m_SessionID);
+  EXPECT_EQ(lhs.m_Type, rhs.m_Type);
+  EXPECT_EQ(lhs.m_Processor, rhs.m_Processor);
+  EXPECT_EQ(lhs.m_CallstackHash, rhs.m_CallstackHash);
+  EXPECT_EQ(lhs.m_FunctionAddress, rhs.m_FunctionAddress);
+  EXPECT_EQ(lhs.m_UserData[0], rhs.m_UserData[0]);
+  EXPECT_EQ(lhs.m_UserData[1], rhs.m_UserData[1]);
+  EXPECT_EQ(lhs.m_Start, rhs.m_Start);
+  EXPECT_EQ(lhs.m_End, rhs.m_End);
+}
+
+}  // namespace
+
+TEST(TimerColumns, TimersRoundTrip) {
+  std::mt19937_64 random(42);
+  std::vector<Timer> timers;
+  TimerColumns columns(3);
+  for (uint64_t i = 0; i < 10000; ++i) {
+    timers.push_back(CreateTimer(i, 3, &random));
+    columns.Add(timers.back());
+  }
+
+  ASSERT_EQ(columns.size(), timers.size());
+  EXPECT_EQ(columns.GetDepth(), 3);
+  for (size_t i = 0; i < timers.size(); ++i) {
+    ExpectEqual(columns.GetTimer(i), timers[i]);
+    EXPECT_EQ(columns.GetStart(i), timers[i].m_Start);
+    EXPECT_EQ(columns.GetEnd(i), timers[i].m_End);
+    EXPECT_EQ(columns.GetFunctionAddress(i), timers[i].m_FunctionAddress);
+  }
+}
+
+TEST(TimerColumns, ReadWhileAdding) {
+  const uint64_t kNumTimers = 200000;
+  TimerColumns columns(0);
+  std::thread writer([&columns, kNumTimers]() {
+    std::mt19937_64 random(42);
+    for (uint64_t i = 0; i < kNumTimers; ++i) {
+      columns.Add(CreateTimer(i, 0, &random));
+    }
+  });
+
+  // Timers below the size read are complete.
+  size_t size = 0;
+  while (size < kNumTimers) {
+    size = columns.size();
+    if (size == 0) continue;
+    Timer timer = columns.GetTimer(size - 1);
+    ASSERT_EQ(timer.m_Start, 1000000 + (size - 1) * 100);
+    ASSERT_GT(timer.m_End, timer.m_Start);
+    if ((size - 1) % 50 == 1) {
+      ASSERT_EQ(timer.m_UserData[1], size - 1);
+    }
+  }
+  writer.join();
+}
+
+TEST(TimerColumns, MemoryUsagePerTimer) {
+  const uint64_t kNumTimers = 1000000;
+  std::mt19937_64 random(5);
+  TimerColumns columns(0);
+  for (uint64_t i = 0; i < kNumTimers; ++i) {
+    columns.Add(CreateTimer(i, 0, &random));
+  }
+  ASSERT_EQ(columns.size(), kNumTimers);
+
+  // Columns hold 31 bytes per timer, about 34 with the block index and the
+  // summaries. Segments hold up to twice that.
+  double bytes_per_timer =
+      static_cast<double>(columns.GetMemoryUsage()) / kNumTimers;
+  EXPECT_GT(bytes_per_timer, 31);
+  EXPECT_LT(bytes_per_timer, 2 * 34);
+}
+
+TEST(TimerColumns, RangeContainsOverlappingTimers) {
+  // Nearly sorted: some neighbors swapped and a few timers arriving late.
+  std::mt19937_64 random(42);
+  std::vector<Timer> timers;
+  for (uint64_t i = 0; i < 20000; ++i) {
+    timers.push_back(CreateTimer(i, 0, &random));
+  }
+  for (size_t i = 1; i < timers.size(); ++i) {
+    if (random() % 10 == 0) std::swap(timers[i - 1], timers[i]);
+  }
+  for (size_t i = 3000; i < timers.size(); i += 5000) {
+    std::rotate(timers.begin() + i - 200, timers.begin() + i - 199,
+                timers.begin() + i + 1);
+  }
+  TimerColumns columns(0);
+  for (const Timer& timer : timers) columns.Add(timer);
+
+  const TickType kMinTick = timers.front().m_Start - 1000;
+  const TickType kMaxTick = kMinTick + 20000 * 100 + 2000;
+  for (int query = 0; query < 1000; ++query) {
+    TickType min_tick = kMinTick + random() % (kMaxTick - kMinTick);
+    TickType max_tick = min_tick + random() % (query % 2 ? 1000 : 100000);
+    std::vector<size_t> expected;
+    for (size_t i = 0; i < timers.size(); ++i) {
+      if (!(min_tick > timers[i].m_End || max_tick < timers[i].m_Start)) {
+        expected.push_back(i);
+      }
+    }
+    std::vector<size_t> visible;
+    columns.ForEachPrimitive(
+        0, columns.size(), min_tick, max_tick, 0,
+        [&visible](size_t index, const TimerColumns::Summary*) {
+          visible.push_back(index);
+        });
+    ASSERT_EQ(visible, expected);
+  }
+
+  EXPECT_EQ(columns.FindFirstEndingAtOrAfter(0), 0);
+  EXPECT_EQ(columns.FindFirstEndingAtOrAfter(kMaxTick),
+            columns.size() / 64 * 64);
+}
+
+// The timers looked at are the visible ones, plus at most a block before
+// them, at zoom levels from the whole capture to a thousandth of a percent
+// of it.
+TEST(TimerColumns, CullingCostFollowsZoom) {
+  const uint64_t kNumTimers = 1000000;
+  std::mt19937_64 random(42);
+  TimerColumns columns(0);
+  for (uint64_t i = 0; i < kNumTimers; ++i) {
+    columns.Add(CreateTimer(i, 0, &random));
+  }
+
+  const TickType kMinTick = columns.GetStart(0);
+  const TickType kDuration = columns.GetEnd(kNumTimers - 1) - kMinTick;
+  std::vector<size_t> visible;
+  for (uint64_t zoom = 1; zoom <= 100000; zoom *= 10) {
+    TickType window = kDuration / zoom;
+    for (int query = 0; query < 10; ++query) {
+      TickType min_tick = kMinTick + random() % (kDuration - window + 1);
+      visible.clear();
+      size_t visited = columns.ForEachPrimitive(
+          0, columns.size(), min_tick, min_tick + window, 0,
+          [&visible](size_t index, const TimerColumns::Summary*) {
+            visible.push_back(index);
+          });
+      EXPECT_LE(visited, visible.size() + 64);
+    }
+  }
+}
+
+TEST(TimerColumns, SummariesCoverRuns) {
+  std::mt19937_64 random(42);
+  std::vector<Timer> timers;
+  TimerColumns columns(0);
+  for (uint64_t i = 0; i < 10000; ++i) {
+    timers.push_back(CreateTimer(i, 0, &random));
+    // Few functions, so that runs have one that is the most frequent.
+    timers.back().m_FunctionAddress = 0x400000 + random() % 3;
+    columns.Add(timers.back());
+  }
+
+  size_t num_summarized = 0;
+  for (size_t index = 0; index < timers.size(); ++index) {
+    for (TickType max_duration : {1000, 10000, 100000, 10000000}) {
+      TimerColumns::Summary summary;
+      size_t count =
+          columns.Summarize(index, max_duration, timers.size(), &summary);
+      if (count == 0) continue;
+      ++num_summarized;
+
+      ASSERT_EQ(index % count, 0);
+      ASSERT_LE(index + count, timers.size());
+      TickType start = timers[index].m_Start;
+      TickType end = timers[index].m_End;
+      std::map<uint64_t, uint32_t> function_counts;
+      for (size_t i = index; i < index + count; ++i) {
+        ASSERT_EQ(timers[i].GetType(), Timer::NONE);
+        start = std::min(start, timers[i].m_Start);
+        end = std::max(end, timers[i].m_End);
+        ++function_counts[timers[i].m_FunctionAddress];
+      }
+      EXPECT_EQ(summary.start, start);
+      EXPECT_EQ(summary.end, end);
+      EXPECT_LE(summary.end - summary.start, max_duration);
+      ASSERT_EQ(function_counts.count(summary.function_address), 1);
+      EXPECT_GE(function_counts[summary.function_address],
+                summary.function_count);
+      uint32_t max_count = 0;
+      for (const auto& pair : function_counts) {
+        max_count = std::max(max_count, pair.second);
+      }
+      // Runs of the first level are counted exactly.
+      if (count == 16) {
+        EXPECT_EQ(summary.function_count, max_count);
+      }
+
+      // The run is the longest one: the next one up is too long or mixed.
+      size_t next_count = 2 * count;
+      if (index % next_count == 0 && index + next_count <= timers.size()) {
+        bool plain = true;
+        for (size_t i = index; i < index + next_count; ++i) {
+          start = std::min(start, timers[i].m_Start);
+          end = std::max(end, timers[i].m_End);
+          plain = plain && timers[i].GetType() == Timer::NONE;
+        }
+        EXPECT_TRUE(!plain || end - start > max_duration);
+      }
+    }
+  }
+  EXPECT_GT(num_summarized, 0);
+}
+
+// Each timer from "begin_index" on is drawn once, alone or in the run that
+// covers it, as in TimeGraph::UpdatePrimitives.
+TEST(TimerColumns, ForEachPrimitiveCoversTimersOnce) {
+  std::mt19937_64 random(42);
+  TimerColumns columns(0);
+  for (uint64_t i = 0; i < 10000; ++i) {
+    Timer timer = CreateTimer(i, 0, &random);
+    if (i % 100 != 0) timer.SetType(Timer::NONE);
+    columns.Add(timer);
+  }
+
+  const TickType kMinTick = columns.GetStart(0);
+  const TickType kMaxTick = columns.GetEnd(columns.size() - 1);
+  size_t total_runs = 0;
+  for (size_t begin_index : {0, 1000, 9999}) {
+    for (TickType ticks_per_pixel : {0, 1000, 100000}) {
+      size_t next_index = begin_index;
+      size_t num_runs = 0;
+      columns.ForEachPrimitive(
+          begin_index, columns.size(), kMinTick, kMaxTick, ticks_per_pixel,
+          [&](size_t index, const TimerColumns::Summary* summary) {
+            ASSERT_EQ(index, next_index);
+            TimerColumns::Summary expected;
+            size_t count = columns.Summarize(index, ticks_per_pixel,
+                                             columns.size(), &expected);
+            if (summary == nullptr) {
+              EXPECT_TRUE(count == 0 || ticks_per_pixel == 0);
+              ++next_index;
+              return;
+            }
+            ++num_runs;
+            EXPECT_EQ(summary->start, expected.start);
+            EXPECT_EQ(summary->end, expected.end);
+            EXPECT_EQ(summary->function_address, expected.function_address);
+            next_index += count;
+          });
+      EXPECT_EQ(next_index, columns.size());
+      if (ticks_per_pixel == 0) {
+        EXPECT_EQ(num_runs, 0);
+      }
+      total_runs += num_runs;
+    }
+  }
+  EXPECT_GT(total_runs, 0);
+}
+
+// Zoomed out, primitives follow the pixels rather than the timers. Zoomed
+// in, timers are drawn one by one.
+TEST(TimerColumns, PrimitivesFollowPixels) {
+  const uint64_t kNumTimers = 1000000;
+  const TickType kNumPixels = 2000;
+  std::mt19937_64 random(42);
+  TimerColumns columns(0);
+  for (uint64_t i = 0; i < kNumTimers; ++i) {
+    Timer timer = CreateTimer(i, 0, &random);
+    timer.SetType(Timer::NONE);
+    columns.Add(timer);
+  }
+
+  const TickType kMinTick = columns.GetStart(0);
+  const TickType kDuration = columns.GetEnd(kNumTimers - 1) - kMinTick;
+  for (uint64_t zoom = 1; zoom <= 10000; zoom *= 10) {
+    TickType window = kDuration / zoom;
+    TickType min_tick = kMinTick + random() % (kDuration - window + 1);
+    TickType max_tick = min_tick + window;
+    std::vector<size_t> visible;
+    columns.ForEachPrimitive(
+        0, columns.size(), min_tick, max_tick, 0,
+        [&visible](size_t index, const TimerColumns::Summary*) {
+          visible.push_back(index);
+        });
+    size_t num_primitives = 0;
+    columns.ForEachPrimitive(
+        0, columns.size(), min_tick, max_tick, window / kNumPixels,
+        [&num_primitives](size_t, const TimerColumns::Summary*) {
+          ++num_primitives;
+        });
+
+    // Pixels with more timers than a run hold a run, and part of two others.
+    EXPECT_LE(num_primitives, 3 * 16 * kNumPixels);
+    // Runs of 16 timers last more than 1500 ticks.
+    if (window / kNumPixels < 1500) {
+      EXPECT_EQ(num_primitives, visible.size());
+    }
+  }
+}
@@ -0,0 +1,38 @@
+#ifndef ORBIT_CORE_TIMER_COLUMNS_TEST_DATA_H_
+#define ORBIT_CORE_TIMER_COLUMNS_TEST_DATA_H_
+
+#include <cstdint>
+#include <random>
+
+#include "TimerColumns.h"
+
+// Timers as recorded on a thread: back to back calls to a few functions,
+// with repeating callstacks, and some context switch and Unreal timers.
+// Shared by the TimerColumns tests and benchmarks.
+inline Timer CreateTimer(uint64_t index, uint8_t depth,
+                         std::mt19937_64* random) {
+  Timer timer;
+  timer.m_TID = 1000 + (*random)() % 4;
+  timer.m_Depth = depth;
+  timer.m_SessionID = 1;
+  timer.m_Start = 1000000 + index * 100;
+  timer.m_End = timer.m_Start + 1 + (*random)() % 99;
+  timer.m_FunctionAddress = 0x400000 + ((*random)() % 200) * 0x40;
+  timer.m_CallstackHash = (*random)() % 1000;
+  switch (index % 50) {
+    case 0:
+      timer.SetType(Timer::CORE_ACTIVITY);
+      timer.m_Processor = static_cast<uint8_t>((*random)() % 16);
+      break;
+    case 1:
+      timer.SetType(Timer::UNREAL_OBJECT);
+      timer.m_UserData[0] = (*random)();
+      timer.m_UserData[1] = index;
+      break;
+    default:
+      break;
+  }
+  return timer;
+}
+
+#endif  // ORBIT_CORE_TIMER_COLUMNS_TEST_DATA_H_
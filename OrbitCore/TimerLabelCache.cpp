@@ -0,0 +1,133 @@
+#include "TimerLabelCache.h"
+
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+struct TimeUnit {
+  // Durations from "min_milliseconds" up to the next unit use this one, NaN
+  // uses the last one like in GetPrettyTime().
+  double min_milliseconds;
+  double milliseconds;
+  const char* name;
+};
+
+constexpr TimeUnit kTimeUnits[] = {{0, 0.000001, "ns"},
+                                   {0.001, 0.001, "us"},
+                                   {1, 1, "ms"},
+                                   {1000, 1000, "s"},
+                                   {60 * 1000, 60 * 1000, "min"},
+                                   {60 * 60 * 1000, 60 * 60 * 1000, "h"},
+                                   {24 * 60 * 60 * 1000,
+                                    24 * 60 * 60 * 1000, "days"}};
+constexpr size_t kNumTimeUnits = sizeof(kTimeUnits) / sizeof(kTimeUnits[0]);
+
+// Integer thousandths above which FormatPrettyTime() uses snprintf().
+constexpr double kMaxThousandths = 1e15;
+
+// Duration in thousandths of a unit, as GetPrettyTime() rounds it.
+struct PrettyTime {
+  uint64_t thousandths;
+  size_t unit;
+  bool negative;
+};
+
+bool GetPrettyTime(double milliseconds, PrettyTime* time) {
+  time->unit = 0;
+  while (time->unit + 1 < kNumTimeUnits &&
+         !(milliseconds < kTimeUnits[time->unit + 1].min_milliseconds)) {
+    ++time->unit;
+  }
+  double value = milliseconds / kTimeUnits[time->unit].milliseconds;
+  // Negative values rounding to zero are printed "-0.000".
+  time->negative = std::signbit(value);
+  double abs_value = std::fabs(value);
+  double thousandths = abs_value * 1000;
+  if (!(thousandths < kMaxThousandths)) return false;
+
+  // Rounds the exact product to nearest, ties to even, as printf() does:
+  // "error" is what the rounded product lacks.
+  double error = std::fma(abs_value, 1000, -thousandths);
+  double floor = std::floor(thousandths);
+  double above_half = thousandths - floor - 0.5;
+  time->thousandths = static_cast<uint64_t>(floor);
+  if (above_half > -error ||
+      (above_half == -error && time->thousandths % 2 != 0)) {
+    ++time->thousandths;
+  }
+  return true;
+}
+
+}  // namespace
+
+size_t FormatPrettyTime(double milliseconds, char* buffer) {
+  PrettyTime time;
+  if (!GetPrettyTime(milliseconds, &time)) {
+    const TimeUnit& unit = kTimeUnits[time.unit];
+    return snprintf(buffer, kMaxPrettyTimeLength, "%.3f %s",
+                    milliseconds / unit.milliseconds, unit.name);
+  }
+
+  // Digits are written backwards from the end of the number.
+  char digits[24];
+  char* end = digits + sizeof(digits);
+  char* begin = end;
+  uint64_t value = time.thousandths;
+  for (int i = 0; i < 3; ++i) {
+    *--begin = static_cast<char>('0' + value % 10);
+    value /= 10;
+  }
+  *--begin = '.';
+  do {
+    *--begin = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  if (time.negative) *--begin = '-';
+
+  char* text = buffer;
+  for (char* digit = begin; digit != end; ++digit) *text++ = *digit;
+  *text++ = ' ';
+  for (const char* c = kTimeUnits[time.unit].name; *c != '\0'; ++c) {
+    *text++ = *c;
+  }
+  *text = '\0';
+  return text - buffer;
+}
+
+uint64_t GetPrettyTimeKey(double milliseconds) {
+  PrettyTime time;
+  if (!GetPrettyTime(milliseconds, &time)) return 0;
+  // Units start at 1 so that no key is 0.
+  return time.thousandths << 4 | (time.unit + 1) << 1 | time.negative;
+}
+
+TimerLabelCache::Label TimerLabelCache::GetLabel(uint64_t function_address,
+                                                 std::string_view name,
+                                                 double milliseconds) {
+  uint64_t time_key = GetPrettyTimeKey(milliseconds);
+  if (time_key != 0) {
+    auto it = labels_.find(std::make_pair(function_address, time_key));
+    if (it != labels_.end()) return it->second;
+  }
+
+  char time[kMaxPrettyTimeLength];
+  size_t time_length = FormatPrettyTime(milliseconds, time);
+  Label label{arena_.Join({name, " ", std::string_view(time, time_length)}),
+              time_length};
+  if (time_key != 0) {
+    labels_.emplace(std::make_pair(function_address, time_key), label);
+  }
+  return label;
+}
+
+void TimerLabelCache::Clear() {
+  labels_.clear();
+  arena_.Reset();
+}
+
+size_t TimerLabelCache::GetMemoryUsage() const {
+  return labels_.capacity() *
+             (sizeof(std::pair<std::pair<uint64_t, uint64_t>, Label>) + 1) +
+         arena_.GetMemoryUsage();
+}
@@ -0,0 +1,48 @@
+#ifndef ORBIT_CORE_TIMER_LABEL_CACHE_H_
+#define ORBIT_CORE_TIMER_LABEL_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+#include "TextArena.h"
+#include "absl/container/flat_hash_map.h"
+
+// Longest text of FormatPrettyTime(), with the terminating null.
+constexpr size_t kMaxPrettyTimeLength = 32;
+
+// Writes "milliseconds" as GetPrettyTime() does, e.g. "1.234 ms", into
+// "buffer" of kMaxPrettyTimeLength chars, without allocating. Returns the
+// length.
+size_t FormatPrettyTime(double milliseconds, char* buffer);
+
+// Same for durations that FormatPrettyTime() writes the same, 0 for the
+// rare ones with no key, such as infinite durations.
+uint64_t GetPrettyTimeKey(double milliseconds);
+
+// Labels of timers, "<name> <duration>", made once per function and
+// displayed duration and reused by later frames, so zooming and scrolling
+// don't format strings. Labels are valid until Clear().
+class TimerLabelCache {
+ public:
+  struct Label {
+    const char* text;
+    // Length of the duration at the end of the text.
+    size_t time_length;
+  };
+  // Label of a timer of "function_address" lasting "milliseconds", made
+  // from "name" unless cached.
+  Label GetLabel(uint64_t function_address, std::string_view name,
+                 double milliseconds);
+
+  void Clear();
+  size_t size() const { return labels_.size(); }
+  size_t GetMemoryUsage() const;
+
+ private:
+  absl::flat_hash_map<std::pair<uint64_t, uint64_t>, Label> labels_;
+  TextArena arena_;
+};
+
+#endif  // ORBIT_CORE_TIMER_LABEL_CACHE_H_
@@ -0,0 +1,51 @@
+// Timing runs of the timer label cache against formatting each label.
+// Correctness is checked by TimerLabelCacheTest.cpp.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#include "TimerLabelCache.h"
+#include "Utils.h"
+
+TEST(TimerLabelCache, LabelsAreFasterThanStrFormat) {
+  // Zooming makes labels of the same timers again.
+  const int kNumTimers = 100000;
+  const int kNumFrames = 10;
+  std::string name = "SomeNamespace::SomeClass::SomeFunction";
+  auto GetMilliseconds = [](int i) { return (i % 1000) * 0.0123; };
+
+  auto start = std::chrono::steady_clock::now();
+  size_t length = 0;
+  for (int frame = 0; frame < kNumFrames; ++frame) {
+    for (int i = 0; i < kNumTimers; ++i) {
+      std::string time = GetPrettyTime(GetMilliseconds(i));
+      length += absl::StrFormat("%s %s", name, time).size();
+    }
+  }
+  auto formatted = std::chrono::steady_clock::now();
+
+  TimerLabelCache cache;
+  size_t cached_length = 0;
+  for (int frame = 0; frame < kNumFrames; ++frame) {
+    for (int i = 0; i < kNumTimers; ++i) {
+      TimerLabelCache::Label label =
+          cache.GetLabel(i % 16, name, GetMilliseconds(i));
+      cached_length += name.size() + 1 + label.time_length;
+    }
+  }
+  auto cached = std::chrono::steady_clock::now();
+
+  EXPECT_EQ(cached_length, length);
+  double format_ns =
+      std::chrono::duration<double, std::nano>(formatted - start).count();
+  double cached_ns =
+      std::chrono::duration<double, std::nano>(cached - formatted).count();
+  printf("StrFormat: %.1f ns per label, cache: %.1f ns per label\n",
+         format_ns / (kNumFrames * kNumTimers),
+         cached_ns / (kNumFrames * kNumTimers));
+  printf("Cache: %zu labels, %zu bytes\n", cache.size(),
+         cache.GetMemoryUsage());
+}
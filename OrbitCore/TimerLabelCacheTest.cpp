@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+#include "TimerLabelCache.h"
+#include "Utils.h"
+
+namespace {
+
+std::string FormatPrettyTime(double milliseconds) {
+  char buffer[kMaxPrettyTimeLength];
+  size_t length = ::FormatPrettyTime(milliseconds, buffer);
+  EXPECT_LT(length, kMaxPrettyTimeLength);
+  return std::string(buffer, length);
+}
+
+}  // namespace
+
+TEST(TimerLabelCache, FormatsLikeGetPrettyTime) {
+  const double kValues[] = {0,
+                            -0.0,
+                            -0.0000001,
+                            -5,
+                            0.0000004999,
+                            0.0000005,
+                            0.0000015,
+                            0.0005,
+                            0.0010005,
+                            1.0005,
+                            999.9999,
+                            59999.9999,
+                            1e12,
+                            1e20,
+                            std::numeric_limits<double>::infinity(),
+                            std::numeric_limits<double>::quiet_NaN()};
+  for (double milliseconds : kValues) {
+    EXPECT_EQ(FormatPrettyTime(milliseconds), GetPrettyTime(milliseconds));
+  }
+
+  // Durations of timers are whole nanoseconds.
+  uint64_t nanoseconds = 1;
+  for (int i = 0; i < 1000000; ++i) {
+    nanoseconds = nanoseconds * 6364136223846793005ull + 1442695040888963407ull;
+    double milliseconds = (nanoseconds >> (i % 64)) * 0.000001;
+    ASSERT_EQ(FormatPrettyTime(milliseconds), GetPrettyTime(milliseconds));
+  }
+  for (uint64_t i = 0; i < 1000000; ++i) {
+    double milliseconds = i * 0.000001;
+    ASSERT_EQ(FormatPrettyTime(milliseconds), GetPrettyTime(milliseconds));
+  }
+}
+
+TEST(TimerLabelCache, KeysMatchTexts) {
+  EXPECT_EQ(GetPrettyTimeKey(1.0004), GetPrettyTimeKey(1.0));
+  EXPECT_NE(GetPrettyTimeKey(1.0006), GetPrettyTimeKey(1.0));
+  EXPECT_NE(GetPrettyTimeKey(0.001), GetPrettyTimeKey(1.0));
+  EXPECT_NE(GetPrettyTimeKey(-1.0), GetPrettyTimeKey(1.0));
+  EXPECT_NE(GetPrettyTimeKey(0), 0);
+  EXPECT_EQ(GetPrettyTimeKey(std::numeric_limits<double>::infinity()), 0);
+}
+
+TEST(TimerLabelCache, ReusesLabels) {
+  TimerLabelCache cache;
+  TimerLabelCache::Label label = cache.GetLabel(0x1000, "Foo", 1.0);
+  EXPECT_STREQ(label.text, "Foo 1.000 ms");
+  EXPECT_EQ(label.time_length, 8);
+
+  EXPECT_EQ(cache.GetLabel(0x1000, "Foo", 1.0001).text, label.text);
+  EXPECT_STREQ(cache.GetLabel(0x1000, "Foo", 2.0).text, "Foo 2.000 ms");
+  EXPECT_STREQ(cache.GetLabel(0x2000, "Bar", 1.0).text, "Bar 1.000 ms");
+  EXPECT_STREQ(label.text, "Foo 1.000 ms");
+  EXPECT_EQ(cache.size(), 3);
+
+  cache.Clear();
+  EXPECT_EQ(cache.size(), 0);
+  EXPECT_STREQ(cache.GetLabel(0x1000, "Foo", 3.0).text, "Foo 3.000 ms");
+}
+
+TEST(TimerLabelCache, LabelsMatchStrFormat) {
+  // Zooming makes labels of the same timers again.
+  const int kNumTimers = 2000;
+  const int kNumFrames = 2;
+  std::string name = "SomeNamespace::SomeClass::SomeFunction";
+  auto GetMilliseconds = [](int i) { return (i % 1000) * 0.0123; };
+
+  TimerLabelCache cache;
+  for (int frame = 0; frame < kNumFrames; ++frame) {
+    for (int i = 0; i < kNumTimers; ++i) {
+      std::string time = GetPrettyTime(GetMilliseconds(i));
+      TimerLabelCache::Label label =
+          cache.GetLabel(i % 16, name, GetMilliseconds(i));
+      ASSERT_EQ(label.text, absl::StrFormat("%s %s", name, time));
+      ASSERT_EQ(label.time_length, time.size());
+    }
+  }
+  // One label per function and duration, reused by the second frame.
+  EXPECT_EQ(cache.size(), 2000);
+}
@@ -117,27 +117,24 @@ void TimerManager::ConsumeTimers() {
   SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
 #endif
 
-  Timer Timer;
+  std::vector<Timer> Timers(kMaxConsumedTimers);
 
   while (!m_ExitRequested) {
     m_ConditionVariable.wait();
 
-    while (!m_ExitRequested && !m_FlushRequested &&
-           m_LockFreeQueue.try_dequeue(Timer)) {
-      --m_NumQueuedEntries;
-      --m_NumQueuedTimers;
-
-      // if( Timer.m_SessionID == Message::GSessionID ) // TODO: re-enable
-      // check.
-      {
-        for (TimerAddedCallback& Callback : m_TimerAddedCallbacks) {
-          Callback(Timer);
-        }
+    while (!m_ExitRequested && !m_FlushRequested) {
+      size_t numTimers =
+          m_LockFreeQueue.try_dequeue_bulk(Timers.data(), kMaxConsumedTimers);
+      if (numTimers == 0) break;
+
+      m_NumQueuedEntries -= (int)numTimers;
+      m_NumQueuedTimers -= (int)numTimers;
+
+      // TODO: re-enable the check of Timer.m_SessionID against
+      // Message::GSessionID, counting m_NumTimersFromPreviousSession.
+      for (TimersAddedCallback& Callback : m_TimersAddedCallbacks) {
+        Callback(Timers.data(), numTimers);
       }
-      /*else
-      {
-          ++m_NumTimersFromPreviousSession;
-      }*/
     }
   }
 }
@@ -185,6 +182,16 @@ void TimerManager::Add(const Timer& a_Timer) {
   }
 }
 
+//-----------------------------------------------------------------------------
+void TimerManager::Add(const Timer* a_Timers, size_t a_NumTimers) {
+  if (m_IsRecording && a_NumTimers > 0) {
+    m_LockFreeQueue.enqueue_bulk(a_Timers, a_NumTimers);
+    m_ConditionVariable.signal();
+    m_NumQueuedEntries += (int)a_NumTimers;
+    m_NumQueuedTimers += (int)a_NumTimers;
+  }
+}
+
 //-----------------------------------------------------------------------------
 void TimerManager::Add(const Message& a_Message) {
   if (m_IsRecording || m_IsClient) {
@@ -33,6 +33,7 @@ class TimerManager {
   void StopClient();
 
   void Add(const Timer& a_Timer);
+  void Add(const Timer* a_Timers, size_t a_NumTimers);
   void Add(const Message& a_Message);
   void Add(const ContextSwitch& a_CS);
 
@@ -62,8 +63,11 @@ class TimerManager {
   std::thread* m_ConsumerThread = nullptr;
   bool m_IsClient = false;
 
-  typedef std::function<void(Timer&)> TimerAddedCallback;
-  std::vector<TimerAddedCallback> m_TimerAddedCallbacks;
+  // Called with the timers dequeued together, up to kMaxConsumedTimers.
+  typedef std::function<void(const Timer* a_Timers, size_t a_NumTimers)>
+      TimersAddedCallback;
+  std::vector<TimersAddedCallback> m_TimersAddedCallbacks;
+  static constexpr size_t kMaxConsumedTimers = 4096;
 
   typedef std::function<void(const struct ContextSwitch&)>
       ContextSwitchAddedCallback;
@@ -0,0 +1,66 @@
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(size_t num_workers) {
+  for (size_t i = 0; i < num_workers; ++i) {
+    workers_.emplace_back(&WorkerPool::Run, this);
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    exit_requested_ = true;
+  }
+  work_condition_.notify_all();
+  for (std::thread& worker : workers_) worker.join();
+}
+
+void WorkerPool::ParallelFor(size_t count,
+                             const std::function<void(size_t)>& function) {
+  if (workers_.empty() || count <= 1) {
+    for (size_t i = 0; i < count; ++i) function(i);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    function_ = &function;
+    count_ = count;
+    next_index_ = 0;
+    num_busy_workers_ = workers_.size();
+    ++loop_id_;
+  }
+  work_condition_.notify_all();
+
+  RunIterations();
+
+  // Workers can still be running their last iteration.
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_condition_.wait(lock, [this] { return num_busy_workers_ == 0; });
+  function_ = nullptr;
+}
+
+void WorkerPool::Run() {
+  uint64_t loop_id = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_condition_.wait(lock, [this, loop_id] {
+        return exit_requested_ || loop_id_ != loop_id;
+      });
+      if (exit_requested_) return;
+      loop_id = loop_id_;
+    }
+
+    RunIterations();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--num_busy_workers_ == 0) done_condition_.notify_one();
+  }
+}
+
+void WorkerPool::RunIterations() {
+  for (size_t i = next_index_++; i < count_; i = next_index_++) {
+    (*function_)(i);
+  }
+}
@@ -0,0 +1,49 @@
+#ifndef ORBIT_CORE_WORKER_POOL_H_
+#define ORBIT_CORE_WORKER_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Threads that run the iterations of a loop in parallel, for work done every
+// frame where starting threads each time would cost too much.
+//
+// ParallelFor() hands out the indices one by one, the calling thread taking
+// part, and returns once all iterations returned. Iterations must not call
+// ParallelFor() of the same pool. One thread calls ParallelFor() at a time.
+class WorkerPool {
+ public:
+  // With no workers, loops run serially on the calling thread.
+  explicit WorkerPool(size_t num_workers);
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+  ~WorkerPool();
+
+  void ParallelFor(size_t count, const std::function<void(size_t)>& function);
+
+  size_t GetNumWorkers() const { return workers_.size(); }
+
+ private:
+  void Run();
+  void RunIterations();
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable work_condition_;
+  std::condition_variable done_condition_;
+  // Incremented for each loop, workers wait for a new one.
+  uint64_t loop_id_ = 0;
+  size_t num_busy_workers_ = 0;
+  bool exit_requested_ = false;
+
+  const std::function<void(size_t)>* function_ = nullptr;
+  size_t count_ = 0;
+  std::atomic<size_t> next_index_{0};
+};
+
+#endif  // ORBIT_CORE_WORKER_POOL_H_
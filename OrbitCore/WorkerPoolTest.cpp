@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "WorkerPool.h"
+
+TEST(WorkerPool, EachIndexRunsOnce) {
+  for (size_t num_workers : {0, 1, 4}) {
+    WorkerPool pool(num_workers);
+    EXPECT_EQ(pool.GetNumWorkers(), num_workers);
+    for (size_t count : {0, 1, 2, 100, 10000}) {
+      std::vector<std::atomic<int>> num_calls(count);
+      pool.ParallelFor(count, [&num_calls](size_t i) { ++num_calls[i]; });
+      for (size_t i = 0; i < count; ++i) ASSERT_EQ(num_calls[i], 1);
+    }
+  }
+}
+
+TEST(WorkerPool, RunsOnWorkers) {
+  WorkerPool pool(3);
+  std::mutex mutex;
+  std::set<std::thread::id> thread_ids;
+  // Loops in a row reuse the workers, iterations wait for each other so
+  // that all threads take part.
+  for (int loop = 0; loop < 100; ++loop) {
+    std::atomic<int> num_started{0};
+    pool.ParallelFor(4, [&](size_t) {
+      ++num_started;
+      while (num_started < 4) std::this_thread::yield();
+      std::lock_guard<std::mutex> lock(mutex);
+      thread_ids.insert(std::this_thread::get_id());
+    });
+  }
+  EXPECT_EQ(thread_ids.size(), 4);
+}
+
+TEST(WorkerPool, NoWorkersRunsSerially) {
+  WorkerPool pool(0);
+  std::vector<size_t> indices;
+  pool.ParallelFor(5, [&indices](size_t i) { indices.push_back(i); });
+  EXPECT_EQ(indices, (std::vector<size_t>{0, 1, 2, 3, 4}));
+}
@@ -15,12 +15,15 @@
 
 #include "CallStackDataView.h"
 #include "Callstack.h"
+#include "CallstackEncoding.h"
 #include "Capture.h"
 #include "CaptureSerializer.h"
 #ifndef NOGL
 #include "CaptureWindow.h"
+#include "FlameGraphWindow.h"
 #endif
 #include "ConnectionManager.h"
+#include "ContextSwitchEncoding.h"
 #include "Debugger.h"
 #include "DiaManager.h"
 #include "FunctionDataView.h"
@@ -46,6 +49,7 @@
 #include "PluginManager.h"
 #include "PrintVar.h"
 #include "ProcessDataView.h"
+#include "ProcessEncoding.h"
 #ifndef NOGL
 #include "RuleEditor.h"
 #endif
@@ -88,10 +92,13 @@ OrbitApp::OrbitApp() {
 #ifdef _WIN32
   m_Debugger = new Debugger();
 #endif
+  CreateCaptureStreams();
 }
 
 //-----------------------------------------------------------------------------
 OrbitApp::~OrbitApp() {
+  // Stops flushing the streams before they are destroyed.
+  m_CaptureStreamer.Stop();
 #ifdef _WIN32
   oqpi_tk::stop_scheduler();
   delete m_Debugger;
@@ -114,12 +121,25 @@ std::wstring OrbitApp::FindFile(const std::wstring& a_Caption,
 void OrbitApp::SetCommandLineArguments(const std::vector<std::string>& a_Args) {
   m_Arguments = a_Args;
 
+  // "record:<file>" records the messages received from the service, for
+  // OrbitCaptureReplay. Looked up first, the client must record from the
+  // start.
+  std::string recordingPath;
+  for (const std::string& arg : a_Args) {
+    if (Contains(arg, "record:")) {
+      recordingPath = Replace(arg, "record:", "");
+    }
+  }
+
   for (const std::string& arg : a_Args) {
     if (Contains(arg, "gamelet:")) {
       std::string address = Replace(arg, "gamelet:", "");
       Capture::GCaptureHost = address;
 
       GTcpClient = std::make_unique<TcpClient>();
+      if (!recordingPath.empty()) {
+        GTcpClient->StartRecording(recordingPath);
+      }
       GTcpClient->AddMainThreadCallback(
           Msg_RemoteProcess,
           [=](const Message& a_Msg) { GOrbitApp->OnRemoteProcess(a_Msg); });
@@ -173,87 +193,93 @@ void GLoadPdbAsync(const std::vector<std::string>& a_Modules) {
   GModuleManager.LoadPdbAsync(a_Modules, []() { GOrbitApp->OnPdbLoaded(); });
 }
 
+// Capture data is sent to the client as soon as a chunk is full, or at the
+// latest kCaptureStreamLatency after the first event of a chunk.
+static constexpr std::chrono::milliseconds kCaptureStreamLatency(5);
+static constexpr size_t kTimerChunkSize = 4096;
+static constexpr size_t kContextSwitchChunkSize = 4096;
+static constexpr size_t kCallstackChunkSize = 512;
+
+//-----------------------------------------------------------------------------
+void OrbitApp::CreateCaptureStreams() {
+  m_TimerStream = std::make_unique<ChunkedStream<Timer>>(
+      &m_CaptureStreamer, kTimerChunkSize, kCaptureStreamLatency,
+      [](const std::vector<Timer>& a_Timers) {
+        Message Msg(Msg_RemoteTimers);
+        Msg.m_Size = uint32_t(sizeof(Timer) * a_Timers.size());
+        GTcpServer->Send(Msg, (void*)a_Timers.data());
+      });
+
+  m_SamplingCallstackStream =
+      std::make_unique<ChunkedStream<LinuxCallstackEvent>>(
+          &m_CaptureStreamer, kCallstackChunkSize, kCaptureStreamLatency,
+          [messageData = std::string()](
+              const std::vector<LinuxCallstackEvent>& a_CallStacks) mutable {
+            EncodeLinuxCallstackEvents(a_CallStacks, &messageData);
+            GTcpServer->Send(Msg_SamplingCallstacks, messageData.data(),
+                             messageData.size());
+          });
+
+  m_HashedSamplingCallstackStream =
+      std::make_unique<ChunkedStream<CallstackEvent>>(
+          &m_CaptureStreamer, kCallstackChunkSize, kCaptureStreamLatency,
+          [messageData = std::string()](
+              const std::vector<CallstackEvent>& a_CallStacks) mutable {
+            EncodeCallstackEvents(a_CallStacks, &messageData);
+            GTcpServer->Send(Msg_SamplingHashedCallstacks, messageData.data(),
+                             messageData.size());
+          });
+
+  m_ContextSwitchStream = std::make_unique<ChunkedStream<ContextSwitch>>(
+      &m_CaptureStreamer, kContextSwitchChunkSize, kCaptureStreamLatency,
+      [messageData = std::string()](
+          const std::vector<ContextSwitch>& a_ContextSwitches) mutable {
+        EncodeContextSwitches(a_ContextSwitches, &messageData);
+        GTcpServer->Send(Msg_RemoteContextSwitches, messageData.data(),
+                         messageData.size());
+      });
+}
+
 // TODO: find a better name
 //-----------------------------------------------------------------------------
 void OrbitApp::StartRemoteCaptureBufferingThread() {
   PRINT_FUNC;
-  m_TimerBuffer.clear();
-  m_SamplingCallstackBuffer.clear();
-  m_HashedSamplingCallstackBuffer.clear();
-  m_ContextSwitchBuffer.clear();
-  m_MessageBufferThread = std::make_shared<std::thread>(
-      &OrbitApp::ProcessBufferedCaptureData, this);
+  m_TimerStream->Clear();
+  m_TimerStream->ResetStats();
+  m_SamplingCallstackStream->Clear();
+  m_SamplingCallstackStream->ResetStats();
+  m_HashedSamplingCallstackStream->Clear();
+  m_HashedSamplingCallstackStream->ResetStats();
+  m_ContextSwitchStream->Clear();
+  m_ContextSwitchStream->ResetStats();
+  m_CaptureStreamer.Start();
 }
 
 //-----------------------------------------------------------------------------
-void OrbitApp::StopRemoteCaptureBufferingThread() {
-  PRINT_FUNC;
-  if (m_MessageBufferThread) {
-    m_MessageBufferThread->join();
-    m_MessageBufferThread = nullptr;
-  }
+template <typename T>
+static void PrintStreamStats(const char* a_Name, ChunkedStream<T>* a_Stream) {
+  typename ChunkedStream<T>::Stats stats = a_Stream->GetStats();
+  PRINT(absl::StrFormat(
+      "%s: %u items, %u full chunks, %u partial chunks, %u max pending\n",
+      a_Name, stats.num_items, stats.num_full_chunks, stats.num_partial_chunks,
+      stats.max_pending_chunks));
 }
 
 //-----------------------------------------------------------------------------
-void OrbitApp::ProcessBufferedCaptureData() {
-  while (Capture::IsCapturing()) {
-    OrbitSleepMs(20);
-
-    // timers:
-    {
-      ScopeLock lock(m_TimerMutex);
-      if (!m_TimerBuffer.empty()) {
-        Message Msg(Msg_RemoteTimers);
-        Msg.m_Size = uint32_t(sizeof(Timer) * m_TimerBuffer.size());
-        GTcpServer->Send(Msg, (void*)m_TimerBuffer.data());
-        m_TimerBuffer.clear();
-      }
-    }
-
-    // sampling callstacks
-    {
-      ScopeLock lock(m_SamplingCallstackMutex);
-      if (!m_SamplingCallstackBuffer.empty()) {
-        std::string messageData =
-            SerializeObjectBinary(m_SamplingCallstackBuffer);
-        GTcpServer->Send(Msg_SamplingCallstacks, messageData.c_str(),
-                         messageData.size());
-        m_SamplingCallstackBuffer.clear();
-      }
-    }
-
-    // hashed sampling callstacks
-    {
-      ScopeLock lock(m_HashedSamplingCallstackMutex);
-      if (!m_HashedSamplingCallstackBuffer.empty()) {
-        std::string messageData =
-            SerializeObjectBinary(m_HashedSamplingCallstackBuffer);
-        GTcpServer->Send(Msg_SamplingHashedCallstacks, messageData.c_str(),
-                         messageData.size());
-        m_HashedSamplingCallstackBuffer.clear();
-      }
-    }
-
-    // context switches
-    {
-      ScopeLock lock(m_ContextSwitchMutex);
-      if (!m_ContextSwitchBuffer.empty()) {
-        Message Msg(Msg_RemoteContextSwitches);
-        Msg.m_Size =
-            uint32_t(sizeof(ContextSwitch) * m_ContextSwitchBuffer.size());
-        GTcpServer->Send(Msg, (void*)m_ContextSwitchBuffer.data());
-        m_ContextSwitchBuffer.clear();
-      }
-    }
-  }
+void OrbitApp::StopRemoteCaptureBufferingThread() {
+  PRINT_FUNC;
+  m_CaptureStreamer.Stop();
+  PrintStreamStats("Timers", m_TimerStream.get());
+  PrintStreamStats("Callstacks", m_SamplingCallstackStream.get());
+  PrintStreamStats("Hashed callstacks", m_HashedSamplingCallstackStream.get());
+  PrintStreamStats("Context switches", m_ContextSwitchStream.get());
 }
 
 //-----------------------------------------------------------------------------
 void OrbitApp::ProcessTimer(const Timer& a_Timer,
                             const std::string& a_FunctionName) {
   if (ConnectionManager::Get().IsService()) {
-    ScopeLock lock(m_TimerMutex);
-    m_TimerBuffer.push_back(a_Timer);
+    m_TimerStream->Append(a_Timer);
   } else {
 #ifndef NOGL
     GCurrentTimeGraph->ProcessTimer(a_Timer);
@@ -265,6 +291,10 @@ void OrbitApp::ProcessTimer(const Timer& a_Timer,
 //-----------------------------------------------------------------------------
 void OrbitApp::ProcessSamplingCallStack(LinuxCallstackEvent& a_CallStack) {
   if (ConnectionManager::Get().IsService()) {
+    // Only one in GetSampleDivisor() samples is kept while the send queue
+    // fills up.
+    if (m_NumRemoteSamples++ % GTcpServer->GetSampleDivisor() != 0) return;
+
     // only send the callstack hash, if we know the callstack
     if (Capture::GSamplingProfiler->HasCallStack(a_CallStack.m_CS.Hash())) {
       CallstackEvent hashed_call_stack;
@@ -274,11 +304,11 @@ void OrbitApp::ProcessSamplingCallStack(LinuxCallstackEvent& a_CallStack) {
 
       ProcessHashedSamplingCallStack(hashed_call_stack);
     } else {
-      ScopeLock lock(m_SamplingCallstackMutex);
-      m_SamplingCallstackBuffer.push_back(a_CallStack);
+      m_SamplingCallstackStream->Append(a_CallStack);
     }
   } else {
-    Capture::GSamplingProfiler->AddCallStack(a_CallStack.m_CS);
+    Capture::GSamplingProfiler->AddCallStack(a_CallStack.m_CS,
+                                             a_CallStack.m_time);
     GEventTracer.GetEventBuffer().AddCallstackEvent(
         a_CallStack.m_time, a_CallStack.m_CS.m_Hash,
         a_CallStack.m_CS.m_ThreadId);
@@ -288,8 +318,7 @@ void OrbitApp::ProcessSamplingCallStack(LinuxCallstackEvent& a_CallStack) {
 //-----------------------------------------------------------------------------
 void OrbitApp::ProcessHashedSamplingCallStack(CallstackEvent& a_CallStack) {
   if (ConnectionManager::Get().IsService()) {
-    ScopeLock lock(m_HashedSamplingCallstackMutex);
-    m_HashedSamplingCallstackBuffer.push_back(a_CallStack);
+    m_HashedSamplingCallstackStream->Append(a_CallStack);
   } else {
     Capture::GSamplingProfiler->AddHashedCallStack(a_CallStack);
     GEventTracer.GetEventBuffer().AddCallstackEvent(
@@ -314,8 +343,7 @@ void OrbitApp::ProcessCallStack(CallStack& a_CallStack) {
 //-----------------------------------------------------------------------------
 void OrbitApp::ProcessContextSwitch(const ContextSwitch& a_ContextSwitch) {
   if (ConnectionManager::Get().IsService()) {
-    ScopeLock lock(m_ContextSwitchMutex);
-    m_ContextSwitchBuffer.push_back(a_ContextSwitch);
+    m_ContextSwitchStream->Append(a_ContextSwitch);
   }
 
   GTimerManager->Add(a_ContextSwitch);
@@ -358,10 +386,11 @@ void OrbitApp::LoadSystrace(const std::string& a_FileName) {
   }
   Capture::GVisibleFunctionsMap = Capture::GSelectedFunctionsMap;
 
-  for (const auto& timer : systrace->GetTimers()) {
 #ifndef NOGL
-    GCurrentTimeGraph->ProcessTimer(timer);
+  GCurrentTimeGraph->ProcessTimers(systrace->GetTimers().data(),
+                                   systrace->GetTimers().size());
 #endif
+  for (const auto& timer : systrace->GetTimers()) {
     ++Capture::GFunctionCountMap[timer.m_FunctionAddress];
   }
 
@@ -386,10 +415,11 @@ void OrbitApp::AppendSystrace(const std::string& a_FileName,
   }
   Capture::GVisibleFunctionsMap = Capture::GSelectedFunctionsMap;
 
-  for (const auto& timer : systrace->GetTimers()) {
 #ifndef NOGL
-    GCurrentTimeGraph->ProcessTimer(timer);
+  GCurrentTimeGraph->ProcessTimers(systrace->GetTimers().data(),
+                                   systrace->GetTimers().size());
 #endif
+  for (const auto& timer : systrace->GetTimers()) {
     Capture::GFunctionCountMap[timer.m_FunctionAddress];
   }
 
@@ -658,6 +688,8 @@ int OrbitApp::OnExit() {
 
   GParams.Save();
   GTimerManager = nullptr;
+  // The last flush of the capture streams sends with GTcpServer.
+  GOrbitApp->m_CaptureStreamer.Stop();
   if (GOrbitApp->HasTcpServer()) {
     GTcpServer->Stop();
   }
@@ -785,6 +817,14 @@ void OrbitApp::RegisterCaptureWindow(CaptureWindow* a_Capture) {
   m_CaptureWindow = a_Capture;
 }
 
+//-----------------------------------------------------------------------------
+void OrbitApp::RegisterFlameGraphWindow(FlameGraphWindow* a_FlameGraph) {
+#ifndef NOGL
+  assert(m_FlameGraphWindow == nullptr);
+  m_FlameGraphWindow = a_FlameGraph;
+#endif
+}
+
 //-----------------------------------------------------------------------------
 void OrbitApp::RegisterOutputLog(LogDataView* a_Log) {
   assert(m_Log == nullptr);
@@ -815,6 +855,12 @@ void OrbitApp::AddSamplingReport(
   for (SamplingReportCallback& callback : app->m_SamplingReportsCallbacks) {
     callback(report);
   }
+
+#ifndef NOGL
+  if (app->m_FlameGraphWindow) {
+    app->m_FlameGraphWindow->SetSamplingProfiler(sampling_profiler);
+  }
+#endif
 }
 
 //-----------------------------------------------------------------------------
@@ -1229,10 +1275,12 @@ void OrbitApp::OnMiniDump(const Message& a_Message) {
 
 //-----------------------------------------------------------------------------
 void OrbitApp::OnRemoteProcess(const Message& a_Message) {
-  std::istringstream buffer(std::string(a_Message.m_Data, a_Message.m_Size));
-  cereal::JSONInputArchive inputAr(buffer);
   std::shared_ptr<Process> remoteProcess = std::make_shared<Process>();
-  inputAr(*remoteProcess);
+  if (!DecodeProcess(a_Message.GetData(), a_Message.m_Size,
+                     remoteProcess.get())) {
+    PRINT("Malformed Msg_RemoteProcess message\n");
+    return;
+  }
   remoteProcess->SetIsRemote(true);
   PRINT_VAR(remoteProcess->GetName());
   GOrbitApp->m_ProcessesDataView->SetRemoteProcess(remoteProcess);
@@ -1240,11 +1288,13 @@ void OrbitApp::OnRemoteProcess(const Message& a_Message) {
 
 //-----------------------------------------------------------------------------
 void OrbitApp::OnRemoteProcessList(const Message& a_Message) {
-  std::istringstream buffer(std::string(a_Message.m_Data, a_Message.m_Size));
-  cereal::JSONInputArchive inputAr(buffer);
   std::shared_ptr<ProcessList> remoteProcessList =
       std::make_shared<ProcessList>();
-  inputAr(*remoteProcessList);
+  if (!DecodeProcessList(a_Message.GetData(), a_Message.m_Size,
+                         remoteProcessList.get())) {
+    PRINT("Malformed Msg_RemoteProcessList message\n");
+    return;
+  }
   remoteProcessList->SetRemote(true);
   GOrbitApp->m_ProcessesDataView->SetRemoteProcessList(remoteProcessList);
 }
@@ -9,6 +9,7 @@
 #include <queue>
 #include <string>
 
+#include "ChunkedStream.h"
 #include "ContextSwitch.h"
 #include "CoreApp.h"
 #include "CrashHandler.h"
@@ -79,7 +80,7 @@ class OrbitApp : public CoreApp {
   void ProcessContextSwitch(const ContextSwitch& a_ContextSwitch) override;
   void AddSymbol(uint64_t a_Address, const std::string& a_Module,
                  const std::string& a_Name) override;
-  void ProcessBufferedCaptureData();
+  void CreateCaptureStreams();
 
   int* GetScreenRes() { return m_ScreenRes; }
 
@@ -92,6 +93,7 @@ class OrbitApp : public CoreApp {
   void RegisterGlobalsDataView(class GlobalsDataView* a_Globals);
   void RegisterSessionsDataView(class SessionsDataView* a_Sessions);
   void RegisterCaptureWindow(class CaptureWindow* a_Capture);
+  void RegisterFlameGraphWindow(class FlameGraphWindow* a_FlameGraph);
   void RegisterOutputLog(class LogDataView* a_Log);
   void RegisterRuleEditor(class RuleEditor* a_RuleEditor);
 
@@ -231,6 +233,7 @@ class OrbitApp : public CoreApp {
   GlobalsDataView* m_GlobalsDataView = nullptr;
   SessionsDataView* m_SessionsDataView = nullptr;
   CaptureWindow* m_CaptureWindow = nullptr;
+  FlameGraphWindow* m_FlameGraphWindow = nullptr;
   LogDataView* m_Log = nullptr;
   RuleEditor* m_RuleEditor = nullptr;
   int m_ScreenRes[2];
@@ -243,16 +246,17 @@ class OrbitApp : public CoreApp {
   std::vector<std::string> m_SymbolDirectories;
   std::function<void(const std::wstring&)> m_UiCallback;
 
-  // buffering data to send large messages instead of small ones:
-  std::shared_ptr<std::thread> m_MessageBufferThread = nullptr;
-  std::vector<ContextSwitch> m_ContextSwitchBuffer;
-  Mutex m_ContextSwitchMutex;
-  std::vector<Timer> m_TimerBuffer;
-  Mutex m_TimerMutex;
-  std::vector<LinuxCallstackEvent> m_SamplingCallstackBuffer;
-  Mutex m_SamplingCallstackMutex;
-  std::vector<CallstackEvent> m_HashedSamplingCallstackBuffer;
-  Mutex m_HashedSamplingCallstackMutex;
+  // Streaming capture data in chunks to send large messages instead of
+  // small ones. The streamer is declared last, it is destroyed first and
+  // its thread stops flushing the streams before they are.
+  std::unique_ptr<ChunkedStream<ContextSwitch>> m_ContextSwitchStream;
+  std::unique_ptr<ChunkedStream<Timer>> m_TimerStream;
+  std::unique_ptr<ChunkedStream<LinuxCallstackEvent>> m_SamplingCallstackStream;
+  std::unique_ptr<ChunkedStream<CallstackEvent>>
+      m_HashedSamplingCallstackStream;
+  ChunkStreamer m_CaptureStreamer;
+  // Samples of the service, some of which are skipped under backpressure.
+  uint64_t m_NumRemoteSamples = 0;
 
   std::wstring m_User;
   std::wstring m_License;
@@ -4,6 +4,42 @@
 #include "Batcher.h"
 
 #include "Core.h"
+#include "GlBatcherBackend.h"
+
+//-----------------------------------------------------------------------------
+Batcher::Batcher() : m_Backend(std::make_unique<GlBatcherBackend>()) {}
+
+//-----------------------------------------------------------------------------
+Batcher::Batcher(std::unique_ptr<BatcherBackend> a_Backend)
+    : m_Backend(std::move(a_Backend)) {}
+
+//-----------------------------------------------------------------------------
+Batcher::~Batcher() {
+  for (std::vector<BlockBuffers>* blockBuffers :
+       {&m_LineBlockBuffers, &m_BoxBlockBuffers}) {
+    for (BlockBuffers& buffers : *blockBuffers) {
+      for (BlockBuffer* buffer : {&buffers.m_Vertices, &buffers.m_Colors,
+                                  &buffers.m_PickingColors}) {
+        if (buffer->m_Id != 0) m_Backend->DeleteBuffer(buffer->m_Id);
+      }
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void Batcher::Reset() {
+  m_LineBuffer.Reset();
+  m_BoxBuffer.Reset();
+
+  for (std::vector<BlockBuffers>* blockBuffers :
+       {&m_LineBlockBuffers, &m_BoxBlockBuffers}) {
+    for (BlockBuffers& buffers : *blockBuffers) {
+      buffers.m_Vertices.m_NumUploaded = 0;
+      buffers.m_Colors.m_NumUploaded = 0;
+      buffers.m_PickingColors.m_NumUploaded = 0;
+    }
+  }
+}
 
 //-----------------------------------------------------------------------------
 TextBox* Batcher::GetTextBox(PickingID a_ID) {
@@ -18,4 +54,120 @@ TextBox* Batcher::GetTextBox(PickingID a_ID) {
   }
 
   return nullptr;
-}
\ No newline at end of file
+}
+
+//-----------------------------------------------------------------------------
+void Batcher::Draw(bool a_Picking) {
+  m_Backend->BeginDraw();
+  DrawBoxBlocks(a_Picking);
+  DrawLineBlocks(a_Picking);
+  m_Backend->EndDraw();
+}
+
+//----------------------------------------------------------------------------
+void Batcher::DrawBoxBlocks(bool a_Picking) {
+  const uint32_t blockSize = BoxBuffer::NUM_BOXES_PER_BLOCK;
+  Block<BoxInstance, blockSize>* block = m_BoxBuffer.m_Boxes.m_Root;
+
+  // Boxes are stored as instances, their vertices and colors are made as
+  // they are uploaded.
+  for (size_t i = 0; block != nullptr; ++i, block = block->m_Next) {
+    uint32_t numBoxes = block->m_Size;
+    if (numBoxes == 0) continue;
+    if (i == m_BoxBlockBuffers.size()) m_BoxBlockBuffers.emplace_back();
+    BlockBuffers& buffers = m_BoxBlockBuffers[i];
+    BlockBuffer& colors =
+        !a_Picking ? buffers.m_Colors : buffers.m_PickingColors;
+
+    uint32_t begin = GetDirtyBegin(&buffers.m_Vertices,
+                                   4 * blockSize * sizeof(Vec3), numBoxes);
+    if (begin < numBoxes) {
+      m_BoxVertices.clear();
+      for (uint32_t j = begin; j < numBoxes; ++j) {
+        Box box = block->m_Data[j].GetBox();
+        m_BoxVertices.insert(m_BoxVertices.end(), box.m_Vertices,
+                             box.m_Vertices + 4);
+      }
+      Upload(&buffers.m_Vertices, 4 * begin * sizeof(Vec3),
+             m_BoxVertices.size() * sizeof(Vec3), m_BoxVertices.data(),
+             numBoxes);
+    }
+
+    begin = GetDirtyBegin(&colors, 4 * blockSize * sizeof(Color), numBoxes);
+    if (begin < numBoxes) {
+      m_BoxColors.clear();
+      for (uint32_t j = begin; j < numBoxes; ++j) {
+        if (!a_Picking) {
+          const Color* boxColors = m_BoxBuffer.GetColors(block->m_Data[j]);
+          m_BoxColors.insert(m_BoxColors.end(), boxColors, boxColors + 4);
+        } else {
+          uint32_t id = static_cast<uint32_t>(i * blockSize + j);
+          m_BoxColors.insert(m_BoxColors.end(), 4,
+                             PickingID::GetColor(PickingID::BOX, id));
+        }
+      }
+      Upload(&colors, 4 * begin * sizeof(Color),
+             m_BoxColors.size() * sizeof(Color), m_BoxColors.data(),
+             numBoxes);
+    }
+
+    m_Backend->Draw(BatcherBackend::QUADS, buffers.m_Vertices.m_Id,
+                    colors.m_Id, 4 * numBoxes);
+  }
+}
+
+//----------------------------------------------------------------------------
+void Batcher::DrawLineBlocks(bool a_Picking) {
+  const uint32_t blockSize = LineBuffer::NUM_LINES_PER_BLOCK;
+  Block<Line, blockSize>* block = m_LineBuffer.m_Lines.m_Root;
+  Block<Color, 2 * blockSize>* colorBlock =
+      !a_Picking ? m_LineBuffer.m_Colors.m_Root
+                 : m_LineBuffer.m_PickingColors.m_Root;
+
+  for (size_t i = 0; block != nullptr;
+       ++i, block = block->m_Next, colorBlock = colorBlock->m_Next) {
+    uint32_t numLines = block->m_Size;
+    if (numLines == 0) continue;
+    if (i == m_LineBlockBuffers.size()) m_LineBlockBuffers.emplace_back();
+    BlockBuffers& buffers = m_LineBlockBuffers[i];
+    BlockBuffer& colors =
+        !a_Picking ? buffers.m_Colors : buffers.m_PickingColors;
+
+    uint32_t begin = GetDirtyBegin(&buffers.m_Vertices,
+                                   blockSize * sizeof(Line), numLines);
+    if (begin < numLines) {
+      Upload(&buffers.m_Vertices, begin * sizeof(Line),
+             (numLines - begin) * sizeof(Line), &block->m_Data[begin],
+             numLines);
+    }
+
+    begin = GetDirtyBegin(&colors, 2 * blockSize * sizeof(Color), numLines);
+    if (begin < numLines) {
+      Upload(&colors, 2 * begin * sizeof(Color),
+             2 * (numLines - begin) * sizeof(Color),
+             &colorBlock->m_Data[2 * begin], numLines);
+    }
+
+    m_Backend->Draw(BatcherBackend::LINES, buffers.m_Vertices.m_Id,
+                    colors.m_Id, 2 * numLines);
+  }
+}
+
+//----------------------------------------------------------------------------
+uint32_t Batcher::GetDirtyBegin(BlockBuffer* a_Buffer, size_t a_Size,
+                                uint32_t a_NumElements) {
+  if (a_Buffer->m_Id == 0) a_Buffer->m_Id = m_Backend->CreateBuffer(a_Size);
+
+  // Elements are only appended until Reset(), the ones past the uploaded
+  // ones are the dirty range.
+  if (a_NumElements < a_Buffer->m_NumUploaded) a_Buffer->m_NumUploaded = 0;
+  return a_Buffer->m_NumUploaded;
+}
+
+//----------------------------------------------------------------------------
+void Batcher::Upload(BlockBuffer* a_Buffer, size_t a_Offset, size_t a_Size,
+                     const void* a_Data, uint32_t a_NumElements) {
+  m_Backend->UploadBuffer(a_Buffer->m_Id, a_Offset, a_Size, a_Data);
+  a_Buffer->m_NumUploaded = a_NumElements;
+  m_NumUploadedBytes += a_Size;
+}
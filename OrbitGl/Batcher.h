@@ -2,11 +2,16 @@
 // Copyright Pierric Gimmig 2013-2017
 //-----------------------------------
 #pragma once
+#include <cstring>
+#include <memory>
+#include <utility>
 #include <vector>
 
+#include "BatcherBackend.h"
 #include "BlockChain.h"
 #include "Geometry.h"
 #include "PickingManager.h"
+#include "absl/container/flat_hash_map.h"
 
 //-----------------------------------------------------------------------------
 struct LineBuffer {
@@ -24,27 +29,129 @@ struct LineBuffer {
   BlockChain<void*, NUM_LINES_PER_BLOCK> m_UserData;
 };
 
+//-----------------------------------------------------------------------------
+// Axis-aligned box in 24 bytes instead of 80 for a Box with its colors and
+// picking colors. Colors of the vertices are in the palette of the box
+// buffer, few distinct ones are used. The picking id is the index of the
+// box.
+struct BoxInstance {
+  // Vertices from the bottom left, clockwise.
+  Box GetBox() const {
+    Box box;
+    box.m_Vertices[0] = Vec3(m_X, m_Y, m_Z);
+    box.m_Vertices[1] = Vec3(m_X, m_Y + m_Height, m_Z);
+    box.m_Vertices[2] = Vec3(m_X + m_Width, m_Y + m_Height, m_Z);
+    box.m_Vertices[3] = Vec3(m_X + m_Width, m_Y, m_Z);
+    return box;
+  }
+
+  float m_X;
+  float m_Y;
+  float m_Width;
+  float m_Height;
+  float m_Z;
+  uint32_t m_ColorIndex;
+};
+
+//-----------------------------------------------------------------------------
+struct BoxColors {
+  Color m_Colors[4];
+};
+
 //-----------------------------------------------------------------------------
 struct BoxBuffer {
   inline void Reset() {
     m_Boxes.Reset();
-    m_Colors.Reset();
-    m_PickingColors.Reset();
     m_UserData.Reset();
+    m_Palette.clear();
+    m_PaletteIndices.clear();
+  }
+
+  // Index of "a_Colors", four colors, in the palette.
+  inline uint32_t GetColorIndex(const Color* a_Colors) {
+    static_assert(sizeof(BoxColors) == 2 * sizeof(uint64_t),
+                  "Colors of a box must be 16 bytes");
+    std::pair<uint64_t, uint64_t> key;
+    memcpy(&key.first, a_Colors, sizeof(uint64_t));
+    memcpy(&key.second, a_Colors + 2, sizeof(uint64_t));
+    auto result = m_PaletteIndices.try_emplace(key, m_Palette.size());
+    if (result.second) {
+      m_Palette.push_back({{a_Colors[0], a_Colors[1], a_Colors[2],
+                            a_Colors[3]}});
+    }
+    return result.first->second;
+  }
+  const Color* GetColors(const BoxInstance& a_Box) const {
+    return m_Palette[a_Box.m_ColorIndex].m_Colors;
   }
 
   static const int NUM_BOXES_PER_BLOCK = 64 * 1024;
 
-  BlockChain<Box, NUM_BOXES_PER_BLOCK> m_Boxes;
-  BlockChain<Color, 4 * NUM_BOXES_PER_BLOCK> m_Colors;
-  BlockChain<Color, 4 * NUM_BOXES_PER_BLOCK> m_PickingColors;
+  BlockChain<BoxInstance, NUM_BOXES_PER_BLOCK> m_Boxes;
   BlockChain<void*, NUM_BOXES_PER_BLOCK> m_UserData;
+  std::vector<BoxColors> m_Palette;
+  absl::flat_hash_map<std::pair<uint64_t, uint64_t>, uint32_t>
+      m_PaletteIndices;
 };
 
 //-----------------------------------------------------------------------------
+// Primitives recorded apart from the batcher, on another thread, and added
+// to it later with Batcher::Append(). Picking ids are assigned when added.
+class BatchSegment {
+ public:
+  void AddLine(const Line& a_Line, const Color* a_Colors,
+               PickingID::Type a_Type, void* a_UserData = nullptr) {
+    m_Lines.push_back({a_Line, {a_Colors[0], a_Colors[1]}, a_Type, a_UserData});
+  }
+
+  void AddBox(const Box& a_Box, const Color* a_Colors,
+              void* a_UserData = nullptr) {
+    m_Boxes.push_back({a_Box,
+                       {a_Colors[0], a_Colors[1], a_Colors[2], a_Colors[3]},
+                       a_UserData});
+  }
+
+  // Keeps the memory for the next primitives.
+  void Clear() {
+    m_Lines.clear();
+    m_Boxes.clear();
+  }
+
+ protected:
+  friend class Batcher;
+
+  struct LinePrimitive {
+    Line m_Line;
+    Color m_Colors[2];
+    PickingID::Type m_Type;
+    void* m_UserData;
+  };
+
+  struct BoxPrimitive {
+    Box m_Box;
+    Color m_Colors[4];
+    void* m_UserData;
+  };
+
+  std::vector<LinePrimitive> m_Lines;
+  std::vector<BoxPrimitive> m_Boxes;
+};
+
+//-----------------------------------------------------------------------------
+// Primitives drawn in batches. Each block of primitives has buffer objects
+// of the backend, filled as primitives are added: as primitives are only
+// appended until Reset(), draws upload the primitives added since the
+// previous draw, and nothing when nothing changed.
 class Batcher {
  public:
-  inline void AddLine(const Line& a_Line, Color* a_Colors,
+  // Draws with OpenGL.
+  Batcher();
+  explicit Batcher(std::unique_ptr<BatcherBackend> a_Backend);
+  ~Batcher();
+  Batcher(const Batcher&) = delete;
+  Batcher& operator=(const Batcher&) = delete;
+
+  inline void AddLine(const Line& a_Line, const Color* a_Colors,
                       PickingID::Type a_Type, void* a_UserData = nullptr) {
     Color pickCol = PickingID::GetColor(a_Type, m_LineBuffer.m_Lines.size());
     m_LineBuffer.m_Lines.push_back(a_Line);
@@ -53,18 +160,32 @@ class Batcher {
     m_LineBuffer.m_UserData.push_back(a_UserData);
   }
 
-  inline void AddBox(const Box& a_Box, Color* a_Colors, PickingID::Type a_Type,
+  // Boxes are axis-aligned, with vertices ordered as BoxInstance::GetBox()
+  // makes them, and picked as PickingID::BOX.
+  inline void AddBox(const Box& a_Box, const Color* a_Colors,
                      void* a_UserData = nullptr) {
-    Color pickCol = PickingID::GetColor(a_Type, m_BoxBuffer.m_Boxes.size());
-    m_BoxBuffer.m_Boxes.push_back(a_Box);
-    m_BoxBuffer.m_Colors.push_back(a_Colors, 4);
-    m_BoxBuffer.m_PickingColors.push_back_n(pickCol, 4);
+    BoxInstance box;
+    box.m_X = a_Box.m_Vertices[0][0];
+    box.m_Y = a_Box.m_Vertices[0][1];
+    box.m_Width = a_Box.m_Vertices[2][0] - box.m_X;
+    box.m_Height = a_Box.m_Vertices[2][1] - box.m_Y;
+    box.m_Z = a_Box.m_Vertices[0][2];
+    box.m_ColorIndex = m_BoxBuffer.GetColorIndex(a_Colors);
+    m_BoxBuffer.m_Boxes.push_back(box);
     m_BoxBuffer.m_UserData.push_back(a_UserData);
   }
 
-  inline void Reset() {
-    m_LineBuffer.Reset();
-    m_BoxBuffer.Reset();
+  // Keeps the buffer objects, the next draw uploads their new content.
+  void Reset();
+
+  // Adds the primitives of "a_Segment" in the order they were recorded.
+  void Append(const BatchSegment& a_Segment) {
+    for (const BatchSegment::BoxPrimitive& box : a_Segment.m_Boxes) {
+      AddBox(box.m_Box, box.m_Colors, box.m_UserData);
+    }
+    for (const BatchSegment::LinePrimitive& line : a_Segment.m_Lines) {
+      AddLine(line.m_Line, line.m_Colors, line.m_Type, line.m_UserData);
+    }
   }
 
   TextBox* GetTextBox(PickingID a_ID);
@@ -72,7 +193,40 @@ class Batcher {
   BoxBuffer& GetBoxBuffer() { return m_BoxBuffer; }
   LineBuffer& GetLineBuffer() { return m_LineBuffer; }
 
+  void Draw(bool a_Picking);
+
+  // Bytes uploaded to buffer objects since the creation.
+  uint64_t GetNumUploadedBytes() const { return m_NumUploadedBytes; }
+
  protected:
+  // Buffer object of a block, and how many elements of the block it holds.
+  struct BlockBuffer {
+    uint32_t m_Id = 0;
+    uint32_t m_NumUploaded = 0;
+  };
+  struct BlockBuffers {
+    BlockBuffer m_Vertices;
+    BlockBuffer m_Colors;
+    BlockBuffer m_PickingColors;
+  };
+
+  void DrawBoxBlocks(bool a_Picking);
+  void DrawLineBlocks(bool a_Picking);
+  // First element of the range of "a_Buffer" to upload for it to hold
+  // "a_NumElements", the buffer being created with "a_Size" bytes.
+  uint32_t GetDirtyBegin(BlockBuffer* a_Buffer, size_t a_Size,
+                         uint32_t a_NumElements);
+  void Upload(BlockBuffer* a_Buffer, size_t a_Offset, size_t a_Size,
+              const void* a_Data, uint32_t a_NumElements);
+
   LineBuffer m_LineBuffer;
   BoxBuffer m_BoxBuffer;
+
+  std::unique_ptr<BatcherBackend> m_Backend;
+  std::vector<BlockBuffers> m_LineBlockBuffers;
+  std::vector<BlockBuffers> m_BoxBlockBuffers;
+  // Vertices and colors of the boxes being uploaded.
+  std::vector<Vec3> m_BoxVertices;
+  std::vector<Color> m_BoxColors;
+  uint64_t m_NumUploadedBytes = 0;
 };
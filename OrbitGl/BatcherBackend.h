@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+//-----------------------------------------------------------------------------
+// Buffer objects that Batcher uploads its primitives to and draws from:
+// vertices are Vec3 and colors are Color, one per vertex. GlBatcherBackend
+// draws with OpenGL, tests use a fake backend.
+class BatcherBackend {
+ public:
+  enum PrimitiveType { LINES, QUADS };
+
+  virtual ~BatcherBackend() = default;
+
+  // Returns the non-zero id of a buffer of "a_Size" bytes.
+  virtual uint32_t CreateBuffer(size_t a_Size) = 0;
+  virtual void DeleteBuffer(uint32_t a_Buffer) = 0;
+  virtual void UploadBuffer(uint32_t a_Buffer, size_t a_Offset, size_t a_Size,
+                            const void* a_Data) = 0;
+
+  // Draws happen between BeginDraw() and EndDraw().
+  virtual void BeginDraw() = 0;
+  virtual void Draw(PrimitiveType a_Type, uint32_t a_VertexBuffer,
+                    uint32_t a_ColorBuffer, uint32_t a_NumVertices) = 0;
+  virtual void EndDraw() = 0;
+};
@@ -0,0 +1,395 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "Batcher.h"
+#include "WorkerPool.h"
+
+namespace {
+
+const size_t kNumTracks = 32;
+
+// Primitives of a track as TimeGraph::UpdateTrackPrimitives() would make
+// them, different counts and values per track.
+void MakeTrackPrimitives(size_t track, std::vector<int>* user_data,
+                         BatchSegment* segment) {
+  size_t num_timers = 100 + 37 * track;
+  user_data->resize(num_timers);
+  for (size_t i = 0; i < num_timers; ++i) {
+    float x = static_cast<float>(i);
+    float y = static_cast<float>(track);
+    auto c = static_cast<unsigned char>(track * 7 + i);
+    Color colors[4] = {Color(c, 0, 0, 255), Color(0, c, 0, 255),
+                       Color(0, 0, c, 255), Color(c, c, c, 255)};
+    if (i % 3 == 0) {
+      Line line;
+      line.m_Beg = Vec3(x, y, 0.f);
+      line.m_End = Vec3(x, y + 1.f, 0.f);
+      segment->AddLine(line, colors, PickingID::LINE, &(*user_data)[i]);
+    } else {
+      Box box;
+      box.m_Vertices[0] = Vec3(x, y, 0.f);
+      box.m_Vertices[1] = Vec3(x, y + 1.f, 0.f);
+      box.m_Vertices[2] = Vec3(x + 0.5f, y + 1.f, 0.f);
+      box.m_Vertices[3] = Vec3(x + 0.5f, y, 0.f);
+      segment->AddBox(box, colors, &(*user_data)[i]);
+    }
+  }
+}
+
+template <class T, uint32_t BlockSize>
+std::vector<T> ToVector(BlockChain<T, BlockSize>* chain) {
+  std::vector<T> values;
+  for (const T& value : *chain) values.push_back(value);
+  return values;
+}
+
+void ExpectSameLines(Batcher* expected, Batcher* actual) {
+  LineBuffer& expected_lines = expected->GetLineBuffer();
+  LineBuffer& actual_lines = actual->GetLineBuffer();
+  std::vector<Line> lines = ToVector(&expected_lines.m_Lines);
+  std::vector<Line> other_lines = ToVector(&actual_lines.m_Lines);
+  ASSERT_EQ(lines.size(), other_lines.size());
+  for (size_t i = 0; i < lines.size(); ++i) {
+    EXPECT_EQ(lines[i].m_Beg, other_lines[i].m_Beg);
+    EXPECT_EQ(lines[i].m_End, other_lines[i].m_End);
+  }
+  EXPECT_EQ(ToVector(&expected_lines.m_Colors),
+            ToVector(&actual_lines.m_Colors));
+  EXPECT_EQ(ToVector(&expected_lines.m_PickingColors),
+            ToVector(&actual_lines.m_PickingColors));
+  EXPECT_EQ(ToVector(&expected_lines.m_UserData),
+            ToVector(&actual_lines.m_UserData));
+}
+
+void ExpectSameBoxes(Batcher* expected, Batcher* actual) {
+  BoxBuffer& expected_boxes = expected->GetBoxBuffer();
+  BoxBuffer& actual_boxes = actual->GetBoxBuffer();
+  std::vector<BoxInstance> boxes = ToVector(&expected_boxes.m_Boxes);
+  std::vector<BoxInstance> other_boxes = ToVector(&actual_boxes.m_Boxes);
+  ASSERT_EQ(boxes.size(), other_boxes.size());
+  for (size_t i = 0; i < boxes.size(); ++i) {
+    Box box = boxes[i].GetBox();
+    Box other_box = other_boxes[i].GetBox();
+    const Color* colors = expected_boxes.GetColors(boxes[i]);
+    const Color* other_colors = actual_boxes.GetColors(other_boxes[i]);
+    for (int j = 0; j < 4; ++j) {
+      EXPECT_EQ(box.m_Vertices[j], other_box.m_Vertices[j]);
+      EXPECT_EQ(colors[j], other_colors[j]);
+    }
+  }
+  EXPECT_EQ(ToVector(&expected_boxes.m_UserData),
+            ToVector(&actual_boxes.m_UserData));
+}
+
+// Buffers in memory, recording uploads and draws.
+class FakeBatcherBackend : public BatcherBackend {
+ public:
+  struct Upload {
+    uint32_t buffer;
+    size_t offset;
+    size_t size;
+  };
+  struct DrawCall {
+    PrimitiveType type;
+    uint32_t vertex_buffer;
+    uint32_t color_buffer;
+    uint32_t num_vertices;
+  };
+
+  uint32_t CreateBuffer(size_t size) override {
+    buffers_[++last_id_].resize(size);
+    return last_id_;
+  }
+  void DeleteBuffer(uint32_t buffer) override {
+    EXPECT_EQ(buffers_.erase(buffer), 1);
+  }
+  void UploadBuffer(uint32_t buffer, size_t offset, size_t size,
+                    const void* data) override {
+    std::vector<char>& buffer_data = buffers_.at(buffer);
+    ASSERT_LE(offset + size, buffer_data.size());
+    memcpy(buffer_data.data() + offset, data, size);
+    uploads_.push_back({buffer, offset, size});
+  }
+
+  void BeginDraw() override {
+    EXPECT_FALSE(drawing_);
+    drawing_ = true;
+  }
+  void Draw(PrimitiveType type, uint32_t vertex_buffer, uint32_t color_buffer,
+            uint32_t num_vertices) override {
+    EXPECT_TRUE(drawing_);
+    draws_.push_back({type, vertex_buffer, color_buffer, num_vertices});
+  }
+  void EndDraw() override {
+    EXPECT_TRUE(drawing_);
+    drawing_ = false;
+  }
+
+  std::map<uint32_t, std::vector<char>> buffers_;
+  std::vector<Upload> uploads_;
+  std::vector<DrawCall> draws_;
+
+ private:
+  uint32_t last_id_ = 0;
+  bool drawing_ = false;
+};
+
+Box MakeBox(float x) {
+  Box box;
+  box.m_Vertices[0] = Vec3(x, 0.f, 0.5f);
+  box.m_Vertices[1] = Vec3(x, 1.f, 0.5f);
+  box.m_Vertices[2] = Vec3(x + 0.5f, 1.f, 0.5f);
+  box.m_Vertices[3] = Vec3(x + 0.5f, 0.f, 0.5f);
+  return box;
+}
+
+void AddBoxes(size_t begin, size_t end, Batcher* batcher,
+              std::vector<int>* user_data = nullptr) {
+  for (size_t i = begin; i < end; ++i) {
+    auto c = static_cast<unsigned char>(i);
+    Color colors[4] = {Color(c, 0, 0, 255), Color(0, c, 0, 255),
+                       Color(0, 0, c, 255), Color(c, c, c, 255)};
+    void* box_user_data = user_data ? &(*user_data)[i] : nullptr;
+    batcher->AddBox(MakeBox(float(i)), colors, box_user_data);
+  }
+}
+
+// Whether the drawn buffers hold the batcher's boxes and colors.
+void ExpectDrawnBoxes(const FakeBatcherBackend& backend, bool picking,
+                      Batcher* batcher) {
+  BoxBuffer& boxes = batcher->GetBoxBuffer();
+  std::vector<Box> expected_boxes;
+  std::vector<Color> expected_colors;
+  for (const BoxInstance& box : boxes.m_Boxes) {
+    expected_boxes.push_back(box.GetBox());
+    for (int i = 0; i < 4; ++i) {
+      uint32_t id = static_cast<uint32_t>(expected_boxes.size() - 1);
+      expected_colors.push_back(picking
+                                    ? PickingID::GetColor(PickingID::BOX, id)
+                                    : boxes.GetColors(box)[i]);
+    }
+  }
+
+  size_t num_boxes = 0;
+  for (const FakeBatcherBackend::DrawCall& draw : backend.draws_) {
+    if (draw.type != BatcherBackend::QUADS) continue;
+    uint32_t num_draw_boxes = draw.num_vertices / 4;
+    ASSERT_LE(num_boxes + num_draw_boxes, expected_boxes.size());
+    const std::vector<char>& vertices = backend.buffers_.at(draw.vertex_buffer);
+    const std::vector<char>& colors = backend.buffers_.at(draw.color_buffer);
+    EXPECT_EQ(memcmp(vertices.data(), &expected_boxes[num_boxes],
+                     num_draw_boxes * sizeof(Box)),
+              0);
+    EXPECT_EQ(memcmp(colors.data(), &expected_colors[4 * num_boxes],
+                     draw.num_vertices * sizeof(Color)),
+              0);
+    num_boxes += num_draw_boxes;
+  }
+  EXPECT_EQ(num_boxes, expected_boxes.size());
+}
+
+}  // namespace
+
+TEST(Batcher, AppendAssignsPickingIdsInOrder) {
+  std::vector<int> user_data;
+  BatchSegment segment;
+  MakeTrackPrimitives(0, &user_data, &segment);
+  auto backend_ptr = std::make_unique<FakeBatcherBackend>();
+  FakeBatcherBackend& backend = *backend_ptr;
+  Batcher batcher(std::move(backend_ptr));
+  batcher.Append(segment);
+  batcher.Append(segment);
+
+  batcher.Draw(true);
+  ASSERT_EQ(backend.draws_.size(), 2);
+  ASSERT_EQ(backend.draws_[0].type, BatcherBackend::QUADS);
+  const std::vector<char>& buffer =
+      backend.buffers_.at(backend.draws_[0].color_buffer);
+  ASSERT_EQ(backend.draws_[0].num_vertices,
+            4 * batcher.GetBoxBuffer().m_Boxes.size());
+  for (uint32_t i = 0; i < backend.draws_[0].num_vertices; ++i) {
+    uint32_t value;
+    memcpy(&value, &buffer[i * sizeof(Color)], sizeof(value));
+    PickingID id = PickingID::Get(value);
+    EXPECT_EQ(id.m_Type, PickingID::BOX);
+    EXPECT_EQ(id.m_Id, i / 4);
+  }
+}
+
+TEST(Batcher, BoxesAreCompact) {
+  EXPECT_EQ(sizeof(BoxInstance), 24);
+
+  // Boxes of a few colors share their palette entries.
+  Batcher batcher;
+  for (size_t i = 0; i < 1000; ++i) {
+    Color color(static_cast<unsigned char>(i % 6), 0, 0, 255);
+    Color colors[4] = {color, color, color, color};
+    batcher.AddBox(MakeBox(float(i)), colors);
+  }
+  EXPECT_EQ(batcher.GetBoxBuffer().m_Palette.size(), 6);
+
+  std::vector<BoxInstance> boxes = ToVector(&batcher.GetBoxBuffer().m_Boxes);
+  ASSERT_EQ(boxes.size(), 1000);
+  for (size_t i = 0; i < boxes.size(); ++i) {
+    Box box = boxes[i].GetBox();
+    Box expected_box = MakeBox(float(i));
+    for (int j = 0; j < 4; ++j) {
+      EXPECT_EQ(box.m_Vertices[j], expected_box.m_Vertices[j]);
+    }
+    EXPECT_EQ(batcher.GetBoxBuffer().GetColors(boxes[i])[0][0], i % 6);
+  }
+}
+
+TEST(Batcher, PickingIdsRoundTrip) {
+  auto backend_ptr = std::make_unique<FakeBatcherBackend>();
+  FakeBatcherBackend& backend = *backend_ptr;
+  Batcher batcher(std::move(backend_ptr));
+  // Boxes of several blocks.
+  const size_t kNumBoxes = 2 * BoxBuffer::NUM_BOXES_PER_BLOCK + 10;
+  std::vector<int> user_data(kNumBoxes);
+  AddBoxes(0, kNumBoxes, &batcher, &user_data);
+
+  batcher.Draw(true);
+  uint32_t num_boxes = 0;
+  for (const FakeBatcherBackend::DrawCall& draw : backend.draws_) {
+    const std::vector<char>& buffer = backend.buffers_.at(draw.color_buffer);
+    for (uint32_t i = 0; i < draw.num_vertices; i += 4) {
+      // What reading the picking buffer at the box gives.
+      uint32_t value;
+      memcpy(&value, &buffer[i * sizeof(Color)], sizeof(value));
+      PickingID id = PickingID::Get(value);
+      ASSERT_EQ(id.m_Type, PickingID::BOX);
+      ASSERT_EQ(id.m_Id, num_boxes);
+      ASSERT_EQ(static_cast<void*>(batcher.GetTextBox(id)),
+                &user_data[num_boxes]);
+      ++num_boxes;
+    }
+  }
+  EXPECT_EQ(num_boxes, kNumBoxes);
+}
+
+TEST(Batcher, ParallelSegmentsMatchSerialOutput) {
+  // Serial: tracks add their primitives to the batcher one after the other.
+  std::vector<std::vector<int>> user_data(kNumTracks);
+  Batcher serial_batcher;
+  BatchSegment serial_segment;
+  for (size_t i = 0; i < kNumTracks; ++i) {
+    MakeTrackPrimitives(i, &user_data[i], &serial_segment);
+    serial_batcher.Append(serial_segment);
+    serial_segment.Clear();
+  }
+
+  // Parallel: each track records its own segment on a worker, the segments
+  // are appended in track order. Done twice, segments being reused.
+  WorkerPool pool(4);
+  std::vector<BatchSegment> segments(kNumTracks);
+  for (int update = 0; update < 2; ++update) {
+    pool.ParallelFor(kNumTracks, [&](size_t i) {
+      MakeTrackPrimitives(i, &user_data[i], &segments[i]);
+    });
+
+    Batcher parallel_batcher;
+    for (BatchSegment& segment : segments) {
+      parallel_batcher.Append(segment);
+      segment.Clear();
+    }
+    ExpectSameLines(&serial_batcher, &parallel_batcher);
+    ExpectSameBoxes(&serial_batcher, &parallel_batcher);
+  }
+}
+
+TEST(Batcher, DrawsUploadNewPrimitivesOnly) {
+  auto backend_ptr = std::make_unique<FakeBatcherBackend>();
+  FakeBatcherBackend& backend = *backend_ptr;
+  Batcher batcher(std::move(backend_ptr));
+
+  // A bit more than a block of boxes, and a few lines.
+  const size_t kNumBoxes = BoxBuffer::NUM_BOXES_PER_BLOCK + 100;
+  AddBoxes(0, kNumBoxes, &batcher);
+  Line line;
+  line.m_Beg = Vec3(0.f, 0.f, 0.f);
+  line.m_End = Vec3(1.f, 1.f, 0.f);
+  Color line_colors[2] = {Color(1, 2, 3, 4), Color(5, 6, 7, 8)};
+  batcher.AddLine(line, line_colors, PickingID::LINE);
+
+  batcher.Draw(false);
+  ExpectDrawnBoxes(backend, false, &batcher);
+  uint64_t expected_bytes = kNumBoxes * (sizeof(Box) + 4 * sizeof(Color)) +
+                            sizeof(Line) + 2 * sizeof(Color);
+  EXPECT_EQ(batcher.GetNumUploadedBytes(), expected_bytes);
+  // Vertices and colors of two blocks of boxes and a block of lines.
+  EXPECT_EQ(backend.uploads_.size(), 6);
+  ASSERT_EQ(backend.draws_.size(), 3);
+  EXPECT_EQ(backend.draws_[2].type, BatcherBackend::LINES);
+  EXPECT_EQ(backend.draws_[2].num_vertices, 2);
+
+  // Nothing changed, nothing is uploaded.
+  backend.uploads_.clear();
+  backend.draws_.clear();
+  batcher.Draw(false);
+  EXPECT_TRUE(backend.uploads_.empty());
+  EXPECT_EQ(backend.draws_.size(), 3);
+  EXPECT_EQ(batcher.GetNumUploadedBytes(), expected_bytes);
+
+  // Appended boxes are uploaded after the ones already uploaded.
+  backend.uploads_.clear();
+  backend.draws_.clear();
+  AddBoxes(kNumBoxes, kNumBoxes + 10, &batcher);
+  batcher.Draw(false);
+  ExpectDrawnBoxes(backend, false, &batcher);
+  ASSERT_EQ(backend.uploads_.size(), 2);
+  EXPECT_EQ(backend.uploads_[0].offset, 100 * sizeof(Box));
+  EXPECT_EQ(backend.uploads_[0].size, 10 * sizeof(Box));
+  EXPECT_EQ(backend.uploads_[1].offset, 4 * 100 * sizeof(Color));
+  EXPECT_EQ(backend.uploads_[1].size, 4 * 10 * sizeof(Color));
+}
+
+TEST(Batcher, PickingUploadsPickingColors) {
+  auto backend_ptr = std::make_unique<FakeBatcherBackend>();
+  FakeBatcherBackend& backend = *backend_ptr;
+  Batcher batcher(std::move(backend_ptr));
+  AddBoxes(0, 1000, &batcher);
+
+  batcher.Draw(false);
+  backend.uploads_.clear();
+  backend.draws_.clear();
+  batcher.Draw(true);
+  ExpectDrawnBoxes(backend, true, &batcher);
+  // Vertices are already uploaded.
+  ASSERT_EQ(backend.uploads_.size(), 1);
+  EXPECT_EQ(backend.uploads_[0].size, 4 * 1000 * sizeof(Color));
+}
+
+TEST(Batcher, ResetKeepsBuffers) {
+  auto backend_ptr = std::make_unique<FakeBatcherBackend>();
+  FakeBatcherBackend& backend = *backend_ptr;
+  {
+    Batcher batcher(std::move(backend_ptr));
+    AddBoxes(0, 1000, &batcher);
+    batcher.Draw(false);
+    size_t num_buffers = backend.buffers_.size();
+
+    // The new boxes are uploaded from the start of the same buffers.
+    batcher.Reset();
+    AddBoxes(500, 700, &batcher);
+    backend.uploads_.clear();
+    backend.draws_.clear();
+    batcher.Draw(false);
+    ExpectDrawnBoxes(backend, false, &batcher);
+    EXPECT_EQ(backend.buffers_.size(), num_buffers);
+    ASSERT_EQ(backend.uploads_.size(), 2);
+    EXPECT_EQ(backend.uploads_[0].offset, 0);
+    EXPECT_EQ(backend.uploads_[0].size, 200 * sizeof(Box));
+
+    // Nothing is drawn once empty.
+    batcher.Reset();
+    backend.draws_.clear();
+    batcher.Draw(false);
+    EXPECT_TRUE(backend.draws_.empty());
+  }
+  // The batcher deleted its buffers, checked by the backend.
+}
@@ -2,6 +2,7 @@
 
 #include <fstream>
 #include <memory>
+#include <vector>
 
 #include "App.h"
 #include "Callstack.h"
@@ -52,7 +53,9 @@ void CaptureSerializer::Save(const std::wstring a_FileName) {
 //-----------------------------------------------------------------------------
 template <class T>
 void CaptureSerializer::Save(T& a_Archive) {
-  m_NumTimers = m_TimeGraph->GetNumTimers();
+  std::vector<Timer> coreActivityTimers =
+      m_TimeGraph->GetCoreActivityTimers();
+  m_NumTimers = m_TimeGraph->GetNumTimers() + (int)coreActivityTimers.size();
 
   // Header
   a_Archive(cereal::make_nvp("Capture", *this));
@@ -99,13 +102,18 @@ void CaptureSerializer::Save(T& a_Archive) {
     a_Archive(GEventTracer.GetEventBuffer());
   }
 
-  // Timers
+  // Timers, the running intervals of the cores first.
   int numWrites = 0;
-  std::vector<std::shared_ptr<TimerChain> > chains =
-      m_TimeGraph->GetAllTimerChains();
-  for (const std::shared_ptr<TimerChain>& chain : chains) {
-    for (const TextBox& box : *chain) {
-      a_Archive(cereal::binary_data((char*)&box.GetTimer(), sizeof(Timer)));
+  for (Timer& timer : coreActivityTimers) {
+    a_Archive(cereal::binary_data((char*)&timer, sizeof(Timer)));
+    ++numWrites;
+  }
+  std::vector<std::shared_ptr<TimerColumns> > timers =
+      m_TimeGraph->GetAllTimerColumns();
+  for (const std::shared_ptr<TimerColumns>& depthTimers : timers) {
+    for (size_t i = 0, size = depthTimers->size(); i < size; ++i) {
+      Timer timer = depthTimers->GetTimer(i);
+      a_Archive(cereal::binary_data((char*)&timer, sizeof(Timer)));
 
       if (++numWrites > m_NumTimers) {
         return;
@@ -151,6 +159,7 @@ void CaptureSerializer::Load(const std::wstring a_FileName) {
 
     // Sampling profiler
     archive(Capture::GSamplingProfiler);
+    Capture::GSamplingProfiler->BuildCallTrees();
     Capture::GSamplingProfiler->SortByThreadUsage();
     GOrbitApp->AddSamplingReport(Capture::GSamplingProfiler, GOrbitApp);
     Capture::GSamplingProfiler->SetLoadedFromFile(true);
@@ -158,10 +167,12 @@ void CaptureSerializer::Load(const std::wstring a_FileName) {
     // Event buffer
     archive(GEventTracer.GetEventBuffer());
 
-    // Timers
-    Timer timer;
-    while (file.read((char*)&timer, sizeof(Timer))) {
-      m_TimeGraph->ProcessTimer(timer);
+    // Timers, read and processed in batches.
+    std::vector<Timer> timers(4096);
+    while (file) {
+      file.read((char*)timers.data(), timers.size() * sizeof(Timer));
+      size_t numTimers = file.gcount() / sizeof(Timer);
+      m_TimeGraph->ProcessTimers(timers.data(), numTimers);
     }
 
     GOrbitApp->FireRefreshCallbacks();
@@ -10,6 +10,7 @@
 #include "EventTracer.h"
 #include "GlUtils.h"
 #include "PluginManager.h"
+#include "ProcessEncoding.h"
 #include "Serialization.h"
 #include "Systrace.h"
 #include "TcpClient.h"
@@ -48,8 +49,10 @@ CaptureWindow::CaptureWindow() {
   m_WorldMaxY = 0;
   m_ProcessX = 0;
 
-  GTimerManager->m_TimerAddedCallbacks.push_back(
-      [=](Timer& a_Timer) { this->OnTimerAdded(a_Timer); });
+  GTimerManager->m_TimersAddedCallbacks.push_back(
+      [=](const Timer* a_Timers, size_t a_NumTimers) {
+        this->OnTimersAdded(a_Timers, a_NumTimers);
+      });
   GTimerManager->m_ContextSwitchAddedCallback = [=](const ContextSwitch& a_CS) {
     this->OnContextSwitchAdded(a_CS);
   };
@@ -194,7 +197,7 @@ void CaptureWindow::Pick(int a_X, int a_Y) {
 
   PickingID pickId = PickingID::Get(*((uint32_t*)(&pixels[0])));
 
-  Capture::GSelectedTextBox = nullptr;
+  m_TimeGraph.SetSelectedTextBox(nullptr);
   Capture::GSelectedThreadId = 0;
 
   Pick(pickId, a_X, a_Y);
@@ -234,7 +237,7 @@ void CaptureWindow::Pick(PickingID a_PickingID, int a_X, int a_Y) {
 
 //-----------------------------------------------------------------------------
 void CaptureWindow::SelectTextBox(class TextBox* a_TextBox) {
-  Capture::GSelectedTextBox = a_TextBox;
+  m_TimeGraph.SetSelectedTextBox(a_TextBox);
   Capture::GSelectedThreadId = a_TextBox->GetTimer().m_TID;
   Capture::GSelectedCallstack =
       Capture::GetCallstack(a_TextBox->GetTimer().m_CallstackHash);
@@ -273,7 +276,7 @@ void CaptureWindow::Hover(int a_X, int a_Y) {
           Capture::GSelectedFunctionsMap[textBox->GetTimer().m_FunctionAddress];
       m_ToolTip =
           s2ws(absl::StrFormat("%s %s", func ? func->PrettyName().c_str() : "",
-                               textBox->GetText().c_str()));
+                               textBox->GetLabel()));
       GOrbitApp->SendToUiAsync(L"tooltip:" + m_ToolTip);
       NeedsRedraw();
     }
@@ -623,7 +626,10 @@ void CaptureWindow::Draw() {
   m_WorldMaxY = 1.5f * ScreenToWorldHeight((int)m_Slider.GetPixelHeight());
 
   if (Capture::IsCapturing()) {
-    ZoomAll();
+    m_TimeGraph.FollowCapture();
+    m_WorldTopLeftY = m_WorldMaxY;
+    ResetHoverTimer();
+    NeedsRedraw();
   }
 
   m_TimeGraph.Draw(m_Picking);
@@ -818,7 +824,20 @@ void CaptureWindow::RenderUI() {
     m_StatsWindow.AddLine(VAR_TO_ANSI(Capture::GSelectedFunctionsMap.size()));
     m_StatsWindow.AddLine(VAR_TO_ANSI(Capture::GVisibleFunctionsMap.size()));
     m_StatsWindow.AddLine(VAR_TO_ANSI(m_TimeGraph.GetNumDrawnTextBoxes()));
+    m_StatsWindow.AddLine(VAR_TO_ANSI(m_TimeGraph.GetNumPrimitiveRebuilds()));
+    m_StatsWindow.AddLine(VAR_TO_ANSI(m_TimeGraph.GetNumPrimitiveAppends()));
+    m_StatsWindow.AddLine(
+        VAR_TO_ANSI(m_TimeGraph.GetBatcher().GetNumUploadedBytes()));
     m_StatsWindow.AddLine(VAR_TO_ANSI(m_TimeGraph.GetNumTimers()));
+    size_t timerMemoryUsage = m_TimeGraph.GetTimerMemoryUsage();
+    double bytesPerTimer =
+        m_TimeGraph.GetNumTimers()
+            ? double(timerMemoryUsage) / m_TimeGraph.GetNumTimers()
+            : 0;
+    m_StatsWindow.AddLine(VAR_TO_ANSI(timerMemoryUsage));
+    m_StatsWindow.AddLine(VAR_TO_ANSI(bytesPerTimer));
+    m_StatsWindow.AddLine(
+        VAR_TO_ANSI(m_TimeGraph.GetContextSwitchMemoryUsage()));
     m_StatsWindow.AddLine(VAR_TO_ANSI(m_TimeGraph.GetThreadTotalHeight()));
 
 #ifdef WIN32
@@ -1132,8 +1151,8 @@ void CaptureWindow::RenderTimeBar() {
 }
 
 //-----------------------------------------------------------------------------
-void CaptureWindow::OnTimerAdded(Timer& a_Timer) {
-  m_TimeGraph.ProcessTimer(a_Timer);
+void CaptureWindow::OnTimersAdded(const Timer* a_Timers, size_t a_NumTimers) {
+  m_TimeGraph.ProcessTimers(a_Timers, a_NumTimers);
 }
 
 //-----------------------------------------------------------------------------
@@ -1144,9 +1163,8 @@ void CaptureWindow::OnContextSwitchAdded(const ContextSwitch& a_CS) {
 //-----------------------------------------------------------------------------
 void CaptureWindow::SendProcess() {
   if (Capture::GTargetProcess) {
-    std::string processData =
-        SerializeObjectHumanReadable(*Capture::GTargetProcess);
-    PRINT_VAR(processData);
+    std::string processData;
+    EncodeProcess(*Capture::GTargetProcess, &processData);
     GTcpClient->Send(Msg_RemoteProcess, (void*)processData.data(),
                      processData.size());
   }
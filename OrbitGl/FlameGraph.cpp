@@ -0,0 +1,209 @@
+#include "FlameGraph.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "GlCanvas.h"
+#include "TextRenderer.h"
+#include "absl/strings/str_format.h"
+
+//-----------------------------------------------------------------------------
+FlameGraph::FlameGraph() {}
+
+//-----------------------------------------------------------------------------
+void FlameGraph::SetCallTree(std::shared_ptr<const CallTree> a_CallTree) {
+  m_CallTree = std::move(a_CallTree);
+  m_NodeOffsets.clear();
+  m_VisibleNodes.clear();
+  m_LayoutNumNodes = 0;
+  m_LayoutTotalCount = 0;
+  ZoomAll();
+}
+
+//-----------------------------------------------------------------------------
+void FlameGraph::SetSymbolResolver(SymbolResolver a_Resolver) {
+  m_SymbolResolver = a_Resolver;
+  m_Labels.clear();
+}
+
+//-----------------------------------------------------------------------------
+void FlameGraph::SetVisibleRange(double a_Min, double a_Max) {
+  static const double kMinVisibleRange = 1e-9;
+  double range = clamp(a_Max - a_Min, kMinVisibleRange, 1.0);
+  m_VisibleMin = clamp(a_Min, 0.0, 1.0 - range);
+  m_VisibleMax = m_VisibleMin + range;
+}
+
+//-----------------------------------------------------------------------------
+void FlameGraph::ZoomOnNode(uint32_t a_NodeIndex) {
+  UpdateLayout();
+  if (m_CallTree == nullptr || a_NodeIndex >= m_NodeOffsets.size()) return;
+
+  double total = (double)m_CallTree->GetTotalCount();
+  if (total == 0) return;
+
+  const CallTree::Node& node = m_CallTree->GetNode(a_NodeIndex);
+  double start = (double)m_NodeOffsets[a_NodeIndex] / total;
+  double end = start + (double)node.inclusive_count / total;
+  SetVisibleRange(start, end);
+}
+
+//-----------------------------------------------------------------------------
+void FlameGraph::Zoom(float a_Delta, double a_MouseRatio) {
+  static double incrementRatio = 0.1;
+  double scale = a_Delta > 0 ? 1 + incrementRatio : 1 - incrementRatio;
+
+  double range = m_VisibleMax - m_VisibleMin;
+  double ref = m_VisibleMin + a_MouseRatio * range;
+  double newMin = ref - scale * (ref - m_VisibleMin);
+  double newMax = ref + scale * (m_VisibleMax - ref);
+  SetVisibleRange(newMin, newMax);
+}
+
+//-----------------------------------------------------------------------------
+void FlameGraph::Pan(double a_RatioOfVisibleRange) {
+  double delta = a_RatioOfVisibleRange * (m_VisibleMax - m_VisibleMin);
+  SetVisibleRange(m_VisibleMin + delta, m_VisibleMax + delta);
+}
+
+//-----------------------------------------------------------------------------
+float FlameGraph::GetTotalHeight() const {
+  uint32_t maxDepth = 0;
+  if (m_CallTree) {
+    for (size_t i = 0; i < m_CallTree->GetNumNodes(); ++i) {
+      maxDepth = std::max(maxDepth, m_CallTree->GetNode(i).depth);
+    }
+  }
+  return (float)maxDepth * m_RowHeight;
+}
+
+//-----------------------------------------------------------------------------
+void FlameGraph::UpdateLayout() {
+  if (m_CallTree == nullptr) return;
+
+  // The call tree only grows, so its node count and total count are enough
+  // to know whether the offsets are stale.
+  if (m_LayoutNumNodes == m_CallTree->GetNumNodes() &&
+      m_LayoutTotalCount == m_CallTree->GetTotalCount()) {
+    return;
+  }
+
+  m_NodeOffsets.assign(m_CallTree->GetNumNodes(), 0);
+  std::vector<uint32_t> stack = {CallTree::kRootIndex};
+  while (!stack.empty()) {
+    uint32_t nodeIndex = stack.back();
+    stack.pop_back();
+
+    uint64_t offset = m_NodeOffsets[nodeIndex];
+    for (uint32_t child : m_CallTree->GetChildren(nodeIndex)) {
+      m_NodeOffsets[child] = offset;
+      offset += m_CallTree->GetNode(child).inclusive_count;
+      stack.push_back(child);
+    }
+  }
+
+  m_LayoutNumNodes = m_CallTree->GetNumNodes();
+  m_LayoutTotalCount = m_CallTree->GetTotalCount();
+}
+
+//-----------------------------------------------------------------------------
+Color FlameGraph::GetNodeColor(const CallTree::Node& a_Node) const {
+  // Stable "warm" colour per function.
+  uint64_t hash = a_Node.function_address * 0x9E3779B97F4A7C15ull;
+  unsigned char r = 205 + (unsigned char)((hash >> 8) % 50);
+  unsigned char g = 80 + (unsigned char)((hash >> 16) % 130);
+  unsigned char b = 40 + (unsigned char)((hash >> 24) % 40);
+  return Color(r, g, b, 255);
+}
+
+//-----------------------------------------------------------------------------
+std::string FlameGraph::GetNodeLabel(uint32_t a_NodeIndex) {
+  const CallTree::Node& node = m_CallTree->GetNode(a_NodeIndex);
+  auto it = m_Labels.find(node.function_address);
+  if (it == m_Labels.end()) {
+    std::string name = m_SymbolResolver
+                           ? m_SymbolResolver(node.function_address)
+                           : absl::StrFormat("%#x", node.function_address);
+    it = m_Labels.emplace(node.function_address, name).first;
+  }
+  return it->second;
+}
+
+//-----------------------------------------------------------------------------
+void FlameGraph::UpdatePrimitives(Batcher& a_Batcher,
+                                  TextRenderer* a_TextRenderer, float a_WorldX,
+                                  float a_WorldY, float a_WorldWidth,
+                                  int a_ScreenWidth) {
+  m_VisibleNodes.clear();
+  m_NumCulledNodes = 0;
+  if (m_CallTree == nullptr || m_CallTree->GetTotalCount() == 0) return;
+
+  UpdateLayout();
+
+  double total = (double)m_CallTree->GetTotalCount();
+  double visibleStart = m_VisibleMin * total;
+  double visibleEnd = m_VisibleMax * total;
+  double visibleCount = visibleEnd - visibleStart;
+  double pixelsPerSample = (double)a_ScreenWidth / visibleCount;
+  double worldPerSample = (double)a_WorldWidth / visibleCount;
+  float z = GlCanvas::Z_VALUE_BOX_ACTIVE;
+  static Color s_TextColor(0, 0, 0, 255);
+
+  m_NodeStack.clear();
+  m_NodeStack.push_back(CallTree::kRootIndex);
+  while (!m_NodeStack.empty()) {
+    uint32_t parentIndex = m_NodeStack.back();
+    m_NodeStack.pop_back();
+
+    const CallTree::Node& parent = m_CallTree->GetNode(parentIndex);
+    for (uint32_t child = parent.first_child; child != CallTree::kInvalidIndex;
+         child = m_CallTree->GetNode(child).next_sibling) {
+      const CallTree::Node& node = m_CallTree->GetNode(child);
+      double start = (double)m_NodeOffsets[child];
+      double end = start + (double)node.inclusive_count;
+      double clippedStart = std::max(start, visibleStart);
+      double clippedEnd = std::min(end, visibleEnd);
+      double widthPixels = (clippedEnd - clippedStart) * pixelsPerSample;
+
+      // Level of detail: children are contained in their parent, so culling
+      // a node that is off-screen or too narrow discards its whole subtree.
+      if (widthPixels < m_MinNodeWidthPixels) {
+        ++m_NumCulledNodes;
+        continue;
+      }
+
+      float x = a_WorldX + (float)((clippedStart - visibleStart) *
+                                   worldPerSample);
+      float width = (float)((clippedEnd - clippedStart) * worldPerSample);
+      float y = a_WorldY - (float)node.depth * m_RowHeight;
+      float height = m_RowHeight - 1.f;
+
+      Box box;
+      box.m_Vertices[0] = Vec3(x, y, z);
+      box.m_Vertices[1] = Vec3(x, y + height, z);
+      box.m_Vertices[2] = Vec3(x + width, y + height, z);
+      box.m_Vertices[3] = Vec3(x + width, y, z);
+      Color colors[4];
+      Color color = GetNodeColor(node);
+      Fill(colors, color);
+      a_Batcher.AddBox(box, colors);
+      m_VisibleNodes.push_back(child);
+
+      if (a_TextRenderer && widthPixels > m_MinLabelWidthPixels) {
+        a_TextRenderer->AddText(GetNodeLabel(child).c_str(), x + 2.f,
+                                y + 2.f, GlCanvas::Z_VALUE_TEXT, s_TextColor,
+                                width - 4.f);
+      }
+
+      m_NodeStack.push_back(child);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+uint32_t FlameGraph::GetNodeFromPickingId(PickingID a_ID) const {
+  if (a_ID.m_Type != PickingID::BOX || a_ID.m_Id >= m_VisibleNodes.size()) {
+    return CallTree::kInvalidIndex;
+  }
+  return m_VisibleNodes[a_ID.m_Id];
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Batcher.h"
+#include "CallTree.h"
+
+class TextRenderer;
+
+//-----------------------------------------------------------------------------
+// Icicle-style flame graph of a CallTree: the root's children are drawn on the
+// top row and each level of the tree goes one row down. The horizontal extent
+// of a node is proportional to its inclusive sample count.
+//
+// Primitives are generated into a Batcher. Nodes narrower than
+// m_MinNodeWidthPixels on screen are culled along with their whole subtree
+// (children are never wider than their parent), so the cost of an update is
+// bounded by what is visible rather than by the size of the tree.
+class FlameGraph {
+ public:
+  FlameGraph();
+
+  typedef std::function<std::string(uint64_t)> SymbolResolver;
+
+  // The tree must not change while it is shown.
+  void SetCallTree(std::shared_ptr<const CallTree> a_CallTree);
+  const CallTree* GetCallTree() const { return m_CallTree.get(); }
+  void SetSymbolResolver(SymbolResolver a_Resolver);
+
+  // The visible horizontal range, as ratios of the root's inclusive count.
+  void SetVisibleRange(double a_Min, double a_Max);
+  double GetVisibleMin() const { return m_VisibleMin; }
+  double GetVisibleMax() const { return m_VisibleMax; }
+  void ZoomAll() { SetVisibleRange(0.0, 1.0); }
+  void ZoomOnNode(uint32_t a_NodeIndex);
+  void Zoom(float a_Delta, double a_MouseRatio);
+  void Pan(double a_RatioOfVisibleRange);
+
+  void SetRowHeight(float a_Height) { m_RowHeight = a_Height; }
+  float GetRowHeight() const { return m_RowHeight; }
+  void SetMinNodeWidthPixels(float a_Width) { m_MinNodeWidthPixels = a_Width; }
+  float GetTotalHeight() const;
+
+  // Fills "a_Batcher" with one box per visible node. The flame graph spans
+  // [a_WorldX, a_WorldX + a_WorldWidth] horizontally and grows downwards from
+  // a_WorldY. Labels are only emitted if "a_TextRenderer" is not null.
+  void UpdatePrimitives(Batcher& a_Batcher, TextRenderer* a_TextRenderer,
+                        float a_WorldX, float a_WorldY, float a_WorldWidth,
+                        int a_ScreenWidth);
+
+  // Maps a picked box back to the call tree node it was generated for.
+  uint32_t GetNodeFromPickingId(PickingID a_ID) const;
+  std::string GetNodeLabel(uint32_t a_NodeIndex);
+
+  uint32_t GetNumVisibleNodes() const {
+    return (uint32_t)m_VisibleNodes.size();
+  }
+  uint32_t GetNumCulledNodes() const { return m_NumCulledNodes; }
+
+ protected:
+  void UpdateLayout();
+  Color GetNodeColor(const CallTree::Node& a_Node) const;
+
+ protected:
+  std::shared_ptr<const CallTree> m_CallTree;
+  SymbolResolver m_SymbolResolver;
+  std::unordered_map<uint64_t, std::string> m_Labels;
+
+  // Horizontal offset of every node, in samples from the start of the root.
+  std::vector<uint64_t> m_NodeOffsets;
+  size_t m_LayoutNumNodes = 0;
+  uint64_t m_LayoutTotalCount = 0;
+
+  // Node index of every box added to the batcher, in insertion order.
+  std::vector<uint32_t> m_VisibleNodes;
+  std::vector<uint32_t> m_NodeStack;
+  uint32_t m_NumCulledNodes = 0;
+
+  double m_VisibleMin = 0.0;
+  double m_VisibleMax = 1.0;
+  float m_RowHeight = 20.f;
+  float m_MinNodeWidthPixels = 1.f;
+  float m_MinLabelWidthPixels = 30.f;
+};
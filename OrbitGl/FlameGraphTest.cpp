@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "Batcher.h"
+#include "CallTree.h"
+#include "FlameGraph.h"
+
+namespace {
+
+// Function 1 calls 2 and 5, 2 calls 3 and 4: 1501 samples in total.
+std::shared_ptr<CallTree> CreateCallTree() {
+  auto call_tree = std::make_shared<CallTree>();
+  call_tree->AddCallstack(std::vector<uint64_t>{3, 2, 1}, 1000);
+  call_tree->AddCallstack(std::vector<uint64_t>{4, 2, 1}, 1);
+  call_tree->AddCallstack(std::vector<uint64_t>{5, 1}, 500);
+  return call_tree;
+}
+
+uint32_t FindNode(const CallTree& call_tree,
+                  const std::vector<uint64_t>& path) {
+  uint32_t node = CallTree::kRootIndex;
+  for (uint64_t function_address : path) {
+    node = call_tree.FindChild(node, function_address);
+  }
+  return node;
+}
+
+struct DrawnNode {
+  float x;
+  float width;
+  float y;
+};
+
+// Boxes of "batcher" by the node they were drawn for.
+std::map<uint32_t, DrawnNode> GetDrawnNodes(const FlameGraph& flame_graph,
+                                            Batcher* batcher) {
+  std::map<uint32_t, DrawnNode> nodes;
+  uint32_t id = 0;
+  for (const BoxInstance& box : batcher->GetBoxBuffer().m_Boxes) {
+    uint32_t node =
+        flame_graph.GetNodeFromPickingId(PickingID::Get(PickingID::BOX, id++));
+    EXPECT_EQ(nodes.count(node), 0);
+    nodes[node] = {box.m_X, box.m_Width, box.m_Y};
+  }
+  return nodes;
+}
+
+}  // namespace
+
+TEST(FlameGraph, LayoutIsProportionalToCounts) {
+  std::shared_ptr<CallTree> call_tree = CreateCallTree();
+  FlameGraph flame_graph;
+  flame_graph.SetCallTree(call_tree);
+  flame_graph.SetRowHeight(10.f);
+
+  // One world unit and one pixel per sample.
+  Batcher batcher;
+  flame_graph.UpdatePrimitives(batcher, nullptr, 0.f, 100.f, 1501.f, 1501);
+  EXPECT_EQ(flame_graph.GetNumVisibleNodes(), 5);
+  EXPECT_EQ(flame_graph.GetNumCulledNodes(), 0);
+  std::map<uint32_t, DrawnNode> nodes = GetDrawnNodes(flame_graph, &batcher);
+  ASSERT_EQ(nodes.size(), 5);
+
+  // Children are laid out by decreasing count from their parent's start.
+  const DrawnNode& node_1 = nodes[FindNode(*call_tree, {1})];
+  EXPECT_FLOAT_EQ(node_1.x, 0.f);
+  EXPECT_FLOAT_EQ(node_1.width, 1501.f);
+  EXPECT_FLOAT_EQ(node_1.y, 90.f);
+  const DrawnNode& node_2 = nodes[FindNode(*call_tree, {1, 2})];
+  EXPECT_FLOAT_EQ(node_2.x, 0.f);
+  EXPECT_FLOAT_EQ(node_2.width, 1001.f);
+  EXPECT_FLOAT_EQ(node_2.y, 80.f);
+  const DrawnNode& node_5 = nodes[FindNode(*call_tree, {1, 5})];
+  EXPECT_FLOAT_EQ(node_5.x, 1001.f);
+  EXPECT_FLOAT_EQ(node_5.width, 500.f);
+  const DrawnNode& node_3 = nodes[FindNode(*call_tree, {1, 2, 3})];
+  EXPECT_FLOAT_EQ(node_3.x, 0.f);
+  EXPECT_FLOAT_EQ(node_3.width, 1000.f);
+  EXPECT_FLOAT_EQ(node_3.y, 70.f);
+  const DrawnNode& node_4 = nodes[FindNode(*call_tree, {1, 2, 4})];
+  EXPECT_FLOAT_EQ(node_4.x, 1000.f);
+  EXPECT_FLOAT_EQ(node_4.width, 1.f);
+
+  EXPECT_FLOAT_EQ(flame_graph.GetTotalHeight(), 30.f);
+}
+
+TEST(FlameGraph, NarrowNodesAreCulledWithTheirSubtree) {
+  std::shared_ptr<CallTree> call_tree = CreateCallTree();
+  // 2 samples of 1 -> 8 -> 9, too narrow on 100 pixels.
+  call_tree->AddCallstack(std::vector<uint64_t>{9, 8, 1}, 2);
+  FlameGraph flame_graph;
+  flame_graph.SetCallTree(call_tree);
+
+  Batcher batcher;
+  flame_graph.UpdatePrimitives(batcher, nullptr, 0.f, 0.f, 1.f, 100);
+  // Nodes 4 and 8 are culled, 9 is never visited.
+  EXPECT_EQ(flame_graph.GetNumCulledNodes(), 2);
+  EXPECT_EQ(flame_graph.GetNumVisibleNodes(), 4);
+  std::map<uint32_t, DrawnNode> nodes = GetDrawnNodes(flame_graph, &batcher);
+  EXPECT_EQ(nodes.count(FindNode(*call_tree, {1, 2, 4})), 0);
+  EXPECT_EQ(nodes.count(FindNode(*call_tree, {1, 8})), 0);
+  EXPECT_EQ(nodes.count(FindNode(*call_tree, {1, 8, 9})), 0);
+
+  // A lower threshold keeps them.
+  flame_graph.SetMinNodeWidthPixels(0.01f);
+  batcher.Reset();
+  flame_graph.UpdatePrimitives(batcher, nullptr, 0.f, 0.f, 1.f, 100);
+  EXPECT_EQ(flame_graph.GetNumCulledNodes(), 0);
+  EXPECT_EQ(flame_graph.GetNumVisibleNodes(), 7);
+}
+
+TEST(FlameGraph, ZoomOnNodeCullsNodesOutsideOfIt) {
+  std::shared_ptr<CallTree> call_tree = CreateCallTree();
+  FlameGraph flame_graph;
+  flame_graph.SetCallTree(call_tree);
+  uint32_t node_5 = FindNode(*call_tree, {1, 5});
+  flame_graph.ZoomOnNode(node_5);
+  EXPECT_DOUBLE_EQ(flame_graph.GetVisibleMin(), 1001.0 / 1501.0);
+  EXPECT_DOUBLE_EQ(flame_graph.GetVisibleMax(), 1.0);
+
+  Batcher batcher;
+  flame_graph.UpdatePrimitives(batcher, nullptr, 10.f, 0.f, 50.f, 500);
+  // Node 2 and its subtree are off-screen, node 1 is clipped to node 5.
+  EXPECT_EQ(flame_graph.GetNumCulledNodes(), 1);
+  std::map<uint32_t, DrawnNode> nodes = GetDrawnNodes(flame_graph, &batcher);
+  ASSERT_EQ(nodes.size(), 2);
+  for (uint32_t node : {FindNode(*call_tree, {1}), node_5}) {
+    ASSERT_EQ(nodes.count(node), 1);
+    EXPECT_FLOAT_EQ(nodes[node].x, 10.f);
+    EXPECT_FLOAT_EQ(nodes[node].width, 50.f);
+  }
+}
+
+TEST(FlameGraph, KeepsItsCallTree) {
+  std::shared_ptr<CallTree> call_tree = CreateCallTree();
+  FlameGraph flame_graph;
+  flame_graph.SetCallTree(call_tree);
+  const CallTree* shown = call_tree.get();
+  call_tree.reset();
+  ASSERT_EQ(flame_graph.GetCallTree(), shown);
+
+  Batcher batcher;
+  flame_graph.UpdatePrimitives(batcher, nullptr, 0.f, 0.f, 1501.f, 1501);
+  EXPECT_EQ(flame_graph.GetNumVisibleNodes(), 5);
+  EXPECT_EQ(flame_graph.GetNodeFromPickingId(PickingID::Get(PickingID::BOX, 5)),
+            CallTree::kInvalidIndex);
+}
@@ -0,0 +1,252 @@
+#include "FlameGraphWindow.h"
+
+#include "App.h"
+#include "OpenGl.h"
+#include "SamplingProfiler.h"
+#include "absl/strings/str_format.h"
+
+//-----------------------------------------------------------------------------
+FlameGraphWindow::FlameGraphWindow() {
+  m_DrawUI = false;
+  m_WorldTopLeftX = 0;
+  m_WorldTopLeftY = 0;
+  m_TextRendererStatic.SetCanvas(this);
+  GOrbitApp->RegisterFlameGraphWindow(this);
+}
+
+//-----------------------------------------------------------------------------
+FlameGraphWindow::~FlameGraphWindow() {}
+
+//-----------------------------------------------------------------------------
+void FlameGraphWindow::SetSamplingProfiler(
+    std::shared_ptr<SamplingProfiler> a_Profiler) {
+  m_Profiler = a_Profiler;
+  m_FlameGraph.SetSymbolResolver([this](uint64_t a_Address) {
+    return m_Profiler ? ws2s(m_Profiler->GetSymbolFromAddress(a_Address))
+                      : std::string();
+  });
+  UpdateCallTree();
+}
+
+//-----------------------------------------------------------------------------
+void FlameGraphWindow::UpdateCallTree() {
+  // The profiler keeps adding samples to its trees from other threads, the
+  // flame graph lays out a copy.
+  std::shared_ptr<const CallTree> callTree;
+  if (m_Profiler) {
+    // Show the "All" summary when it exists, the busiest thread otherwise.
+    callTree = m_Profiler->CopyCallTree(0, m_Direction);
+    if (callTree == nullptr || callTree->GetTotalCount() == 0) {
+      ThreadID tid = m_Profiler->GetBusiestThreadID();
+      if (tid != 0) callTree = m_Profiler->CopyCallTree(tid, m_Direction);
+    }
+  }
+
+  m_SelectedNode = CallTree::kInvalidIndex;
+  m_FlameGraph.SetCallTree(callTree);
+  ZoomAll();
+}
+
+//-----------------------------------------------------------------------------
+void FlameGraphWindow::ToggleInverted() {
+  m_Direction = m_Direction == CallTree::Direction::kTopDown
+                    ? CallTree::Direction::kBottomUp
+                    : CallTree::Direction::kTopDown;
+  UpdateCallTree();
+}
+
+//-----------------------------------------------------------------------------
+void FlameGraphWindow::ZoomAll() {
+  m_FlameGraph.ZoomAll();
+  m_WorldTopLeftY = 0;
+  NeedsUpdate();
+}
+
+//-----------------------------------------------------------------------------
+void FlameGraphWindow::NeedsUpdate() {
+  m_NeedsUpdatePrimitives = true;
+  NeedsRedraw();
+}
+
+//-----------------------------------------------------------------------------
+void FlameGraphWindow::Resize(int a_Width, int a_Height) {
+  m_Width = a_Width;
+  m_Height = a_Height;
+  // One world unit per pixel.
+  m_DesiredWorldWidth = (float)a_Width;
+  m_DesiredWorldHeight = (float)a_Height;
+  NeedsUpdate();
+}
+
+//-----------------------------------------------------------------------------
+void FlameGraphWindow::Draw() {
+  if (m_NeedsUpdatePrimitives || m_Picking) {
+    m_Batcher.Reset();
+    m_TextRendererStatic.Clear();
+    m_TextRendererStatic.Init();
+    m_FlameGraph.UpdatePrimitives(
+        m_Batcher, m_Picking ? nullptr : &m_TextRendererStatic, 0.f, 0.f,
+        m_WorldWidth, getWidth());
+    m_NeedsUpdatePrimitives = m_Picking;
+  }
+
+  m_Batcher.Draw(m_Picking);
+
+  if (!m_Picking) {
+    DrawStatus();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void FlameGraphWindow::RenderText() {
+  if (!m_Picking) {
+    m_TextRendererStatic.Display();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void FlameGraphWindow::DrawStatus() {
+  static Color s_Color(255, 255, 255, 255);
+  std::string status =
+      m_FlameGraph.GetCallTree() == nullptr
+          ? "No sampling data"
+          : absl::StrFormat(
+                "%s - %u nodes drawn, %u culled - [space] zoom all, [I] %s",
+                m_Direction == CallTree::Direction::kTopDown ? "Top-down"
+                                                             : "Bottom-up",
+                m_FlameGraph.GetNumVisibleNodes(),
+                m_FlameGraph.GetNumCulledNodes(),
+                m_Direction == CallTree::Direction::kTopDown ? "bottom-up"
+                                                             : "top-down");
+  m_TextRenderer.AddText2D(status.c_str(), 5, getHeight() - 5, Z_VALUE_TEXT_UI,
+                           s_Color);
+}
+
+//-----------------------------------------------------------------------------
+void FlameGraphWindow::PostRender() {
+  if (m_Picking) {
+    m_Picking = false;
+    Pick(m_ScreenClickX, m_ScreenClickY);
+    NeedsRedraw();
+    GlCanvas::Render(m_Width, m_Height);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void FlameGraphWindow::Pick(int a_X, int a_Y) {
+  // 4 bytes per pixel (RGBA), 1x1 bitmap
+  std::vector<unsigned char> pixels(1 * 1 * 4);
+  glReadPixels(a_X, m_MainWindowHeight - a_Y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+               &pixels[0]);
+  PickingID pickId = PickingID::Get(*((uint32_t*)(&pixels[0])));
+
+  m_SelectedNode = m_FlameGraph.GetNodeFromPickingId(pickId);
+  const CallTree* callTree = m_FlameGraph.GetCallTree();
+  if (m_SelectedNode == CallTree::kInvalidIndex || callTree == nullptr) {
+    return;
+  }
+
+  if (m_DoubleClicking) {
+    m_FlameGraph.ZoomOnNode(m_SelectedNode);
+  }
+
+  const CallTree::Node& node = callTree->GetNode(m_SelectedNode);
+  float percent = 100.f * (float)node.inclusive_count /
+                  (float)callTree->GetTotalCount();
+  std::string toolTip = absl::StrFormat(
+      "%s - %u samples (%.2f%%), %u exclusive",
+      m_FlameGraph.GetNodeLabel(m_SelectedNode), node.inclusive_count, percent,
+      node.exclusive_count);
+  GOrbitApp->SendToUiAsync(L"tooltip:" + s2ws(toolTip));
+  NeedsUpdate();
+}
+
+//-----------------------------------------------------------------------------
+void FlameGraphWindow::MouseMoved(int a_X, int a_Y, bool a_Left, bool a_Right,
+                                  bool a_Middle) {
+  if (a_Left && !m_ImguiActive && getWidth() > 0) {
+    // Horizontal panning moves the visible sample range, vertical panning
+    // scrolls through the call depth.
+    m_FlameGraph.Pan(-(double)(a_X - m_MousePosX) / (double)getWidth());
+    m_WorldTopLeftY = std::min(
+        0.f, m_WorldTopLeftY + ScreenToWorldHeight(a_Y - m_MousePosY));
+    NeedsUpdate();
+  }
+
+  ScreenToWorld(a_X, a_Y, m_MouseX, m_MouseY);
+  m_MousePosX = a_X;
+  m_MousePosY = a_Y;
+  NeedsRedraw();
+}
+
+//-----------------------------------------------------------------------------
+void FlameGraphWindow::LeftDown(int a_X, int a_Y) {
+  GlCanvas::LeftDown(a_X, a_Y);
+  m_MousePosX = a_X;
+  m_MousePosY = a_Y;
+  m_Picking = true;
+}
+
+//-----------------------------------------------------------------------------
+void FlameGraphWindow::LeftDoubleClick() {
+  GlCanvas::LeftDoubleClick();
+  m_DoubleClicking = true;
+  m_Picking = true;
+}
+
+//-----------------------------------------------------------------------------
+void FlameGraphWindow::MouseWheelMoved(int a_X, int a_Y, int a_Delta,
+                                       bool a_Ctrl) {
+  if (a_Delta == 0 || getWidth() == 0) return;
+
+  int delta = -a_Delta / abs(a_Delta);
+  m_MouseRatio = (double)a_X / (double)getWidth();
+  m_FlameGraph.Zoom((float)delta, m_MouseRatio);
+  m_WheelMomentum =
+      delta * m_WheelMomentum < 0 ? 0.f : m_WheelMomentum + (float)delta;
+  NeedsUpdate();
+}
+
+//-----------------------------------------------------------------------------
+void FlameGraphWindow::UpdateWheelMomentum(float a_DeltaTime) {
+  GlCanvas::UpdateWheelMomentum(a_DeltaTime);
+  if (m_WheelMomentum != 0.f) {
+    m_FlameGraph.Zoom(m_WheelMomentum, m_MouseRatio);
+    NeedsUpdate();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void FlameGraphWindow::KeyPressed(unsigned int a_KeyCode, bool a_Ctrl,
+                                  bool a_Shift, bool a_Alt) {
+  UpdateSpecialKeys(a_Ctrl, a_Shift, a_Alt);
+
+  if (!m_ImguiActive) {
+    switch (a_KeyCode) {
+      case ' ':
+        ZoomAll();
+        break;
+      case 'A':
+        m_FlameGraph.Pan(-0.1);
+        NeedsUpdate();
+        break;
+      case 'D':
+        m_FlameGraph.Pan(0.1);
+        NeedsUpdate();
+        break;
+      case 'W':
+        m_FlameGraph.Zoom(-1.f, 0.5);
+        NeedsUpdate();
+        break;
+      case 'S':
+        m_FlameGraph.Zoom(1.f, 0.5);
+        NeedsUpdate();
+        break;
+      case 'I':
+        ToggleInverted();
+        break;
+    }
+  }
+
+  GlCanvas::KeyPressed(a_KeyCode, a_Ctrl, a_Shift, a_Alt);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <memory>
+
+#include "Batcher.h"
+#include "FlameGraph.h"
+#include "GlCanvas.h"
+
+class SamplingProfiler;
+
+//-----------------------------------------------------------------------------
+class FlameGraphWindow : public GlCanvas {
+ public:
+  FlameGraphWindow();
+  ~FlameGraphWindow() override;
+
+  void SetSamplingProfiler(std::shared_ptr<SamplingProfiler> a_Profiler);
+
+  void Draw() override;
+  void RenderText() override;
+  void PostRender() override;
+  void Resize(int a_Width, int a_Height) override;
+  void MouseMoved(int a_X, int a_Y, bool a_Left, bool a_Right,
+                  bool a_Middle) override;
+  void LeftDown(int a_X, int a_Y) override;
+  void LeftDoubleClick() override;
+  void MouseWheelMoved(int a_X, int a_Y, int a_Delta, bool a_Ctrl) override;
+  void KeyPressed(unsigned int a_KeyCode, bool a_Ctrl, bool a_Shift,
+                  bool a_Alt) override;
+  void UpdateWheelMomentum(float a_DeltaTime) override;
+
+  void ZoomAll();
+  void NeedsUpdate();
+  void ToggleInverted();
+
+ protected:
+  void UpdateCallTree();
+  void Pick(int a_X, int a_Y);
+  void DrawStatus();
+
+ protected:
+  std::shared_ptr<SamplingProfiler> m_Profiler;
+  FlameGraph m_FlameGraph;
+  Batcher m_Batcher;
+  TextRenderer m_TextRendererStatic;
+  CallTree::Direction m_Direction = CallTree::Direction::kTopDown;
+  uint32_t m_SelectedNode = CallTree::kInvalidIndex;
+  bool m_NeedsUpdatePrimitives = true;
+};
@@ -0,0 +1,56 @@
+#include "GlBatcherBackend.h"
+
+#include "CoreMath.h"
+#include "OpenGl.h"
+
+//-----------------------------------------------------------------------------
+uint32_t GlBatcherBackend::CreateBuffer(size_t a_Size) {
+  GLuint buffer = 0;
+  glGenBuffers(1, &buffer);
+  glBindBuffer(GL_ARRAY_BUFFER, buffer);
+  glBufferData(GL_ARRAY_BUFFER, a_Size, nullptr, GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  return buffer;
+}
+
+//-----------------------------------------------------------------------------
+void GlBatcherBackend::DeleteBuffer(uint32_t a_Buffer) {
+  GLuint buffer = a_Buffer;
+  glDeleteBuffers(1, &buffer);
+}
+
+//-----------------------------------------------------------------------------
+void GlBatcherBackend::UploadBuffer(uint32_t a_Buffer, size_t a_Offset,
+                                    size_t a_Size, const void* a_Data) {
+  glBindBuffer(GL_ARRAY_BUFFER, a_Buffer);
+  glBufferSubData(GL_ARRAY_BUFFER, a_Offset, a_Size, a_Data);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+//-----------------------------------------------------------------------------
+void GlBatcherBackend::BeginDraw() {
+  glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glDisable(GL_CULL_FACE);
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_COLOR_ARRAY);
+  glEnable(GL_TEXTURE_2D);
+}
+
+//-----------------------------------------------------------------------------
+void GlBatcherBackend::Draw(PrimitiveType a_Type, uint32_t a_VertexBuffer,
+                            uint32_t a_ColorBuffer, uint32_t a_NumVertices) {
+  glBindBuffer(GL_ARRAY_BUFFER, a_VertexBuffer);
+  glVertexPointer(3, GL_FLOAT, sizeof(Vec3), nullptr);
+  glBindBuffer(GL_ARRAY_BUFFER, a_ColorBuffer);
+  glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Color), nullptr);
+  glDrawArrays(a_Type == QUADS ? GL_QUADS : GL_LINES, 0, a_NumVertices);
+}
+
+//-----------------------------------------------------------------------------
+void GlBatcherBackend::EndDraw() {
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glDisableClientState(GL_COLOR_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+  glPopAttrib();
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "BatcherBackend.h"
+
+//-----------------------------------------------------------------------------
+// Vertex buffer objects drawn with client state arrays.
+class GlBatcherBackend : public BatcherBackend {
+ public:
+  uint32_t CreateBuffer(size_t a_Size) override;
+  void DeleteBuffer(uint32_t a_Buffer) override;
+  void UploadBuffer(uint32_t a_Buffer, size_t a_Offset, size_t a_Size,
+                    const void* a_Data) override;
+
+  void BeginDraw() override;
+  void Draw(PrimitiveType a_Type, uint32_t a_VertexBuffer,
+            uint32_t a_ColorBuffer, uint32_t a_NumVertices) override;
+  void EndDraw() override;
+};
@@ -557,9 +557,37 @@ void GlCanvas::RenderSamplingUI() {
   ImGui::ProgressBar(std::min(curTime / totTime, 1.f), ImVec2(0.f, 0.f),
                      prog.c_str());
 
+  RenderSlidingWindowReport();
+
   ImGui::End();
 }
 
+//-----------------------------------------------------------------------------
+void GlCanvas::RenderSlidingWindowReport() {
+  SamplingProfiler* profiler = Capture::GSamplingProfiler.get();
+  if (profiler == nullptr || !profiler->HasSlidingWindow()) return;
+
+  // Updating the report resolves the new callstacks, don't do it every frame.
+  static const double kRefreshPeriodMs = 500.0;
+  if (m_SlidingWindowTimer.QueryMillis() > kRefreshPeriodMs) {
+    profiler->UpdateSlidingWindowReport();
+    m_SlidingWindowTimer.Start();
+  }
+
+  double windowSeconds =
+      MicroSecondsFromTicks(0, profiler->GetSlidingWindowDuration()) * 0.000001;
+  ImGui::Text("Last %.1f s: %i samples", windowSeconds,
+              profiler->GetSlidingWindowNumSamples());
+
+  static const size_t kMaxFunctions = 20;
+  std::vector<SampledFunction> report = profiler->GetSlidingWindowReport();
+  for (size_t i = 0; i < report.size() && i < kMaxFunctions; ++i) {
+    const SampledFunction& function = report[i];
+    ImGui::Text("%6.2f%% %6.2f%%  %s", function.m_Inclusive,
+                function.m_Exclusive, ws2s(function.m_Name).c_str());
+  }
+}
+
 //-----------------------------------------------------------------------------
 void GlCanvas::UpdateSceneBox() {
   Vec2 pos;
@@ -97,6 +97,7 @@ class GlCanvas : public GlPanel {
   virtual void RenderUI();
   virtual void RenderText() {}
   void RenderSamplingUI();
+  void RenderSlidingWindowReport();
 
   ImGuiContext* GetImGuiContext() { return m_ImGuiContext; }
 
@@ -153,6 +154,7 @@ class GlCanvas : public GlPanel {
   TextRenderer m_TextRenderer;
   TextBox m_SceneBox;
   Timer m_UpdateTimer;
+  Timer m_SlidingWindowTimer;
   PickingManager m_PickingManager;
   bool m_Picking;
   bool m_DoubleClicking;
@@ -6,6 +6,7 @@
 
 #include "BlackBoard.h"
 #include "CaptureWindow.h"
+#include "FlameGraphWindow.h"
 #include "GlCanvas.h"
 #include "HomeWindow.h"
 #include "ImmediateWindow.h"
@@ -35,6 +36,9 @@ GlPanel* GlPanel::Create(Type a_Type, void* a_UserData) {
     case PLUGIN:
       panel = new PluginCanvas((Orbit::Plugin*)a_UserData);
 
+      break;
+    case FLAME_GRAPH:
+      panel = new FlameGraphWindow();
       break;
   }
 
@@ -10,7 +10,15 @@ class GlPanel {
   GlPanel();
   virtual ~GlPanel();
 
-  enum Type { CAPTURE, IMMEDIATE, VISUALIZE, RULE_EDITOR, PLUGIN, DEBUG };
+  enum Type {
+    CAPTURE,
+    IMMEDIATE,
+    VISUALIZE,
+    RULE_EDITOR,
+    PLUGIN,
+    DEBUG,
+    FLAME_GRAPH
+  };
 
   static GlPanel* Create(Type a_Type, void* a_UserData = nullptr);
 
@@ -13,6 +13,8 @@ SamplingReport::SamplingReport(
     std::shared_ptr<class SamplingProfiler> a_SamplingProfiler) {
   m_Profiler = a_SamplingProfiler;
   m_SelectedAddress = 0;
+  m_SelectedThreadId = 0;
+  m_SelectedAddressCallstackIndex = 0;
   m_CallstackDataView = nullptr;
   m_SelectedSortedCallstackReport = nullptr;
   FillReport();
@@ -46,10 +48,11 @@ void SamplingReport::FillReport() {
 //-----------------------------------------------------------------------------
 void SamplingReport::OnSelectAddress(uint64_t a_Address, ThreadID a_ThreadId) {
   if (m_CallstackDataView) {
-    if (m_SelectedAddress != a_Address) {
+    if (m_SelectedAddress != a_Address || m_SelectedThreadId != a_ThreadId) {
       m_SelectedSortedCallstackReport =
           m_Profiler->GetSortedCallstacksFromAddress(a_Address, a_ThreadId);
       m_SelectedAddress = a_Address;
+      m_SelectedThreadId = a_ThreadId;
       OnCallstackIndexChanged(0);
     }
   }
@@ -62,7 +65,7 @@ void SamplingReport::OnSelectAddress(uint64_t a_Address, ThreadID a_ThreadId) {
 //-----------------------------------------------------------------------------
 void SamplingReport::IncrementCallstackIndex() {
   assert(HasCallstacks());
-  int maxIndex = (int)m_SelectedSortedCallstackReport->m_CallStacks.size() - 1;
+  int maxIndex = m_SelectedSortedCallstackReport->m_NumUniqueCallStacks - 1;
   if (++m_SelectedAddressCallstackIndex > maxIndex) {
     m_SelectedAddressCallstackIndex = 0;
   }
@@ -73,7 +76,7 @@ void SamplingReport::IncrementCallstackIndex() {
 //-----------------------------------------------------------------------------
 void SamplingReport::DecrementCallstackIndex() {
   assert(HasCallstacks());
-  int maxIndex = (int)m_SelectedSortedCallstackReport->m_CallStacks.size() - 1;
+  int maxIndex = m_SelectedSortedCallstackReport->m_NumUniqueCallStacks - 1;
   if (--m_SelectedAddressCallstackIndex < 0) {
     m_SelectedAddressCallstackIndex = maxIndex;
   }
@@ -83,30 +86,54 @@ void SamplingReport::DecrementCallstackIndex() {
 
 //-----------------------------------------------------------------------------
 std::wstring SamplingReport::GetSelectedCallstackString() {
-  if (m_SelectedSortedCallstackReport) {
-    int numOccurances = m_SelectedSortedCallstackReport
-                            ->m_CallStacks[m_SelectedAddressCallstackIndex]
-                            .m_Count;
+  const CallstackCount* callstack = GetSelectedCallstackCount();
+  if (callstack) {
+    int numOccurances = callstack->m_Count;
     int totalCallstacks = m_SelectedSortedCallstackReport->m_NumCallStacksTotal;
 
     return Format(
         L"%i of %i unique callstacks.  [%i/%i total callstacks](%.2f%%)",
         m_SelectedAddressCallstackIndex + 1,
-        m_SelectedSortedCallstackReport->m_CallStacks.size(), numOccurances,
+        m_SelectedSortedCallstackReport->m_NumUniqueCallStacks, numOccurances,
         totalCallstacks, 100.f * (float)numOccurances / (float)totalCallstacks);
   }
 
   return L"Callstacks";
 }
 
+//-----------------------------------------------------------------------------
+const CallstackCount* SamplingReport::GetSelectedCallstackCount() const {
+  if (!m_SelectedSortedCallstackReport) return nullptr;
+  const SortedCallstackReport& report = *m_SelectedSortedCallstackReport;
+  int pageIndex = m_SelectedAddressCallstackIndex - report.m_FirstIndex;
+  if (pageIndex < 0 || pageIndex >= (int)report.m_CallStacks.size()) {
+    return nullptr;
+  }
+  return &report.m_CallStacks[pageIndex];
+}
+
 //-----------------------------------------------------------------------------
 void SamplingReport::OnCallstackIndexChanged(int a_Index) {
   if (a_Index >= 0 &&
-      a_Index < (int)m_SelectedSortedCallstackReport->m_CallStacks.size()) {
-    CallstackCount& cs = m_SelectedSortedCallstackReport->m_CallStacks[a_Index];
+      a_Index < m_SelectedSortedCallstackReport->m_NumUniqueCallStacks) {
+    // Only one page of callstacks is sorted and kept at a time, fetch the
+    // page containing "a_Index" if it isn't the current one.
+    const SortedCallstackReport& report = *m_SelectedSortedCallstackReport;
+    if (a_Index < report.m_FirstIndex ||
+        a_Index >= report.m_FirstIndex + (int)report.m_CallStacks.size()) {
+      int pageSize = SortedCallstackReport::kPageSize;
+      m_SelectedSortedCallstackReport =
+          m_Profiler->GetSortedCallstacksFromAddress(
+              m_SelectedAddress, m_SelectedThreadId,
+              (a_Index / pageSize) * pageSize, pageSize);
+    }
+
     m_SelectedAddressCallstackIndex = a_Index;
-    m_CallstackDataView->SetCallStack(
-        m_Profiler->GetCallStack(cs.m_CallstackId));
+    const CallstackCount* cs = GetSelectedCallstackCount();
+    if (cs) {
+      m_CallstackDataView->SetCallStack(
+          m_Profiler->GetCallStack(cs->m_CallstackId));
+    }
   } else {
     m_SelectedAddressCallstackIndex = 0;
   }
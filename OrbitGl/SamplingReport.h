@@ -36,12 +36,16 @@ class SamplingReport {
     return m_SelectedSortedCallstackReport != nullptr;
   }
 
+ protected:
+  const struct CallstackCount* GetSelectedCallstackCount() const;
+
  protected:
   std::shared_ptr<class SamplingProfiler> m_Profiler;
   std::vector<std::shared_ptr<class DataView> > m_ThreadReports;
   CallStackDataView* m_CallstackDataView;
 
   unsigned long long m_SelectedAddress;
+  uint32_t m_SelectedThreadId;
   std::shared_ptr<struct SortedCallstackReport> m_SelectedSortedCallstackReport;
   int m_SelectedAddressCallstackIndex;
   std::function<void()> m_UiRefreshFunc;
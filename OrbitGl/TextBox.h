@@ -70,6 +70,12 @@ class TextBox {
 
   const std::string& GetText() const { return m_Text; }
   void SetText(const std::string& a_Text) { m_Text = a_Text; }
+  // Text owned by someone else, such as a cached timer label, shown instead
+  // of the text when set.
+  void SetLabel(const char* a_Label) { m_Label = a_Label; }
+  const char* GetLabel() const {
+    return m_Label != nullptr ? m_Label : m_Text.c_str();
+  }
 
   void SetTimer(const Timer& a_Timer) { m_Timer = a_Timer; }
   const Timer& GetTimer() const { return m_Timer; }
@@ -109,6 +115,7 @@ class TextBox {
   Vec2 m_Min;
   Vec2 m_Max;
   std::string m_Text;
+  const char* m_Label = nullptr;
   Color m_Color;
   Timer m_Timer;
   int m_MainFrameCounter;
@@ -1,5 +1,6 @@
 #include "ThreadTrack.h"
 
+#include <algorithm>
 #include <limits>
 
 #include "EventTrack.h"
@@ -46,21 +47,55 @@ void ThreadTrack::OnDrag(int a_X, int a_Y) { Track::OnDrag(a_X, a_Y); }
 //-----------------------------------------------------------------------------
 void ThreadTrack::OnTimer(const Timer& a_Timer) {
   UpdateDepth(a_Timer.m_Depth + 1);
-  TextBox textBox(Vec2(0, 0), Vec2(0, 0), "", m_TextRenderer,
-                  Color(255, 0, 0, 255));
-  textBox.SetTimer(a_Timer);
-
-  std::shared_ptr<TimerChain> timerChain = m_Timers[a_Timer.m_Depth];
-  if (timerChain == nullptr) {
-    timerChain = std::make_shared<TimerChain>();
-    m_Timers[a_Timer.m_Depth] = timerChain;
+
+  std::shared_ptr<TimerColumns> timers;
+  {
+    ScopeLock lock(m_Mutex);
+    std::shared_ptr<TimerColumns>& depthTimers = m_Timers[a_Timer.m_Depth];
+    if (depthTimers == nullptr) {
+      depthTimers = std::make_shared<TimerColumns>(a_Timer.m_Depth);
+    }
+    timers = depthTimers;
   }
-  timerChain->push_back(textBox);
+
+  timers->Add(a_Timer);
   ++m_NumTimers;
   if (a_Timer.m_Start < m_MinTime) m_MinTime = a_Timer.m_Start;
   if (a_Timer.m_End > m_MaxTime) m_MaxTime = a_Timer.m_End;
 }
 
+//-----------------------------------------------------------------------------
+void ThreadTrack::OnTimers(const Timer* const* a_Timers, size_t a_NumTimers) {
+  // Timers of each depth of the batch, found once. Columns are never removed
+  // from m_Timers, so the pointers stay valid once the lock is released.
+  TimerColumns* depthTimers[std::numeric_limits<uint8_t>::max() + 1] = {};
+  uint32_t maxDepth = 0;
+  {
+    ScopeLock lock(m_Mutex);
+    for (size_t i = 0; i < a_NumTimers; ++i) {
+      uint8_t depth = a_Timers[i]->m_Depth;
+      if (depthTimers[depth] != nullptr) continue;
+      std::shared_ptr<TimerColumns>& timers = m_Timers[depth];
+      if (timers == nullptr) timers = std::make_shared<TimerColumns>(depth);
+      depthTimers[depth] = timers.get();
+      maxDepth = std::max(maxDepth, static_cast<uint32_t>(depth));
+    }
+  }
+  if (a_NumTimers > 0) UpdateDepth(maxDepth + 1);
+
+  TickType minTime = m_MinTime;
+  TickType maxTime = m_MaxTime;
+  for (size_t i = 0; i < a_NumTimers; ++i) {
+    const Timer& timer = *a_Timers[i];
+    depthTimers[timer.m_Depth]->Add(timer);
+    minTime = std::min(minTime, timer.m_Start);
+    maxTime = std::max(maxTime, timer.m_End);
+  }
+  m_NumTimers += static_cast<uint32_t>(a_NumTimers);
+  m_MinTime = minTime;
+  m_MaxTime = maxTime;
+}
+
 //-----------------------------------------------------------------------------
 float ThreadTrack::GetHeight() const {
   TimeGraphLayout& layout = m_TimeGraph->GetLayout();
@@ -69,8 +104,8 @@ float ThreadTrack::GetHeight() const {
 }
 
 //-----------------------------------------------------------------------------
-std::vector<std::shared_ptr<TimerChain>> ThreadTrack::GetTimers() {
-  std::vector<std::shared_ptr<TimerChain>> timers;
+std::vector<std::shared_ptr<TimerColumns>> ThreadTrack::GetTimers() {
+  std::vector<std::shared_ptr<TimerColumns>> timers;
   ScopeLock lock(m_Mutex);
   for (auto& timerChain : m_Timers) {
     timers.push_back(timerChain.second);
@@ -97,43 +132,56 @@ Color ThreadTrack::GetColor(ThreadID a_TID) {
 }
 
 //-----------------------------------------------------------------------------
-const TextBox* ThreadTrack::GetFirstAfterTime(TickType a_Tick,
-                                              uint32_t a_Depth) const {
-  std::shared_ptr<TimerChain> textBoxes = GetTimers(a_Depth);
-  if (textBoxes == nullptr) return nullptr;
+size_t ThreadTrack::GetTimerMemoryUsage() const {
+  size_t memoryUsage = 0;
+  ScopeLock lock(m_Mutex);
+  for (const auto& pair : m_Timers) {
+    memoryUsage += pair.second->GetMemoryUsage();
+  }
+  return memoryUsage;
+}
 
-  // TODO: do better than linear search...
-  for (TextBox& textBox : *textBoxes) {
-    if (textBox.GetTimer().m_Start > a_Tick) {
-      return &textBox;
+//-----------------------------------------------------------------------------
+bool ThreadTrack::GetFirstAfterTime(TickType a_Tick, uint32_t a_Depth,
+                                    Timer* a_Timer) const {
+  std::shared_ptr<TimerColumns> timers = GetTimers(a_Depth);
+  if (timers == nullptr) return false;
+
+  // Timers ending before "a_Tick" also start before it.
+  for (size_t i = timers->FindFirstEndingAtOrAfter(a_Tick),
+              size = timers->size();
+       i < size; ++i) {
+    if (timers->GetStart(i) > a_Tick) {
+      *a_Timer = timers->GetTimer(i);
+      return true;
     }
   }
 
-  return nullptr;
+  return false;
 }
 
 //-----------------------------------------------------------------------------
-const TextBox* ThreadTrack::GetFirstBeforeTime(TickType a_Tick,
-                                               uint32_t a_Depth) const {
-  std::shared_ptr<TimerChain> textBoxes = GetTimers(a_Depth);
-  if (textBoxes == nullptr) return nullptr;
+bool ThreadTrack::GetFirstBeforeTime(TickType a_Tick, uint32_t a_Depth,
+                                     Timer* a_Timer) const {
+  std::shared_ptr<TimerColumns> timers = GetTimers(a_Depth);
+  if (timers == nullptr) return false;
 
-  TextBox* textBox = nullptr;
-
-  // TODO: do better than linear search...
-  for (TextBox& box : *textBoxes) {
-    if (box.GetTimer().m_Start > a_Tick) {
-      return textBox;
+  // Timers ending before "a_Tick" also start before it.
+  for (size_t i = timers->FindFirstEndingAtOrAfter(a_Tick),
+              size = timers->size();
+       i < size; ++i) {
+    if (timers->GetStart(i) > a_Tick) {
+      if (i == 0) return false;
+      *a_Timer = timers->GetTimer(i - 1);
+      return true;
     }
-
-    textBox = &box;
   }
 
-  return nullptr;
+  return false;
 }
 
 //-----------------------------------------------------------------------------
-std::shared_ptr<TimerChain> ThreadTrack::GetTimers(uint32_t a_Depth) const {
+std::shared_ptr<TimerColumns> ThreadTrack::GetTimers(uint32_t a_Depth) const {
   ScopeLock lock(m_Mutex);
   auto it = m_Timers.find(a_Depth);
   if (it != m_Timers.end()) return it->second;
@@ -141,42 +189,53 @@ std::shared_ptr<TimerChain> ThreadTrack::GetTimers(uint32_t a_Depth) const {
 }
 
 //-----------------------------------------------------------------------------
-const TextBox* ThreadTrack::GetLeft(TextBox* a_TextBox) const {
-  const Timer& timer = a_TextBox->GetTimer();
-  if (timer.m_TID == m_ThreadID) {
-    std::shared_ptr<TimerChain> timers = GetTimers(timer.m_Depth);
-    if (timers) return timers->GetElementBefore(a_TextBox);
+size_t ThreadTrack::Find(const TimerColumns& a_Timers, const Timer& a_Timer) {
+  size_t size = a_Timers.size();
+  for (size_t i = 0; i < size; ++i) {
+    if (a_Timers.GetStart(i) == a_Timer.m_Start &&
+        a_Timers.GetEnd(i) == a_Timer.m_End) {
+      return i;
+    }
   }
-  return nullptr;
+  return size;
 }
 
 //-----------------------------------------------------------------------------
-const TextBox* ThreadTrack::GetRight(TextBox* a_TextBox) const {
-  const Timer& timer = a_TextBox->GetTimer();
-  if (timer.m_TID == m_ThreadID) {
-    std::shared_ptr<TimerChain> timers = GetTimers(timer.m_Depth);
-    if (timers) return timers->GetElementAfter(a_TextBox);
+bool ThreadTrack::GetLeft(const Timer& a_Timer, Timer* a_Left) const {
+  if (a_Timer.m_TID == m_ThreadID) {
+    std::shared_ptr<TimerColumns> timers = GetTimers(a_Timer.m_Depth);
+    if (timers) {
+      size_t index = Find(*timers, a_Timer);
+      if (index != 0 && index < timers->size()) {
+        *a_Left = timers->GetTimer(index - 1);
+        return true;
+      }
+    }
   }
-  return nullptr;
+  return false;
 }
 
 //-----------------------------------------------------------------------------
-const TextBox* ThreadTrack::GetUp(TextBox* a_TextBox) const {
-  const Timer& timer = a_TextBox->GetTimer();
-  return GetFirstBeforeTime(timer.m_Start, timer.m_Depth - 1);
+bool ThreadTrack::GetRight(const Timer& a_Timer, Timer* a_Right) const {
+  if (a_Timer.m_TID == m_ThreadID) {
+    std::shared_ptr<TimerColumns> timers = GetTimers(a_Timer.m_Depth);
+    if (timers) {
+      size_t index = Find(*timers, a_Timer);
+      if (index + 1 < timers->size()) {
+        *a_Right = timers->GetTimer(index + 1);
+        return true;
+      }
+    }
+  }
+  return false;
 }
 
 //-----------------------------------------------------------------------------
-const TextBox* ThreadTrack::GetDown(TextBox* a_TextBox) const {
-  const Timer& timer = a_TextBox->GetTimer();
-  return GetFirstAfterTime(timer.m_Start, timer.m_Depth + 1);
+bool ThreadTrack::GetUp(const Timer& a_Timer, Timer* a_Up) const {
+  return GetFirstBeforeTime(a_Timer.m_Start, a_Timer.m_Depth - 1, a_Up);
 }
 
 //-----------------------------------------------------------------------------
-std::vector<std::shared_ptr<TimerChain>> ThreadTrack::GetAllChains() const {
-  std::vector<std::shared_ptr<TimerChain>> chains;
-  for (const auto& pair : m_Timers) {
-    chains.push_back(pair.second);
-  }
-  return chains;
+bool ThreadTrack::GetDown(const Timer& a_Timer, Timer* a_Down) const {
+  return GetFirstAfterTime(a_Timer.m_Start, a_Timer.m_Depth + 1, a_Down);
 }
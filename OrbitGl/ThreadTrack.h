@@ -6,17 +6,14 @@
 #include <map>
 #include <memory>
 
-#include "BlockChain.h"
 #include "CallstackTypes.h"
-#include "TextBox.h"
 #include "Threading.h"
+#include "TimerColumns.h"
 #include "Track.h"
 
 class TextRenderer;
 class EventTrack;
 
-typedef BlockChain<TextBox, 4 * 1024> TimerChain;
-
 //-----------------------------------------------------------------------------
 class ThreadTrack : public Track {
  public:
@@ -26,11 +23,13 @@ class ThreadTrack : public Track {
   void Draw(GlCanvas* a_Canvas, bool a_Picking) override;
   void OnDrag(int a_X, int a_Y) override;
   void OnTimer(const Timer& a_Timer);
+  // Same as calling OnTimer for each timer, locking once.
+  void OnTimers(const Timer* const* a_Timers, size_t a_NumTimers);
 
   // Track
   float GetHeight() const override;
 
-  std::vector<std::shared_ptr<TimerChain>> GetTimers();
+  std::vector<std::shared_ptr<TimerColumns>> GetTimers();
   uint32_t GetDepth() const { return m_Depth; }
 
   Color GetColor() const;
@@ -40,15 +39,20 @@ class ThreadTrack : public Track {
   TickType GetMinTime() const { return m_MinTime; }
   TickType GetMaxTime() const { return m_MaxTime; }
 
-  const TextBox* GetFirstAfterTime(TickType a_Tick, uint32_t a_Depth) const;
-  const TextBox* GetFirstBeforeTime(TickType a_Tick, uint32_t a_Depth) const;
+  // Bytes held by the timers of all depths.
+  size_t GetTimerMemoryUsage() const;
 
-  const TextBox* GetLeft(TextBox* a_TextBox) const;
-  const TextBox* GetRight(TextBox* a_TextBox) const;
-  const TextBox* GetUp(TextBox* a_TextBox) const;
-  const TextBox* GetDown(TextBox* a_TextBox) const;
+  // Timers are returned by value, see TimerColumns. These return false if
+  // there is no such timer.
+  bool GetFirstAfterTime(TickType a_Tick, uint32_t a_Depth,
+                         Timer* a_Timer) const;
+  bool GetFirstBeforeTime(TickType a_Tick, uint32_t a_Depth,
+                          Timer* a_Timer) const;
 
-  std::vector<std::shared_ptr<TimerChain>> GetAllChains() const;
+  bool GetLeft(const Timer& a_Timer, Timer* a_Left) const;
+  bool GetRight(const Timer& a_Timer, Timer* a_Right) const;
+  bool GetUp(const Timer& a_Timer, Timer* a_Up) const;
+  bool GetDown(const Timer& a_Timer, Timer* a_Down) const;
 
   bool GetVisible() const { return m_Visible; }
   void SetVisible(bool value) { m_Visible = value; }
@@ -57,7 +61,9 @@ class ThreadTrack : public Track {
   inline void UpdateDepth(uint32_t a_Depth) {
     if (a_Depth > m_Depth) m_Depth = a_Depth;
   }
-  std::shared_ptr<TimerChain> GetTimers(uint32_t a_Depth) const;
+  std::shared_ptr<TimerColumns> GetTimers(uint32_t a_Depth) const;
+  // Index of "a_Timer" in "a_Timers", or a_Timers.size() if it isn't there.
+  static size_t Find(const TimerColumns& a_Timers, const Timer& a_Timer);
 
  protected:
   TextRenderer* m_TextRenderer = nullptr;
@@ -71,5 +77,5 @@ class ThreadTrack : public Track {
   std::atomic<TickType> m_MaxTime;
   mutable Mutex m_Mutex;
 
-  std::map<int, std::shared_ptr<TimerChain>> m_Timers;
+  std::map<int, std::shared_ptr<TimerColumns>> m_Timers;
 };
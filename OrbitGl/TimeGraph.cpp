@@ -5,6 +5,9 @@
 #include "TimeGraph.h"
 
 #include <algorithm>
+#include <limits>
+#include <thread>
+#include <tuple>
 
 #include "App.h"
 #include "Batcher.h"
@@ -25,7 +28,6 @@
 #include "ThreadTrack.h"
 #include "TimerManager.h"
 #include "Utils.h"
-#include "absl/strings/str_format.h"
 
 #ifdef _WIN32
 #include "EventTracer.h"
@@ -34,7 +36,10 @@
 TimeGraph* GCurrentTimeGraph = nullptr;
 
 //-----------------------------------------------------------------------------
-TimeGraph::TimeGraph() { m_LastThreadReorder.Start(); }
+TimeGraph::TimeGraph()
+    : m_WorkerPool(std::max(std::thread::hardware_concurrency(), 1u) - 1) {
+  m_LastThreadReorder.Start();
+}
 
 //-----------------------------------------------------------------------------
 void TimeGraph::SetCanvas(GlCanvas* a_Canvas) {
@@ -52,6 +57,9 @@ void TimeGraph::SetFontSize(int a_FontSize) {
 //-----------------------------------------------------------------------------
 void TimeGraph::Clear() {
   m_Batcher.Reset();
+  m_TrackPrimitives.clear();
+  m_CorePrimitives.reset();
+  m_LabelCaches.clear();
   m_SessionMinCounter = 0xFFFFFFFFFFFFFFFF;
   m_SessionMaxCounter = 0;
   m_ThreadCountMap.clear();
@@ -62,8 +70,7 @@ void TimeGraph::Clear() {
   ScopeLock lock(m_Mutex);
   m_ThreadTracks.clear();
 
-  m_ContextSwitchesMap.clear();
-  m_CoreUtilizationMap.clear();
+  m_ContextSwitches.Clear();
 }
 
 //-----------------------------------------------------------------------------
@@ -121,6 +128,25 @@ void TimeGraph::Zoom(const TextBox* a_TextBox) {
   SetMinMax(mid - extent, mid + extent);
 }
 
+//-----------------------------------------------------------------------------
+void TimeGraph::FollowCapture() {
+  if (!UpdateSessionMinMaxCounter()) return;
+
+  double sessionUs =
+      MicroSecondsFromTicks(m_SessionMinCounter, m_SessionMaxCounter);
+  if (sessionUs <= m_MaxTimeUs) {
+    m_NeedsAppendPrimitives = true;
+    return;
+  }
+
+  // Leave room for a quarter of the view, or of the capture when it is
+  // shorter than the history shown.
+  double historyUs = GNumHistorySeconds * 1000 * 1000;
+  m_MaxTimeUs = sessionUs + 0.25 * std::min(sessionUs, historyUs);
+  m_MinTimeUs = std::max(m_MaxTimeUs - historyUs, 0.0);
+  NeedsUpdate();
+}
+
 //-----------------------------------------------------------------------------
 double TimeGraph::GetSessionTimeSpanUs() {
   if (UpdateSessionMinMaxCounter()) {
@@ -206,41 +232,70 @@ double TimeGraph::GetTimeIntervalMicro(double a_Ratio) {
 
 //-----------------------------------------------------------------------------
 void TimeGraph::ProcessTimer(const Timer& a_Timer) {
-  if (a_Timer.m_End > m_SessionMaxCounter) {
-    m_SessionMaxCounter = a_Timer.m_End;
+  ProcessTimers(&a_Timer, 1);
+}
+
+//-----------------------------------------------------------------------------
+void TimeGraph::ProcessTimers(const Timer* a_Timers, size_t a_NumTimers) {
+  // Large batches are split, which bounds what the batch keeps allocated.
+  const size_t kMaxBatchSize = 4096;
+  while (a_NumTimers > kMaxBatchSize) {
+    ProcessTimers(a_Timers, kMaxBatchSize);
+    a_Timers += kMaxBatchSize;
+    a_NumTimers -= kMaxBatchSize;
   }
 
-  switch (a_Timer.m_Type) {
-    case Timer::ALLOC:
-      m_MemTracker.ProcessAlloc(a_Timer);
-      return;
-    case Timer::FREE:
-      m_MemTracker.ProcessFree(a_Timer);
-      return;
-    case Timer::CORE_ACTIVITY:
-      Capture::GHasContextSwitches = true;
-      break;
-    default:
-      break;
+  m_TimerBatch.Clear();
+  for (size_t i = 0; i < a_NumTimers; ++i) {
+    const Timer& timer = a_Timers[i];
+    if (timer.m_End > m_SessionMaxCounter) {
+      m_SessionMaxCounter = timer.m_End;
+    }
+
+    switch (timer.m_Type) {
+      case Timer::ALLOC:
+        m_MemTracker.ProcessAlloc(timer);
+        continue;
+      case Timer::FREE:
+        m_MemTracker.ProcessFree(timer);
+        continue;
+      case Timer::CORE_ACTIVITY:
+        AddCoreActivity(timer);
+        continue;
+      default:
+        break;
+    }
+
+    // Use thead 0 as container for scheduling events.
+    bool isScheduling = timer.IsType(Timer::THREAD_ACTIVITY);
+    m_TimerBatch.Add(timer, isScheduling ? 0 : timer.m_TID);
   }
+  m_TimerBatch.Group();
 
-  if (a_Timer.m_FunctionAddress > 0) {
-    Function* func = Capture::GTargetProcess->GetFunctionFromAddress(
-        a_Timer.m_FunctionAddress);
+  m_BatchFunctions.clear();
+  for (const TimerBatch::Function& function : m_TimerBatch.GetFunctions()) {
+    Function* func = nullptr;
+    if (function.address > 0) {
+      func = Capture::GTargetProcess->GetFunctionFromAddress(function.address);
+    }
     if (func != nullptr) {
-      ++Capture::GFunctionCountMap[a_Timer.m_FunctionAddress];
-      func->UpdateStats(a_Timer);
+      Capture::GFunctionCountMap[function.address] += function.num_timers;
     }
+    m_BatchFunctions.push_back(func);
   }
 
-  if (!a_Timer.IsType(Timer::THREAD_ACTIVITY) &&
-      !a_Timer.IsType(Timer::CORE_ACTIVITY)) {
-    GetThreadTrack(a_Timer.m_TID)->OnTimer(a_Timer);
-    ++m_ThreadCountMap[a_Timer.m_TID];
-  } else {
-    // Use thead 0 as container for scheduling events.
-    GetThreadTrack(0)->OnTimer(a_Timer);
-    ++m_ThreadCountMap[0];
+  const Timer* const* timers = m_TimerBatch.GetTimers();
+  for (size_t i = 0; i < m_TimerBatch.size(); ++i) {
+    if (Function* func = m_BatchFunctions[m_TimerBatch.GetFunctionIndex(i)]) {
+      func->UpdateStats(*timers[i]);
+    }
+  }
+
+  for (const TimerBatch::Thread& thread : m_TimerBatch.GetThreads()) {
+    uint32_t numTimers = thread.end - thread.begin;
+    GetThreadTrack(thread.thread_id)->OnTimers(timers + thread.begin,
+                                               numTimers);
+    m_ThreadCountMap[thread.thread_id] += numTimers;
   }
 }
 
@@ -258,70 +313,95 @@ uint32_t TimeGraph::GetNumTimers() const {
 //-----------------------------------------------------------------------------
 uint32_t TimeGraph::GetNumCores() const {
   ScopeLock lock(m_Mutex);
-  return m_CoreUtilizationMap.size();
+  return m_ContextSwitches.GetNumProcessors();
 }
 
 //-----------------------------------------------------------------------------
-std::vector<std::shared_ptr<TimerChain>> TimeGraph::GetAllTimerChains() const {
-  std::vector<std::shared_ptr<TimerChain>> chains;
-  for (const auto& pair : m_ThreadTracks) {
+std::vector<std::shared_ptr<TimerColumns>> TimeGraph::GetAllTimerColumns()
+    const {
+  std::vector<std::shared_ptr<TimerColumns>> timers;
+  for (const auto& pair : GetThreadTracksCopy()) {
     const std::shared_ptr<ThreadTrack>& track = pair.second;
-    Append(chains, track->GetAllChains());
+    Append(timers, track->GetTimers());
   }
-  return chains;
+  return timers;
 }
 
 //-----------------------------------------------------------------------------
-void TimeGraph::AddContextSwitch(const ContextSwitch& a_CS) {
-  auto pair = std::make_pair(a_CS.m_Time, a_CS);
-
-  if (a_CS.m_Type == ContextSwitch::Out) {
-    if (true) {
-      // Processor time line
-      std::map<long long, ContextSwitch>& csMap =
-          m_CoreUtilizationMap[a_CS.m_ProcessorIndex];
-
-      if (!csMap.empty()) {
-        ContextSwitch& lastCS = csMap.rbegin()->second;
-        if (lastCS.m_Type == ContextSwitch::In) {
-          Timer timer;
-          timer.m_Start = lastCS.m_Time;
-          timer.m_End = a_CS.m_Time;
-          timer.m_TID = a_CS.m_ThreadId;
-          timer.m_Processor = (int8_t)a_CS.m_ProcessorIndex;
-          timer.m_SessionID = Message::GSessionID;
-          timer.SetType(Timer::CORE_ACTIVITY);
-
-          GTimerManager->Add(timer);
-        }
-      }
-    }
+size_t TimeGraph::GetTimerMemoryUsage() const {
+  size_t memoryUsage = 0;
+  for (const auto& pair : GetThreadTracksCopy()) {
+    memoryUsage += pair.second->GetTimerMemoryUsage();
+  }
+  return memoryUsage;
+}
 
-    if (false) {
-      // Thread time line
-      std::map<long long, ContextSwitch>& csMap =
-          m_ContextSwitchesMap[a_CS.m_ThreadId];
-
-      if (!csMap.empty()) {
-        ContextSwitch& lastCS = csMap.rbegin()->second;
-        if (lastCS.m_Type == ContextSwitch::In) {
-          Timer timer;
-          timer.m_Start = lastCS.m_Time;
-          timer.m_End = a_CS.m_Time;
-          timer.m_TID = a_CS.m_ThreadId;
-          timer.m_SessionID = Message::GSessionID;
-          timer.SetType(Timer::THREAD_ACTIVITY);
-
-          GTimerManager->Add(timer);
-        }
-      }
+//-----------------------------------------------------------------------------
+size_t TimeGraph::GetContextSwitchMemoryUsage() const {
+  ScopeLock lock(m_Mutex);
+  return m_ContextSwitches.GetMemoryUsage();
+}
+
+//-----------------------------------------------------------------------------
+static Timer MakeCoreActivityTimer(
+    uint16_t a_ProcessorIndex,
+    const ContextSwitchTimeline::RunningInterval& a_Interval) {
+  Timer timer;
+  timer.m_Start = a_Interval.start;
+  timer.m_End = a_Interval.end;
+  timer.m_TID = a_Interval.thread_id;
+  timer.m_Processor = (int8_t)a_ProcessorIndex;
+  timer.m_SessionID = Message::GSessionID;
+  timer.SetType(Timer::CORE_ACTIVITY);
+  return timer;
+}
+
+//-----------------------------------------------------------------------------
+std::vector<Timer> TimeGraph::GetCoreActivityTimers() const {
+  std::vector<Timer> timers;
+  ScopeLock lock(m_Mutex);
+  for (uint16_t processorIndex : m_ContextSwitches.GetProcessorIndices()) {
+    m_ContextSwitches.ForEachRunningInterval(
+        processorIndex, 0, std::numeric_limits<uint64_t>::max(),
+        [&](const ContextSwitchTimeline::RunningInterval& a_Interval) {
+          timers.push_back(MakeCoreActivityTimer(processorIndex, a_Interval));
+        });
+  }
+  return timers;
+}
+
+//-----------------------------------------------------------------------------
+void TimeGraph::AddContextSwitch(const ContextSwitch& a_CS) {
+  // Core tracks are drawn from the running intervals of the timeline, new
+  // ones are appended to the primitives. A late switch can pair the
+  // intervals already drawn differently.
+  {
+    ScopeLock lock(m_Mutex);
+    uint64_t numLateContextSwitches =
+        m_ContextSwitches.GetNumLateContextSwitches();
+    m_ContextSwitches.Add(a_CS);
+    if (m_ContextSwitches.GetNumLateContextSwitches() !=
+        numLateContextSwitches) {
+      NeedsUpdate();
     }
   }
+  Capture::GHasContextSwitches = true;
+  UpdateMaxTimeStamp(a_CS.m_Time);
+}
 
-  // TODO: if events are already sorted by timestamp, then
-  //       we don't need to use maps. To investigate...
-  m_ContextSwitchesMap[a_CS.m_ThreadId].insert(pair);
-  m_CoreUtilizationMap[a_CS.m_ProcessorIndex].insert(pair);
+//-----------------------------------------------------------------------------
+void TimeGraph::AddCoreActivity(const Timer& a_Timer) {
+  // Saved captures store the running intervals as timers, they are added to
+  // the timeline as the switches that make them.
+  ContextSwitch contextSwitch(ContextSwitch::In);
+  contextSwitch.m_ThreadId = a_Timer.m_TID;
+  contextSwitch.m_ProcessorIndex = a_Timer.m_Processor;
+  contextSwitch.m_ProcessorNumber = a_Timer.m_Processor;
+  contextSwitch.m_Time = a_Timer.m_Start;
+  AddContextSwitch(contextSwitch);
+  contextSwitch.m_Type = ContextSwitch::Out;
+  contextSwitch.m_Time = a_Timer.m_End;
+  AddContextSwitch(contextSwitch);
 }
 
 //-----------------------------------------------------------------------------
@@ -396,17 +476,30 @@ void TimeGraph::Select(const Vec2& a_WorldStart, const Vec2 a_WorldStop) {
 }
 
 //-----------------------------------------------------------------------------
-void TimeGraph::SelectLeft(const TextBox* a_TextBox) {
-  TextBox* textBox = const_cast<TextBox*>(a_TextBox);
-  Capture::GSelectedTextBox = textBox;
-  const Timer& timer = textBox->GetTimer();
+void TimeGraph::SetSelectedTextBox(const TextBox* a_TextBox) {
+  if (a_TextBox == nullptr) {
+    Capture::GSelectedTextBox = nullptr;
+    return;
+  }
 
-  if (IsVisible(timer)) {
+  m_SelectedTextBox = *a_TextBox;
+  // The label belongs to the primitives.
+  m_SelectedTextBox.SetLabel(nullptr);
+  Capture::GSelectedTextBox = &m_SelectedTextBox;
+}
+
+//-----------------------------------------------------------------------------
+void TimeGraph::SelectLeft(const Timer& a_Timer) {
+  TextBox textBox;
+  textBox.SetTimer(a_Timer);
+  SetSelectedTextBox(&textBox);
+
+  if (IsVisible(a_Timer)) {
     return;
   }
 
   double currentTimeWindowUs = m_MaxTimeUs - m_MinTimeUs;
-  m_RefTimeUs = MicroSecondsFromTicks(m_SessionMinCounter, timer.m_Start);
+  m_RefTimeUs = MicroSecondsFromTicks(m_SessionMinCounter, a_Timer.m_Start);
 
   double ratio = m_MarginRatio;
   double minTimeUs = m_RefTimeUs - ratio * currentTimeWindowUs;
@@ -416,17 +509,17 @@ void TimeGraph::SelectLeft(const TextBox* a_TextBox) {
 }
 
 //-----------------------------------------------------------------------------
-void TimeGraph::SelectRight(const TextBox* a_TextBox) {
-  TextBox* textBox = const_cast<TextBox*>(a_TextBox);
-  Capture::GSelectedTextBox = textBox;
-  const Timer& timer = textBox->GetTimer();
+void TimeGraph::SelectRight(const Timer& a_Timer) {
+  TextBox textBox;
+  textBox.SetTimer(a_Timer);
+  SetSelectedTextBox(&textBox);
 
-  if (IsVisible(timer)) {
+  if (IsVisible(a_Timer)) {
     return;
   }
 
   double currentTimeWindowUs = m_MaxTimeUs - m_MinTimeUs;
-  m_RefTimeUs = MicroSecondsFromTicks(m_SessionMinCounter, timer.m_End);
+  m_RefTimeUs = MicroSecondsFromTicks(m_SessionMinCounter, a_Timer.m_End);
 
   static double ratio = 1.0;
   double minTimeUs = m_RefTimeUs - ratio * currentTimeWindowUs;
@@ -442,24 +535,248 @@ void TimeGraph::NeedsUpdate() { m_NeedsUpdatePrimitives = true; }
 inline std::string GetExtraInfo(const Timer& a_Timer) {
   std::string info;
   if (!Capture::IsCapturing() && a_Timer.GetType() == Timer::UNREAL_OBJECT) {
-    info =
-        "[" + ws2s(GOrbitUnreal.GetObjectNames()[a_Timer.m_UserData[0]]) + "]";
+    // Doesn't add entries, unlike operator[], for calls from several threads.
+    auto& objectNames = GOrbitUnreal.GetObjectNames();
+    auto it = objectNames.find(a_Timer.m_UserData[0]);
+    if (it != objectNames.end()) {
+      info = "[" + ws2s(it->second) + "]";
+    }
   }
   return info;
 }
 
 //-----------------------------------------------------------------------------
-void TimeGraph::UpdatePrimitives(bool a_Picking) {
-  m_Batcher.Reset();
-  m_VisibleTextBoxes.clear();
-  m_TextRendererStatic.Clear();
-  m_TextRendererStatic.Init();  // TODO: needed?
+// Doesn't add entries, unlike operator[], for calls from several threads.
+static Function* FindFunction(const std::map<ULONG64, Function*>& a_Functions,
+                              ULONG64 a_Address) {
+  auto it = a_Functions.find(a_Address);
+  return it != a_Functions.end() ? it->second : nullptr;
+}
+
+//-----------------------------------------------------------------------------
+static bool IsSameTimer(const Timer& a_Timer, const Timer& a_Other) {
+  return a_Timer.m_Start == a_Other.m_Start && a_Timer.m_End == a_Other.m_End &&
+         a_Timer.m_TID == a_Other.m_TID && a_Timer.m_Depth == a_Other.m_Depth &&
+         a_Timer.m_Type == a_Other.m_Type;
+}
+
+//-----------------------------------------------------------------------------
+void TimeGraph::UpdateTrackPrimitives(ThreadTrack& a_Track,
+                                      const PrimitivesRange& a_Range,
+                                      TrackPrimitives* a_Primitives) {
+  std::vector<std::shared_ptr<TimerColumns>> depthTimers = a_Track.GetTimers();
+  for (auto& timers : depthTimers) {
+    if (timers == nullptr) break;
+
+    size_t numTimers = timers->size();
+    size_t& numTimersWithPrimitives =
+        a_Primitives->m_NumTimersWithPrimitives[timers.get()];
+    size_t begin = numTimersWithPrimitives;
+    numTimersWithPrimitives = numTimers;
+    timers->ForEachPrimitive(
+        begin, numTimers, a_Range.m_Start, a_Range.m_Stop,
+        a_Range.m_TicksPerPixel,
+        [&](size_t a_Index, const TimerColumns::Summary* a_Summary) {
+          // A run is drawn as its first timer, stretched.
+          Timer timer = timers->GetTimer(a_Index);
+          if (a_Summary != nullptr) {
+            timer.m_Start = a_Summary->start;
+            timer.m_End = a_Summary->end;
+            timer.m_FunctionAddress = a_Summary->function_address;
+          }
+          AddTimerPrimitives(timer, a_Range, a_Primitives);
+        });
+  }
+}
+
+//-----------------------------------------------------------------------------
+void TimeGraph::UpdateCorePrimitives(const PrimitivesRange& a_Range,
+                                     TrackPrimitives* a_Primitives) {
+  // Intervals are copied out of the lock, drawing them looks up functions
+  // and the selection.
+  std::vector<Timer> timers;
+  {
+    ScopeLock lock(m_Mutex);
+    for (uint16_t processorIndex : m_ContextSwitches.GetProcessorIndices()) {
+      TrackPrimitives::CoreState& core = a_Primitives->m_Cores[processorIndex];
+      TickType minTime = core.m_HasInterval
+                             ? std::max(a_Range.m_Start, core.m_LastEnd)
+                             : a_Range.m_Start;
+      m_ContextSwitches.ForEachRunningInterval(
+          processorIndex, minTime, a_Range.m_Stop,
+          [&](const ContextSwitchTimeline::RunningInterval& a_Interval) {
+            // Intervals are sorted and don't overlap, the ones up to the
+            // last are done.
+            if (core.m_HasInterval &&
+                std::tie(a_Interval.start, a_Interval.end) <=
+                    std::tie(core.m_LastStart, core.m_LastEnd)) {
+              return;
+            }
+            core.m_HasInterval = true;
+            core.m_LastStart = a_Interval.start;
+            core.m_LastEnd = a_Interval.end;
+            // Of the intervals lasting at most a pixel, one per pixel is
+            // drawn.
+            if (a_Interval.end - a_Interval.start <= a_Range.m_TicksPerPixel) {
+              if (a_Interval.start < core.m_NextLineTick) return;
+              core.m_NextLineTick = a_Interval.start + a_Range.m_TicksPerPixel;
+            }
+            timers.push_back(MakeCoreActivityTimer(processorIndex, a_Interval));
+          });
+    }
+  }
 
+  for (const Timer& timer : timers) {
+    AddTimerPrimitives(timer, a_Range, a_Primitives);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void TimeGraph::AddTimerPrimitives(const Timer& a_Timer,
+                                   const PrimitivesRange& a_Range,
+                                   TrackPrimitives* a_Primitives) {
+  double start =
+      MicroSecondsFromTicks(m_SessionMinCounter, a_Timer.m_Start) -
+      m_MinTimeUs;
+  double end = MicroSecondsFromTicks(m_SessionMinCounter, a_Timer.m_End) -
+               m_MinTimeUs;
+  double elapsed = end - start;
+
+  double NormalizedStart = start * a_Range.m_InvTimeWindow;
+  double NormalizedLength = elapsed * a_Range.m_InvTimeWindow;
+
+  bool isCore = a_Timer.IsType(Timer::CORE_ACTIVITY);
+
+  float threadOffset =
+      !isCore ? m_Layout.GetThreadOffset(a_Timer.m_TID, a_Timer.m_Depth)
+              : m_Layout.GetCoreOffset(a_Timer.m_Processor);
+
+  float boxHeight = !isCore ? m_Layout.GetTextBoxHeight()
+                            : m_Layout.GetTextCoresHeight();
+
+  float WorldTimerStartX =
+      float(m_WorldStartX + NormalizedStart * m_WorldWidth);
+  float WorldTimerWidth = float(NormalizedLength * m_WorldWidth);
+
+  Vec2 pos(WorldTimerStartX, threadOffset);
+  Vec2 size(WorldTimerWidth, boxHeight);
+
+  a_Primitives->m_TextBoxes.push_back(TextBox(pos, size));
+  TextBox& textBox = a_Primitives->m_TextBoxes.back();
+  textBox.SetTimer(a_Timer);
+
+  if (!isCore) {
+    int& depth = a_Primitives->m_ThreadDepths[a_Timer.m_TID];
+    depth = std::max(depth, a_Timer.m_Depth + 1);
+  }
+
+  bool isContextSwitch = a_Timer.IsType(Timer::THREAD_ACTIVITY);
+  bool isVisibleWidth = NormalizedLength * m_Canvas->getWidth() > 1;
+  bool isSameThreadIdAsSelected =
+      isCore && (a_Timer.m_TID == Capture::GSelectedThreadId);
+  bool isInactive =
+      (!isContextSwitch && a_Timer.m_FunctionAddress &&
+       (Capture::GVisibleFunctionsMap.size() &&
+        FindFunction(Capture::GVisibleFunctionsMap,
+                     a_Timer.m_FunctionAddress) == nullptr)) ||
+      (Capture::GSelectedThreadId != 0 && isCore &&
+       !isSameThreadIdAsSelected);
+  bool isSelected = Capture::GSelectedTextBox != nullptr &&
+                    IsSameTimer(a_Timer,
+                                Capture::GSelectedTextBox->GetTimer());
+
+  const unsigned char g = 100;
+  Color grey(g, g, g, 255);
+  static Color selectionColor(0, 128, 255, 255);
+  Color col = GetThreadColor(a_Timer.m_TID);
+  col = isSelected
+            ? selectionColor
+            : isSameThreadIdAsSelected ? col : isInactive ? grey : col;
+  textBox.SetColor(col[0], col[1], col[2]);
+  static int oddAlpha = 210;
+  if (!(a_Timer.m_Depth & 0x1)) {
+    col[3] = oddAlpha;
+  }
+
+  float z = isInactive ? GlCanvas::Z_VALUE_BOX_INACTIVE
+                       : GlCanvas::Z_VALUE_BOX_ACTIVE;
+
+  if (isVisibleWidth) {
+    Box box;
+    box.m_Vertices[0] = Vec3(pos[0], pos[1], z);
+    box.m_Vertices[1] = Vec3(pos[0], pos[1] + size[1], z);
+    box.m_Vertices[2] = Vec3(pos[0] + size[0], pos[1] + size[1], z);
+    box.m_Vertices[3] = Vec3(pos[0] + size[0], pos[1], z);
+    Color colors[4];
+    Fill(colors, col);
+
+    static float coeff = 0.94f;
+    Vec3 dark = Vec3(col[0], col[1], col[2]) * coeff;
+    colors[1] = Color((unsigned char)dark[0], (unsigned char)dark[1],
+                      (unsigned char)dark[2], (unsigned char)col[3]);
+    colors[0] = colors[1];
+    a_Primitives->m_Batch.AddBox(box, colors, &textBox);
+
+    if (!isContextSwitch && !isCore) {
+      double elapsedMillis = ((double)elapsed) * 0.001;
+      Function* func = FindFunction(Capture::GSelectedFunctionsMap,
+                                    a_Timer.m_FunctionAddress);
+
+      const std::string* name = nullptr;
+      std::string extraInfo;
+      if (func) {
+        name = &func->PrettyName();
+        extraInfo = GetExtraInfo(a_Timer);
+      } else if (!SystraceManager::Get().IsEmpty()) {
+        textBox.SetLabel(a_Primitives->m_TextArena.Add(
+            SystraceManager::Get().GetFunctionName(
+                a_Timer.m_FunctionAddress)));
+      } else if (!Capture::IsCapturing()) {
+        // GZoneNames is populated when capturing, prevent race
+        // by accessing it only when not capturing.
+        auto it = Capture::GZoneNames.find(a_Timer.m_FunctionAddress);
+        if (it != Capture::GZoneNames.end()) {
+          name = &it->second;
+        }
+      }
+
+      // Labels are cached per function and displayed duration, the
+      // ones with extra info are made for each a_Timer.
+      if (name != nullptr && extraInfo.empty()) {
+        TimerLabelCache::Label label =
+            a_Primitives->m_LabelCache->GetLabel(
+                a_Timer.m_FunctionAddress, *name, elapsedMillis);
+        textBox.SetLabel(label.text);
+        textBox.SetElapsedTimeTextLength(label.time_length);
+      } else if (name != nullptr) {
+        char time[kMaxPrettyTimeLength];
+        size_t timeLength = FormatPrettyTime(elapsedMillis, time);
+        textBox.SetLabel(a_Primitives->m_TextArena.Join(
+            {*name, " ", extraInfo, " ", {time, timeLength}}));
+        textBox.SetElapsedTimeTextLength(timeLength);
+      }
+    }
+
+    if (!isCore) {
+      a_Primitives->m_Labels.push_back(&textBox);
+    }
+  } else {
+    Line line;
+    line.m_Beg = Vec3(pos[0], pos[1], z);
+    line.m_End = Vec3(pos[0], pos[1] + size[1], z);
+    Color colors[2];
+    Fill(colors, col);
+    a_Primitives->m_Batch.AddLine(line, colors, PickingID::LINE,
+                                  &textBox);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void TimeGraph::UpdatePrimitives(bool a_Picking) {
   UpdateMaxTimeStamp(GEventTracer.GetEventBuffer().GetMaxTime());
 
   m_SceneBox = m_Canvas->GetSceneBox();
   float minX = m_SceneBox.GetPosX();
-  m_NumDrawnTextBoxes = 0;
 
   m_TimeWindowUs = m_MaxTimeUs - m_MinTimeUs;
   m_WorldStartX = m_Canvas->GetWorldTopLeftX();
@@ -468,176 +785,129 @@ void TimeGraph::UpdatePrimitives(bool a_Picking) {
 
   UpdateThreadIds();
 
-  double span = m_MaxTimeUs - m_MinTimeUs;
-  TickType rawStart = GetTickFromUs(m_MinTimeUs + m_MarginRatio * span);
-  TickType rawStop = GetTickFromUs(m_MaxTimeUs);
-
-  unsigned int TextBoxID = 0;
+  // Primitives of new timers are appended while nothing else changed.
+  PrimitivesView view;
+  view.m_MinTimeUs = m_MinTimeUs;
+  view.m_MaxTimeUs = m_MaxTimeUs;
+  view.m_SessionMinCounter = m_SessionMinCounter;
+  view.m_WorldStartX = m_WorldStartX;
+  view.m_WorldWidth = m_WorldWidth;
+  view.m_Width = m_Canvas->getWidth();
+  view.m_ThreadBlockOffsets = m_Layout.GetThreadBlockOffsets();
+  bool append = !a_Picking && !m_NeedsUpdatePrimitives &&
+                !m_PrimitivesPicking && view == m_PrimitivesView;
+  if (append) {
+    ++m_NumPrimitiveAppends;
+  } else {
+    m_Batcher.Reset();
+    m_TrackPrimitives.clear();
+    m_CorePrimitives.reset();
+    // No text box points to the labels anymore, caches that grew too big
+    // while zooming are emptied.
+    static const size_t kMaxCachedLabels = 64 * 1024;
+    for (auto& pair : m_LabelCaches) {
+      if (pair.second->size() > kMaxCachedLabels) pair.second->Clear();
+    }
+    if (m_DrawText) {
+      m_TextRendererStatic.Clear();
+      m_TextRendererStatic.Init();  // TODO: needed?
+    }
+    m_NumDrawnTextBoxes = 0;
+    m_LastEventTick = 0;
+    m_PrimitivesView = view;
+    m_PrimitivesPicking = a_Picking;
+    ++m_NumPrimitiveRebuilds;
+  }
 
+  PrimitivesRange range;
+  double span = m_MaxTimeUs - m_MinTimeUs;
+  range.m_Start = GetTickFromUs(m_MinTimeUs + m_MarginRatio * span);
+  range.m_Stop = GetTickFromUs(m_MaxTimeUs);
+  // Runs of timers lasting at most a pixel are drawn as one line.
+  range.m_TicksPerPixel = (range.m_Stop - GetTickFromUs(m_MinTimeUs)) /
+                          std::max(m_Canvas->getWidth(), 1);
+  range.m_InvTimeWindow = invTimeWindow;
+
+  // Each visible track makes its primitives on a worker thread, they are
+  // added to the batcher and the text renderer in track order.
+  std::vector<std::shared_ptr<ThreadTrack>> tracks;
+  std::vector<TrackPrimitives*> trackPrimitives;
   for (auto& pair : GetThreadTracksCopy()) {
     std::shared_ptr<ThreadTrack>& threadTrack = pair.second;
-
     if (!m_Layout.IsThreadVisible(threadTrack->GetID())) continue;
 
-    std::vector<std::shared_ptr<TimerChain>> depthChain =
-        threadTrack->GetTimers();
-    for (auto& textBoxes : depthChain) {
-      if (textBoxes == nullptr) break;
-
-      for (TextBox& textBox : *textBoxes) {
-        const Timer& timer = textBox.GetTimer();
-
-        if (!(rawStart > timer.m_End || rawStop < timer.m_Start)) {
-          double start =
-              MicroSecondsFromTicks(m_SessionMinCounter, timer.m_Start) -
-              m_MinTimeUs;
-          double end = MicroSecondsFromTicks(m_SessionMinCounter, timer.m_End) -
-                       m_MinTimeUs;
-          double elapsed = end - start;
-
-          double NormalizedStart = start * invTimeWindow;
-          double NormalizedLength = elapsed * invTimeWindow;
-
-          bool isCore = timer.IsType(Timer::CORE_ACTIVITY);
-
-          float threadOffset =
-              !isCore ? m_Layout.GetThreadOffset(timer.m_TID, timer.m_Depth)
-                      : m_Layout.GetCoreOffset(timer.m_Processor);
-
-          float boxHeight = !isCore ? m_Layout.GetTextBoxHeight()
-                                    : m_Layout.GetTextCoresHeight();
-
-          float WorldTimerStartX =
-              float(m_WorldStartX + NormalizedStart * m_WorldWidth);
-          float WorldTimerWidth = float(NormalizedLength * m_WorldWidth);
-
-          Vec2 pos(WorldTimerStartX, threadOffset);
-          Vec2 size(WorldTimerWidth, boxHeight);
-
-          textBox.SetPos(pos);
-          textBox.SetSize(size);
-
-          if (!isCore) {
-            UpdateThreadDepth(timer.m_TID, timer.m_Depth + 1);
-          }
-
-          bool isContextSwitch = timer.IsType(Timer::THREAD_ACTIVITY);
-          bool isVisibleWidth = NormalizedLength * m_Canvas->getWidth() > 1;
-          bool isSameThreadIdAsSelected =
-              isCore && (timer.m_TID == Capture::GSelectedThreadId);
-          bool isInactive =
-              (!isContextSwitch && timer.m_FunctionAddress &&
-               (Capture::GVisibleFunctionsMap.size() &&
-                Capture::GVisibleFunctionsMap[timer.m_FunctionAddress] ==
-                    nullptr)) ||
-              (Capture::GSelectedThreadId != 0 && isCore &&
-               !isSameThreadIdAsSelected);
-          bool isSelected = &textBox == Capture::GSelectedTextBox;
-
-          const unsigned char g = 100;
-          Color grey(g, g, g, 255);
-          static Color selectionColor(0, 128, 255, 255);
-          Color col = GetThreadColor(timer.m_TID);
-          col = isSelected
-                    ? selectionColor
-                    : isSameThreadIdAsSelected ? col : isInactive ? grey : col;
-          textBox.SetColor(col[0], col[1], col[2]);
-          static int oddAlpha = 210;
-          if (!(timer.m_Depth & 0x1)) {
-            col[3] = oddAlpha;
-          }
-
-          float z = isInactive ? GlCanvas::Z_VALUE_BOX_INACTIVE
-                               : GlCanvas::Z_VALUE_BOX_ACTIVE;
-
-          if (isVisibleWidth) {
-            Box box;
-            box.m_Vertices[0] = Vec3(pos[0], pos[1], z);
-            box.m_Vertices[1] = Vec3(pos[0], pos[1] + size[1], z);
-            box.m_Vertices[2] = Vec3(pos[0] + size[0], pos[1] + size[1], z);
-            box.m_Vertices[3] = Vec3(pos[0] + size[0], pos[1], z);
-            Color colors[4];
-            Fill(colors, col);
-
-            static float coeff = 0.94f;
-            Vec3 dark = Vec3(col[0], col[1], col[2]) * coeff;
-            colors[1] = Color((unsigned char)dark[0], (unsigned char)dark[1],
-                              (unsigned char)dark[2], (unsigned char)col[3]);
-            colors[0] = colors[1];
-            m_Batcher.AddBox(box, colors, PickingID::BOX, &textBox);
-
-            if (!isContextSwitch && textBox.GetText().size() == 0) {
-              double elapsedMillis = ((double)elapsed) * 0.001;
-              std::string time = GetPrettyTime(elapsedMillis);
-              Function* func =
-                  Capture::GSelectedFunctionsMap[timer.m_FunctionAddress];
-
-              textBox.SetElapsedTimeTextLength(time.length());
-
-              const char* name = nullptr;
-              if (func) {
-                std::string extraInfo = GetExtraInfo(timer);
-                name = func->PrettyName().c_str();
-                std::string text = absl::StrFormat(
-                    "%s %s %s", name, extraInfo.c_str(), time.c_str());
-
-                textBox.SetText(text);
-              } else if (!SystraceManager::Get().IsEmpty()) {
-                textBox.SetText(SystraceManager::Get().GetFunctionName(
-                    timer.m_FunctionAddress));
-              } else if (!Capture::IsCapturing()) {
-                // GZoneNames is populated when capturing, prevent race
-                // by accessing it only when not capturing.
-                auto it = Capture::GZoneNames.find(timer.m_FunctionAddress);
-                if (it != Capture::GZoneNames.end()) {
-                  name = it->second.c_str();
-                  std::string text =
-                      absl::StrFormat("%s %s", name, time.c_str());
-                  textBox.SetText(text);
-                }
-              }
-            }
+    std::unique_ptr<TrackPrimitives>& primitives =
+        m_TrackPrimitives[threadTrack->GetID()];
+    if (primitives == nullptr) {
+      std::unique_ptr<TimerLabelCache>& labelCache =
+          m_LabelCaches[threadTrack->GetID()];
+      if (labelCache == nullptr) {
+        labelCache = std::make_unique<TimerLabelCache>();
+      }
+      primitives = std::make_unique<TrackPrimitives>();
+      primitives->m_LabelCache = labelCache.get();
+    }
+    tracks.push_back(threadTrack);
+    trackPrimitives.push_back(primitives.get());
+  }
 
-            if (!isCore) {
-              // m_VisibleTextBoxes.push_back(&textBox);
-              static Color s_Color(255, 255, 255, 255);
-
-              const Vec2& boxPos = textBox.GetPos();
-              const Vec2& boxSize = textBox.GetSize();
-              float posX = std::max(boxPos[0], minX);
-              float maxSize = boxPos[0] + boxSize[0] - posX;
-              m_TextRendererStatic.AddTextTrailingCharsPrioritized(
-                  textBox.GetText().c_str(), posX, textBox.GetPosY() + 1.f,
-                  GlCanvas::Z_VALUE_TEXT, s_Color,
-                  textBox.GetElapsedTimeTextLength(), maxSize);
-            }
-          } else {
-            Line line;
-            line.m_Beg = Vec3(pos[0], pos[1], z);
-            line.m_End = Vec3(pos[0], pos[1] + size[1], z);
-            Color colors[2];
-            Fill(colors, col);
-            m_Batcher.AddLine(line, colors, PickingID::LINE, &textBox);
-          }
-        }
+  auto updateTrack = [this, &tracks, &trackPrimitives, &range](size_t i) {
+    UpdateTrackPrimitives(*tracks[i], range, trackPrimitives[i]);
+  };
+  if (m_ParallelPrimitives) {
+    m_WorkerPool.ParallelFor(tracks.size(), updateTrack);
+  } else {
+    for (size_t i = 0; i < tracks.size(); ++i) updateTrack(i);
+  }
 
-        ++TextBoxID;
+  static Color s_Color(255, 255, 255, 255);
+  for (TrackPrimitives* primitives : trackPrimitives) {
+    m_Batcher.Append(primitives->m_Batch);
+    primitives->m_Batch.Clear();
+
+    if (m_DrawText) {
+      for (const TextBox* textBox : primitives->m_Labels) {
+        const Vec2& boxPos = textBox->GetPos();
+        const Vec2& boxSize = textBox->GetSize();
+        float posX = std::max(boxPos[0], minX);
+        float maxSize = boxPos[0] + boxSize[0] - posX;
+        m_TextRendererStatic.AddTextTrailingCharsPrioritized(
+            textBox->GetLabel(), posX, textBox->GetPosY() + 1.f,
+            GlCanvas::Z_VALUE_TEXT, s_Color,
+            textBox->GetElapsedTimeTextLength(), maxSize);
       }
     }
+    primitives->m_Labels.clear();
+
+    for (auto& pair : primitives->m_ThreadDepths) {
+      UpdateThreadDepth(pair.first, pair.second);
+    }
+    primitives->m_ThreadDepths.clear();
+  }
+
+  if (m_CorePrimitives == nullptr) {
+    m_CorePrimitives = std::make_unique<TrackPrimitives>();
   }
+  UpdateCorePrimitives(range, m_CorePrimitives.get());
+  m_Batcher.Append(m_CorePrimitives->m_Batch);
+  m_CorePrimitives->m_Batch.Clear();
 
   if (!a_Picking) {
-    UpdateEvents();
+    UpdateEvents(append);
   }
 
   m_NeedsUpdatePrimitives = false;
+  m_NeedsAppendPrimitives = false;
   m_NeedsRedraw = true;
 }
 
 //-----------------------------------------------------------------------------
-void TimeGraph::UpdateEvents() {
+void TimeGraph::UpdateEvents(bool a_Append) {
   TickType rawMin = GetTickFromUs(m_MinTimeUs);
   TickType rawMax = GetTickFromUs(m_MaxTimeUs);
+  // Appending draws the events newer than all events drawn. Events arriving
+  // after newer ones of other threads are drawn by the next full update.
+  TickType minTime = a_Append ? std::max(rawMin, m_LastEventTick) : rawMin;
 
   ScopeLock lock(GEventTracer.GetEventBuffer().GetMutex());
 
@@ -652,21 +922,23 @@ void TimeGraph::UpdateEvents() {
     // Sampling Events
     float ThreadOffset = (float)m_Layout.GetSamplingTrackOffset(threadID);
     if (ThreadOffset != -1.f) {
-      for (auto& callstackPair : callstacks) {
-        unsigned long long time = callstackPair.first;
-
-        if (time > rawMin && time < rawMax) {
-          float x = GetWorldFromTick(time);
-          Line line;
-          line.m_Beg = Vec3(x, ThreadOffset, GlCanvas::Z_VALUE_EVENT);
-          line.m_End = Vec3(x, ThreadOffset - m_Layout.GetEventTrackHeight(),
-                            GlCanvas::Z_VALUE_EVENT);
-          m_Batcher.AddLine(line, lineColor, PickingID::EVENT);
-        }
+      for (auto it = callstacks.upper_bound(minTime);
+           it != callstacks.end() && TickType(it->first) < rawMax; ++it) {
+        TickType time = it->first;
+        m_LastEventTick = std::max(m_LastEventTick, time);
+
+        float x = GetWorldFromTick(time);
+        Line line;
+        line.m_Beg = Vec3(x, ThreadOffset, GlCanvas::Z_VALUE_EVENT);
+        line.m_End = Vec3(x, ThreadOffset - m_Layout.GetEventTrackHeight(),
+                          GlCanvas::Z_VALUE_EVENT);
+        m_Batcher.AddLine(line, lineColor, PickingID::EVENT);
       }
     }
   }
 
+  if (a_Append) return;
+
   // Draw selected events
   Color selectedColor[2];
   Color col(0, 255, 0, 255);
@@ -730,7 +1002,8 @@ void TimeGraph::Draw(bool a_Picking) {
   //       Now that each thread track has multiple blockchains as opposed to
   //       only having a single global one, this a bit trickier.
   if (/*m_TextBoxes.keep( GParams.m_MaxNumTimers ) ||*/ (
-          !a_Picking && m_NeedsUpdatePrimitives) ||
+          !a_Picking &&
+          (m_NeedsUpdatePrimitives || m_NeedsAppendPrimitives)) ||
       a_Picking) {
     UpdatePrimitives(a_Picking);
   }
@@ -853,8 +1126,8 @@ void TimeGraph::OnLeft() {
   TextBox* selection = Capture::GSelectedTextBox;
   if (selection) {
     const Timer& timer = selection->GetTimer();
-    const TextBox* left = GetThreadTrack(timer.m_TID)->GetLeft(selection);
-    if (left) {
+    Timer left;
+    if (GetThreadTrack(timer.m_TID)->GetLeft(timer, &left)) {
       SelectLeft(left);
     }
   }
@@ -866,8 +1139,8 @@ void TimeGraph::OnRight() {
   TextBox* selection = Capture::GSelectedTextBox;
   if (selection) {
     const Timer& timer = selection->GetTimer();
-    const TextBox* right = GetThreadTrack(timer.m_TID)->GetRight(selection);
-    if (right) {
+    Timer right;
+    if (GetThreadTrack(timer.m_TID)->GetRight(timer, &right)) {
       SelectRight(right);
     }
   }
@@ -879,8 +1152,8 @@ void TimeGraph::OnUp() {
   TextBox* selection = Capture::GSelectedTextBox;
   if (selection) {
     const Timer& timer = selection->GetTimer();
-    const TextBox* up = GetThreadTrack(timer.m_TID)->GetUp(selection);
-    if (up) {
+    Timer up;
+    if (GetThreadTrack(timer.m_TID)->GetUp(timer, &up)) {
       Select(up);
     }
   }
@@ -892,8 +1165,8 @@ void TimeGraph::OnDown() {
   TextBox* selection = Capture::GSelectedTextBox;
   if (selection) {
     const Timer& timer = selection->GetTimer();
-    const TextBox* down = GetThreadTrack(timer.m_TID)->GetDown(selection);
-    if (down) {
+    Timer down;
+    if (GetThreadTrack(timer.m_TID)->GetDown(timer, &down)) {
       Select(down);
     }
   }
@@ -908,65 +1181,7 @@ void TimeGraph::DrawText() {
 }
 
 //----------------------------------------------------------------------------
-void TimeGraph::DrawBuffered(bool a_Picking) {
-  glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-  glDisable(GL_CULL_FACE);
-  glEnableClientState(GL_VERTEX_ARRAY);
-  glEnableClientState(GL_COLOR_ARRAY);
-  glEnable(GL_TEXTURE_2D);
-
-  DrawBoxBuffer(a_Picking);
-  DrawLineBuffer(a_Picking);
-
-  glDisableClientState(GL_COLOR_ARRAY);
-  glDisableClientState(GL_VERTEX_ARRAY);
-  glPopAttrib();
-}
-
-//----------------------------------------------------------------------------
-void TimeGraph::DrawBoxBuffer(bool a_Picking) {
-  Block<Box, BoxBuffer::NUM_BOXES_PER_BLOCK>* boxBlock =
-      m_Batcher.GetBoxBuffer().m_Boxes.m_Root;
-  Block<Color, BoxBuffer::NUM_BOXES_PER_BLOCK * 4>* colorBlock;
-
-  colorBlock = !a_Picking ? m_Batcher.GetBoxBuffer().m_Colors.m_Root
-                          : m_Batcher.GetBoxBuffer().m_PickingColors.m_Root;
-
-  while (boxBlock) {
-    if (int numElems = boxBlock->m_Size) {
-      glVertexPointer(3, GL_FLOAT, sizeof(Vec3), boxBlock->m_Data);
-      glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Color),
-                     (void*)(colorBlock->m_Data));
-      glDrawArrays(GL_QUADS, 0, numElems * 4);
-    }
-
-    boxBlock = boxBlock->m_Next;
-    colorBlock = colorBlock->m_Next;
-  }
-}
-
-//----------------------------------------------------------------------------
-void TimeGraph::DrawLineBuffer(bool a_Picking) {
-  Block<Line, LineBuffer::NUM_LINES_PER_BLOCK>* lineBlock =
-      m_Batcher.GetLineBuffer().m_Lines.m_Root;
-  Block<Color, LineBuffer::NUM_LINES_PER_BLOCK * 2>* colorBlock;
-
-  colorBlock = !a_Picking ? m_Batcher.GetLineBuffer().m_Colors.m_Root
-                          : m_Batcher.GetLineBuffer().m_PickingColors.m_Root;
-
-  while (lineBlock) {
-    if (int numElems = lineBlock->m_Size) {
-      glVertexPointer(3, GL_FLOAT, sizeof(Vec3), lineBlock->m_Data);
-      glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Color),
-                     (void*)(colorBlock->m_Data));
-      glDrawArrays(GL_LINES, 0, numElems * 2);
-    }
-
-    lineBlock = lineBlock->m_Next;
-    colorBlock = colorBlock->m_Next;
-  }
-}
+void TimeGraph::DrawBuffered(bool a_Picking) { m_Batcher.Draw(a_Picking); }
 
 //-----------------------------------------------------------------------------
 void TimeGraph::DrawEvents(bool a_Picking) {
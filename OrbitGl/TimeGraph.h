@@ -3,11 +3,13 @@
 //-----------------------------------
 #pragma once
 
+#include <memory>
 #include <unordered_map>
 
 #include "Batcher.h"
 #include "BlockChain.h"
 #include "ContextSwitch.h"
+#include "ContextSwitchTimeline.h"
 #include "Core.h"
 #include "EventBuffer.h"
 #include "Geometry.h"
@@ -17,7 +19,11 @@
 #include "ThreadTrack.h"
 #include "ThreadTrackMap.h"
 #include "TimeGraphLayout.h"
+#include "TimerBatch.h"
+#include "TimerLabelCache.h"
+#include "WorkerPool.h"
 
+class Function;
 class Systrace;
 
 class TimeGraph {
@@ -29,8 +35,6 @@ class TimeGraph {
   void DrawMainFrame(TextBox& a_Box);
   void DrawEvents(bool a_Picking = false);
   void DrawTime();
-  void DrawLineBuffer(bool a_Picking);
-  void DrawBoxBuffer(bool a_Picking);
   void DrawBuffered(bool a_Picking);
   void DrawText();
 
@@ -38,10 +42,13 @@ class TimeGraph {
   void UpdatePrimitives(bool a_Picking);
 
   void UpdateThreadIds();
-  void UpdateEvents();
+  void UpdateEvents(bool a_Append);
   void SelectEvents(float a_WorldStart, float a_WorldEnd, ThreadID a_TID);
 
   void ProcessTimer(const Timer& a_Timer);
+  // Tracks and function stats are looked up once per thread and function
+  // of the batch instead of once per timer.
+  void ProcessTimers(const Timer* a_Timers, size_t a_NumTimers);
   void UpdateThreadDepth(int a_ThreadId, int a_Depth);
   void UpdateMaxTimeStamp(TickType a_Time);
   void AddContextSwitch();
@@ -58,6 +65,10 @@ class TimeGraph {
 
   void Clear();
   void ZoomAll();
+  // Keeps the end of the capture in view. The view only moves when the
+  // capture reaches its end, in between new timers are appended to the
+  // primitives.
+  void FollowCapture();
   void Zoom(const TextBox* a_TextBox);
   void ZoomTime(float a_ZoomValue, double a_MouseRatio);
   void SetMinMax(double a_MinTimeUs, double a_MaxTimeUs);
@@ -66,18 +77,30 @@ class TimeGraph {
   double GetTime(double a_Ratio);
   double GetTimeIntervalMicro(double a_Ratio);
   void Select(const Vec2& a_WorldStart, const Vec2 a_WorldStop);
-  void Select(const TextBox* a_TextBox) { SelectRight(a_TextBox); }
-  void SelectLeft(const TextBox* a_TextBox);
-  void SelectRight(const TextBox* a_TextBox);
+  void Select(const Timer& a_Timer) { SelectRight(a_Timer); }
+  void SelectLeft(const Timer& a_Timer);
+  void SelectRight(const Timer& a_Timer);
+  // Sets Capture::GSelectedTextBox to a copy of "a_TextBox", or to null.
+  void SetSelectedTextBox(const TextBox* a_TextBox);
   double GetSessionTimeSpanUs();
   double GetCurrentTimeSpanUs();
   void NeedsRedraw() { m_NeedsRedraw = true; }
   bool IsRedrawNeeded() const { return m_NeedsRedraw; }
-  void ToggleDrawText() { m_DrawText = !m_DrawText; }
+  // Hidden text isn't laid out, the primitives are made again when shown.
+  void ToggleDrawText() {
+    m_DrawText = !m_DrawText;
+    NeedsUpdate();
+  }
   void SetThreadFilter(const std::string& a_Filter);
 
   bool IsVisible(const Timer& a_Timer);
   int GetNumDrawnTextBoxes() { return m_NumDrawnTextBoxes; }
+  uint64_t GetNumPrimitiveRebuilds() const { return m_NumPrimitiveRebuilds; }
+  uint64_t GetNumPrimitiveAppends() const { return m_NumPrimitiveAppends; }
+  // Thread tracks make their primitives on worker threads unless disabled.
+  void SetParallelPrimitives(bool a_Parallel) {
+    m_ParallelPrimitives = a_Parallel;
+  }
   void AddContextSwitch(const ContextSwitch& a_CS);
   void SetPickingManager(class PickingManager* a_Manager) {
     m_PickingManager = a_Manager;
@@ -94,7 +117,12 @@ class TimeGraph {
   Batcher& GetBatcher() { return m_Batcher; }
   uint32_t GetNumTimers() const;
   uint32_t GetNumCores() const;
-  std::vector<std::shared_ptr<TimerChain> > GetAllTimerChains() const;
+  std::vector<std::shared_ptr<TimerColumns> > GetAllTimerColumns() const;
+  // Bytes held by the timers of all thread tracks.
+  size_t GetTimerMemoryUsage() const;
+  size_t GetContextSwitchMemoryUsage() const;
+  // Running intervals of the cores as CORE_ACTIVITY timers, for saving.
+  std::vector<Timer> GetCoreActivityTimers() const;
   double GetMarginRatio() const { return m_MarginRatio; }
 
   void OnDrag(float a_Ratio);
@@ -114,6 +142,47 @@ class TimeGraph {
   std::shared_ptr<ThreadTrack> GetThreadTrack(ThreadID a_TID);
   ThreadTrackMap GetThreadTracksCopy() const;
 
+  // Visible time range of an UpdatePrimitives() call.
+  struct PrimitivesRange {
+    TickType m_Start = 0;
+    TickType m_Stop = 0;
+    TickType m_TicksPerPixel = 0;
+    double m_InvTimeWindow = 0;
+  };
+  // Primitives of a thread track, made on a worker thread. Labels and thread
+  // depths are applied by the calling thread.
+  struct TrackPrimitives {
+    BatchSegment m_Batch;
+    // Text boxes of the drawn timers, which the batcher's user data points
+    // to. Timers don't have text boxes of their own, positions and labels
+    // are computed for the visible ones.
+    BlockChain<TextBox, 256> m_TextBoxes;
+    std::vector<const TextBox*> m_Labels;
+    // Labels that aren't cached, such as ones with extra info.
+    TextArena m_TextArena;
+    TimerLabelCache* m_LabelCache = nullptr;
+    std::map<ThreadID, int> m_ThreadDepths;
+    // Timers of each depth that primitives were made for.
+    std::unordered_map<const TimerColumns*, size_t> m_NumTimersWithPrimitives;
+    // Last running interval of each core that primitives were made for.
+    struct CoreState {
+      bool m_HasInterval = false;
+      TickType m_LastStart = 0;
+      TickType m_LastEnd = 0;
+      // Intervals of at most a pixel starting before are skipped.
+      TickType m_NextLineTick = 0;
+    };
+    std::map<uint16_t, CoreState> m_Cores;
+  };
+  void UpdateTrackPrimitives(ThreadTrack& a_Track,
+                             const PrimitivesRange& a_Range,
+                             TrackPrimitives* a_Primitives);
+  void AddTimerPrimitives(const Timer& a_Timer, const PrimitivesRange& a_Range,
+                          TrackPrimitives* a_Primitives);
+  void UpdateCorePrimitives(const PrimitivesRange& a_Range,
+                            TrackPrimitives* a_Primitives);
+  void AddCoreActivity(const Timer& a_Timer);
+
  private:
   TextRenderer m_TextRendererStatic;
   TextRenderer* m_TextRenderer = nullptr;
@@ -142,18 +211,58 @@ class TimeGraph {
   std::map<ThreadID, class EventTrack*>
       m_EventTracks;  // TODO: put in ThreadTrack
 
-  std::map<DWORD /*ThreadId*/, std::map<long long, ContextSwitch> >
-      m_ContextSwitchesMap;
-  std::map<DWORD /*CoreId*/, std::map<long long, ContextSwitch> >
-      m_CoreUtilizationMap;
+  // Context switches by core and by thread, and the running intervals the
+  // core tracks are drawn from. Guarded by m_Mutex.
+  ContextSwitchTimeline m_ContextSwitches;
 
   std::map<ThreadID, uint32_t> m_ThreadCountMap;
 
+  // Reused by ProcessTimers.
+  TimerBatch m_TimerBatch;
+  std::vector<Function*> m_BatchFunctions;
+
   std::vector<CallstackEvent> m_SelectedCallstackEvents;
   bool m_NeedsUpdatePrimitives = false;
+  bool m_NeedsAppendPrimitives = false;
   bool m_DrawText = true;
   bool m_NeedsRedraw = false;
-  std::vector<TextBox*> m_VisibleTextBoxes;
+  std::unordered_map<ThreadID, std::unique_ptr<TrackPrimitives>>
+      m_TrackPrimitives;
+  std::unique_ptr<TrackPrimitives> m_CorePrimitives;
+  // Labels of each thread track, kept over updates.
+  std::unordered_map<ThreadID, std::unique_ptr<TimerLabelCache>>
+      m_LabelCaches;
+  WorkerPool m_WorkerPool;
+  bool m_ParallelPrimitives = true;
+
+  // What the primitives depend on besides timers and settings, whose
+  // changes call NeedsUpdate().
+  struct PrimitivesView {
+    double m_MinTimeUs = 0;
+    double m_MaxTimeUs = 0;
+    TickType m_SessionMinCounter = 0;
+    float m_WorldStartX = 0;
+    float m_WorldWidth = 0;
+    int m_Width = 0;
+    std::map<ThreadID, float> m_ThreadBlockOffsets;
+
+    bool operator==(const PrimitivesView& a_Other) const {
+      return m_MinTimeUs == a_Other.m_MinTimeUs &&
+             m_MaxTimeUs == a_Other.m_MaxTimeUs &&
+             m_SessionMinCounter == a_Other.m_SessionMinCounter &&
+             m_WorldStartX == a_Other.m_WorldStartX &&
+             m_WorldWidth == a_Other.m_WorldWidth &&
+             m_Width == a_Other.m_Width &&
+             m_ThreadBlockOffsets == a_Other.m_ThreadBlockOffsets;
+    }
+  };
+  PrimitivesView m_PrimitivesView;
+  bool m_PrimitivesPicking = false;
+  TickType m_LastEventTick = 0;
+  uint64_t m_NumPrimitiveRebuilds = 0;
+  uint64_t m_NumPrimitiveAppends = 0;
+  // Copy of the selected text box, which outlives m_TrackPrimitives.
+  TextBox m_SelectedTextBox;
   Batcher m_Batcher;
   PickingManager* m_PickingManager = nullptr;
   Timer m_LastThreadReorder;
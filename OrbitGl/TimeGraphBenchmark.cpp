@@ -0,0 +1,76 @@
+// Timing runs of the time graph, kept out of OrbitGlTests.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "Capture.h"
+#include "OrbitProcess.h"
+#include "TimeGraph.h"
+#include "TimerManager.h"
+
+namespace {
+
+// Timers of a few threads interleaved, as received during a capture.
+std::vector<Timer> CreateTimers(size_t num_timers, size_t num_threads) {
+  std::mt19937_64 random(17);
+  std::vector<Timer> timers(num_timers);
+  for (size_t i = 0; i < num_timers; ++i) {
+    Timer& timer = timers[i];
+    timer.m_TID = 1000 + static_cast<uint32_t>(random() % num_threads);
+    timer.m_Depth = static_cast<uint8_t>(random() % 8);
+    timer.m_Start = 1000000 + i * 100;
+    timer.m_End = timer.m_Start + 1 + random() % 99;
+    timer.m_FunctionAddress = 0x400000 + (random() % 500) * 0x40;
+    timer.m_CallstackHash = random() % 1000;
+  }
+  return timers;
+}
+
+double GetMilliseconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+}  // namespace
+
+// The capture window gets the timers dequeued together, which
+// TimeGraph::ProcessTimers takes as one batch, where it took them one by
+// one before.
+TEST(TimeGraph, BatchedIngestionAgainstPerTimer) {
+  const size_t kNumTimers = 2000000;
+  std::vector<Timer> timers = CreateTimers(kNumTimers, 32);
+  std::shared_ptr<Process> targetProcess = Capture::GTargetProcess;
+  Capture::GTargetProcess = std::make_shared<Process>();
+
+  TimeGraph per_timer;
+  auto start = std::chrono::steady_clock::now();
+  for (const Timer& timer : timers) per_timer.ProcessTimer(timer);
+  double per_timer_ms = GetMilliseconds(start);
+
+  TimeGraph batched;
+  start = std::chrono::steady_clock::now();
+  for (size_t begin = 0; begin < kNumTimers;
+       begin += TimerManager::kMaxConsumedTimers) {
+    size_t count =
+        std::min(TimerManager::kMaxConsumedTimers, kNumTimers - begin);
+    batched.ProcessTimers(timers.data() + begin, count);
+  }
+  double batched_ms = GetMilliseconds(start);
+
+  EXPECT_EQ(per_timer.GetNumTimers(), kNumTimers);
+  EXPECT_EQ(batched.GetNumTimers(), kNumTimers);
+  Capture::GTargetProcess = targetProcess;
+
+  std::cout << "Per timer: " << kNumTimers / per_timer_ms * 1000
+            << " timers/s" << std::endl
+            << "Batched: " << kNumTimers / batched_ms * 1000 << " timers/s"
+            << std::endl;
+}
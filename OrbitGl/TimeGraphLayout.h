@@ -39,6 +39,9 @@ class TimeGraphLayout {
   }
 
   void SetNumCores(int a_NumCores) { m_NumCores = a_NumCores; }
+  const std::map<ThreadID, float>& GetThreadBlockOffsets() const {
+    return m_ThreadBlockOffsets;
+  }
 
  protected:
   void SortTracksByPosition(const ThreadTrackMap& a_ThreadTracks);
@@ -0,0 +1,216 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "Batcher.h"
+#include "GlCanvas.h"
+#include "TextBox.h"
+#include "TextRenderer.h"
+#include "TimeGraph.h"
+
+namespace {
+
+// Nested timers of a few threads, some too short to be drawn as boxes.
+std::vector<Timer> CreateTimers() {
+  const uint32_t kNumThreads = 12;
+  const uint64_t kNumCalls = 500;
+  std::vector<Timer> timers;
+  for (uint64_t call = 0; call < kNumCalls; ++call) {
+    for (uint32_t thread = 0; thread < kNumThreads; ++thread) {
+      TickType start = 1000000 + call * 1000 + thread;
+      TickType duration = call % 7 == 0 ? 900 : 1 + call % 5;
+      for (uint8_t depth = 0; depth < 1 + thread % 4; ++depth) {
+        Timer timer;
+        timer.m_TID = 100 + thread;
+        timer.m_Depth = depth;
+        timer.m_Start = start + 10 * depth;
+        timer.m_End = timer.m_Start + duration;
+        timers.push_back(timer);
+      }
+    }
+  }
+  return timers;
+}
+
+// A primitive of the batcher, with the timer its text box was made for.
+struct DrawnTimer {
+  std::vector<Vec3> vertices;
+  std::vector<Color> colors;
+  TickType start;
+  TickType end;
+  ThreadID thread_id;
+  uint8_t depth;
+
+  bool operator==(const DrawnTimer& other) const {
+    return std::tie(vertices, colors, start, end, thread_id, depth) ==
+           std::tie(other.vertices, other.colors, other.start, other.end,
+                    other.thread_id, other.depth);
+  }
+};
+
+template <class T, uint32_t BlockSize>
+std::vector<T> ToVector(BlockChain<T, BlockSize>* chain) {
+  std::vector<T> values;
+  for (const T& value : *chain) values.push_back(value);
+  return values;
+}
+
+DrawnTimer MakeDrawnTimer(std::vector<Vec3> vertices,
+                          std::vector<Color> colors, void* user_data) {
+  const Timer& timer = static_cast<const TextBox*>(user_data)->GetTimer();
+  return {std::move(vertices), std::move(colors), timer.m_Start,
+          timer.m_End,         timer.m_TID,       timer.m_Depth};
+}
+
+// Boxes, then lines, in the order of the batcher.
+std::vector<DrawnTimer> GetDrawnTimers(Batcher* batcher) {
+  std::vector<DrawnTimer> drawn;
+  BoxBuffer& box_buffer = batcher->GetBoxBuffer();
+  std::vector<BoxInstance> boxes = ToVector(&box_buffer.m_Boxes);
+  std::vector<void*> box_user_data = ToVector(&box_buffer.m_UserData);
+  EXPECT_EQ(boxes.size(), box_user_data.size());
+  for (size_t i = 0; i < boxes.size(); ++i) {
+    Box box = boxes[i].GetBox();
+    const Color* colors = box_buffer.GetColors(boxes[i]);
+    drawn.push_back(MakeDrawnTimer({box.m_Vertices, box.m_Vertices + 4},
+                                   {colors, colors + 4}, box_user_data[i]));
+  }
+
+  LineBuffer& line_buffer = batcher->GetLineBuffer();
+  std::vector<Line> lines = ToVector(&line_buffer.m_Lines);
+  std::vector<Color> line_colors = ToVector(&line_buffer.m_Colors);
+  std::vector<void*> line_user_data = ToVector(&line_buffer.m_UserData);
+  EXPECT_EQ(lines.size(), line_user_data.size());
+  for (size_t i = 0; i < lines.size(); ++i) {
+    drawn.push_back(
+        MakeDrawnTimer({lines[i].m_Beg, lines[i].m_End},
+                       {line_colors[2 * i], line_colors[2 * i + 1]},
+                       line_user_data[i]));
+  }
+  return drawn;
+}
+
+// The primitives of the batcher by timer, as their order depends on when
+// the timers were added.
+std::vector<DrawnTimer> GetSortedDrawnTimers(Batcher* batcher) {
+  std::vector<DrawnTimer> drawn = GetDrawnTimers(batcher);
+  std::sort(drawn.begin(), drawn.end(),
+            [](const DrawnTimer& lhs, const DrawnTimer& rhs) {
+              return std::tie(lhs.thread_id, lhs.depth, lhs.start, lhs.end) <
+                     std::tie(rhs.thread_id, rhs.depth, rhs.start, rhs.end);
+            });
+  return drawn;
+}
+
+}  // namespace
+
+// The tracks making their primitives on worker threads fill the batcher as
+// when they make them one after the other.
+TEST(TimeGraph, ParallelPrimitivesMatchSerialOutput) {
+  GlCanvas canvas;
+  canvas.Resize(2000, 1000);
+  TextRenderer text_renderer;
+  TimeGraph time_graph;
+  time_graph.SetTextRenderer(&text_renderer);
+  time_graph.SetCanvas(&canvas);
+  // Laying out text needs a GL context, only the batcher is compared.
+  time_graph.ToggleDrawText();
+  std::vector<Timer> timers = CreateTimers();
+  time_graph.ProcessTimers(timers.data(), timers.size());
+
+  time_graph.SetParallelPrimitives(false);
+  time_graph.ZoomAll();
+  double min_time_us = time_graph.GetMinTimeUs();
+  double max_time_us = time_graph.GetMaxTimeUs();
+  double span_us = max_time_us - min_time_us;
+
+  // The whole capture, and a fiftieth of it.
+  for (double zoom : {1.0, 50.0}) {
+    time_graph.SetMinMax(max_time_us - span_us / zoom, max_time_us);
+    time_graph.SetParallelPrimitives(false);
+    time_graph.UpdatePrimitives(false);
+    std::vector<DrawnTimer> serial =
+        GetDrawnTimers(&time_graph.GetBatcher());
+    EXPECT_GT(time_graph.GetBatcher().GetBoxBuffer().m_Boxes.size(), 0);
+
+    time_graph.SetParallelPrimitives(true);
+    time_graph.NeedsUpdate();
+    time_graph.UpdatePrimitives(false);
+    std::vector<DrawnTimer> parallel =
+        GetDrawnTimers(&time_graph.GetBatcher());
+    ASSERT_EQ(parallel.size(), serial.size());
+    EXPECT_TRUE(parallel == serial);
+  }
+  EXPECT_EQ(time_graph.GetNumPrimitiveAppends(), 0);
+}
+
+// New timers are appended to the primitives while the view doesn't change,
+// which draws what a full update draws.
+TEST(TimeGraph, AppendedPrimitivesMatchFullUpdate) {
+  GlCanvas canvas;
+  canvas.Resize(2000, 1000);
+  TextRenderer text_renderer;
+  TimeGraph time_graph;
+  time_graph.SetTextRenderer(&text_renderer);
+  time_graph.SetCanvas(&canvas);
+  time_graph.ToggleDrawText();
+
+  // The second half of the timers comes later. A timer of another thread
+  // spans all of them, so that the view covers them from the start.
+  std::vector<Timer> timers = CreateTimers();
+  size_t half = timers.size() / 2;
+  std::vector<Timer> first_timers(timers.begin(), timers.begin() + half);
+  Timer frame;
+  frame.m_TID = 99;
+  frame.m_Start = timers.front().m_Start;
+  frame.m_End = timers.back().m_End;
+  first_timers.push_back(frame);
+  time_graph.ProcessTimers(first_timers.data(), first_timers.size());
+
+  time_graph.ZoomAll();
+  EXPECT_EQ(time_graph.GetNumPrimitiveRebuilds(), 1);
+  EXPECT_EQ(time_graph.GetNumPrimitiveAppends(), 0);
+  size_t num_first_drawn = GetDrawnTimers(&time_graph.GetBatcher()).size();
+  EXPECT_GT(num_first_drawn, 0);
+
+  time_graph.ProcessTimers(timers.data() + half, timers.size() - half);
+  time_graph.UpdatePrimitives(false);
+  EXPECT_EQ(time_graph.GetNumPrimitiveRebuilds(), 1);
+  EXPECT_EQ(time_graph.GetNumPrimitiveAppends(), 1);
+  std::vector<DrawnTimer> appended =
+      GetSortedDrawnTimers(&time_graph.GetBatcher());
+  EXPECT_GT(appended.size(), num_first_drawn);
+
+  time_graph.NeedsUpdate();
+  time_graph.UpdatePrimitives(false);
+  EXPECT_EQ(time_graph.GetNumPrimitiveRebuilds(), 2);
+  std::vector<DrawnTimer> rebuilt =
+      GetSortedDrawnTimers(&time_graph.GetBatcher());
+  ASSERT_EQ(appended.size(), rebuilt.size());
+  EXPECT_TRUE(appended == rebuilt);
+
+  // Nothing changed, there is nothing to append.
+  time_graph.UpdatePrimitives(false);
+  EXPECT_EQ(time_graph.GetNumPrimitiveRebuilds(), 2);
+  EXPECT_EQ(time_graph.GetNumPrimitiveAppends(), 2);
+  EXPECT_EQ(GetDrawnTimers(&time_graph.GetBatcher()).size(), rebuilt.size());
+
+  // The time graph isn't told about the canvas resize, it sees that the
+  // view changed and draws everything again.
+  canvas.Resize(1000, 1000);
+  time_graph.UpdatePrimitives(false);
+  EXPECT_EQ(time_graph.GetNumPrimitiveRebuilds(), 3);
+  EXPECT_EQ(time_graph.GetNumPrimitiveAppends(), 2);
+
+  // So are the primitives for picking, and the ones after them.
+  time_graph.UpdatePrimitives(true);
+  EXPECT_EQ(time_graph.GetNumPrimitiveRebuilds(), 4);
+  time_graph.UpdatePrimitives(false);
+  EXPECT_EQ(time_graph.GetNumPrimitiveRebuilds(), 5);
+  time_graph.UpdatePrimitives(false);
+  EXPECT_EQ(time_graph.GetNumPrimitiveRebuilds(), 5);
+  EXPECT_EQ(time_graph.GetNumPrimitiveAppends(), 3);
+}
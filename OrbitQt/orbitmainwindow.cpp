@@ -128,6 +128,7 @@ OrbitMainWindow::OrbitMainWindow(QApplication* a_App, QWidget* parent)
 
   CreateSamplingTab();
   CreateSelectionTab();
+  CreateFlameGraphTab();
   CreatePluginTabs();
 
   this->setWindowTitle("Orbit Profiler");
@@ -274,6 +275,19 @@ void OrbitMainWindow::CreateSamplingTab() {
   ui->RightTabWidget->addTab(m_SamplingTab, QString("sampling"));
 }
 
+//-----------------------------------------------------------------------------
+void OrbitMainWindow::CreateFlameGraphTab() {
+  QWidget* widget = new QWidget();
+  QGridLayout* layout = new QGridLayout(widget);
+  layout->setSpacing(6);
+  layout->setContentsMargins(11, 11, 11, 11);
+  OrbitGLWidget* glWidget = new OrbitGLWidget(widget);
+  layout->addWidget(glWidget, 0, 0, 1, 1);
+  ui->RightTabWidget->addTab(widget, QString("flame graph"));
+
+  glWidget->Initialize(GlPanel::FLAME_GRAPH, this);
+}
+
 //-----------------------------------------------------------------------------
 void OrbitMainWindow::CreatePluginTabs() {
   for (Orbit::Plugin* plugin : GPluginManager.m_Plugins) {
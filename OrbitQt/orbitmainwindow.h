@@ -30,6 +30,7 @@ class OrbitMainWindow : public QMainWindow {
       std::shared_ptr<class SamplingReport> a_SamplingReport);
   void CreateSamplingTab();
   void CreateSelectionTab();
+  void CreateFlameGraphTab();
   void CreatePluginTabs();
   void OnNewSelection(std::shared_ptr<class SamplingReport> a_SamplingReport);
   void OnReceiveMessage(const std::wstring& a_Message);